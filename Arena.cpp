@@ -0,0 +1,20 @@
+// Arena.cpp
+#include "Arena.h"
+
+Arena::Arena(size_t firstChunkSize) : nextChunkSize_(firstChunkSize) {
+}
+
+char* Arena::grow(size_t size, size_t alignment) {
+    // Chunks double up to kMaxChunkSize; a larger request gets a chunk of its own size.
+    size_t chunkSize = nextChunkSize_;
+    if (chunkSize < size + alignment) chunkSize = size + alignment;
+    if (nextChunkSize_ < kMaxChunkSize) nextChunkSize_ *= 2;
+
+    chunks_.emplace_back(new char[chunkSize]);
+    bytesReserved_ += chunkSize;
+    next_ = chunks_.back().get();
+    end_ = next_ + chunkSize;
+
+    uintptr_t at = (reinterpret_cast<uintptr_t>(next_) + (alignment - 1)) & ~static_cast<uintptr_t>(alignment - 1);
+    return reinterpret_cast<char*>(at);
+}
@@ -0,0 +1,72 @@
+// Arena.h
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Arena: A bump allocator with chunked growth.
+// Objects are carved out of large chunks and are never freed one by one;
+// destroying the Arena releases every chunk at once, in O(chunks), without
+// running destructors. Only put objects here that own no other resources
+// (AST nodes hold raw pointers into the same Arena and views into the source).
+class Arena {
+public:
+    explicit Arena(size_t firstChunkSize = 64 * 1024);
+
+    Arena(Arena&&) noexcept = default;
+    Arena& operator=(Arena&&) noexcept = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        uintptr_t at = (reinterpret_cast<uintptr_t>(next_) + (alignment - 1)) & ~static_cast<uintptr_t>(alignment - 1);
+        if (at + size > reinterpret_cast<uintptr_t>(end_)) {
+            at = reinterpret_cast<uintptr_t>(grow(size, alignment));
+        }
+        next_ = reinterpret_cast<char*>(at + size);
+        ++allocationCount_;
+        bytesUsed_ += size;
+        return reinterpret_cast<void*>(at);
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copies `count` trivially copyable elements into the Arena.
+    template <typename T>
+    T* copyArray(const T* items, size_t count) {
+        if (count == 0) return nullptr;
+        T* out = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        std::memcpy(out, items, sizeof(T) * count);
+        return out;
+    }
+
+    // --- Statistics ---
+    size_t allocationCount() const { return allocationCount_; }
+    size_t bytesUsed() const { return bytesUsed_; }          // Requested bytes, without padding
+    size_t bytesReserved() const { return bytesReserved_; }  // Sum of all chunk sizes
+    size_t chunkCount() const { return chunks_.size(); }
+
+private:
+    static const size_t kMaxChunkSize = 4 * 1024 * 1024;
+
+    char* grow(size_t size, size_t alignment); // Starts a new chunk; returns aligned space for `size`
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char* next_ = nullptr;
+    char* end_ = nullptr;
+    size_t nextChunkSize_;
+    size_t allocationCount_ = 0;
+    size_t bytesUsed_ = 0;
+    size_t bytesReserved_ = 0;
+};
+
+#endif // ARENA_H
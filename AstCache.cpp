@@ -0,0 +1,801 @@
+// AstCache.cpp
+#include "AstCache.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = { 'A', 'D', 'D', 'D', 'A', 'S', 'T', '\0' };
+const uint32_t kFormatVersion = 1;
+const uint32_t kByteOrderMark = 0x01020304; // Reads differently on a machine of the other byte order
+constexpr uint32_t kTokenTypeCount = static_cast<uint32_t>(TokenType::END_OF_FILE) + 1;
+#define AST_CACHE_COUNT_KIND(Name) + 1
+constexpr uint32_t kNodeKindCount = 0 AST_NODE_LIST(AST_CACHE_COUNT_KIND);
+#undef AST_CACHE_COUNT_KIND
+const uint8_t kNullRecord = 0xFF; // An absent optional child
+
+// Entry layout: EntryHeader, then the payload:
+//   uint32 offsets[tokenCount], lengths[tokenCount], payloads[tokenCount]
+//   uint8  types[tokenCount]
+//   LiteralRecord literals[literalCount]
+//   char   strings[stringBytes]   (string literals whose bytes are not in the source)
+//   char   nodes[nodeBytes]       (postorder node records)
+struct EntryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t tokenTypeCount;
+    uint32_t nodeKindCount;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t tokenCount;
+    uint64_t literalCount;
+    uint64_t stringBytes;
+    uint64_t nodeBytes;
+    uint64_t payloadHash;
+};
+static_assert(sizeof(EntryHeader) == 80, "EntryHeader is written as is");
+
+struct LiteralRecord {
+    uint8_t kind;      // LiteralValue::Kind
+    uint8_t inSource;  // String bytes are at `bits` in the source rather than in the string table
+    uint8_t unused[2];
+    uint32_t length;   // String length
+    uint64_t bits;     // The value's bytes (integer, float, double or char), or the string position
+};
+static_assert(sizeof(LiteralRecord) == 16, "LiteralRecord is written as is");
+
+uint64_t load64(const unsigned char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+bool isExpressionKind(NodeKind kind) {
+    switch (kind) {
+    case NodeKind::BinaryExpression:
+    case NodeKind::UnaryExpression:
+    case NodeKind::Identifier:
+    case NodeKind::ArrayIndex:
+    case NodeKind::Call:
+    case NodeKind::IntegerLiteral:
+    case NodeKind::FloatLiteral:
+    case NodeKind::CharLiteral:
+    case NodeKind::StringLiteral:
+    case NodeKind::ErrorExpression:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isStatementKind(NodeKind kind) {
+    switch (kind) {
+    case NodeKind::VariableDeclaration:
+    case NodeKind::ArrayDeclaration:
+    case NodeKind::Assignment:
+    case NodeKind::ExpressionStatement:
+    case NodeKind::IncrementStatement:
+    case NodeKind::IfStatement:
+    case NodeKind::WhileStatement:
+    case NodeKind::ForStatement:
+    case NodeKind::ScanfStatement:
+    case NodeKind::PrintfStatement:
+    case NodeKind::ReturnStatement:
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <typename T>
+bool hasKind(const AstNode* node) {
+    if constexpr (std::is_same_v<T, ExpressionNode>) return isExpressionKind(node->kind);
+    else if constexpr (std::is_same_v<T, StatementNode>) return isStatementKind(node->kind);
+    else if constexpr (std::is_same_v<T, ParameterNode>) return node->kind == NodeKind::Parameter;
+    else return node->kind == NodeKind::FunctionDefinition;
+}
+
+// --- Writing ---
+
+class EntryWriter {
+public:
+    std::vector<char> bytes;
+
+    template <typename T>
+    void put(T value) {
+        size_t at = bytes.size();
+        bytes.resize(at + sizeof(T));
+        std::memcpy(bytes.data() + at, &value, sizeof(T));
+    }
+
+    void writeNodes(const ProgramNode* program);
+
+private:
+    void record(const AstNode* node);
+    static void appendChildren(const AstNode* node, std::vector<const AstNode*>& out);
+
+    template <typename T>
+    static void appendAll(const NodeList<T>& nodes, std::vector<const AstNode*>& out) {
+        for (const T* node : nodes) out.push_back(node);
+    }
+};
+
+// A node's children in the order its record expects them, absent ones as nullptr.
+void EntryWriter::appendChildren(const AstNode* node, std::vector<const AstNode*>& out) {
+    switch (node->kind) {
+    case NodeKind::IntegerLiteral:
+    case NodeKind::FloatLiteral:
+    case NodeKind::CharLiteral:
+    case NodeKind::StringLiteral:
+    case NodeKind::ErrorExpression:
+    case NodeKind::Identifier:
+    case NodeKind::IncrementStatement:
+    case NodeKind::Parameter:
+        break;
+    case NodeKind::ArrayIndex: out.push_back(static_cast<const ArrayIndexNode*>(node)->index); break;
+    case NodeKind::Call: appendAll(static_cast<const CallNode*>(node)->arguments, out); break;
+    case NodeKind::BinaryExpression: {
+        auto binary = static_cast<const BinaryExpressionNode*>(node);
+        out.push_back(binary->left);
+        out.push_back(binary->right);
+        break;
+    }
+    case NodeKind::UnaryExpression: out.push_back(static_cast<const UnaryExpressionNode*>(node)->operand); break;
+    case NodeKind::VariableDeclaration: out.push_back(static_cast<const VariableDeclarationNode*>(node)->initializer); break;
+    case NodeKind::ArrayDeclaration: appendAll(static_cast<const ArrayDeclarationNode*>(node)->elements, out); break;
+    case NodeKind::Assignment: {
+        auto assignment = static_cast<const AssignmentNode*>(node);
+        out.push_back(assignment->target);
+        out.push_back(assignment->value);
+        break;
+    }
+    case NodeKind::ExpressionStatement: out.push_back(static_cast<const ExpressionStatementNode*>(node)->expression); break;
+    case NodeKind::IfStatement: {
+        auto statement = static_cast<const IfStatementNode*>(node);
+        out.push_back(statement->condition);
+        appendAll(statement->thenBody, out);
+        appendAll(statement->elseBody, out);
+        break;
+    }
+    case NodeKind::WhileStatement: {
+        auto statement = static_cast<const WhileStatementNode*>(node);
+        out.push_back(statement->condition);
+        appendAll(statement->body, out);
+        break;
+    }
+    case NodeKind::ForStatement: {
+        auto statement = static_cast<const ForStatementNode*>(node);
+        out.push_back(statement->init);
+        out.push_back(statement->condition);
+        out.push_back(statement->update);
+        appendAll(statement->body, out);
+        break;
+    }
+    case NodeKind::ScanfStatement: out.push_back(static_cast<const ScanfStatementNode*>(node)->target); break;
+    case NodeKind::PrintfStatement: out.push_back(static_cast<const PrintfStatementNode*>(node)->argument); break;
+    case NodeKind::ReturnStatement: out.push_back(static_cast<const ReturnStatementNode*>(node)->returnValue); break;
+    case NodeKind::FunctionDefinition: {
+        auto function = static_cast<const FunctionDefinitionNode*>(node);
+        appendAll(function->parameters, out);
+        appendAll(function->body, out);
+        break;
+    }
+    case NodeKind::Program: {
+        auto program = static_cast<const ProgramNode*>(node);
+        appendAll(program->globals, out);
+        appendAll(program->functions, out);
+        break;
+    }
+    }
+}
+
+// The kind byte and the node's own fields; list lengths tell the loader how
+// many of the preceding records are children.
+void EntryWriter::record(const AstNode* node) {
+    put(static_cast<uint8_t>(node->kind));
+    switch (node->kind) {
+    case NodeKind::IntegerLiteral: put(static_cast<const IntegerLiteralNode*>(node)->token); break;
+    case NodeKind::FloatLiteral: put(static_cast<const FloatLiteralNode*>(node)->token); break;
+    case NodeKind::CharLiteral: put(static_cast<const CharLiteralNode*>(node)->token); break;
+    case NodeKind::StringLiteral: put(static_cast<const StringLiteralNode*>(node)->token); break;
+    case NodeKind::ErrorExpression: put(static_cast<const ErrorExpressionNode*>(node)->token); break;
+    case NodeKind::Identifier: put(static_cast<const IdentifierNode*>(node)->nameToken); break;
+    case NodeKind::ArrayIndex: put(static_cast<const ArrayIndexNode*>(node)->nameToken); break;
+    case NodeKind::Call: {
+        auto call = static_cast<const CallNode*>(node);
+        put(call->nameToken);
+        put(call->arguments.count);
+        break;
+    }
+    case NodeKind::BinaryExpression: {
+        auto binary = static_cast<const BinaryExpressionNode*>(node);
+        put(static_cast<uint8_t>(binary->op));
+        put(binary->opToken);
+        break;
+    }
+    case NodeKind::UnaryExpression: {
+        auto unary = static_cast<const UnaryExpressionNode*>(node);
+        put(static_cast<uint8_t>(unary->op));
+        put(unary->opToken);
+        break;
+    }
+    case NodeKind::VariableDeclaration: {
+        auto declaration = static_cast<const VariableDeclarationNode*>(node);
+        put(declaration->typeToken);
+        put(declaration->nameToken);
+        break;
+    }
+    case NodeKind::ArrayDeclaration: {
+        auto declaration = static_cast<const ArrayDeclarationNode*>(node);
+        put(declaration->typeToken);
+        put(declaration->nameToken);
+        put(declaration->sizeToken);
+        put(declaration->elements.count);
+        break;
+    }
+    case NodeKind::Assignment:
+    case NodeKind::ExpressionStatement:
+        break;
+    case NodeKind::IncrementStatement: {
+        auto statement = static_cast<const IncrementStatementNode*>(node);
+        put(statement->nameToken);
+        put(statement->opToken);
+        put(static_cast<uint8_t>((statement->isIncrement ? 1 : 0) | (statement->isPrefix ? 2 : 0)));
+        break;
+    }
+    case NodeKind::IfStatement: {
+        auto statement = static_cast<const IfStatementNode*>(node);
+        put(statement->keywordToken);
+        put(statement->elseToken);
+        put(statement->thenBody.count);
+        put(statement->elseBody.count);
+        break;
+    }
+    case NodeKind::WhileStatement: {
+        auto statement = static_cast<const WhileStatementNode*>(node);
+        put(statement->keywordToken);
+        put(statement->body.count);
+        break;
+    }
+    case NodeKind::ForStatement: {
+        auto statement = static_cast<const ForStatementNode*>(node);
+        put(statement->keywordToken);
+        put(statement->body.count);
+        break;
+    }
+    case NodeKind::ScanfStatement: {
+        auto statement = static_cast<const ScanfStatementNode*>(node);
+        put(statement->keywordToken);
+        put(statement->formatToken);
+        break;
+    }
+    case NodeKind::PrintfStatement: {
+        auto statement = static_cast<const PrintfStatementNode*>(node);
+        put(statement->keywordToken);
+        put(statement->formatToken);
+        break;
+    }
+    case NodeKind::ReturnStatement: put(static_cast<const ReturnStatementNode*>(node)->keywordToken); break;
+    case NodeKind::Parameter: {
+        auto parameter = static_cast<const ParameterNode*>(node);
+        put(parameter->typeToken);
+        put(parameter->nameToken);
+        break;
+    }
+    case NodeKind::FunctionDefinition: {
+        auto function = static_cast<const FunctionDefinitionNode*>(node);
+        put(function->returnTypeToken);
+        put(function->identifierToken);
+        put(function->parameters.count);
+        put(function->body.count);
+        break;
+    }
+    case NodeKind::Program: {
+        auto program = static_cast<const ProgramNode*>(node);
+        put(program->globals.count);
+        put(program->functions.count);
+        break;
+    }
+    }
+}
+
+void EntryWriter::writeNodes(const ProgramNode* program) {
+    // Postorder with an explicit stack: a node is written once all its children are.
+    struct Pending {
+        const AstNode* node;
+        bool childrenDone;
+    };
+    std::vector<Pending> stack{ Pending{ program, false } };
+    std::vector<const AstNode*> children;
+    while (!stack.empty()) {
+        Pending item = stack.back();
+        stack.pop_back();
+        if (!item.node) {
+            put(kNullRecord);
+        }
+        else if (item.childrenDone) {
+            record(item.node);
+        }
+        else {
+            stack.push_back(Pending{ item.node, true });
+            children.clear();
+            appendChildren(item.node, children);
+            for (size_t i = children.size(); i-- > 0;) stack.push_back(Pending{ children[i], false });
+        }
+    }
+}
+
+// --- Reading ---
+
+// Decodes the postorder node records into `arena`. Every read is bounds-checked;
+// the first inconsistency sets ok to false and the result is discarded.
+class NodeReader {
+public:
+    NodeReader(const char* data, size_t size, const TokenBuffer& tokens, Arena& arena)
+        : at_(data), end_(data + size), tokens_(tokens), arena_(arena) {}
+
+    ProgramNode* read();
+
+private:
+    const char* at_;
+    const char* end_;
+    const TokenBuffer& tokens_;
+    Arena& arena_;
+    bool ok_ = true;
+    std::vector<AstNode*> stack_; // Nodes that do not have a parent yet
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (static_cast<size_t>(end_ - at_) < sizeof(T)) {
+            ok_ = false;
+            return value;
+        }
+        std::memcpy(&value, at_, sizeof(T));
+        at_ += sizeof(T);
+        return value;
+    }
+    TokenIndex token() {
+        TokenIndex index = get<TokenIndex>();
+        if (index >= tokens_.size()) ok_ = false;
+        return index;
+    }
+    TokenIndex optionalToken() {
+        TokenIndex index = get<TokenIndex>();
+        if (index != kNoToken && index >= tokens_.size()) ok_ = false;
+        return index;
+    }
+    // A token whose decoded value is read through the node, so it must be of this kind.
+    TokenIndex literalToken(LiteralValue::Kind kind) {
+        TokenIndex index = token();
+        if (ok_) {
+            LiteralValue::Kind actual = tokens_.literal(index).kind;
+            bool isFloat = kind == LiteralValue::Kind::Float && actual == LiteralValue::Kind::Double;
+            if (actual != kind && !isFloat) ok_ = false;
+        }
+        return index;
+    }
+    template <typename E>
+    E op(uint8_t count) {
+        uint8_t value = get<uint8_t>();
+        if (value >= count) ok_ = false;
+        return static_cast<E>(value);
+    }
+
+    // The last `count` parentless nodes become children of the next node. They
+    // are consumed left to right and popped by finish().
+    AstNode** children_ = nullptr;
+    size_t childCount_ = 0;
+    size_t nextChild_ = 0;
+    bool takeChildren(uint64_t count) {
+        if (!ok_ || count > stack_.size()) return ok_ = false;
+        childCount_ = static_cast<size_t>(count);
+        children_ = stack_.data() + stack_.size() - childCount_;
+        nextChild_ = 0;
+        return true;
+    }
+    template <typename T>
+    T* child(bool optional = false) {
+        AstNode* node = children_[nextChild_++];
+        if (!node ? !optional : !hasKind<T>(node)) ok_ = false;
+        return static_cast<T*>(node);
+    }
+    template <typename T>
+    NodeList<T> list(uint32_t count) {
+        NodeList<T> nodes;
+        if (count == 0) return nodes;
+        nodes.items = static_cast<T**>(arena_.allocate(sizeof(T*) * count, alignof(T*)));
+        nodes.count = count;
+        for (uint32_t i = 0; i < count; ++i) nodes.items[i] = child<T>();
+        return nodes;
+    }
+    void finish(AstNode* node) {
+        stack_.resize(stack_.size() - childCount_);
+        stack_.push_back(node);
+    }
+
+    AstNode* record(NodeKind kind);
+};
+
+AstNode* NodeReader::record(NodeKind kind) {
+    // Scalars first; takeChildren() then claims the node's children from the stack.
+    switch (kind) {
+    case NodeKind::IntegerLiteral: {
+        TokenIndex t = literalToken(LiteralValue::Kind::Integer);
+        return takeChildren(0) ? arena_.make<IntegerLiteralNode>(t) : nullptr;
+    }
+    case NodeKind::FloatLiteral: {
+        TokenIndex t = literalToken(LiteralValue::Kind::Float);
+        return takeChildren(0) ? arena_.make<FloatLiteralNode>(t) : nullptr;
+    }
+    case NodeKind::CharLiteral: {
+        TokenIndex t = literalToken(LiteralValue::Kind::Char);
+        return takeChildren(0) ? arena_.make<CharLiteralNode>(t) : nullptr;
+    }
+    case NodeKind::StringLiteral: {
+        TokenIndex t = literalToken(LiteralValue::Kind::String);
+        return takeChildren(0) ? arena_.make<StringLiteralNode>(t) : nullptr;
+    }
+    case NodeKind::ErrorExpression: {
+        TokenIndex t = token();
+        return takeChildren(0) ? arena_.make<ErrorExpressionNode>(t) : nullptr;
+    }
+    case NodeKind::Identifier: {
+        TokenIndex name = token();
+        return takeChildren(0) ? arena_.make<IdentifierNode>(name) : nullptr;
+    }
+    case NodeKind::ArrayIndex: {
+        TokenIndex name = token();
+        if (!takeChildren(1)) return nullptr;
+        return arena_.make<ArrayIndexNode>(name, child<ExpressionNode>());
+    }
+    case NodeKind::Call: {
+        TokenIndex name = token();
+        uint32_t count = get<uint32_t>();
+        if (!takeChildren(count)) return nullptr;
+        return arena_.make<CallNode>(name, list<ExpressionNode>(count));
+    }
+    case NodeKind::BinaryExpression: {
+        BinaryOp o = op<BinaryOp>(static_cast<uint8_t>(BinaryOp::LogicalOr) + 1);
+        TokenIndex opToken = token();
+        if (!takeChildren(2)) return nullptr;
+        ExpressionNode* left = child<ExpressionNode>();
+        return arena_.make<BinaryExpressionNode>(o, opToken, left, child<ExpressionNode>());
+    }
+    case NodeKind::UnaryExpression: {
+        UnaryOp o = op<UnaryOp>(static_cast<uint8_t>(UnaryOp::BitNot) + 1);
+        TokenIndex opToken = token();
+        if (!takeChildren(1)) return nullptr;
+        return arena_.make<UnaryExpressionNode>(o, opToken, child<ExpressionNode>());
+    }
+    case NodeKind::VariableDeclaration: {
+        TokenIndex type = token();
+        TokenIndex name = token();
+        if (!takeChildren(1)) return nullptr;
+        return arena_.make<VariableDeclarationNode>(type, name, child<ExpressionNode>(true));
+    }
+    case NodeKind::ArrayDeclaration: {
+        TokenIndex type = token();
+        TokenIndex name = token();
+        TokenIndex size = optionalToken();
+        uint32_t count = get<uint32_t>();
+        if (!takeChildren(count)) return nullptr;
+        return arena_.make<ArrayDeclarationNode>(type, name, size, list<ExpressionNode>(count));
+    }
+    case NodeKind::Assignment: {
+        if (!takeChildren(2)) return nullptr;
+        ExpressionNode* target = child<ExpressionNode>();
+        return arena_.make<AssignmentNode>(target, child<ExpressionNode>());
+    }
+    case NodeKind::ExpressionStatement: {
+        if (!takeChildren(1)) return nullptr;
+        return arena_.make<ExpressionStatementNode>(child<ExpressionNode>());
+    }
+    case NodeKind::IncrementStatement: {
+        TokenIndex name = token();
+        TokenIndex opToken = token();
+        uint8_t flags = op<uint8_t>(4);
+        return takeChildren(0) ? arena_.make<IncrementStatementNode>(name, opToken, (flags & 1) != 0, (flags & 2) != 0) : nullptr;
+    }
+    case NodeKind::IfStatement: {
+        TokenIndex keyword = token();
+        TokenIndex elseToken = optionalToken();
+        uint32_t thenCount = get<uint32_t>();
+        uint32_t elseCount = get<uint32_t>();
+        if (!takeChildren(uint64_t(1) + thenCount + elseCount)) return nullptr;
+        ExpressionNode* condition = child<ExpressionNode>();
+        NodeList<StatementNode> thenBody = list<StatementNode>(thenCount);
+        return arena_.make<IfStatementNode>(keyword, condition, thenBody, elseToken, list<StatementNode>(elseCount));
+    }
+    case NodeKind::WhileStatement: {
+        TokenIndex keyword = token();
+        uint32_t count = get<uint32_t>();
+        if (!takeChildren(uint64_t(1) + count)) return nullptr;
+        ExpressionNode* condition = child<ExpressionNode>();
+        return arena_.make<WhileStatementNode>(keyword, condition, list<StatementNode>(count));
+    }
+    case NodeKind::ForStatement: {
+        TokenIndex keyword = token();
+        uint32_t count = get<uint32_t>();
+        if (!takeChildren(uint64_t(3) + count)) return nullptr;
+        StatementNode* init = child<StatementNode>(true);
+        ExpressionNode* condition = child<ExpressionNode>(true);
+        StatementNode* update = child<StatementNode>(true);
+        return arena_.make<ForStatementNode>(keyword, init, condition, update, list<StatementNode>(count));
+    }
+    case NodeKind::ScanfStatement: {
+        TokenIndex keyword = token();
+        TokenIndex format = literalToken(LiteralValue::Kind::String);
+        if (!takeChildren(1)) return nullptr;
+        return arena_.make<ScanfStatementNode>(keyword, format, child<ExpressionNode>());
+    }
+    case NodeKind::PrintfStatement: {
+        TokenIndex keyword = token();
+        TokenIndex format = literalToken(LiteralValue::Kind::String);
+        if (!takeChildren(1)) return nullptr;
+        return arena_.make<PrintfStatementNode>(keyword, format, child<ExpressionNode>(true));
+    }
+    case NodeKind::ReturnStatement: {
+        TokenIndex keyword = token();
+        if (!takeChildren(1)) return nullptr;
+        return arena_.make<ReturnStatementNode>(keyword, child<ExpressionNode>(true));
+    }
+    case NodeKind::Parameter: {
+        TokenIndex type = token();
+        TokenIndex name = token();
+        return takeChildren(0) ? arena_.make<ParameterNode>(type, name) : nullptr;
+    }
+    case NodeKind::FunctionDefinition: {
+        TokenIndex returnType = token();
+        TokenIndex name = token();
+        uint32_t parameterCount = get<uint32_t>();
+        uint32_t bodyCount = get<uint32_t>();
+        if (!takeChildren(uint64_t(parameterCount) + bodyCount)) return nullptr;
+        NodeList<ParameterNode> parameters = list<ParameterNode>(parameterCount);
+        return arena_.make<FunctionDefinitionNode>(returnType, name, parameters, list<StatementNode>(bodyCount));
+    }
+    case NodeKind::Program: {
+        uint32_t globalCount = get<uint32_t>();
+        uint32_t functionCount = get<uint32_t>();
+        if (!takeChildren(uint64_t(globalCount) + functionCount)) return nullptr;
+        ProgramNode* program = arena_.make<ProgramNode>();
+        program->globals = list<StatementNode>(globalCount);
+        program->functions = list<FunctionDefinitionNode>(functionCount);
+        return program;
+    }
+    }
+    ok_ = false;
+    return nullptr;
+}
+
+ProgramNode* NodeReader::read() {
+    while (ok_ && at_ < end_) {
+        uint8_t kind = get<uint8_t>();
+        if (kind == kNullRecord) {
+            stack_.push_back(nullptr);
+            continue;
+        }
+        if (kind >= kNodeKindCount) return nullptr;
+        AstNode* node = record(static_cast<NodeKind>(kind));
+        if (!ok_ || !node) return nullptr;
+        finish(node);
+    }
+    if (!ok_ || stack_.size() != 1 || !stack_[0] || stack_[0]->kind != NodeKind::Program) return nullptr;
+    return static_cast<ProgramNode*>(stack_[0]);
+}
+
+} // namespace
+
+AstCache::AstCache(std::string directory) : directory_(std::move(directory)) {
+}
+
+uint64_t AstCache::hash(std::string_view bytes) {
+    // Two independent multiply-rotate lanes over 16-byte blocks, then a final mix.
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(bytes.data());
+    size_t size = bytes.size();
+    const uint64_t k1 = 0x9E3779B97F4A7C15ull;
+    const uint64_t k2 = 0xC2B2AE3D27D4EB4Full;
+    uint64_t a = size ^ k1;
+    uint64_t b = size ^ k2;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        a = ((a ^ load64(p + i)) * k2);
+        a = (a << 31) | (a >> 33);
+        b = ((b ^ load64(p + i + 8)) * k1);
+        b = (b << 29) | (b >> 35);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p + i, size - i < 8 ? size - i : 8);
+    a ^= tail * k1;
+    if (size - i > 8) {
+        tail = 0;
+        std::memcpy(&tail, p + i + 8, size - i - 8);
+        b ^= tail * k2;
+    }
+    return mix(a ^ mix(b));
+}
+
+std::string AstCache::entryPath(uint64_t sourceHash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016" PRIx64 ".ast", sourceHash);
+    return (std::filesystem::path(directory_) / name).string();
+}
+
+bool AstCache::store(const CompilationUnit& unit, uint64_t sourceHash) {
+    lastError_.clear();
+    const TokenBuffer& tokens = unit.tokens;
+    size_t count = tokens.size();
+    if (!unit.program || !unit.diagnostics.empty()) return fail("the unit has errors");
+    std::string_view text = unit.source->text();
+
+    // Token columns and literals.
+    EntryWriter payload;
+    payload.bytes.reserve(count * 14 + 64);
+    std::vector<LiteralRecord> literals;
+    std::string strings;
+    for (size_t i = 0; i < count; ++i) payload.put(tokens.offset(i));
+    for (size_t i = 0; i < count; ++i) payload.put(tokens.length(i));
+    for (size_t i = 0; i < count; ++i) {
+        LiteralValue value = tokens.literal(i);
+        if (value.kind == LiteralValue::Kind::None) {
+            payload.put(uint32_t(0));
+            continue;
+        }
+        LiteralRecord record{};
+        record.kind = static_cast<uint8_t>(value.kind);
+        if (value.kind == LiteralValue::Kind::String) {
+            std::string_view bytes = value.stringValue();
+            record.length = static_cast<uint32_t>(bytes.size());
+            if (bytes.data() >= text.data() && bytes.data() + bytes.size() <= text.data() + text.size()) {
+                record.inSource = 1;
+                record.bits = static_cast<uint64_t>(bytes.data() - text.data());
+            }
+            else {
+                record.bits = strings.size();
+                strings.append(bytes);
+            }
+        }
+        else {
+            std::memcpy(&record.bits, &value.integer, sizeof(record.bits));
+        }
+        literals.push_back(record);
+        payload.put(static_cast<uint32_t>(literals.size()));
+    }
+    for (size_t i = 0; i < count; ++i) payload.put(static_cast<uint8_t>(tokens.type(i)));
+    for (const LiteralRecord& record : literals) payload.put(record);
+    payload.bytes.insert(payload.bytes.end(), strings.begin(), strings.end());
+    size_t nodesStart = payload.bytes.size();
+    payload.writeNodes(unit.program);
+
+    EntryHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.byteOrder = kByteOrderMark;
+    header.tokenTypeCount = kTokenTypeCount;
+    header.nodeKindCount = kNodeKindCount;
+    header.sourceHash = sourceHash;
+    header.sourceSize = text.size();
+    header.tokenCount = count;
+    header.literalCount = literals.size();
+    header.stringBytes = strings.size();
+    header.nodeBytes = payload.bytes.size() - nodesStart;
+    header.payloadHash = hash(std::string_view(payload.bytes.data(), payload.bytes.size()));
+
+    // Write to a private name and rename, so readers see a whole entry or none.
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error) return fail("cannot create " + directory_ + ": " + error.message());
+    std::string path = entryPath(sourceHash);
+    std::string temporary = path + ".tmp" + std::to_string(static_cast<long>(getpid()));
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) return fail("cannot write " + temporary);
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(payload.bytes.data(), 1, payload.bytes.size(), file) == payload.bytes.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return fail("cannot write " + path);
+    }
+    return true;
+}
+
+bool AstCache::load(CompilationUnit& unit, uint64_t sourceHash) {
+    lastError_.clear();
+    std::string path = entryPath(sourceHash);
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) return false; // A plain miss
+    std::shared_ptr<const SourceBuffer> entry = SourceBuffer::fromFile(path); // Mapped read-only
+    if (!entry) return fail("cannot read " + path);
+
+    std::string_view bytes = entry->text();
+    EntryHeader header;
+    if (bytes.size() < sizeof(header)) return fail(path + ": truncated header");
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) return fail(path + ": not an AST cache entry");
+    if (header.version != kFormatVersion || header.byteOrder != kByteOrderMark
+        || header.tokenTypeCount != kTokenTypeCount || header.nodeKindCount != kNodeKindCount) {
+        return fail(path + ": written by a different version");
+    }
+    std::string_view text = unit.source->text();
+    if (header.sourceHash != sourceHash || header.sourceSize != text.size()) return fail(path + ": stale entry");
+
+    std::string_view payload = bytes.substr(sizeof(header));
+    const uint64_t limit = uint64_t(1) << 40; // Keeps the size arithmetic below from overflowing
+    if (header.tokenCount == 0 || header.tokenCount > limit || header.literalCount > limit
+        || header.stringBytes > limit || header.nodeBytes > limit
+        || payload.size() != header.tokenCount * 13 + header.literalCount * sizeof(LiteralRecord)
+            + header.stringBytes + header.nodeBytes) {
+        return fail(path + ": inconsistent sizes");
+    }
+    if (hash(payload) != header.payloadHash) return fail(path + ": checksum mismatch");
+
+    // Columns, literal table, strings and nodes, in file order.
+    size_t count = static_cast<size_t>(header.tokenCount);
+    const char* offsets = payload.data();
+    const char* lengths = offsets + count * 4;
+    const char* payloads = lengths + count * 4;
+    const char* types = payloads + count * 4;
+    const char* literalRecords = types + count;
+    const char* strings = literalRecords + header.literalCount * sizeof(LiteralRecord);
+    const char* nodes = strings + header.stringBytes;
+
+    TokenBuffer tokens(unit.source);
+    tokens.appendColumns(offsets, lengths, types, count);
+    for (size_t i = 0; i < count; ++i) {
+        if (static_cast<uint8_t>(tokens.type(i)) >= kTokenTypeCount || uint64_t(tokens.offset(i)) + tokens.length(i) > text.size()) {
+            return fail(path + ": invalid token");
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t literal;
+        std::memcpy(&literal, payloads + i * 4, 4);
+        if (literal == 0) continue;
+        if (literal > header.literalCount || !TokenBuffer::isLiteral(tokens.type(i))) return fail(path + ": invalid token");
+        LiteralRecord record;
+        std::memcpy(&record, literalRecords + (literal - 1) * sizeof(LiteralRecord), sizeof(record));
+        LiteralValue value;
+        if (record.kind == static_cast<uint8_t>(LiteralValue::Kind::String)) {
+            uint64_t available = record.inSource ? text.size() : header.stringBytes;
+            if (record.bits > available || record.length > available - record.bits) return fail(path + ": invalid literal");
+            const char* base = record.inSource ? text.data() : strings;
+            value = LiteralValue::ofString(std::string_view(base + record.bits, record.length)); // Copied unless in the source
+        }
+        else if (record.kind > static_cast<uint8_t>(LiteralValue::Kind::None)
+            && record.kind < static_cast<uint8_t>(LiteralValue::Kind::String)) {
+            value.kind = static_cast<LiteralValue::Kind>(record.kind);
+            std::memcpy(&value.integer, &record.bits, sizeof(record.bits));
+        }
+        else {
+            return fail(path + ": invalid literal");
+        }
+        tokens.setLiteral(i, value);
+    }
+    if (tokens.type(count - 1) != TokenType::END_OF_FILE) return fail(path + ": invalid token");
+
+    // Decode into a scratch Arena first, so a bad record leaves the unit untouched.
+    Arena arena;
+    ProgramNode* program = NodeReader(nodes, static_cast<size_t>(header.nodeBytes), tokens, arena).read();
+    if (!program) return fail(path + ": invalid node records");
+    tokens.internIdentifiers(Interner::global()); // Symbol IDs are per process, so they are not stored
+
+    unit.tokens = std::move(tokens);
+    unit.astArena = std::move(arena);
+    unit.workerArenas.clear();
+    unit.program = program;
+    return true;
+}
@@ -0,0 +1,55 @@
+// AstCache.h
+#ifndef ASTCACHE_H
+#define ASTCACHE_H
+
+#include "CompilationUnit.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// AstCache: A directory of parsed units, keyed by a hash of the source bytes.
+// An entry holds everything the tree needs besides the source itself: the
+// token columns, the decoded literal values and the AST. On a hit the entry is
+// mapped and decoded straight into the unit, so neither Lexer nor Parser runs.
+//
+// Entries are position-independent. Nodes are stored in postorder as a kind
+// byte plus their token indices, operators and list lengths; a node's children
+// are the records right before it, so the loader rebuilds the tree bottom-up
+// with one stack and no pointers are ever written to disk.
+//
+// Every entry starts with a versioned header and is checked before use: the
+// format version and the grammar's token and node kind counts must match, the
+// source hash and size must be this source's, a checksum covers the payload,
+// and every token index, literal and node record is bounds-checked while
+// decoding. Any failure is a miss (see lastError()) and the caller parses
+// normally; store() then replaces the entry. Entries are written to a
+// temporary file and renamed into place, so concurrent runs never see a
+// partial one.
+class AstCache {
+public:
+    explicit AstCache(std::string directory);
+
+    // Fast non-cryptographic 64-bit hash (not collision-proof; entries also
+    // record the source size).
+    static uint64_t hash(std::string_view bytes);
+
+    // Fills unit.tokens and unit.program from the entry for `sourceHash`
+    // (the hash of unit.source). Returns false on a miss or an invalid entry.
+    bool load(CompilationUnit& unit, uint64_t sourceHash);
+    // Saves the tokens and tree of a unit parsed without diagnostics.
+    bool store(const CompilationUnit& unit, uint64_t sourceHash);
+
+    const std::string& lastError() const { return lastError_; } // Why the last load or store failed
+    std::string entryPath(uint64_t sourceHash) const;
+
+private:
+    std::string directory_;
+    std::string lastError_;
+
+    bool fail(std::string message) {
+        lastError_ = std::move(message);
+        return false;
+    }
+};
+
+#endif // ASTCACHE_H
@@ -1,39 +1,78 @@
 // AstNode.cpp
 #include "AstNode.h"
-#include <iostream>
+#include "TokenBuffer.h"
 
-// --- Implementations of print methods for each AST node ---
+long long IntegerLiteralNode::getValue(const TokenBuffer& tokens) const {
+    return tokens.literal(token).integer;
+}
 
-void IntegerLiteralNode::print(int indentLevel) const {
-    std::cout << indent(indentLevel) << "IntegerLiteralNode: " << token.lexeme << " (Value: " << getValue() << ")" << std::endl;
+double FloatLiteralNode::getValue(const TokenBuffer& tokens) const {
+    LiteralValue value = tokens.literal(token);
+    return value.kind == LiteralValue::Kind::Float ? value.floatValue : value.doubleValue;
 }
 
-void ReturnStatementNode::print(int indentLevel) const {
-    std::cout << indent(indentLevel) << "ReturnStatementNode (" << keywordToken.lexeme << ")" << std::endl;
-    if (returnValue) {
-        returnValue->print(indentLevel + 1);
-    }
-    else {
-        std::cout << indent(indentLevel + 1) << "<no return value>" << std::endl;
+char CharLiteralNode::getValue(const TokenBuffer& tokens) const {
+    return tokens.literal(token).charValue;
+}
+
+std::string_view StringLiteralNode::getValue(const TokenBuffer& tokens) const {
+    return tokens.literal(token).stringValue();
+}
+
+TokenIndex expressionToken(const ExpressionNode* node) {
+    switch (node->kind) {
+    case NodeKind::BinaryExpression: return static_cast<const BinaryExpressionNode*>(node)->opToken;
+    case NodeKind::UnaryExpression: return static_cast<const UnaryExpressionNode*>(node)->opToken;
+    case NodeKind::Identifier: return static_cast<const IdentifierNode*>(node)->nameToken;
+    case NodeKind::ArrayIndex: return static_cast<const ArrayIndexNode*>(node)->nameToken;
+    case NodeKind::Call: return static_cast<const CallNode*>(node)->nameToken;
+    case NodeKind::IntegerLiteral: return static_cast<const IntegerLiteralNode*>(node)->token;
+    case NodeKind::FloatLiteral: return static_cast<const FloatLiteralNode*>(node)->token;
+    case NodeKind::CharLiteral: return static_cast<const CharLiteralNode*>(node)->token;
+    case NodeKind::StringLiteral: return static_cast<const StringLiteralNode*>(node)->token;
+    case NodeKind::ErrorExpression: return static_cast<const ErrorExpressionNode*>(node)->token;
+    default: return kNoToken;
     }
 }
 
-void FunctionDefinitionNode::print(int indentLevel) const {
-    std::cout << indent(indentLevel) << "FunctionDefinitionNode: " << returnTypeToken.lexeme << " " << identifierToken.lexeme << "()" << std::endl;
-    std::cout << indent(indentLevel) << "Body:" << std::endl;
-    if (body.empty()) {
-        std::cout << indent(indentLevel + 1) << "<empty body>" << std::endl;
+const char* nodeKindToString(NodeKind kind) {
+    switch (kind) {
+#define AST_NODE_NAME(Name) case NodeKind::Name: return #Name "Node";
+        AST_NODE_LIST(AST_NODE_NAME)
+#undef AST_NODE_NAME
     }
-    else {
-        for (const auto& stmt : body) {
-            stmt->print(indentLevel + 1);
-        }
+    return "UnknownNode";
+}
+
+const char* binaryOpToString(BinaryOp op) {
+    switch (op) {
+    case BinaryOp::Add: return "+";
+    case BinaryOp::Subtract: return "-";
+    case BinaryOp::Multiply: return "*";
+    case BinaryOp::Divide: return "/";
+    case BinaryOp::Modulo: return "%";
+    case BinaryOp::Less: return "<";
+    case BinaryOp::LessEqual: return "<=";
+    case BinaryOp::Greater: return ">";
+    case BinaryOp::GreaterEqual: return ">=";
+    case BinaryOp::Equal: return "==";
+    case BinaryOp::NotEqual: return "!=";
+    case BinaryOp::ShiftLeft: return "<<";
+    case BinaryOp::ShiftRight: return ">>";
+    case BinaryOp::BitAnd: return "&";
+    case BinaryOp::BitOr: return "|";
+    case BinaryOp::BitXor: return "^";
+    case BinaryOp::LogicalAnd: return "&&";
+    case BinaryOp::LogicalOr: return "||";
     }
+    return "?";
 }
 
-void ProgramNode::print(int indentLevel) const {
-    std::cout << indent(indentLevel) << "ProgramNode" << std::endl;
-    for (const auto& func : functions) {
-        func->print(indentLevel + 1);
+const char* unaryOpToString(UnaryOp op) {
+    switch (op) {
+    case UnaryOp::Negate: return "-";
+    case UnaryOp::LogicalNot: return "!";
+    case UnaryOp::BitNot: return "~";
     }
-}
\ No newline at end of file
+    return "?";
+}
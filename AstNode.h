@@ -3,103 +3,382 @@
 #define ASTNODE_H
 
 #include "Token.h" // We'll need Token for storing lexemes, types, positions
-#include <vector>
+#include <cstdint>
 #include <string>
-#include <memory> // For std::unique_ptr
 
-// Forward declaration for a potential Visitor pattern (good for later)
-class AstVisitor;
+class TokenBuffer;
+
+// AST nodes are allocated in the Arena of their CompilationUnit and are never
+// deleted one by one, so they must not own resources: children are plain
+// pointers into the same Arena and tokens only view the source.
+//
+// Nodes do not copy Tokens. They refer to them by index into the unit's
+// TokenBuffer, which is where lexemes, literal values and source positions are
+// read from, and carry a one-byte NodeKind instead of a vtable. An integer
+// literal is 8 bytes and a function definition 40, where a single Token is 56.
+// Names are keyed by the interned ID of their token, tokens.symbol(nameToken),
+// so symbol tables compare integers rather than strings.
+
+// Index of a token in the TokenBuffer the tree was parsed from.
+using TokenIndex = uint32_t;
+constexpr TokenIndex kNoToken = ~TokenIndex(0); // Marks an optional token that is absent
+
+// NodeList: An Arena-allocated array of child nodes (replaces std::vector<std::unique_ptr<T>>).
+template <typename T>
+struct NodeList {
+    T** items = nullptr;
+    uint32_t count = 0;
+
+    T** begin() const { return items; }
+    T** end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* operator[](size_t index) const { return items[index]; }
+};
+
+// Every concrete node type; X(Name) stands for class NameNode and NodeKind::Name.
+// Dispatch code (AstVisitor, AstWalker) is generated from this list.
+#define AST_NODE_LIST(X) \
+    X(Program)               \
+    X(FunctionDefinition)    \
+    X(Parameter)             \
+    X(VariableDeclaration)   \
+    X(ArrayDeclaration)      \
+    X(Assignment)            \
+    X(ExpressionStatement)   \
+    X(IncrementStatement)    \
+    X(IfStatement)           \
+    X(WhileStatement)        \
+    X(ForStatement)          \
+    X(ScanfStatement)        \
+    X(PrintfStatement)       \
+    X(ReturnStatement)       \
+    X(BinaryExpression)      \
+    X(UnaryExpression)       \
+    X(Identifier)            \
+    X(ArrayIndex)            \
+    X(Call)                  \
+    X(IntegerLiteral)        \
+    X(FloatLiteral)          \
+    X(CharLiteral)           \
+    X(StringLiteral)         \
+    X(ErrorExpression)
+
+// Concrete node types. Code that needs the dynamic type switches on AstNode::kind
+// and static_casts (see printAst).
+enum class NodeKind : uint8_t {
+#define AST_NODE_KIND(Name) Name,
+    AST_NODE_LIST(AST_NODE_KIND)
+#undef AST_NODE_KIND
+};
+
+#define AST_NODE_FORWARD(Name) class Name##Node;
+AST_NODE_LIST(AST_NODE_FORWARD)
+#undef AST_NODE_FORWARD
 
 // Base class for all AST nodes
 class AstNode {
 public:
-    virtual ~AstNode() = default; // Virtual destructor for proper cleanup
-
-    // Pure virtual function for printing the AST (for debugging)
-    // 'indent' is for pretty printing.
-    virtual void print(int indentLevel = 0) const = 0;
+    NodeKind kind; // Traversals dispatch on this (see AstVisitor.h)
 
-    // Optional: Accept method for the Visitor pattern
-    // virtual void accept(AstVisitor* visitor) = 0;
-
-    // Optional: Store line/column info for error reporting from AST
-    // int line;
-    // int column;
-    // AstNode(int l, int c) : line(l), column(c) {}
-    // AstNode() : line(0), column(0) {} // Default
+protected:
+    explicit AstNode(NodeKind k) : kind(k) {}
 };
 
 // --- Expression Nodes ---
 class ExpressionNode : public AstNode {
     // Common properties or methods for all expressions can go here
+protected:
+    using AstNode::AstNode;
+};
+
+// Binary and unary operators; the Parser's operator table gives their precedence.
+enum class BinaryOp : uint8_t {
+    Add, Subtract, Multiply, Divide, Modulo,
+    Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual,
+    ShiftLeft, ShiftRight, BitAnd, BitOr, BitXor,
+    LogicalAnd, LogicalOr, // Short-circuit
+};
+
+enum class UnaryOp : uint8_t {
+    Negate, LogicalNot, BitNot,
+};
+
+class BinaryExpressionNode : public ExpressionNode {
+public:
+    BinaryOp op;
+    TokenIndex opToken;
+    ExpressionNode* left;
+    ExpressionNode* right;
+
+    BinaryExpressionNode(BinaryOp o, TokenIndex opTok, ExpressionNode* l, ExpressionNode* r)
+        : ExpressionNode(NodeKind::BinaryExpression), op(o), opToken(opTok), left(l), right(r) {}
+};
+
+class UnaryExpressionNode : public ExpressionNode {
+public:
+    UnaryOp op;
+    TokenIndex opToken;
+    ExpressionNode* operand;
+
+    UnaryExpressionNode(UnaryOp o, TokenIndex opTok, ExpressionNode* e)
+        : ExpressionNode(NodeKind::UnaryExpression), op(o), opToken(opTok), operand(e) {}
+};
+
+// A use of a variable (or, after '&' in scanf, its address).
+class IdentifierNode : public ExpressionNode {
+public:
+    TokenIndex nameToken;
+
+    explicit IdentifierNode(TokenIndex name) : ExpressionNode(NodeKind::Identifier), nameToken(name) {}
+};
+
+// name[index]
+class ArrayIndexNode : public ExpressionNode {
+public:
+    TokenIndex nameToken;
+    ExpressionNode* index;
+
+    ArrayIndexNode(TokenIndex name, ExpressionNode* i)
+        : ExpressionNode(NodeKind::ArrayIndex), nameToken(name), index(i) {}
+};
+
+// name(arguments)
+class CallNode : public ExpressionNode {
+public:
+    TokenIndex nameToken;
+    NodeList<ExpressionNode> arguments;
+
+    CallNode(TokenIndex name, NodeList<ExpressionNode> args)
+        : ExpressionNode(NodeKind::Call), nameToken(name), arguments(args) {}
 };
 
 class IntegerLiteralNode : public ExpressionNode {
 public:
-    Token token; // The INTEGER_LITERAL token itself
+    TokenIndex token; // The INTEGER_LITERAL token itself
 
-    IntegerLiteralNode(Token t) : token(std::move(t)) {
-        // Assert or check that t.type is indeed INTEGER_LITERAL
+    explicit IntegerLiteralNode(TokenIndex t) : ExpressionNode(NodeKind::IntegerLiteral), token(t) {
+        // Assert or check that the token is indeed INTEGER_LITERAL
     }
 
-    long long getValue() const { // Helper to get the integer value
-        return std::stoll(token.lexeme); // std::stoll for long long
-    }
+    long long getValue(const TokenBuffer& tokens) const; // Decoded once by the Lexer
+};
+
+// A FLOAT_LITERAL or DOUBLE_LITERAL token.
+class FloatLiteralNode : public ExpressionNode {
+public:
+    TokenIndex token;
+
+    explicit FloatLiteralNode(TokenIndex t) : ExpressionNode(NodeKind::FloatLiteral), token(t) {}
+
+    double getValue(const TokenBuffer& tokens) const;
+};
+
+class CharLiteralNode : public ExpressionNode {
+public:
+    TokenIndex token;
+
+    explicit CharLiteralNode(TokenIndex t) : ExpressionNode(NodeKind::CharLiteral), token(t) {}
+
+    char getValue(const TokenBuffer& tokens) const;
+};
+
+class StringLiteralNode : public ExpressionNode {
+public:
+    TokenIndex token;
+
+    explicit StringLiteralNode(TokenIndex t) : ExpressionNode(NodeKind::StringLiteral), token(t) {}
+
+    std::string_view getValue(const TokenBuffer& tokens) const; // Escapes already decoded
+};
+
+// Stands in for an expression that failed to parse, so the parser can keep going
+// after reporting it. A tree that contains one is never handed to later phases.
+class ErrorExpressionNode : public ExpressionNode {
+public:
+    TokenIndex token; // Where the expression was expected
 
-    void print(int indentLevel = 0) const override;
-    // void accept(AstVisitor* visitor) override { visitor->visit(this); }
+    explicit ErrorExpressionNode(TokenIndex t) : ExpressionNode(NodeKind::ErrorExpression), token(t) {}
 };
 
 // --- Statement Nodes ---
 class StatementNode : public AstNode {
     // Common properties or methods for all statements
+protected:
+    using AstNode::AstNode;
 };
 
-class ReturnStatementNode : public StatementNode {
+// type name [= initializer];  (a global or local variable)
+class VariableDeclarationNode : public StatementNode {
+public:
+    TokenIndex typeToken;
+    TokenIndex nameToken;
+    ExpressionNode* initializer; // nullptr if there is none
+
+    VariableDeclarationNode(TokenIndex type, TokenIndex name, ExpressionNode* init)
+        : StatementNode(NodeKind::VariableDeclaration), typeToken(type), nameToken(name), initializer(init) {}
+};
+
+// type name[size] [= { elements }];
+class ArrayDeclarationNode : public StatementNode {
+public:
+    TokenIndex typeToken;
+    TokenIndex nameToken;
+    TokenIndex sizeToken; // kNoToken for name[]: the size comes from the initializer
+    NodeList<ExpressionNode> elements;
+
+    ArrayDeclarationNode(TokenIndex type, TokenIndex name, TokenIndex size, NodeList<ExpressionNode> elems)
+        : StatementNode(NodeKind::ArrayDeclaration), typeToken(type), nameToken(name), sizeToken(size), elements(elems) {}
+};
+
+// target = value;  (target is an IdentifierNode or ArrayIndexNode)
+class AssignmentNode : public StatementNode {
+public:
+    ExpressionNode* target;
+    ExpressionNode* value;
+
+    AssignmentNode(ExpressionNode* t, ExpressionNode* v)
+        : StatementNode(NodeKind::Assignment), target(t), value(v) {}
+};
+
+// An expression evaluated for its effect; the grammar only allows calls here.
+class ExpressionStatementNode : public StatementNode {
 public:
-    Token keywordToken; // The 'return' keyword token
-    std::unique_ptr<ExpressionNode> returnValue; // The expression being returned
+    ExpressionNode* expression;
 
-    ReturnStatementNode(Token keyword, std::unique_ptr<ExpressionNode> expr)
-        : keywordToken(std::move(keyword)), returnValue(std::move(expr)) {}
+    explicit ExpressionStatementNode(ExpressionNode* e)
+        : StatementNode(NodeKind::ExpressionStatement), expression(e) {}
+};
 
-    void print(int indentLevel = 0) const override;
-    // void accept(AstVisitor* visitor) override { visitor->visit(this); }
+// name++, name--, ++name or --name
+class IncrementStatementNode : public StatementNode {
+public:
+    TokenIndex nameToken;
+    TokenIndex opToken;
+    bool isIncrement; // ++ rather than --
+    bool isPrefix;
+
+    IncrementStatementNode(TokenIndex name, TokenIndex op, bool increment, bool prefix)
+        : StatementNode(NodeKind::IncrementStatement), nameToken(name), opToken(op), isIncrement(increment), isPrefix(prefix) {}
+};
+
+class IfStatementNode : public StatementNode {
+public:
+    TokenIndex keywordToken;
+    TokenIndex elseToken; // kNoToken without an else branch
+    ExpressionNode* condition;
+    NodeList<StatementNode> thenBody;
+    NodeList<StatementNode> elseBody;
+
+    IfStatementNode(TokenIndex keyword, ExpressionNode* cond, NodeList<StatementNode> thenStmts,
+        TokenIndex elseTok, NodeList<StatementNode> elseStmts)
+        : StatementNode(NodeKind::IfStatement), keywordToken(keyword), elseToken(elseTok),
+        condition(cond), thenBody(thenStmts), elseBody(elseStmts) {}
+};
+
+class WhileStatementNode : public StatementNode {
+public:
+    TokenIndex keywordToken;
+    ExpressionNode* condition;
+    NodeList<StatementNode> body;
+
+    WhileStatementNode(TokenIndex keyword, ExpressionNode* cond, NodeList<StatementNode> stmts)
+        : StatementNode(NodeKind::WhileStatement), keywordToken(keyword), condition(cond), body(stmts) {}
+};
+
+// for (init; condition; update) body  -- each header part may be absent (nullptr)
+class ForStatementNode : public StatementNode {
+public:
+    TokenIndex keywordToken;
+    StatementNode* init;
+    ExpressionNode* condition;
+    StatementNode* update;
+    NodeList<StatementNode> body;
+
+    ForStatementNode(TokenIndex keyword, StatementNode* i, ExpressionNode* cond, StatementNode* u,
+        NodeList<StatementNode> stmts)
+        : StatementNode(NodeKind::ForStatement), keywordToken(keyword), init(i), condition(cond), update(u), body(stmts) {}
+};
+
+// scanf("%d", &name) or scanf("%s", name[index])
+class ScanfStatementNode : public StatementNode {
+public:
+    TokenIndex keywordToken;
+    TokenIndex formatToken; // The STRING_LITERAL holding the format spec
+    ExpressionNode* target; // IdentifierNode (after '&') or ArrayIndexNode
+
+    ScanfStatementNode(TokenIndex keyword, TokenIndex format, ExpressionNode* t)
+        : StatementNode(NodeKind::ScanfStatement), keywordToken(keyword), formatToken(format), target(t) {}
+};
+
+// printf("%d", value)
+class PrintfStatementNode : public StatementNode {
+public:
+    TokenIndex keywordToken;
+    TokenIndex formatToken;
+    ExpressionNode* argument; // nullptr for printf("text")
+
+    PrintfStatementNode(TokenIndex keyword, TokenIndex format, ExpressionNode* arg)
+        : StatementNode(NodeKind::PrintfStatement), keywordToken(keyword), formatToken(format), argument(arg) {}
+};
+
+class ReturnStatementNode : public StatementNode {
+public:
+    TokenIndex keywordToken; // The 'return' keyword token
+    ExpressionNode* returnValue; // The expression being returned (nullptr for "return;")
+
+    ReturnStatementNode(TokenIndex keyword, ExpressionNode* expr)
+        : StatementNode(NodeKind::ReturnStatement), keywordToken(keyword), returnValue(expr) {}
 };
 
 
 // --- Definition Nodes (like function definitions) ---
-class FunctionDefinitionNode : public AstNode { // Could also be a type of Statement or a top-level declaration
+class ParameterNode : public AstNode {
 public:
-    Token returnTypeToken; // Token for the return type (e.g., "int")
-    Token identifierToken; // Token for the function name
-    // Parameters will be added later: std::vector<std::unique_ptr<VariableDeclarationNode>> parameters;
-    std::vector<std::unique_ptr<StatementNode>> body; // Statements in the function body
+    TokenIndex typeToken;
+    TokenIndex nameToken;
 
-    FunctionDefinitionNode(Token retType, Token id, std::vector<std::unique_ptr<StatementNode>> bodyStmts)
-        : returnTypeToken(std::move(retType)),
-        identifierToken(std::move(id)),
-        body(std::move(bodyStmts)) {}
+    ParameterNode(TokenIndex type, TokenIndex name)
+        : AstNode(NodeKind::Parameter), typeToken(type), nameToken(name) {}
+};
+
+class FunctionDefinitionNode : public AstNode { // Could also be a type of Statement or a top-level declaration
+public:
+    TokenIndex returnTypeToken; // Token for the return type ("void", or a base type such as "int")
+    TokenIndex identifierToken; // Token for the function name
+    NodeList<ParameterNode> parameters;
+    NodeList<StatementNode> body; // Statements in the function body
 
-    void print(int indentLevel = 0) const override;
-    // void accept(AstVisitor* visitor) override { visitor->visit(this); }
+    FunctionDefinitionNode(TokenIndex retType, TokenIndex id, NodeList<ParameterNode> params, NodeList<StatementNode> bodyStmts)
+        : AstNode(NodeKind::FunctionDefinition),
+        returnTypeToken(retType),
+        identifierToken(id),
+        parameters(params),
+        body(bodyStmts) {}
 };
 
 
 // --- Program Node (Root of the AST) ---
 class ProgramNode : public AstNode {
 public:
-    // For now, a program is just a list of function definitions.
-    // Later, it could include global variables, class definitions, etc.
-    std::vector<std::unique_ptr<FunctionDefinitionNode>> functions;
+    // Global declarations come before the first function definition.
+    NodeList<StatementNode> globals; // VariableDeclarationNode and ArrayDeclarationNode
+    NodeList<FunctionDefinitionNode> functions;
 
-    void print(int indentLevel = 0) const override;
-    // void accept(AstVisitor* visitor) override { visitor->visit(this); }
+    ProgramNode() : AstNode(NodeKind::Program) {}
 };
 
-// Helper for indentation in print methods
-inline std::string indent(int level) {
-    return std::string(level * 2, ' '); // 2 spaces per indent level
-}
+// Prints a tree for debugging to stdout; lexemes and values are read from
+// `tokens`. See AstPrinter.h for other formats and for printing into a buffer.
+void printAst(const AstNode* node, const TokenBuffer& tokens, int indentLevel = 0);
+
+// The token that identifies an expression node: its operator, name or
+// literal. No two expression nodes of a tree share one, so later phases key
+// per-expression data by it (see SemanticInfo).
+TokenIndex expressionToken(const ExpressionNode* node);
+
+const char* nodeKindToString(NodeKind kind);
+const char* binaryOpToString(BinaryOp op);
+const char* unaryOpToString(UnaryOp op);
 
-#endif // ASTNODE_H
\ No newline at end of file
+#endif // ASTNODE_H
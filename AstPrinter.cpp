@@ -0,0 +1,494 @@
+// AstPrinter.cpp
+#include "AstPrinter.h"
+#include "TokenBuffer.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Output still to be produced: a node, or a fixed piece of text. A printer pops
+// one item, writes it, and pushes what follows it; the items a node pushes are
+// reversed afterwards, so they can be pushed in reading order.
+struct PrintItem {
+    const AstNode* node; // nullptr for text
+    const char* text;
+    int indentLevel;
+};
+
+class PrinterBase {
+protected:
+    PrinterBase(const TokenBuffer& tokens, OutputBuffer& out) : tokens_(tokens), out_(out) {}
+
+    const TokenBuffer& tokens_;
+    OutputBuffer& out_;
+    std::vector<PrintItem> stack_;
+
+    void push(const AstNode* node, int indentLevel = 0) { stack_.push_back(PrintItem{ node, nullptr, indentLevel }); }
+    void pushText(const char* text, int indentLevel = 0) { stack_.push_back(PrintItem{ nullptr, text, indentLevel }); }
+
+    template <typename Printer>
+    void run(Printer& printer, const AstNode* root, int indentLevel) {
+        push(root, indentLevel);
+        while (!stack_.empty()) {
+            PrintItem item = stack_.back();
+            stack_.pop_back();
+            size_t mark = stack_.size();
+            if (item.node) printer.printNode(item.node, item.indentLevel);
+            else printer.printText(item.text, item.indentLevel);
+            std::reverse(stack_.begin() + mark, stack_.end());
+        }
+    }
+};
+
+// --- Indented text ---
+
+class TextPrinter : PrinterBase {
+public:
+    TextPrinter(const TokenBuffer& tokens, OutputBuffer& out) : PrinterBase(tokens, out) {}
+
+    void print(const AstNode* root, int indentLevel) { run(*this, root, indentLevel); }
+
+    void printText(const char* text, int indentLevel) {
+        line(indentLevel) << text << '\n';
+    }
+
+    void printNode(const AstNode* node, int indentLevel);
+
+private:
+    OutputBuffer& line(int indentLevel) {
+        out_.spaces(static_cast<size_t>(indentLevel) * 2); // 2 spaces per indent level
+        return out_;
+    }
+
+    template <typename T>
+    void pushAll(const NodeList<T>& nodes, int indentLevel) {
+        for (const T* node : nodes) push(node, indentLevel);
+    }
+
+    // "label" on the node's level, then the statements one level deeper.
+    void pushBody(const char* label, const NodeList<StatementNode>& statements, int indentLevel) {
+        pushText(label, indentLevel);
+        if (statements.empty()) pushText("<empty body>", indentLevel + 1);
+        pushAll(statements, indentLevel + 1);
+    }
+};
+
+void TextPrinter::printNode(const AstNode* node, int indentLevel) {
+    const TokenBuffer& tokens = tokens_;
+    switch (node->kind) {
+    case NodeKind::IntegerLiteral: {
+        auto literal = static_cast<const IntegerLiteralNode*>(node);
+        line(indentLevel) << "IntegerLiteralNode: " << tokens.lexeme(literal->token) << " (Value: ";
+        out_.writeInt(literal->getValue(tokens));
+        out_ << ")\n";
+        break;
+    }
+    case NodeKind::FloatLiteral: {
+        auto literal = static_cast<const FloatLiteralNode*>(node);
+        line(indentLevel) << "FloatLiteralNode: " << tokens.lexeme(literal->token) << " (Value: ";
+        out_.writeDouble(literal->getValue(tokens));
+        out_ << ")\n";
+        break;
+    }
+    case NodeKind::CharLiteral: {
+        auto literal = static_cast<const CharLiteralNode*>(node);
+        line(indentLevel) << "CharLiteralNode: " << tokens.lexeme(literal->token) << " (Value: ";
+        out_.writeInt(literal->getValue(tokens));
+        out_ << ")\n";
+        break;
+    }
+    case NodeKind::StringLiteral: {
+        auto literal = static_cast<const StringLiteralNode*>(node);
+        line(indentLevel) << "StringLiteralNode: " << tokens.lexeme(literal->token) << '\n';
+        break;
+    }
+    case NodeKind::ErrorExpression:
+        line(indentLevel) << "ErrorExpressionNode\n";
+        break;
+    case NodeKind::Identifier: {
+        auto identifier = static_cast<const IdentifierNode*>(node);
+        line(indentLevel) << "IdentifierNode: " << tokens.lexeme(identifier->nameToken) << '\n';
+        break;
+    }
+    case NodeKind::ArrayIndex: {
+        auto access = static_cast<const ArrayIndexNode*>(node);
+        line(indentLevel) << "ArrayIndexNode: " << tokens.lexeme(access->nameToken) << "[]\n";
+        push(access->index, indentLevel + 1);
+        break;
+    }
+    case NodeKind::Call: {
+        auto call = static_cast<const CallNode*>(node);
+        line(indentLevel) << "CallNode: " << tokens.lexeme(call->nameToken) << "()\n";
+        pushAll(call->arguments, indentLevel + 1);
+        break;
+    }
+    case NodeKind::BinaryExpression: {
+        auto binary = static_cast<const BinaryExpressionNode*>(node);
+        line(indentLevel) << "BinaryExpressionNode (" << binaryOpToString(binary->op) << ")\n";
+        push(binary->left, indentLevel + 1);
+        push(binary->right, indentLevel + 1);
+        break;
+    }
+    case NodeKind::UnaryExpression: {
+        auto unary = static_cast<const UnaryExpressionNode*>(node);
+        line(indentLevel) << "UnaryExpressionNode (" << unaryOpToString(unary->op) << ")\n";
+        push(unary->operand, indentLevel + 1);
+        break;
+    }
+    case NodeKind::VariableDeclaration: {
+        auto declaration = static_cast<const VariableDeclarationNode*>(node);
+        line(indentLevel) << "VariableDeclarationNode: " << tokens.lexeme(declaration->typeToken)
+            << ' ' << tokens.lexeme(declaration->nameToken) << '\n';
+        if (declaration->initializer) push(declaration->initializer, indentLevel + 1);
+        break;
+    }
+    case NodeKind::ArrayDeclaration: {
+        auto declaration = static_cast<const ArrayDeclarationNode*>(node);
+        line(indentLevel) << "ArrayDeclarationNode: " << tokens.lexeme(declaration->typeToken)
+            << ' ' << tokens.lexeme(declaration->nameToken) << '['
+            << (declaration->sizeToken != kNoToken ? tokens.lexeme(declaration->sizeToken) : std::string_view())
+            << "]\n";
+        pushAll(declaration->elements, indentLevel + 1);
+        break;
+    }
+    case NodeKind::Assignment: {
+        auto assignment = static_cast<const AssignmentNode*>(node);
+        line(indentLevel) << "AssignmentNode\n";
+        push(assignment->target, indentLevel + 1);
+        push(assignment->value, indentLevel + 1);
+        break;
+    }
+    case NodeKind::ExpressionStatement: {
+        auto statement = static_cast<const ExpressionStatementNode*>(node);
+        line(indentLevel) << "ExpressionStatementNode\n";
+        push(statement->expression, indentLevel + 1);
+        break;
+    }
+    case NodeKind::IncrementStatement: {
+        auto statement = static_cast<const IncrementStatementNode*>(node);
+        line(indentLevel) << "IncrementStatementNode: ";
+        if (statement->isPrefix) out_ << tokens.lexeme(statement->opToken) << tokens.lexeme(statement->nameToken);
+        else out_ << tokens.lexeme(statement->nameToken) << tokens.lexeme(statement->opToken);
+        out_ << '\n';
+        break;
+    }
+    case NodeKind::IfStatement: {
+        auto statement = static_cast<const IfStatementNode*>(node);
+        line(indentLevel) << "IfStatementNode\n";
+        push(statement->condition, indentLevel + 1);
+        pushBody("Then:", statement->thenBody, indentLevel);
+        if (statement->elseToken != kNoToken) pushBody("Else:", statement->elseBody, indentLevel);
+        break;
+    }
+    case NodeKind::WhileStatement: {
+        auto statement = static_cast<const WhileStatementNode*>(node);
+        line(indentLevel) << "WhileStatementNode\n";
+        push(statement->condition, indentLevel + 1);
+        pushBody("Body:", statement->body, indentLevel);
+        break;
+    }
+    case NodeKind::ForStatement: {
+        auto statement = static_cast<const ForStatementNode*>(node);
+        line(indentLevel) << "ForStatementNode\n";
+        pushText("Init:", indentLevel);
+        if (statement->init) push(statement->init, indentLevel + 1);
+        pushText("Condition:", indentLevel);
+        if (statement->condition) push(statement->condition, indentLevel + 1);
+        pushText("Update:", indentLevel);
+        if (statement->update) push(statement->update, indentLevel + 1);
+        pushBody("Body:", statement->body, indentLevel);
+        break;
+    }
+    case NodeKind::ScanfStatement: {
+        auto statement = static_cast<const ScanfStatementNode*>(node);
+        line(indentLevel) << "ScanfStatementNode: " << tokens.lexeme(statement->formatToken) << '\n';
+        push(statement->target, indentLevel + 1);
+        break;
+    }
+    case NodeKind::PrintfStatement: {
+        auto statement = static_cast<const PrintfStatementNode*>(node);
+        line(indentLevel) << "PrintfStatementNode: " << tokens.lexeme(statement->formatToken) << '\n';
+        if (statement->argument) push(statement->argument, indentLevel + 1);
+        break;
+    }
+    case NodeKind::ReturnStatement: {
+        auto statement = static_cast<const ReturnStatementNode*>(node);
+        line(indentLevel) << "ReturnStatementNode (" << tokens.lexeme(statement->keywordToken) << ")\n";
+        if (statement->returnValue) push(statement->returnValue, indentLevel + 1);
+        else pushText("<no return value>", indentLevel + 1);
+        break;
+    }
+    case NodeKind::Parameter: {
+        auto parameter = static_cast<const ParameterNode*>(node);
+        line(indentLevel) << "ParameterNode: " << tokens.lexeme(parameter->typeToken)
+            << ' ' << tokens.lexeme(parameter->nameToken) << '\n';
+        break;
+    }
+    case NodeKind::FunctionDefinition: {
+        auto function = static_cast<const FunctionDefinitionNode*>(node);
+        line(indentLevel) << "FunctionDefinitionNode: " << tokens.lexeme(function->returnTypeToken)
+            << ' ' << tokens.lexeme(function->identifierToken) << '(';
+        for (size_t i = 0; i < function->parameters.size(); ++i) {
+            const ParameterNode* parameter = function->parameters[i];
+            out_ << (i ? ", " : "") << tokens.lexeme(parameter->typeToken) << ' ' << tokens.lexeme(parameter->nameToken);
+        }
+        out_ << ")\n";
+        pushBody("Body:", function->body, indentLevel);
+        break;
+    }
+    case NodeKind::Program: {
+        auto program = static_cast<const ProgramNode*>(node);
+        line(indentLevel) << "ProgramNode\n";
+        pushAll(program->globals, indentLevel + 1);
+        pushAll(program->functions, indentLevel + 1);
+        break;
+    }
+    }
+}
+
+// --- JSON ---
+
+class JsonPrinter : PrinterBase {
+public:
+    JsonPrinter(const TokenBuffer& tokens, OutputBuffer& out) : PrinterBase(tokens, out) {}
+
+    void print(const AstNode* root) { run(*this, root, 0); }
+
+    void printText(const char* text, int) { out_ << text; }
+
+    void printNode(const AstNode* node, int);
+
+private:
+    // {"kind":"Name" plus the position of `token`, if there is one.
+    void open(const AstNode* node, TokenIndex token = kNoToken) {
+        std::string_view name = nodeKindToString(node->kind);
+        name.remove_suffix(4); // "Node"
+        out_ << "{\"kind\":\"" << name << '"';
+        if (token != kNoToken) {
+            int line = 0;
+            int column = 0;
+            tokens_.source()->locate(tokens_.offset(token), line, column);
+            out_ << ",\"line\":";
+            out_.writeInt(line);
+            out_ << ",\"column\":";
+            out_.writeInt(column);
+        }
+    }
+    void field(const char* name) { out_ << ",\"" << name << "\":"; }
+    void stringField(const char* name, std::string_view value) {
+        field(name);
+        out_.writeJsonString(value);
+    }
+
+    // `key` is the complete ",\"name\":" text, pushed as one item.
+    void pushChild(const char* key, const AstNode* child) {
+        pushText(key);
+        if (child) push(child);
+        else pushText("null");
+    }
+    template <typename T>
+    void pushArray(const char* key, const NodeList<T>& nodes) {
+        pushText(key);
+        pushText("[");
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (i) pushText(",");
+            push(nodes[i]);
+        }
+        pushText("]");
+    }
+};
+
+void JsonPrinter::printNode(const AstNode* node, int) {
+    const TokenBuffer& tokens = tokens_;
+    switch (node->kind) {
+    case NodeKind::IntegerLiteral: {
+        auto literal = static_cast<const IntegerLiteralNode*>(node);
+        open(node, literal->token);
+        field("value");
+        out_.writeInt(literal->getValue(tokens));
+        break;
+    }
+    case NodeKind::FloatLiteral: {
+        auto literal = static_cast<const FloatLiteralNode*>(node);
+        open(node, literal->token);
+        field("value");
+        out_.writeDoubleExact(literal->getValue(tokens));
+        break;
+    }
+    case NodeKind::CharLiteral: {
+        auto literal = static_cast<const CharLiteralNode*>(node);
+        open(node, literal->token);
+        field("value");
+        out_.writeInt(literal->getValue(tokens));
+        break;
+    }
+    case NodeKind::StringLiteral: {
+        auto literal = static_cast<const StringLiteralNode*>(node);
+        open(node, literal->token);
+        stringField("value", literal->getValue(tokens));
+        break;
+    }
+    case NodeKind::ErrorExpression:
+        open(node, static_cast<const ErrorExpressionNode*>(node)->token);
+        break;
+    case NodeKind::Identifier: {
+        auto identifier = static_cast<const IdentifierNode*>(node);
+        open(node, identifier->nameToken);
+        stringField("name", tokens.lexeme(identifier->nameToken));
+        break;
+    }
+    case NodeKind::ArrayIndex: {
+        auto access = static_cast<const ArrayIndexNode*>(node);
+        open(node, access->nameToken);
+        stringField("name", tokens.lexeme(access->nameToken));
+        pushChild(",\"index\":", access->index);
+        break;
+    }
+    case NodeKind::Call: {
+        auto call = static_cast<const CallNode*>(node);
+        open(node, call->nameToken);
+        stringField("name", tokens.lexeme(call->nameToken));
+        pushArray(",\"arguments\":", call->arguments);
+        break;
+    }
+    case NodeKind::BinaryExpression: {
+        auto binary = static_cast<const BinaryExpressionNode*>(node);
+        open(node, binary->opToken);
+        stringField("op", binaryOpToString(binary->op));
+        pushChild(",\"left\":", binary->left);
+        pushChild(",\"right\":", binary->right);
+        break;
+    }
+    case NodeKind::UnaryExpression: {
+        auto unary = static_cast<const UnaryExpressionNode*>(node);
+        open(node, unary->opToken);
+        stringField("op", unaryOpToString(unary->op));
+        pushChild(",\"operand\":", unary->operand);
+        break;
+    }
+    case NodeKind::VariableDeclaration: {
+        auto declaration = static_cast<const VariableDeclarationNode*>(node);
+        open(node, declaration->nameToken);
+        stringField("type", tokens.lexeme(declaration->typeToken));
+        stringField("name", tokens.lexeme(declaration->nameToken));
+        pushChild(",\"initializer\":", declaration->initializer);
+        break;
+    }
+    case NodeKind::ArrayDeclaration: {
+        auto declaration = static_cast<const ArrayDeclarationNode*>(node);
+        open(node, declaration->nameToken);
+        stringField("type", tokens.lexeme(declaration->typeToken));
+        stringField("name", tokens.lexeme(declaration->nameToken));
+        field("size");
+        if (declaration->sizeToken != kNoToken) out_.writeInt(tokens.literal(declaration->sizeToken).integer);
+        else out_ << "null";
+        pushArray(",\"elements\":", declaration->elements);
+        break;
+    }
+    case NodeKind::Assignment: {
+        auto assignment = static_cast<const AssignmentNode*>(node);
+        open(node);
+        pushChild(",\"target\":", assignment->target);
+        pushChild(",\"value\":", assignment->value);
+        break;
+    }
+    case NodeKind::ExpressionStatement:
+        open(node);
+        pushChild(",\"expression\":", static_cast<const ExpressionStatementNode*>(node)->expression);
+        break;
+    case NodeKind::IncrementStatement: {
+        auto statement = static_cast<const IncrementStatementNode*>(node);
+        open(node, statement->nameToken);
+        stringField("name", tokens.lexeme(statement->nameToken));
+        stringField("op", statement->isIncrement ? "++" : "--");
+        field("prefix");
+        out_ << (statement->isPrefix ? "true" : "false");
+        break;
+    }
+    case NodeKind::IfStatement: {
+        auto statement = static_cast<const IfStatementNode*>(node);
+        open(node, statement->keywordToken);
+        pushChild(",\"condition\":", statement->condition);
+        pushArray(",\"then\":", statement->thenBody);
+        if (statement->elseToken != kNoToken) pushArray(",\"else\":", statement->elseBody);
+        else pushText(",\"else\":null");
+        break;
+    }
+    case NodeKind::WhileStatement: {
+        auto statement = static_cast<const WhileStatementNode*>(node);
+        open(node, statement->keywordToken);
+        pushChild(",\"condition\":", statement->condition);
+        pushArray(",\"body\":", statement->body);
+        break;
+    }
+    case NodeKind::ForStatement: {
+        auto statement = static_cast<const ForStatementNode*>(node);
+        open(node, statement->keywordToken);
+        pushChild(",\"init\":", statement->init);
+        pushChild(",\"condition\":", statement->condition);
+        pushChild(",\"update\":", statement->update);
+        pushArray(",\"body\":", statement->body);
+        break;
+    }
+    case NodeKind::ScanfStatement: {
+        auto statement = static_cast<const ScanfStatementNode*>(node);
+        open(node, statement->keywordToken);
+        stringField("format", tokens.literal(statement->formatToken).stringValue());
+        pushChild(",\"target\":", statement->target);
+        break;
+    }
+    case NodeKind::PrintfStatement: {
+        auto statement = static_cast<const PrintfStatementNode*>(node);
+        open(node, statement->keywordToken);
+        stringField("format", tokens.literal(statement->formatToken).stringValue());
+        pushChild(",\"argument\":", statement->argument);
+        break;
+    }
+    case NodeKind::ReturnStatement: {
+        auto statement = static_cast<const ReturnStatementNode*>(node);
+        open(node, statement->keywordToken);
+        pushChild(",\"value\":", statement->returnValue);
+        break;
+    }
+    case NodeKind::Parameter: {
+        auto parameter = static_cast<const ParameterNode*>(node);
+        open(node, parameter->nameToken);
+        stringField("type", tokens.lexeme(parameter->typeToken));
+        stringField("name", tokens.lexeme(parameter->nameToken));
+        break;
+    }
+    case NodeKind::FunctionDefinition: {
+        auto function = static_cast<const FunctionDefinitionNode*>(node);
+        open(node, function->identifierToken);
+        stringField("returnType", tokens.lexeme(function->returnTypeToken));
+        stringField("name", tokens.lexeme(function->identifierToken));
+        pushArray(",\"parameters\":", function->parameters);
+        pushArray(",\"body\":", function->body);
+        break;
+    }
+    case NodeKind::Program: {
+        auto program = static_cast<const ProgramNode*>(node);
+        open(node);
+        pushArray(",\"globals\":", program->globals);
+        pushArray(",\"functions\":", program->functions);
+        break;
+    }
+    }
+    pushText("}");
+}
+
+} // namespace
+
+void printAst(const AstNode* node, const TokenBuffer& tokens, OutputBuffer& out, AstFormat format, int indentLevel) {
+    if (format == AstFormat::Json) {
+        JsonPrinter(tokens, out).print(node);
+    }
+    else {
+        TextPrinter(tokens, out).print(node, indentLevel);
+    }
+}
+
+void printAst(const AstNode* node, const TokenBuffer& tokens, int indentLevel) {
+    OutputBuffer out(stdout, 64 * 1024);
+    printAst(node, tokens, out, AstFormat::Text, indentLevel);
+}
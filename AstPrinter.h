@@ -0,0 +1,25 @@
+// AstPrinter.h
+#ifndef ASTPRINTER_H
+#define ASTPRINTER_H
+
+#include "AstNode.h"
+#include "OutputBuffer.h"
+
+class TokenBuffer;
+
+enum class AstFormat : uint8_t {
+    Text, // The indented debugging dump (one node per line)
+    Json, // One JSON object per node, for tools
+};
+
+// Writes the tree below `node` to `out`. Lexemes, values and positions are read
+// from `tokens`. Both printers walk the tree with an explicit stack, so trees
+// of any depth (e.g. a long chain of parentheses) print without recursion.
+//
+// JSON objects have "kind" (the NodeKind name), "line" and "column" where the
+// node has a token of its own, the node's scalar fields, and its children
+// under their member names (lists as arrays, absent children as null).
+void printAst(const AstNode* node, const TokenBuffer& tokens, OutputBuffer& out,
+    AstFormat format = AstFormat::Text, int indentLevel = 0);
+
+#endif // ASTPRINTER_H
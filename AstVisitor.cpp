@@ -0,0 +1,20 @@
+// AstVisitor.cpp
+#include "AstVisitor.h"
+
+void AstVisitor::visit(const AstNode* node) {
+    switch (node->kind) {
+#define AST_VISITOR_CASE(Name) \
+    case NodeKind::Name: visit##Name(static_cast<const Name##Node*>(node)); break;
+    AST_NODE_LIST(AST_VISITOR_CASE)
+#undef AST_VISITOR_CASE
+    }
+}
+
+// --- Default visit methods: descend into the children ---
+
+#define AST_VISITOR_DEFAULT(Name)                                                  \
+    void AstVisitor::visit##Name(const Name##Node* node) {                         \
+        forEachChild(node, [this](const AstNode* child) { visit(child); });        \
+    }
+AST_NODE_LIST(AST_VISITOR_DEFAULT)
+#undef AST_VISITOR_DEFAULT
@@ -0,0 +1,137 @@
+// AstVisitor.h
+#ifndef ASTVISITOR_H
+#define ASTVISITOR_H
+
+#include "AstNode.h"
+
+// Two ways to traverse an AST:
+//
+//  - AstVisitor: the classic visitor. One virtual call per node; convenient for
+//    passes that are swapped at run time or live behind an interface.
+//  - AstWalker<Derived>: static dispatch. walk() switches on the node's kind and
+//    calls Derived's visit methods directly (CRTP), so they can be inlined and a
+//    traversal costs no indirect call per node. Use it for the compiler's own passes.
+//
+// In both forms the default visit method of a node visits its children in source
+// order, so a pass only overrides the node kinds it cares about and calls the
+// base method (or visitChildren) to keep descending.
+
+// --- Children of each node kind, in source order ---
+// fn is called with each non-null child as a const AstNode*.
+
+template <typename F> void forEachChild(const ProgramNode* node, F&& fn) {
+    for (const StatementNode* global : node->globals) fn(global);
+    for (const FunctionDefinitionNode* function : node->functions) fn(function);
+}
+template <typename F> void forEachChild(const FunctionDefinitionNode* node, F&& fn) {
+    for (const ParameterNode* parameter : node->parameters) fn(parameter);
+    for (const StatementNode* statement : node->body) fn(statement);
+}
+template <typename F> void forEachChild(const ParameterNode*, F&&) {}
+template <typename F> void forEachChild(const VariableDeclarationNode* node, F&& fn) {
+    if (node->initializer) fn(node->initializer);
+}
+template <typename F> void forEachChild(const ArrayDeclarationNode* node, F&& fn) {
+    for (const ExpressionNode* element : node->elements) fn(element);
+}
+template <typename F> void forEachChild(const AssignmentNode* node, F&& fn) {
+    fn(node->target);
+    fn(node->value);
+}
+template <typename F> void forEachChild(const ExpressionStatementNode* node, F&& fn) {
+    fn(node->expression);
+}
+template <typename F> void forEachChild(const IncrementStatementNode*, F&&) {}
+template <typename F> void forEachChild(const IfStatementNode* node, F&& fn) {
+    fn(node->condition);
+    for (const StatementNode* statement : node->thenBody) fn(statement);
+    for (const StatementNode* statement : node->elseBody) fn(statement);
+}
+template <typename F> void forEachChild(const WhileStatementNode* node, F&& fn) {
+    fn(node->condition);
+    for (const StatementNode* statement : node->body) fn(statement);
+}
+template <typename F> void forEachChild(const ForStatementNode* node, F&& fn) {
+    if (node->init) fn(node->init);
+    if (node->condition) fn(node->condition);
+    if (node->update) fn(node->update);
+    for (const StatementNode* statement : node->body) fn(statement);
+}
+template <typename F> void forEachChild(const ScanfStatementNode* node, F&& fn) {
+    fn(node->target);
+}
+template <typename F> void forEachChild(const PrintfStatementNode* node, F&& fn) {
+    if (node->argument) fn(node->argument);
+}
+template <typename F> void forEachChild(const ReturnStatementNode* node, F&& fn) {
+    if (node->returnValue) fn(node->returnValue);
+}
+template <typename F> void forEachChild(const BinaryExpressionNode* node, F&& fn) {
+    fn(node->left);
+    fn(node->right);
+}
+template <typename F> void forEachChild(const UnaryExpressionNode* node, F&& fn) {
+    fn(node->operand);
+}
+template <typename F> void forEachChild(const IdentifierNode*, F&&) {}
+template <typename F> void forEachChild(const ArrayIndexNode* node, F&& fn) {
+    fn(node->index);
+}
+template <typename F> void forEachChild(const CallNode* node, F&& fn) {
+    for (const ExpressionNode* argument : node->arguments) fn(argument);
+}
+template <typename F> void forEachChild(const IntegerLiteralNode*, F&&) {}
+template <typename F> void forEachChild(const FloatLiteralNode*, F&&) {}
+template <typename F> void forEachChild(const CharLiteralNode*, F&&) {}
+template <typename F> void forEachChild(const StringLiteralNode*, F&&) {}
+template <typename F> void forEachChild(const ErrorExpressionNode*, F&&) {}
+
+// Dispatches on the node's kind first.
+template <typename F> void forEachChild(const AstNode* node, F&& fn) {
+    switch (node->kind) {
+#define AST_FOR_EACH_CHILD_CASE(Name) \
+    case NodeKind::Name: forEachChild(static_cast<const Name##Node*>(node), fn); break;
+    AST_NODE_LIST(AST_FOR_EACH_CHILD_CASE)
+#undef AST_FOR_EACH_CHILD_CASE
+    }
+}
+
+class AstVisitor {
+public:
+    virtual ~AstVisitor() = default;
+
+#define AST_VISITOR_METHOD(Name) virtual void visit##Name(const Name##Node* node);
+    AST_NODE_LIST(AST_VISITOR_METHOD)
+#undef AST_VISITOR_METHOD
+
+    // Dispatches on node->kind to the matching visit method.
+    void visit(const AstNode* node);
+};
+
+template <typename Derived>
+class AstWalker {
+public:
+    void walk(const AstNode* node) {
+        switch (node->kind) {
+#define AST_WALKER_CASE(Name) \
+        case NodeKind::Name: derived().visit##Name(static_cast<const Name##Node*>(node)); break;
+        AST_NODE_LIST(AST_WALKER_CASE)
+#undef AST_WALKER_CASE
+        }
+    }
+
+    // Default behavior: descend. Derived hides these to handle a node kind.
+#define AST_WALKER_METHOD(Name) void visit##Name(const Name##Node* node) { visitChildren(node); }
+    AST_NODE_LIST(AST_WALKER_METHOD)
+#undef AST_WALKER_METHOD
+
+    template <typename Node>
+    void visitChildren(const Node* node) {
+        forEachChild(node, [this](const AstNode* child) { walk(child); });
+    }
+
+private:
+    Derived& derived() { return static_cast<Derived&>(*this); }
+};
+
+#endif // ASTVISITOR_H
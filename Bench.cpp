@@ -0,0 +1,54 @@
+// Bench.cpp
+#include "Bench.h"
+#include "BytecodeCompiler.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "SemanticAnalyzer.h"
+#include "Vm.h"
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+bool checkProgram(CompilationUnit& unit) {
+    unit.tokens = Lexer(unit.source).getAllTokens();
+    unit.program = Parser(unit.tokens, unit.astArena, unit.diagnostics).parseProgram();
+    if (!unit.diagnostics.empty() || !SemanticAnalyzer(unit.tokens, unit.diagnostics, unit.semantics).analyze(unit.program)) {
+        unit.diagnostics.printAll(*unit.source, std::cerr);
+        return false;
+    }
+    return true;
+}
+
+std::string readCapture(std::FILE* capture) {
+    std::string text;
+    std::rewind(capture);
+    char buffer[256];
+    size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), capture)) > 0) text.append(buffer, read);
+    std::fclose(capture);
+    return text;
+}
+
+std::string vmOutput(const CompilationUnit& unit) {
+    std::string output;
+    BytecodeProgram program;
+    if (BytecodeCompiler(unit.tokens, unit.semantics).compile(unit.program, program)) {
+        Vm vm(program);
+        std::FILE* capture = std::tmpfile();
+        if (capture) vm.setOutput(capture);
+        bool ok = vm.run();
+        if (capture) output = readCapture(capture);
+        if (!ok) output += "error: " + vm.errorMessage();
+    }
+    return output;
+}
+
+std::string interpreterOutput(IrInterpreter& interpreter) {
+    std::FILE* capture = std::tmpfile();
+    if (capture) interpreter.setOutput(capture);
+    bool ok = interpreter.run();
+    std::string output = capture ? readCapture(capture) : std::string();
+    if (!ok) output += "error: " + interpreter.errorMessage();
+    return output;
+}
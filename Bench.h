@@ -0,0 +1,52 @@
+// Bench.h
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "CompilationUnit.h"
+#include "IrInterpreter.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Helpers shared by the --bench-* and --check-* modes of main.cpp, which run
+// tables of generated programs ("workloads") and report one line per program.
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start);
+
+struct Workload {
+    const char* name;
+    std::string text; // The generated source
+};
+
+// Calls run(workload, report) for each of the `count` workloads and prints
+// "<prefix>: <name>:<report>" on std::cerr for every one it returns true for.
+// A run that returns false has printed why it could not run the workload.
+template <typename Run>
+void runWorkloads(const char* prefix, const Workload* workloads, size_t count, Run run) {
+    for (size_t i = 0; i < count; ++i) {
+        std::ostringstream report;
+        if (!run(workloads[i], report)) continue;
+        std::cerr << prefix << ": " << workloads[i].name << ":" << report.str() << std::endl;
+    }
+}
+
+// Lexes, parses and checks the unit's source; false (after printing the
+// errors) on any error.
+bool checkProgram(CompilationUnit& unit);
+
+// Everything a generated program wrote to `capture` (a temporary file), which is closed.
+std::string readCapture(std::FILE* capture);
+
+// What the program prints on the VM, followed by its run-time error if any:
+// the reference the IR benchmarks compare every build with.
+std::string vmOutput(const CompilationUnit& unit);
+
+// Runs an IR build and returns what it prints in the form of vmOutput().
+std::string interpreterOutput(IrInterpreter& interpreter);
+
+#endif // BENCH_H
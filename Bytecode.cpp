@@ -0,0 +1,94 @@
+// Bytecode.cpp
+#include "Bytecode.h"
+#include <algorithm>
+#include <string>
+
+const char* opName(Op op) {
+    static const char* const kNames[] = {
+#define BYTECODE_OP_NAME(name, operands, effect) #name,
+        BYTECODE_OP_LIST(BYTECODE_OP_NAME)
+#undef BYTECODE_OP_NAME
+    };
+    return kNames[static_cast<size_t>(op)];
+}
+
+// printf without an argument prints its text; only "%%" needs translating.
+std::string printfText(std::string_view format) {
+    std::string text;
+    text.reserve(format.size());
+    for (size_t i = 0; i < format.size(); ++i) {
+        text += format[i];
+        if (format[i] == '%' && i + 1 < format.size() && format[i + 1] == '%') ++i;
+    }
+    return text;
+}
+
+// Bounds what scanf may write: a "%s" reads at most kMaxScanfString bytes (the
+// VM's buffer holds one more for the NUL) and a "%c" exactly one char, whatever
+// width the source gave. The semantic pass only allows digit widths in scanf.
+std::string boundScanfWidth(std::string_view format, IoKind kind) {
+    std::string result;
+    result.reserve(format.size() + 4);
+    for (size_t i = 0; i < format.size(); ++i) {
+        result += format[i];
+        if (format[i] != '%') continue;
+        if (i + 1 < format.size() && format[i + 1] == '%') {
+            result += format[++i];
+            continue;
+        }
+        size_t digits = i + 1;
+        while (digits < format.size() && format[digits] >= '0' && format[digits] <= '9') ++digits;
+        uint64_t width = 0;
+        for (size_t d = i + 1; d < digits && width <= kMaxScanfString; ++d) width = width * 10 + (format[d] - '0');
+        if (kind == IoKind::String) {
+            bool keep = digits > i + 1 && width > 0 && width <= kMaxScanfString;
+            result += keep ? std::string(format.substr(i + 1, digits - i - 1)) : std::to_string(kMaxScanfString);
+        }
+        else if (kind != IoKind::Char) {
+            result.append(format.substr(i + 1, digits - i - 1));
+        }
+        i = digits - 1;
+    }
+    return result;
+}
+
+uint32_t BytecodeProgram::sourceOffsetAt(uint32_t pc) const {
+    auto after = std::upper_bound(positions.begin(), positions.end(), pc,
+        [](uint32_t value, const Position& position) { return value < position.pc; });
+    return after == positions.begin() ? 0 : (after - 1)->offset;
+}
+
+void BytecodeProgram::disassemble(OutputBuffer& out) const {
+    // Function entries in code order; the code before the first one is the start-up code.
+    std::vector<const BytecodeFunction*> byEntry;
+    for (const BytecodeFunction& function : functions) byEntry.push_back(&function);
+    std::sort(byEntry.begin(), byEntry.end(),
+        [](const BytecodeFunction* a, const BytecodeFunction* b) { return a->entry < b->entry; });
+
+    out << "<start> (" << "globals ";
+    out.writeInt(globalCount);
+    out << "):\n";
+    size_t next = 0;
+    for (uint32_t pc = 0; pc < code.size();) {
+        if (next < byEntry.size() && byEntry[next]->entry == pc) {
+            const BytecodeFunction& function = *byEntry[next++];
+            out << function.name << " (params ";
+            out.writeInt(function.paramCount);
+            out << ", locals ";
+            out.writeInt(function.localCount);
+            out << ", frame ";
+            out.writeInt(function.frameSize);
+            out << "):\n";
+        }
+        Op op = static_cast<Op>(code[pc]);
+        char offset[8];
+        std::snprintf(offset, sizeof(offset), "%05u", pc);
+        out << "  " << offset << "  " << opName(op);
+        for (uint8_t i = 1; i <= kOpOperandCount[code[pc]]; ++i) {
+            out << ' ';
+            out.writeInt(static_cast<int32_t>(code[pc + i]));
+        }
+        out << '\n';
+        pc += 1 + kOpOperandCount[code[pc]];
+    }
+}
@@ -0,0 +1,146 @@
+// Bytecode.h
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "OutputBuffer.h"
+#include "StringPool.h"
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The instruction set of the stack VM (see Vm.h), produced by BytecodeCompiler.
+// X(Name, operands, stack effect): every instruction is one opcode word followed
+// by `operands` operand words; the effect is the change in operand stack depth
+// (that of Call depends on the callee and is accounted for by the compiler).
+//
+// Instructions are typed: the semantic pass already knows every expression's
+// type, so there is an int and a float variant of each operator and no tag is
+// checked at run time. Ints are 32-bit and wrap around; floats are doubles;
+// chars are ints kept in signed char range; strings are immutable.
+#define BYTECODE_OP_LIST(X)                                                      \
+    X(Halt, 0, 0)                                                                \
+    X(Pop, 0, -1)                                                                \
+    X(Dup, 0, 1)                                                                 \
+    X(PushInt, 1, 1)            /* immediate */                                  \
+    X(PushConst, 1, 1)          /* constant index */                             \
+    X(LoadLocal, 1, 1)          /* frame slot */                                 \
+    X(StoreLocal, 1, -1)                                                         \
+    X(LoadGlobal, 1, 1)         /* global slot */                                \
+    X(StoreGlobal, 1, -1)                                                        \
+    X(LoadLocalElem, 2, 0)      /* base slot, size; index on the stack */        \
+    X(StoreLocalElem, 2, -2)    /* index, value on the stack */                  \
+    X(LoadGlobalElem, 2, 0)                                                      \
+    X(StoreGlobalElem, 2, -2)                                                    \
+    X(FillLocal, 2, -1)         /* base slot, count; value on the stack */       \
+    X(FillGlobal, 2, -1)                                                         \
+    X(AddrLocal, 1, 1)          /* pushes a reference to a slot (for scanf) */   \
+    X(AddrGlobal, 1, 1)                                                          \
+    X(AddrLocalElem, 2, 0)                                                       \
+    X(AddrGlobalElem, 2, 0)                                                      \
+    X(IncLocal, 2, 0)           /* slot, delta: int ++ and -- */                 \
+    X(IncGlobal, 2, 0)                                                           \
+    X(AddI, 0, -1) X(SubI, 0, -1) X(MulI, 0, -1) X(DivI, 0, -1) X(ModI, 0, -1)   \
+    X(ShlI, 0, -1) X(ShrI, 0, -1) X(AndI, 0, -1) X(OrI, 0, -1) X(XorI, 0, -1)    \
+    X(LtI, 0, -1) X(LeI, 0, -1) X(GtI, 0, -1) X(GeI, 0, -1) X(EqI, 0, -1) X(NeI, 0, -1) \
+    X(NegI, 0, 0) X(NotI, 0, 0) X(BitNotI, 0, 0) X(BoolI, 0, 0)                  \
+    X(AddF, 0, -1) X(SubF, 0, -1) X(MulF, 0, -1) X(DivF, 0, -1)                  \
+    X(LtF, 0, -1) X(LeF, 0, -1) X(GtF, 0, -1) X(GeF, 0, -1) X(EqF, 0, -1) X(NeF, 0, -1) \
+    X(NegF, 0, 0) X(NotF, 0, 0) X(BoolF, 0, 0)                                   \
+    X(IToF, 0, 0) X(FToI, 0, 0) X(IToC, 0, 0)                                    \
+    X(Jump, 1, 0)               /* code offset */                                \
+    X(JumpIfFalse, 1, -1)                                                        \
+    X(JumpIfTrue, 1, -1)                                                         \
+    X(JumpFalseOrPop, 1, -1)    /* && and ||: keep the deciding operand */       \
+    X(JumpTrueOrPop, 1, -1)                                                      \
+    X(JumpIfLtI, 1, -2)         /* compare the two ints on top and branch */     \
+    X(JumpIfLeI, 1, -2) X(JumpIfGtI, 1, -2) X(JumpIfGeI, 1, -2)                  \
+    X(JumpIfEqI, 1, -2) X(JumpIfNeI, 1, -2)                                      \
+    X(Call, 1, 0)               /* function index; arguments on the stack */     \
+    X(Return, 0, 0)                                                              \
+    X(ReturnValue, 0, -1)                                                        \
+    X(PrintText, 1, 0)          /* constant index of the text */                 \
+    X(Printf, 2, -1)            /* format constant, IoKind; argument on the stack */ \
+    X(Scanf, 2, -1)             /* format constant, IoKind; reference on the stack */
+
+enum class Op : uint8_t {
+#define BYTECODE_OP_ENUM(name, operands, effect) name,
+    BYTECODE_OP_LIST(BYTECODE_OP_ENUM)
+#undef BYTECODE_OP_ENUM
+};
+
+constexpr uint8_t kOpOperandCount[] = {
+#define BYTECODE_OP_OPERANDS(name, operands, effect) operands,
+    BYTECODE_OP_LIST(BYTECODE_OP_OPERANDS)
+#undef BYTECODE_OP_OPERANDS
+};
+constexpr int8_t kOpStackEffect[] = {
+#define BYTECODE_OP_EFFECT(name, operands, effect) effect,
+    BYTECODE_OP_LIST(BYTECODE_OP_EFFECT)
+#undef BYTECODE_OP_EFFECT
+};
+constexpr size_t kOpCount = sizeof(kOpOperandCount);
+
+const char* opName(Op op);
+
+// One stack slot, global or array element. The instruction decides which
+// member is live.
+union Value {
+    int32_t i;
+    double f;
+    const char* s;  // NUL-terminated, in a StringPool (never freed while running)
+    Value* ref;     // Only between AddrXxx and Scanf
+};
+static_assert(sizeof(Value) == 8, "one word per slot");
+
+// Ints wrap around like the unsigned arithmetic they are computed in.
+inline int32_t wrapInt(uint32_t value) { return static_cast<int32_t>(value); }
+
+// Out-of-range and NaN conversions give INT_MIN, as x86's cvttsd2si does.
+inline int32_t floatToInt(double value) {
+    if (!(value >= -2147483648.0 && value < 2147483648.0)) return INT_MIN;
+    return static_cast<int32_t>(value);
+}
+
+// How Printf passes its argument and how Scanf stores what it read.
+enum class IoKind : uint8_t { Int, Float, Char, String };
+constexpr uint32_t kMaxScanfString = 4095; // Longest string one "%s" may read
+
+// The text a printf without an argument prints ("%%" becomes "%").
+std::string printfText(std::string_view format);
+// The format with its width bounded to what one IoKind target can hold.
+std::string boundScanfWidth(std::string_view format, IoKind kind);
+
+struct BytecodeFunction {
+    std::string_view name;
+    uint32_t entry;      // Code offset of the first instruction
+    uint32_t paramCount; // Arguments become the first frame slots
+    uint32_t localCount; // Parameters included
+    uint32_t frameSize;  // localCount plus the deepest operand stack
+};
+
+// BytecodeProgram: Everything the VM needs, independent of the AST and tokens.
+// Execution starts at offset 0, which initializes the globals, calls main and halts.
+struct BytecodeProgram {
+    std::vector<uint32_t> code;
+    std::vector<Value> constants;
+    StringPool strings; // Bytes of string constants and formats
+    std::vector<BytecodeFunction> functions;
+    uint32_t globalCount = 0;
+    uint32_t startDepth = 0;       // Deepest operand stack of the start-up code
+    bool mainReturnsValue = false; // int main(): its value is the exit status
+
+    // Source offsets of the instructions that can fail at run time, for errors.
+    struct Position {
+        uint32_t pc;
+        uint32_t offset;
+    };
+    std::vector<Position> positions;
+    uint32_t sourceOffsetAt(uint32_t pc) const; // Of the last recorded instruction at or before pc
+
+    // One line per instruction, grouped by function.
+    void disassemble(OutputBuffer& out) const;
+};
+
+#endif // BYTECODE_H
@@ -0,0 +1,677 @@
+// BytecodeCompiler.cpp
+#include "BytecodeCompiler.h"
+#include <algorithm>
+
+namespace {
+
+const uint32_t kNoStorage = ~0u;
+
+// Arrays declare their size with an integer literal or through their initializer.
+uint32_t arraySize(const TokenBuffer& tokens, const ArrayDeclarationNode* node) {
+    if (node->sizeToken == kNoToken) return node->elements.count;
+    return static_cast<uint32_t>(tokens.literal(node->sizeToken).integer);
+}
+
+IoKind ioKindOf(ValueType type) {
+    switch (type) {
+    case ValueType::Float: return IoKind::Float;
+    case ValueType::Char: return IoKind::Char;
+    case ValueType::String: return IoKind::String;
+    default: return IoKind::Int;
+    }
+}
+
+Op integerOperator(BinaryOp op) {
+    switch (op) {
+    case BinaryOp::Add: return Op::AddI;
+    case BinaryOp::Subtract: return Op::SubI;
+    case BinaryOp::Multiply: return Op::MulI;
+    case BinaryOp::Divide: return Op::DivI;
+    case BinaryOp::Modulo: return Op::ModI;
+    case BinaryOp::Less: return Op::LtI;
+    case BinaryOp::LessEqual: return Op::LeI;
+    case BinaryOp::Greater: return Op::GtI;
+    case BinaryOp::GreaterEqual: return Op::GeI;
+    case BinaryOp::Equal: return Op::EqI;
+    case BinaryOp::NotEqual: return Op::NeI;
+    case BinaryOp::ShiftLeft: return Op::ShlI;
+    case BinaryOp::ShiftRight: return Op::ShrI;
+    case BinaryOp::BitAnd: return Op::AndI;
+    case BinaryOp::BitOr: return Op::OrI;
+    default: return Op::XorI;
+    }
+}
+
+// Only arithmetic and comparisons take floats (see SemanticAnalyzer::finishOperator).
+Op floatOperator(BinaryOp op) {
+    switch (op) {
+    case BinaryOp::Add: return Op::AddF;
+    case BinaryOp::Subtract: return Op::SubF;
+    case BinaryOp::Multiply: return Op::MulF;
+    case BinaryOp::Divide: return Op::DivF;
+    case BinaryOp::Less: return Op::LtF;
+    case BinaryOp::LessEqual: return Op::LeF;
+    case BinaryOp::Greater: return Op::GtF;
+    case BinaryOp::GreaterEqual: return Op::GeF;
+    case BinaryOp::Equal: return Op::EqF;
+    default: return Op::NeF;
+    }
+}
+
+// The fused compare-and-branch for an int comparison, or its negation.
+bool branchOperator(BinaryOp op, bool jumpIfTrue, Op& branch) {
+    static const BinaryOp kNegated[] = {
+        BinaryOp::GreaterEqual, BinaryOp::Greater, BinaryOp::LessEqual, BinaryOp::Less,
+        BinaryOp::NotEqual, BinaryOp::Equal,
+    };
+    if (op < BinaryOp::Less || op > BinaryOp::NotEqual) return false;
+    if (!jumpIfTrue) op = kNegated[static_cast<int>(op) - static_cast<int>(BinaryOp::Less)];
+    switch (op) {
+    case BinaryOp::Less: branch = Op::JumpIfLtI; break;
+    case BinaryOp::LessEqual: branch = Op::JumpIfLeI; break;
+    case BinaryOp::Greater: branch = Op::JumpIfGtI; break;
+    case BinaryOp::GreaterEqual: branch = Op::JumpIfGeI; break;
+    case BinaryOp::Equal: branch = Op::JumpIfEqI; break;
+    default: branch = Op::JumpIfNeI; break;
+    }
+    return true;
+}
+
+} // namespace
+
+BytecodeCompiler::BytecodeCompiler(const TokenBuffer& tokens, const SemanticInfo& info)
+    : tokens_(tokens), info_(info) {}
+
+bool BytecodeCompiler::compile(const ProgramNode* program, BytecodeProgram& out) {
+    program_ = &out;
+    storageOf_.assign(tokens_.size(), kNoStorage);
+    storages_.clear();
+    functions_.clear();
+    emptyString_ = addString("");
+
+    // Functions are numbered in declaration order, so calls may precede the callee.
+    const FunctionDefinitionNode* mainFunction = nullptr;
+    uint32_t mainIndex = 0;
+    for (const FunctionDefinitionNode* function : program->functions) {
+        uint32_t index = static_cast<uint32_t>(functions_.size());
+        storageOf_[function->identifierToken] = static_cast<uint32_t>(storages_.size());
+        storages_.push_back(Storage{ StorageKind::Function,
+            valueTypeOfKeyword(tokens_.type(function->returnTypeToken)), false, index, 0 });
+        functions_.push_back(function);
+        std::string_view name = out.strings.store(tokens_.lexeme(function->identifierToken));
+        out.functions.push_back(BytecodeFunction{ name, 0, function->parameters.count, 0, 0 });
+        if (name == "main") {
+            mainFunction = function;
+            mainIndex = index;
+        }
+    }
+    if (!mainFunction) {
+        error_ = "Program has no main function";
+        return false;
+    }
+    if (!mainFunction->parameters.empty()) {
+        error_ = "main must not take parameters";
+        return false;
+    }
+
+    // Start-up code: initialize the globals in order, then run main.
+    depth_ = maxDepth_ = 0;
+    for (const StatementNode* global : program->globals) declareGlobal(global);
+    out.mainReturnsValue = storages_[storageOf_[mainFunction->identifierToken]].type != ValueType::Void;
+    emit(Op::Call, static_cast<int32_t>(mainIndex));
+    if (out.mainReturnsValue) adjustDepth(1);
+    emit(Op::Halt);
+    out.startDepth = static_cast<uint32_t>(maxDepth_);
+
+    for (size_t i = 0; i < functions_.size(); ++i) compileFunction(functions_[i], static_cast<uint32_t>(i));
+    return true;
+}
+
+// --- Emission ---
+
+void BytecodeCompiler::emit(Op op) {
+    program_->code.push_back(static_cast<uint32_t>(op));
+    adjustDepth(kOpStackEffect[static_cast<size_t>(op)]);
+}
+
+void BytecodeCompiler::emit(Op op, int32_t operand) {
+    emit(op);
+    program_->code.push_back(static_cast<uint32_t>(operand));
+}
+
+void BytecodeCompiler::emit(Op op, int32_t first, int32_t second) {
+    emit(op);
+    program_->code.push_back(static_cast<uint32_t>(first));
+    program_->code.push_back(static_cast<uint32_t>(second));
+}
+
+uint32_t BytecodeCompiler::emitJump(Op op) {
+    emit(op, 0);
+    return here() - 1;
+}
+
+void BytecodeCompiler::adjustDepth(int delta) {
+    depth_ += delta;
+    maxDepth_ = std::max(maxDepth_, depth_);
+}
+
+void BytecodeCompiler::mark(TokenIndex token) {
+    program_->positions.push_back(BytecodeProgram::Position{ here(), tokens_.offset(token) });
+}
+
+uint32_t BytecodeCompiler::addConstant(Value value) {
+    program_->constants.push_back(value);
+    return static_cast<uint32_t>(program_->constants.size() - 1);
+}
+
+uint32_t BytecodeCompiler::addString(std::string_view text) {
+    // Stored with the NUL, so the VM can hand the bytes straight to stdio.
+    std::string_view stored = program_->strings.store(std::string(text) + '\0');
+    Value value;
+    value.s = stored.data();
+    return addConstant(value);
+}
+
+// --- Declarations ---
+
+void BytecodeCompiler::declareGlobal(const StatementNode* declaration) {
+    const bool isArray = declaration->kind == NodeKind::ArrayDeclaration;
+    TokenIndex typeToken, nameToken;
+    uint32_t size = 1;
+    if (isArray) {
+        const ArrayDeclarationNode* node = static_cast<const ArrayDeclarationNode*>(declaration);
+        typeToken = node->typeToken;
+        nameToken = node->nameToken;
+        size = arraySize(tokens_, node);
+    }
+    else {
+        const VariableDeclarationNode* node = static_cast<const VariableDeclarationNode*>(declaration);
+        typeToken = node->typeToken;
+        nameToken = node->nameToken;
+    }
+    storageOf_[nameToken] = static_cast<uint32_t>(storages_.size());
+    storages_.push_back(Storage{ StorageKind::Global, valueTypeOfKeyword(tokens_.type(typeToken)),
+        isArray, program_->globalCount, size });
+    program_->globalCount += size;
+    compileDeclaration(declaration, storages_.back());
+}
+
+uint32_t BytecodeCompiler::allocateLocals(uint32_t count) {
+    uint32_t first = nextLocal_;
+    nextLocal_ += count;
+    maxLocals_ = std::max(maxLocals_, nextLocal_);
+    return first;
+}
+
+void BytecodeCompiler::compileDeclaration(const StatementNode* declaration, const Storage& storage) {
+    const bool global = storage.kind == StorageKind::Global;
+    const int32_t slot = static_cast<int32_t>(storage.slot);
+    if (!storage.isArray) {
+        const ExpressionNode* initializer = static_cast<const VariableDeclarationNode*>(declaration)->initializer;
+        if (initializer) {
+            compileExpression(initializer);
+            convert(typeOf(initializer), storage.type);
+        }
+        else {
+            pushDefault(storage.type);
+        }
+        emit(global ? Op::StoreGlobal : Op::StoreLocal, slot);
+        return;
+    }
+
+    const NodeList<ExpressionNode>& elements = static_cast<const ArrayDeclarationNode*>(declaration)->elements;
+    pushDefault(storage.type);
+    emit(global ? Op::FillGlobal : Op::FillLocal, slot, static_cast<int32_t>(storage.size));
+    for (uint32_t i = 0; i < elements.count && i < storage.size; ++i) {
+        compileExpression(elements[i]);
+        convert(typeOf(elements[i]), storage.type);
+        emit(global ? Op::StoreGlobal : Op::StoreLocal, slot + static_cast<int32_t>(i));
+    }
+}
+
+void BytecodeCompiler::pushDefault(ValueType type) {
+    Value zero;
+    switch (type) {
+    case ValueType::Float:
+        zero.f = 0.0;
+        emit(Op::PushConst, static_cast<int32_t>(addConstant(zero)));
+        break;
+    case ValueType::String:
+        emit(Op::PushConst, static_cast<int32_t>(emptyString_));
+        break;
+    default:
+        emit(Op::PushInt, 0);
+        break;
+    }
+}
+
+// --- Statements ---
+
+void BytecodeCompiler::compileFunction(const FunctionDefinitionNode* function, uint32_t index) {
+    function_ = function;
+    returnType_ = valueTypeOfKeyword(tokens_.type(function->returnTypeToken));
+    nextLocal_ = maxLocals_ = 0;
+    depth_ = maxDepth_ = 0;
+    scopeMarks_.clear();
+
+    BytecodeFunction& compiled = program_->functions[index];
+    compiled.entry = here();
+    for (const ParameterNode* parameter : function->parameters) {
+        storageOf_[parameter->nameToken] = static_cast<uint32_t>(storages_.size());
+        storages_.push_back(Storage{ StorageKind::Local, valueTypeOfKeyword(tokens_.type(parameter->typeToken)),
+            false, allocateLocals(1), 1 });
+    }
+    compileBody(function->body);
+
+    // Falling off the end returns (the default value of a non-void function).
+    if (returnType_ == ValueType::Void) {
+        emit(Op::Return);
+    }
+    else {
+        pushDefault(returnType_);
+        emit(Op::ReturnValue);
+    }
+    compiled.localCount = maxLocals_;
+    compiled.frameSize = maxLocals_ + static_cast<uint32_t>(maxDepth_);
+}
+
+void BytecodeCompiler::compileBody(NodeList<StatementNode> body) {
+    const size_t statementBase = statements_.size();
+    for (size_t i = body.count; i-- > 0;) statements_.push_back(PendingStatement{ body[i], 0, 0, 0 });
+    while (statements_.size() > statementBase) {
+        PendingStatement item = statements_.back();
+        statements_.pop_back();
+        compileStatement(item);
+    }
+}
+
+void BytecodeCompiler::pushBlock(NodeList<StatementNode> block) {
+    statements_.push_back(PendingStatement{ nullptr, 1, 0, 0 });
+    for (size_t i = block.count; i-- > 0;) statements_.push_back(PendingStatement{ block[i], 0, 0, 0 });
+    statements_.push_back(PendingStatement{ nullptr, 0, 0, 0 });
+}
+
+void BytecodeCompiler::compileStatement(const PendingStatement& item) {
+    const StatementNode* statement = item.node;
+    if (!statement) {
+        // Sibling blocks reuse the slots of the block before them.
+        if (item.state == 0) {
+            scopeMarks_.push_back(nextLocal_);
+        }
+        else {
+            nextLocal_ = scopeMarks_.back();
+            scopeMarks_.pop_back();
+        }
+        return;
+    }
+
+    switch (statement->kind) {
+    case NodeKind::VariableDeclaration:
+    case NodeKind::ArrayDeclaration: {
+        TokenIndex typeToken, nameToken;
+        uint32_t size = 1;
+        const bool isArray = statement->kind == NodeKind::ArrayDeclaration;
+        if (isArray) {
+            const ArrayDeclarationNode* node = static_cast<const ArrayDeclarationNode*>(statement);
+            typeToken = node->typeToken;
+            nameToken = node->nameToken;
+            size = arraySize(tokens_, node);
+        }
+        else {
+            const VariableDeclarationNode* node = static_cast<const VariableDeclarationNode*>(statement);
+            typeToken = node->typeToken;
+            nameToken = node->nameToken;
+        }
+        // The initializer was resolved before the name was declared, so it
+        // never reads the slot it initializes.
+        storageOf_[nameToken] = static_cast<uint32_t>(storages_.size());
+        storages_.push_back(Storage{ StorageKind::Local, valueTypeOfKeyword(tokens_.type(typeToken)),
+            isArray, allocateLocals(size), size });
+        compileDeclaration(statement, storages_.back());
+        break;
+    }
+    case NodeKind::Assignment:
+    case NodeKind::ExpressionStatement:
+    case NodeKind::IncrementStatement:
+        compileSimpleStatement(statement);
+        break;
+    case NodeKind::IfStatement: {
+        const IfStatementNode* node = static_cast<const IfStatementNode*>(statement);
+        if (item.state == 0) {
+            uint32_t skipThen = compileBranch(node->condition, false);
+            statements_.push_back(PendingStatement{ statement, 1, skipThen, 0 });
+            pushBlock(node->thenBody);
+        }
+        else if (item.state == 1 && !node->elseBody.empty()) {
+            uint32_t skipElse = emitJump(Op::Jump);
+            patch(item.a);
+            statements_.push_back(PendingStatement{ statement, 2, skipElse, 0 });
+            pushBlock(node->elseBody);
+        }
+        else {
+            patch(item.a);
+        }
+        break;
+    }
+    case NodeKind::WhileStatement: {
+        // Jump to the test at the bottom; the body starts at `b`.
+        const WhileStatementNode* node = static_cast<const WhileStatementNode*>(statement);
+        if (item.state == 0) {
+            uint32_t toTest = emitJump(Op::Jump);
+            statements_.push_back(PendingStatement{ statement, 1, toTest, here() });
+            pushBlock(node->body);
+        }
+        else {
+            patch(item.a);
+            program_->code[compileBranch(node->condition, true)] = item.b;
+        }
+        break;
+    }
+    case NodeKind::ForStatement: {
+        const ForStatementNode* node = static_cast<const ForStatementNode*>(statement);
+        if (item.state == 0) {
+            if (node->init) compileSimpleStatement(node->init);
+            uint32_t toTest = emitJump(Op::Jump);
+            statements_.push_back(PendingStatement{ statement, 1, toTest, here() });
+            pushBlock(node->body);
+        }
+        else {
+            if (node->update) compileSimpleStatement(node->update);
+            patch(item.a);
+            if (node->condition) program_->code[compileBranch(node->condition, true)] = item.b;
+            else emit(Op::Jump, static_cast<int32_t>(item.b));
+        }
+        break;
+    }
+    case NodeKind::ScanfStatement:
+        compileScanf(static_cast<const ScanfStatementNode*>(statement));
+        break;
+    case NodeKind::PrintfStatement:
+        compilePrintf(static_cast<const PrintfStatementNode*>(statement));
+        break;
+    case NodeKind::ReturnStatement: {
+        const ReturnStatementNode* node = static_cast<const ReturnStatementNode*>(statement);
+        if (node->returnValue) {
+            compileExpression(node->returnValue);
+            convert(typeOf(node->returnValue), returnType_);
+            emit(Op::ReturnValue);
+        }
+        else {
+            emit(Op::Return);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void BytecodeCompiler::compileSimpleStatement(const StatementNode* statement) {
+    switch (statement->kind) {
+    case NodeKind::Assignment: {
+        const AssignmentNode* node = static_cast<const AssignmentNode*>(statement);
+        compileStore(node->target, node->value);
+        break;
+    }
+    case NodeKind::ExpressionStatement: {
+        const ExpressionNode* expression = static_cast<const ExpressionStatementNode*>(statement)->expression;
+        compileExpression(expression);
+        if (typeOf(expression) != ValueType::Void) emit(Op::Pop);
+        break;
+    }
+    case NodeKind::IncrementStatement:
+        compileIncrement(static_cast<const IncrementStatementNode*>(statement));
+        break;
+    default:
+        break;
+    }
+}
+
+void BytecodeCompiler::compileStore(const ExpressionNode* target, const ExpressionNode* value) {
+    if (target->kind == NodeKind::ArrayIndex) {
+        const ArrayIndexNode* element = static_cast<const ArrayIndexNode*>(target);
+        const Storage& storage = storageOf(element->nameToken);
+        compileExpression(element->index);
+        compileExpression(value);
+        convert(typeOf(value), storage.type);
+        mark(element->nameToken);
+        emit(storage.kind == StorageKind::Global ? Op::StoreGlobalElem : Op::StoreLocalElem,
+            static_cast<int32_t>(storage.slot), static_cast<int32_t>(storage.size));
+        return;
+    }
+    const Storage& storage = storageOf(static_cast<const IdentifierNode*>(target)->nameToken);
+    compileExpression(value);
+    convert(typeOf(value), storage.type);
+    emit(storage.kind == StorageKind::Global ? Op::StoreGlobal : Op::StoreLocal, static_cast<int32_t>(storage.slot));
+}
+
+void BytecodeCompiler::compileIncrement(const IncrementStatementNode* node) {
+    const Storage& storage = storageOf(node->nameToken);
+    const bool global = storage.kind == StorageKind::Global;
+    const int32_t slot = static_cast<int32_t>(storage.slot);
+    const int32_t delta = node->isIncrement ? 1 : -1;
+    if (storage.type == ValueType::Int) {
+        emit(global ? Op::IncGlobal : Op::IncLocal, slot, delta);
+        return;
+    }
+    emit(global ? Op::LoadGlobal : Op::LoadLocal, slot);
+    if (storage.type == ValueType::Float) {
+        Value one;
+        one.f = delta;
+        emit(Op::PushConst, static_cast<int32_t>(addConstant(one)));
+        emit(Op::AddF);
+    }
+    else {
+        emit(Op::PushInt, delta);
+        emit(Op::AddI);
+        emit(Op::IToC);
+    }
+    emit(global ? Op::StoreGlobal : Op::StoreLocal, slot);
+}
+
+uint32_t BytecodeCompiler::compileBranch(const ExpressionNode* condition, bool jumpIfTrue) {
+    while (condition->kind == NodeKind::UnaryExpression
+        && static_cast<const UnaryExpressionNode*>(condition)->op == UnaryOp::LogicalNot) {
+        condition = static_cast<const UnaryExpressionNode*>(condition)->operand;
+        jumpIfTrue = !jumpIfTrue;
+    }
+    if (condition->kind == NodeKind::BinaryExpression) {
+        const BinaryExpressionNode* binary = static_cast<const BinaryExpressionNode*>(condition);
+        Op branch;
+        if (isIntegral(typeOf(binary->left)) && isIntegral(typeOf(binary->right))
+            && branchOperator(binary->op, jumpIfTrue, branch)) {
+            compileExpression(binary->left);
+            compileExpression(binary->right);
+            return emitJump(branch);
+        }
+    }
+    compileExpression(condition);
+    if (typeOf(condition) == ValueType::Float) emit(Op::BoolF);
+    return emitJump(jumpIfTrue ? Op::JumpIfTrue : Op::JumpIfFalse);
+}
+
+void BytecodeCompiler::compilePrintf(const PrintfStatementNode* node) {
+    std::string_view format = tokens_.literal(node->formatToken).stringValue();
+    if (!node->argument) {
+        emit(Op::PrintText, static_cast<int32_t>(addString(printfText(format))));
+        return;
+    }
+    compileExpression(node->argument);
+    IoKind kind = ioKindOf(typeOf(node->argument));
+    if (kind == IoKind::Char) kind = IoKind::Int; // Promoted, as in a C call
+    emit(Op::Printf, static_cast<int32_t>(addString(format)), static_cast<int32_t>(kind));
+}
+
+void BytecodeCompiler::compileScanf(const ScanfStatementNode* node) {
+    const ExpressionNode* target = node->target;
+    const bool isElement = target->kind == NodeKind::ArrayIndex;
+    TokenIndex nameToken = isElement
+        ? static_cast<const ArrayIndexNode*>(target)->nameToken
+        : static_cast<const IdentifierNode*>(target)->nameToken;
+    const Storage& storage = storageOf(nameToken);
+    const bool global = storage.kind == StorageKind::Global;
+    if (isElement) {
+        compileExpression(static_cast<const ArrayIndexNode*>(target)->index);
+        mark(nameToken);
+        emit(global ? Op::AddrGlobalElem : Op::AddrLocalElem,
+            static_cast<int32_t>(storage.slot), static_cast<int32_t>(storage.size));
+    }
+    else {
+        emit(global ? Op::AddrGlobal : Op::AddrLocal, static_cast<int32_t>(storage.slot));
+    }
+    IoKind kind = ioKindOf(storage.type);
+    std::string format = boundScanfWidth(tokens_.literal(node->formatToken).stringValue(), kind);
+    emit(Op::Scanf, static_cast<int32_t>(addString(format)), static_cast<int32_t>(kind));
+}
+
+// --- Expressions ---
+
+void BytecodeCompiler::compileExpression(const ExpressionNode* root) {
+    const size_t expressionBase = expressions_.size();
+    expressions_.push_back(PendingExpression{ root, 0, 0 });
+    while (expressions_.size() > expressionBase) {
+        PendingExpression item = expressions_.back();
+        expressions_.pop_back();
+        compileExpressionStep(item);
+    }
+}
+
+void BytecodeCompiler::compileExpressionStep(PendingExpression item) {
+    const ExpressionNode* node = item.node;
+    switch (node->kind) {
+    case NodeKind::IntegerLiteral:
+        // Ints are 32-bit; a wider literal wraps like the arithmetic does.
+        emit(Op::PushInt, static_cast<int32_t>(static_cast<uint32_t>(
+            static_cast<const IntegerLiteralNode*>(node)->getValue(tokens_))));
+        break;
+    case NodeKind::FloatLiteral: {
+        Value value;
+        value.f = static_cast<const FloatLiteralNode*>(node)->getValue(tokens_);
+        emit(Op::PushConst, static_cast<int32_t>(addConstant(value)));
+        break;
+    }
+    case NodeKind::CharLiteral:
+        emit(Op::PushInt, static_cast<const CharLiteralNode*>(node)->getValue(tokens_));
+        break;
+    case NodeKind::StringLiteral:
+        emit(Op::PushConst, static_cast<int32_t>(addString(static_cast<const StringLiteralNode*>(node)->getValue(tokens_))));
+        break;
+    case NodeKind::Identifier: {
+        const Storage& storage = storageOf(static_cast<const IdentifierNode*>(node)->nameToken);
+        emit(storage.kind == StorageKind::Global ? Op::LoadGlobal : Op::LoadLocal, static_cast<int32_t>(storage.slot));
+        break;
+    }
+    case NodeKind::ArrayIndex: {
+        const ArrayIndexNode* element = static_cast<const ArrayIndexNode*>(node);
+        if (item.state == 0) {
+            expressions_.push_back(PendingExpression{ node, 1, 0 });
+            expressions_.push_back(PendingExpression{ element->index, 0, 0 });
+            break;
+        }
+        const Storage& storage = storageOf(element->nameToken);
+        mark(element->nameToken);
+        emit(storage.kind == StorageKind::Global ? Op::LoadGlobalElem : Op::LoadLocalElem,
+            static_cast<int32_t>(storage.slot), static_cast<int32_t>(storage.size));
+        break;
+    }
+    case NodeKind::UnaryExpression: {
+        const UnaryExpressionNode* unary = static_cast<const UnaryExpressionNode*>(node);
+        if (item.state == 0) {
+            expressions_.push_back(PendingExpression{ node, 1, 0 });
+            expressions_.push_back(PendingExpression{ unary->operand, 0, 0 });
+            break;
+        }
+        const bool isFloat = typeOf(unary->operand) == ValueType::Float;
+        switch (unary->op) {
+        case UnaryOp::Negate: emit(isFloat ? Op::NegF : Op::NegI); break;
+        case UnaryOp::LogicalNot: emit(isFloat ? Op::NotF : Op::NotI); break;
+        case UnaryOp::BitNot: emit(Op::BitNotI); break;
+        }
+        break;
+    }
+    case NodeKind::BinaryExpression: {
+        const BinaryExpressionNode* binary = static_cast<const BinaryExpressionNode*>(node);
+        if (binary->op == BinaryOp::LogicalAnd || binary->op == BinaryOp::LogicalOr) {
+            // Both sides become 0 or 1; the left one decides unless it is
+            // true for && (false for ||), in which case it is popped.
+            const ExpressionNode* side = item.state == 1 ? binary->left : binary->right;
+            if (item.state == 0) {
+                expressions_.push_back(PendingExpression{ node, 1, 0 });
+                expressions_.push_back(PendingExpression{ binary->left, 0, 0 });
+                break;
+            }
+            emit(typeOf(side) == ValueType::Float ? Op::BoolF : Op::BoolI);
+            if (item.state == 1) {
+                uint32_t shortCircuit = emitJump(binary->op == BinaryOp::LogicalAnd ? Op::JumpFalseOrPop : Op::JumpTrueOrPop);
+                expressions_.push_back(PendingExpression{ node, 2, shortCircuit });
+                expressions_.push_back(PendingExpression{ binary->right, 0, 0 });
+            }
+            else {
+                patch(item.patch);
+            }
+            break;
+        }
+        ValueType operandType = typeOf(binary->left) == ValueType::Float || typeOf(binary->right) == ValueType::Float
+            ? ValueType::Float : ValueType::Int;
+        if (item.state == 0) {
+            expressions_.push_back(PendingExpression{ node, 1, 0 });
+            expressions_.push_back(PendingExpression{ binary->left, 0, 0 });
+        }
+        else if (item.state == 1) {
+            convert(typeOf(binary->left), operandType);
+            expressions_.push_back(PendingExpression{ node, 2, 0 });
+            expressions_.push_back(PendingExpression{ binary->right, 0, 0 });
+        }
+        else {
+            convert(typeOf(binary->right), operandType);
+            if (operandType == ValueType::Float) {
+                emit(floatOperator(binary->op));
+            }
+            else {
+                if (binary->op == BinaryOp::Divide || binary->op == BinaryOp::Modulo) mark(binary->opToken);
+                emit(integerOperator(binary->op));
+            }
+        }
+        break;
+    }
+    case NodeKind::Call: {
+        // State i: arguments before i are on the stack, converted but the last.
+        const CallNode* call = static_cast<const CallNode*>(node);
+        const Storage& callee = storageOf(call->nameToken);
+        const NodeList<ParameterNode>& parameters = functions_[callee.slot]->parameters;
+        if (item.state > 0) {
+            convert(typeOf(call->arguments[item.state - 1]),
+                valueTypeOfKeyword(tokens_.type(parameters[item.state - 1]->typeToken)));
+        }
+        if (item.state < call->arguments.count) {
+            expressions_.push_back(PendingExpression{ node, item.state + 1, 0 });
+            expressions_.push_back(PendingExpression{ call->arguments[item.state], 0, 0 });
+            break;
+        }
+        mark(call->nameToken);
+        emit(Op::Call, static_cast<int32_t>(callee.slot));
+        adjustDepth(-static_cast<int>(call->arguments.count) + (callee.type == ValueType::Void ? 0 : 1));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void BytecodeCompiler::convert(ValueType from, ValueType to) {
+    if (from == to) return;
+    switch (to) {
+    case ValueType::Float:
+        if (isIntegral(from)) emit(Op::IToF);
+        break;
+    case ValueType::Int:
+        if (from == ValueType::Float) emit(Op::FToI);
+        break;
+    case ValueType::Char:
+        if (from == ValueType::Float) emit(Op::FToI);
+        if (isNumeric(from)) emit(Op::IToC);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,117 @@
+// BytecodeCompiler.h
+#ifndef BYTECODECOMPILER_H
+#define BYTECODECOMPILER_H
+
+#include "AstNode.h"
+#include "Bytecode.h"
+#include "SemanticInfo.h"
+#include "TokenBuffer.h"
+#include <string>
+#include <vector>
+
+// BytecodeCompiler: Translates a checked tree into a BytecodeProgram.
+// Names are bound through SemanticInfo::declarations and operators typed
+// through SemanticInfo::types, so the tree must have passed the
+// SemanticAnalyzer. Globals get global slots; parameters, locals and local
+// arrays get frame slots, reused by sibling blocks. Every declaration stores
+// its initial value (0, 0.0 or "" without an initializer), so the VM never
+// reads an uninitialized slot.
+//
+// Like the other passes it walks statements and expressions with explicit
+// stacks. Conditions compile to fused compare-and-branch instructions where
+// both operands are ints, and loops test their condition at the bottom, so an
+// iteration takes a single branch.
+class BytecodeCompiler {
+public:
+    BytecodeCompiler(const TokenBuffer& tokens, const SemanticInfo& info);
+
+    // Returns false (see error()) if the program has no main() without parameters.
+    bool compile(const ProgramNode* program, BytecodeProgram& out);
+    const std::string& error() const { return error_; }
+
+private:
+    enum class StorageKind : uint8_t { Global, Local, Function };
+    struct Storage {
+        StorageKind kind;
+        ValueType type;
+        bool isArray;
+        uint32_t slot; // Global or frame slot (the first element of an array), or function index
+        uint32_t size; // Array length
+    };
+
+    // Work items of the explicit-stack walks. `state` counts the children
+    // already compiled; `a` and `b` hold jump offsets to patch or jump back to.
+    struct PendingStatement {
+        const StatementNode* node; // nullptr for a scope boundary
+        uint8_t state;             // For a boundary: 0 opens a scope, 1 closes it
+        uint32_t a;
+        uint32_t b;
+    };
+    struct PendingExpression {
+        const ExpressionNode* node;
+        uint32_t state;
+        uint32_t patch;
+    };
+
+    const TokenBuffer& tokens_;
+    const SemanticInfo& info_;
+    BytecodeProgram* program_ = nullptr;
+    std::string error_;
+
+    std::vector<uint32_t> storageOf_; // By declaring name token: index into storages_
+    std::vector<Storage> storages_;
+    std::vector<const FunctionDefinitionNode*> functions_; // By function index
+    uint32_t emptyString_ = 0;        // Constant index of ""
+
+    // Per function
+    const FunctionDefinitionNode* function_ = nullptr;
+    ValueType returnType_ = ValueType::Void;
+    uint32_t nextLocal_ = 0;
+    uint32_t maxLocals_ = 0;
+    int depth_ = 0;    // Operand stack depth at the current instruction
+    int maxDepth_ = 0;
+    std::vector<uint32_t> scopeMarks_; // nextLocal_ at each open block
+    std::vector<PendingStatement> statements_;
+    std::vector<PendingExpression> expressions_;
+
+    // --- Emission ---
+    uint32_t here() const { return static_cast<uint32_t>(program_->code.size()); }
+    void emit(Op op);
+    void emit(Op op, int32_t operand);
+    void emit(Op op, int32_t first, int32_t second);
+    uint32_t emitJump(Op op); // Returns the operand to patch()
+    void patch(uint32_t operand) { program_->code[operand] = here(); }
+    void adjustDepth(int delta);
+    void mark(TokenIndex token); // The next instruction may fail at run time
+    uint32_t addConstant(Value value);
+    uint32_t addString(std::string_view text);
+
+    // --- Declarations ---
+    const Storage& storageOf(TokenIndex nameToken) const { return storages_[storageOf_[info_.declarationOf(nameToken)]]; }
+    void declareGlobal(const StatementNode* declaration);
+    uint32_t allocateLocals(uint32_t count);
+    void compileDeclaration(const StatementNode* declaration, const Storage& storage);
+    void pushDefault(ValueType type);
+
+    // --- Statements ---
+    void compileFunction(const FunctionDefinitionNode* function, uint32_t index);
+    void compileBody(NodeList<StatementNode> body);
+    void pushBlock(NodeList<StatementNode> block);
+    void compileStatement(const PendingStatement& item);
+    void compileSimpleStatement(const StatementNode* statement); // Also the for-loop header
+    void compileStore(const ExpressionNode* target, const ExpressionNode* value);
+    void compileIncrement(const IncrementStatementNode* node);
+    // Branches if the condition is true (false); returns the jump operand to
+    // patch() or to set to a backward target.
+    uint32_t compileBranch(const ExpressionNode* condition, bool jumpIfTrue);
+    void compilePrintf(const PrintfStatementNode* node);
+    void compileScanf(const ScanfStatementNode* node);
+
+    // --- Expressions ---
+    void compileExpression(const ExpressionNode* root);
+    void compileExpressionStep(PendingExpression item);
+    void convert(ValueType from, ValueType to);
+    ValueType typeOf(const ExpressionNode* node) const { return info_.typeOf(node); }
+};
+
+#endif // BYTECODECOMPILER_H
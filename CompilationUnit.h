@@ -0,0 +1,32 @@
+// CompilationUnit.h
+#ifndef COMPILATIONUNIT_H
+#define COMPILATIONUNIT_H
+
+#include "Arena.h"
+#include "AstNode.h"
+#include "Diagnostics.h"
+#include "SemanticInfo.h"
+#include "SourceBuffer.h"
+#include "TokenBuffer.h"
+#include <memory>
+#include <vector>
+
+// CompilationUnit: Everything that belongs to one parsed source.
+// It owns the source bytes, the token stream the AST refers to by index, and
+// the Arenas holding every AST node, so the whole tree is released at once, in
+// O(chunks), when the unit goes away. Lexical, syntax and semantic errors of
+// the unit are collected in `diagnostics`; `semantics` holds what the
+// SemanticAnalyzer resolved.
+struct CompilationUnit {
+    explicit CompilationUnit(std::shared_ptr<const SourceBuffer> src) : source(src), tokens(std::move(src)) {}
+
+    std::shared_ptr<const SourceBuffer> source;
+    TokenBuffer tokens;
+    Arena astArena;
+    ProgramNode* program = nullptr;
+    std::vector<Arena> workerArenas; // Functions parsed by ParallelParser live here
+    Diagnostics diagnostics;
+    SemanticInfo semantics;
+};
+
+#endif // COMPILATIONUNIT_H
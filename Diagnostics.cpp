@@ -0,0 +1,35 @@
+// Diagnostics.cpp
+#include "Diagnostics.h"
+#include <algorithm>
+
+void Diagnostics::printAll(const SourceBuffer& source, std::ostream& out) const {
+    // Lexical errors of a bulk-lexed input are all reported before the first
+    // syntax error, so order by position rather than by arrival.
+    std::vector<const Diagnostic*> ordered;
+    ordered.reserve(entries_.size());
+    for (const Diagnostic& diagnostic : entries_) ordered.push_back(&diagnostic);
+    std::stable_sort(ordered.begin(), ordered.end(),
+        [](const Diagnostic* a, const Diagnostic* b) { return a->offset < b->offset; });
+    for (const Diagnostic* diagnostic : ordered) print(source, *diagnostic, out);
+}
+
+void Diagnostics::print(const SourceBuffer& source, const Diagnostic& diagnostic, std::ostream& out) {
+    // Positions are only computed here, on the error path.
+    int line = 0;
+    int column = 0;
+    source.locate(diagnostic.offset, line, column);
+    switch (diagnostic.kind) {
+    case DiagnosticKind::Lexical:
+        out << "Lexical Error [Line " << line
+            << ", Col " << column
+            << " near '" << diagnostic.lexeme << "'"
+            << "]: " << diagnostic.message << std::endl;
+        break;
+    case DiagnosticKind::Syntax:
+        out << "Parser Error: " << diagnostic.message << " at line " << line << " col " << column << std::endl;
+        break;
+    case DiagnosticKind::Semantic:
+        out << "Semantic Error: " << diagnostic.message << " at line " << line << " col " << column << std::endl;
+        break;
+    }
+}
@@ -0,0 +1,59 @@
+// Diagnostics.h
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include "SourceBuffer.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Which phase found the problem; selects how it is printed.
+enum class DiagnosticKind : uint8_t {
+    Lexical,
+    Syntax,
+    Semantic,
+};
+
+// One error, positioned by byte offset. Line and column are only computed
+// when it is printed (see SourceBuffer::locate).
+struct Diagnostic {
+    DiagnosticKind kind;
+    uint32_t offset;          // Start of the offending token
+    std::string_view lexeme;  // The offending characters (views the source)
+    std::string message;
+};
+
+// Diagnostics: The error sink shared by the Lexer, the Parser and the
+// SemanticAnalyzer of one compilation, so a single run reports every error instead of stopping at the
+// first one. Reporting never throws or prints; the driver prints at the end.
+class Diagnostics {
+public:
+    void report(DiagnosticKind kind, uint32_t offset, std::string_view lexeme, std::string message) {
+        entries_.push_back(Diagnostic{ kind, offset, lexeme, std::move(message) });
+    }
+    void add(Diagnostic diagnostic) { entries_.push_back(std::move(diagnostic)); }
+
+    bool empty() const { return entries_.empty(); }
+    size_t size() const { return entries_.size(); }
+    const std::vector<Diagnostic>& entries() const { return entries_; }
+    std::vector<Diagnostic>::const_iterator begin() const { return entries_.begin(); }
+    std::vector<Diagnostic>::const_iterator end() const { return entries_.end(); }
+
+    // Drops the trailing entries at or after `offset` (used when a re-lex
+    // discards the tokens that raised them).
+    void discardFrom(uint32_t offset) {
+        while (!entries_.empty() && entries_.back().offset >= offset) entries_.pop_back();
+    }
+    void clear() { entries_.clear(); }
+
+    // Prints every entry in source order (stable for entries at the same offset).
+    void printAll(const SourceBuffer& source, std::ostream& out) const;
+    static void print(const SourceBuffer& source, const Diagnostic& diagnostic, std::ostream& out);
+
+private:
+    std::vector<Diagnostic> entries_;
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,81 @@
+// IncrementalLexer.cpp
+#include "IncrementalLexer.h"
+#include <algorithm>
+#include <string>
+
+std::shared_ptr<const SourceBuffer> IncrementalLexer::applyEdit(const SourceBuffer& old, uint32_t offset,
+    uint32_t removedLength, std::string_view inserted, TextEdit* edit) {
+    std::string_view text = old.text();
+    std::string edited;
+    edited.reserve(text.size() - removedLength + inserted.size());
+    edited.append(text.substr(0, offset));
+    edited.append(inserted);
+    edited.append(text.substr(offset + removedLength));
+    if (edit) {
+        *edit = TextEdit{ offset, removedLength, static_cast<uint32_t>(inserted.size()) };
+    }
+    return SourceBuffer::fromString(std::move(edited), old.name());
+}
+
+TokenBuffer IncrementalLexer::relex(const TokenBuffer& oldTokens, std::shared_ptr<const SourceBuffer> newSource, const TextEdit& edit) {
+    relexed_ = 0;
+    reused_ = 0;
+    errors_.clear();
+
+    const int64_t delta = static_cast<int64_t>(edit.insertedLength) - static_cast<int64_t>(edit.removedLength);
+    const uint32_t oldEditEnd = edit.offset + edit.removedLength;   // In old coordinates
+    const uint32_t newEditEnd = edit.offset + edit.insertedLength;  // In new coordinates
+
+    // Restart at the last token that starts at least Lexer::kMaxLookahead bytes
+    // before the edit: lexing everything before it only read unchanged bytes.
+    size_t restart = 0;      // Old tokens [0, restart) are kept as they are
+    uint32_t restartAt = 0;  // Where lexing resumes (0 if the edit touches the first token)
+    {
+        size_t lo = 0;
+        size_t hi = oldTokens.size();
+        while (lo < hi) { // First token too close to (or past) the edit
+            size_t mid = lo + (hi - lo) / 2;
+            if (oldTokens.offset(mid) + Lexer::kMaxLookahead <= edit.offset) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo > 0) {
+            restart = lo - 1;
+            restartAt = oldTokens.offset(restart);
+        }
+    }
+
+    TokenBuffer tokens(newSource);
+    // About one token per 4 bytes of size change; an edit that deletes more
+    // text than the old tokens cover must not turn the estimate negative.
+    tokens.reserve(static_cast<size_t>(std::max<int64_t>(0, static_cast<int64_t>(oldTokens.size()) + delta / 4) + 16));
+    tokens.append(oldTokens, 0, restart);
+    reused_ = restart;
+
+    Lexer lexer(newSource, mode_);
+    lexer.setErrorSink(&errors_);
+    lexer.seek(restartAt);
+
+    size_t candidate = restart; // Old token that may be the sync point
+    while (true) {
+        Token token = lexer.getNextToken();
+        if (token.offset >= newEditEnd) {
+            // Past the edit: is there an old token at the same (shifted) place?
+            int64_t oldOffset = static_cast<int64_t>(token.offset) - delta;
+            while (candidate < oldTokens.size() &&
+                   (oldTokens.offset(candidate) < oldEditEnd || oldTokens.offset(candidate) < oldOffset)) {
+                ++candidate;
+            }
+            if (candidate < oldTokens.size() && oldTokens.offset(candidate) == oldOffset) {
+                // In sync: every remaining token is the old one, shifted.
+                errors_.discardFrom(token.offset);
+                tokens.append(oldTokens, candidate, oldTokens.size(), delta);
+                reused_ += oldTokens.size() - candidate;
+                break;
+            }
+        }
+        tokens.push(token);
+        ++relexed_;
+        if (token.type == TokenType::END_OF_FILE) break;
+    }
+    return tokens;
+}
@@ -0,0 +1,54 @@
+// IncrementalLexer.h
+#ifndef INCREMENTALLEXER_H
+#define INCREMENTALLEXER_H
+
+#include "Lexer.h"
+#include "TokenBuffer.h"
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// TextEdit: Bytes [offset, offset + removedLength) of the old text were
+// replaced by insertedLength new bytes.
+struct TextEdit {
+    uint32_t offset;
+    uint32_t removedLength;
+    uint32_t insertedLength;
+};
+
+// Re-lexes only the part of a token stream that an edit can affect.
+//
+// Lexing restarts at the last old token that starts well before the edit
+// (every byte the Lexer looked at to get there is unchanged) and continues in the
+// new text until it produces a token starting at the shifted offset of an old
+// token past the edit. Since the Lexer's whole state is its position, the
+// rest of the old stream is then reused with offsets shifted by the size
+// change. The work is proportional to the edit, not to the file.
+class IncrementalLexer {
+public:
+    explicit IncrementalLexer(LexerMode mode = LexerMode::Table) : mode_(mode) {}
+
+    // Builds the edited source: `old` with the edited range replaced by `inserted`.
+    static std::shared_ptr<const SourceBuffer> applyEdit(const SourceBuffer& old, uint32_t offset,
+        uint32_t removedLength, std::string_view inserted, TextEdit* edit = nullptr);
+
+    // `oldTokens` must be the complete token stream of the text before `edit`,
+    // `newSource` the text after it.
+    TokenBuffer relex(const TokenBuffer& oldTokens, std::shared_ptr<const SourceBuffer> newSource, const TextEdit& edit);
+
+    // About the last relex(): tokens produced by the Lexer vs. reused from the
+    // old stream, and lexical errors found in the re-lexed range (errors of
+    // reused tokens were reported when they were first lexed).
+    size_t relexedCount() const { return relexed_; }
+    size_t reusedCount() const { return reused_; }
+    const Diagnostics& errors() const { return errors_; }
+
+private:
+    LexerMode mode_;
+    size_t relexed_ = 0;
+    size_t reused_ = 0;
+    Diagnostics errors_;
+};
+
+#endif // INCREMENTALLEXER_H
@@ -0,0 +1,77 @@
+// Interner.cpp
+#include "Interner.h"
+#include <cstring>
+
+namespace {
+const size_t kInitialSlots = 1024;
+}
+
+Interner::Interner() : slots_(kInitialSlots, Slot{0, kNoSymbol}) {
+}
+
+Interner& Interner::global() {
+    static Interner interner;
+    return interner;
+}
+
+uint32_t Interner::hash(std::string_view name) {
+    // Eight bytes at a time; identifiers are short, so this is one or two rounds.
+    const uint64_t kMultiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t h = name.size() * kMultiplier;
+    const char* p = name.data();
+    size_t left = name.size();
+    while (left >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        h = (h ^ word) * kMultiplier;
+        h ^= h >> 29;
+        p += 8;
+        left -= 8;
+    }
+    if (left > 0) {
+        uint64_t word = 0;
+        std::memcpy(&word, p, left);
+        h = (h ^ word) * kMultiplier;
+    }
+    h ^= h >> 32;
+    return static_cast<uint32_t>(h);
+}
+
+SymbolId Interner::find(std::string_view name) const {
+    uint32_t h = hash(name);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots_[i];
+        if (slot.id == kNoSymbol) return kNoSymbol;
+        if (slot.hash == h && names_[slot.id] == name) return slot.id;
+    }
+}
+
+SymbolId Interner::intern(std::string_view name) {
+    uint32_t h = hash(name);
+    size_t mask = slots_.size() - 1;
+    size_t i = h & mask;
+    for (;; i = (i + 1) & mask) {
+        const Slot& slot = slots_[i];
+        if (slot.id == kNoSymbol) break;
+        if (slot.hash == h && names_[slot.id] == name) return slot.id;
+    }
+
+    SymbolId id = static_cast<SymbolId>(names_.size());
+    names_.push_back(pool_.store(name));
+    hashes_.push_back(h);
+    slots_[i] = Slot{h, id};
+    if (names_.size() * 2 > slots_.size()) grow();
+    return id;
+}
+
+void Interner::grow() {
+    std::vector<Slot> slots(slots_.size() * 2, Slot{0, kNoSymbol});
+    size_t mask = slots.size() - 1;
+    for (SymbolId id = 0; id < names_.size(); ++id) {
+        size_t i = hashes_[id] & mask;
+        while (slots[i].id != kNoSymbol) i = (i + 1) & mask;
+        slots[i] = Slot{hashes_[id], id};
+    }
+    slots_.swap(slots);
+}
@@ -0,0 +1,57 @@
+// Interner.h
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include "StringPool.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Dense ID of an interned identifier: the n-th distinct name gets ID n.
+using SymbolId = uint32_t;
+constexpr SymbolId kNoSymbol = ~0u;
+
+// Interner: Gives every distinct identifier spelling a dense 32-bit ID, so
+// symbol tables and later passes compare and hash names as integers.
+// The table is open-addressed with linear probing; a slot holds the name's
+// full hash next to its ID, so a probe only touches the name bytes when the
+// hashes agree. Names are copied into a StringPool, so name() views stay valid
+// for the interner's lifetime, independent of the source they were lexed from.
+//
+// Not thread-safe: intern from one thread at a time (ParallelLexer interns
+// after its chunks are stitched, on the calling thread).
+class Interner {
+public:
+    Interner();
+
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+
+    // The ID of `name`, adding it on first sight.
+    SymbolId intern(std::string_view name);
+    // The ID of `name`, or kNoSymbol if it was never interned.
+    SymbolId find(std::string_view name) const;
+
+    std::string_view name(SymbolId id) const { return names_[id]; }
+    size_t size() const { return names_.size(); }
+    size_t bytesUsed() const { return pool_.bytesUsed(); }
+
+    // The process-wide interner the Lexer uses unless given another one.
+    static Interner& global();
+
+private:
+    struct Slot {
+        uint32_t hash;
+        SymbolId id; // kNoSymbol marks an empty slot
+    };
+
+    static uint32_t hash(std::string_view name);
+    void grow();
+
+    std::vector<Slot> slots_; // Power-of-two size, at most half full
+    std::vector<std::string_view> names_;  // Indexed by SymbolId
+    std::vector<uint32_t> hashes_;         // Indexed by SymbolId (for rehashing)
+    StringPool pool_;
+};
+
+#endif // INTERNER_H
@@ -0,0 +1,583 @@
+// Ir.cpp
+#include "Ir.h"
+#include "Bytecode.h"
+#include <algorithm>
+
+namespace {
+
+struct OpcodeInfo {
+    const char* mnemonic;
+    int operands;
+};
+
+const OpcodeInfo kOpcodes[] = {
+#define IR_OPCODE_INFO(name, mnemonic, operands) { mnemonic, operands },
+    IR_OPCODE_LIST(IR_OPCODE_INFO)
+#undef IR_OPCODE_INFO
+};
+
+std::string valueName(ValueId value) { return "%" + std::to_string(value); }
+std::string blockName(BlockId block) { return "b" + std::to_string(block); }
+
+bool isIntBinary(IrOp op) { return op >= IrOp::Add && op <= IrOp::Ne; }
+bool isFloatBinary(IrOp op) { return op >= IrOp::FAdd && op <= IrOp::FNe; }
+bool isMemoryAccess(IrOp op) { return op == IrOp::LoadElem || op == IrOp::StoreElem || op == IrOp::FillArray; }
+
+// The operand types an instruction requires (IrType::Void: any), or false
+// if its operands may have any type.
+bool requiredOperandType(const IrInstruction& instruction, uint32_t index, IrType& type) {
+    IrOp op = instruction.op;
+    if (isIntBinary(op) || op == IrOp::Neg || op == IrOp::Not || op == IrOp::BitNot
+        || op == IrOp::IToF || op == IrOp::IToC || op == IrOp::Branch) {
+        type = IrType::Int;
+        return true;
+    }
+    if (isFloatBinary(op) || op == IrOp::FNeg || op == IrOp::FToI) {
+        type = IrType::Float;
+        return true;
+    }
+    if ((op == IrOp::LoadElem || op == IrOp::StoreElem) && index == 0) {
+        type = IrType::Int;
+        return true;
+    }
+    if (op == IrOp::Phi || op == IrOp::Copy || op == IrOp::Scan) {
+        type = instruction.type;
+        return true;
+    }
+    return false;
+}
+
+void writeArray(OutputBuffer& out, const IrInstruction& instruction) {
+    out << ((instruction.flags & IrInstruction::kGlobalMemory) ? '@' : '$');
+    out.writeInt(instruction.aux);
+    out << '[';
+    out.writeInt(instruction.aux2);
+    out << ']';
+}
+
+void printInstruction(const IrModule& module, const IrFunction& function, ValueId id, OutputBuffer& out) {
+    const IrInstruction& instruction = function[id];
+    out << "  ";
+    if (instruction.type != IrType::Void) {
+        out << '%';
+        out.writeInt(id);
+        out << " = ";
+    }
+    out << irOpName(instruction.op);
+    if (instruction.type != IrType::Void) out << ' ' << irTypeToString(instruction.type);
+
+    const ValueId* operands = function.operandsOf(id);
+    bool first = true;
+    auto separate = [&]() {
+        out << (first ? " " : ", ");
+        first = false;
+    };
+    auto writeOperands = [&](uint32_t from) {
+        for (uint32_t i = from; i < instruction.operandCount; ++i) {
+            separate();
+            out << '%';
+            out.writeInt(operands[i]);
+        }
+    };
+
+    switch (instruction.op) {
+    case IrOp::Const:
+        out << ' ';
+        if (instruction.type == IrType::Float) out.writeDoubleExact(instruction.constant.f);
+        else out.writeInt(instruction.constant.i);
+        break;
+    case IrOp::String:
+        out << ' ';
+        out.writeJsonString(module.strings[instruction.aux]);
+        break;
+    case IrOp::Param:
+        out << ' ';
+        out.writeInt(instruction.aux);
+        break;
+    case IrOp::Phi: {
+        const IrBlock& block = function.blocks[instruction.block];
+        for (uint32_t i = 0; i < instruction.operandCount; ++i) {
+            separate();
+            out << "[%";
+            out.writeInt(operands[i]);
+            out << ", b";
+            out.writeInt(i < block.predecessors.size() ? block.predecessors[i] : kNoBlock);
+            out << ']';
+        }
+        break;
+    }
+    case IrOp::LoadGlobal:
+    case IrOp::StoreGlobal:
+        out << " @";
+        out.writeInt(instruction.aux);
+        first = false;
+        writeOperands(0);
+        break;
+    case IrOp::LoadElem:
+    case IrOp::StoreElem:
+    case IrOp::FillArray:
+        out << ' ';
+        writeArray(out, instruction);
+        first = false;
+        writeOperands(0);
+        break;
+    case IrOp::Call:
+        out << ' ' << module.functions[instruction.aux].name << '(';
+        for (uint32_t i = 0; i < instruction.operandCount; ++i) {
+            if (i) out << ", ";
+            out << '%';
+            out.writeInt(operands[i]);
+        }
+        out << ')';
+        break;
+    case IrOp::Print:
+    case IrOp::Scan:
+        out << ' ';
+        out.writeJsonString(module.strings[instruction.aux]);
+        first = false;
+        writeOperands(0);
+        break;
+    case IrOp::Jump:
+        out << " b";
+        out.writeInt(instruction.aux);
+        break;
+    case IrOp::Branch:
+        writeOperands(0);
+        out << ", b";
+        out.writeInt(instruction.aux);
+        out << ", b";
+        out.writeInt(instruction.aux2);
+        break;
+    default:
+        writeOperands(0);
+        break;
+    }
+    out << '\n';
+}
+
+} // namespace
+
+const char* irTypeToString(IrType type) {
+    switch (type) {
+    case IrType::Void: return "void";
+    case IrType::Int: return "int";
+    case IrType::Float: return "float";
+    case IrType::String: return "string";
+    }
+    return "?";
+}
+
+const char* irOpName(IrOp op) { return kOpcodes[static_cast<size_t>(op)].mnemonic; }
+int irOperandCount(IrOp op) { return kOpcodes[static_cast<size_t>(op)].operands; }
+
+bool isPure(IrOp op) {
+    switch (op) {
+    case IrOp::Div: case IrOp::Mod:  // Trap on a zero divisor
+    case IrOp::LoadElem:             // Traps out of bounds
+    case IrOp::StoreGlobal: case IrOp::StoreElem: case IrOp::FillArray:
+    case IrOp::Call: case IrOp::Print: case IrOp::Scan:
+    case IrOp::Jump: case IrOp::Branch: case IrOp::Return:
+    case IrOp::Nop:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool evaluateIr(IrOp op, IrConstant a, IrConstant b, IrConstant& result) {
+    const uint32_t x = static_cast<uint32_t>(a.i);
+    const uint32_t y = static_cast<uint32_t>(b.i);
+    switch (op) {
+    case IrOp::Copy: result = a; return true;
+    case IrOp::Add: result.i = wrapInt(x + y); return true;
+    case IrOp::Sub: result.i = wrapInt(x - y); return true;
+    case IrOp::Mul: result.i = wrapInt(x * y); return true;
+    // INT_MIN / -1 wraps to INT_MIN (and INT_MIN % -1 is 0), as in the VM.
+    case IrOp::Div:
+        if (b.i == 0) return false;
+        result.i = b.i == -1 ? wrapInt(0u - x) : a.i / b.i;
+        return true;
+    case IrOp::Mod:
+        if (b.i == 0) return false;
+        result.i = b.i == -1 ? 0 : a.i % b.i;
+        return true;
+    case IrOp::Shl: result.i = wrapInt(x << (y & 31)); return true;
+    case IrOp::Shr: result.i = a.i >> (y & 31); return true; // Arithmetic shift
+    case IrOp::And: result.i = wrapInt(x & y); return true;
+    case IrOp::Or: result.i = wrapInt(x | y); return true;
+    case IrOp::Xor: result.i = wrapInt(x ^ y); return true;
+    case IrOp::Lt: result.i = a.i < b.i; return true;
+    case IrOp::Le: result.i = a.i <= b.i; return true;
+    case IrOp::Gt: result.i = a.i > b.i; return true;
+    case IrOp::Ge: result.i = a.i >= b.i; return true;
+    case IrOp::Eq: result.i = a.i == b.i; return true;
+    case IrOp::Ne: result.i = a.i != b.i; return true;
+    case IrOp::Neg: result.i = wrapInt(0u - x); return true;
+    case IrOp::Not: result.i = a.i == 0; return true;
+    case IrOp::BitNot: result.i = ~a.i; return true;
+    case IrOp::FAdd: result.f = a.f + b.f; return true;
+    case IrOp::FSub: result.f = a.f - b.f; return true;
+    case IrOp::FMul: result.f = a.f * b.f; return true;
+    case IrOp::FDiv: result.f = a.f / b.f; return true;
+    case IrOp::FLt: result.i = a.f < b.f; return true;
+    case IrOp::FLe: result.i = a.f <= b.f; return true;
+    case IrOp::FGt: result.i = a.f > b.f; return true;
+    case IrOp::FGe: result.i = a.f >= b.f; return true;
+    case IrOp::FEq: result.i = a.f == b.f; return true;
+    case IrOp::FNe: result.i = a.f != b.f; return true;
+    case IrOp::FNeg: result.f = -a.f; return true;
+    case IrOp::IToF: result.f = a.i; return true;
+    case IrOp::FToI: result.i = floatToInt(a.f); return true;
+    case IrOp::IToC: result.i = static_cast<signed char>(a.i); return true;
+    default: return false;
+    }
+}
+
+// --- IrFunction ---
+
+ValueId IrFunction::create(const IrInstruction& instruction, const ValueId* operandList, uint32_t count) {
+    ValueId id = static_cast<ValueId>(values.size());
+    values.push_back(instruction);
+    values.back().firstOperand = static_cast<uint32_t>(operands.size());
+    values.back().operandCount = 0;
+    setOperands(id, operandList, count);
+    return id;
+}
+
+void IrFunction::setOperands(ValueId value, const ValueId* operandList, uint32_t count) {
+    IrInstruction& instruction = values[value];
+    if (count > instruction.operandCount) {
+        // A new range at the end of the pool; the old one is left unused.
+        instruction.firstOperand = static_cast<uint32_t>(operands.size());
+        operands.resize(operands.size() + count);
+    }
+    std::copy(operandList, operandList + count, operands.begin() + instruction.firstOperand);
+    instruction.operandCount = count;
+}
+
+ValueId IrFunction::terminator(BlockId block) const {
+    const std::vector<ValueId>& list = blocks[block].instructions;
+    if (list.empty() || !isTerminator(values[list.back()].op)) return kNoValue;
+    return list.back();
+}
+
+uint32_t IrFunction::successors(BlockId block, BlockId out[2]) const {
+    ValueId last = terminator(block);
+    if (last == kNoValue) return 0;
+    const IrInstruction& instruction = values[last];
+    if (instruction.op == IrOp::Jump) {
+        out[0] = instruction.aux;
+        return 1;
+    }
+    if (instruction.op == IrOp::Branch) {
+        out[0] = instruction.aux;
+        out[1] = instruction.aux2;
+        return 2;
+    }
+    return 0;
+}
+
+size_t IrFunction::instructionCount() const {
+    size_t count = 0;
+    for (const IrBlock& block : blocks) count += block.instructions.size();
+    return count;
+}
+
+void IrFunction::replaceOperands(std::vector<ValueId>& replacement) {
+    replacement.resize(values.size(), kNoValue);
+    for (ValueId& operand : operands) {
+        if (operand >= replacement.size() || replacement[operand] == kNoValue) continue;
+        ValueId target = operand;
+        while (replacement[target] != kNoValue) target = replacement[target];
+        // Point the whole chain at its end for the next lookups.
+        for (ValueId at = operand; at != target;) {
+            ValueId next = replacement[at];
+            replacement[at] = target;
+            at = next;
+        }
+        operand = target;
+    }
+}
+
+void IrFunction::compact() {
+    for (IrBlock& block : blocks) {
+        block.instructions.erase(std::remove_if(block.instructions.begin(), block.instructions.end(),
+            [this](ValueId value) { return values[value].op == IrOp::Nop; }), block.instructions.end());
+    }
+}
+
+void IrFunction::removeEdge(BlockId from, BlockId to) {
+    std::vector<BlockId>& predecessors = blocks[to].predecessors;
+    auto at = std::find(predecessors.begin(), predecessors.end(), from);
+    if (at == predecessors.end()) return;
+    size_t index = static_cast<size_t>(at - predecessors.begin());
+    predecessors.erase(at);
+    for (ValueId value : blocks[to].instructions) {
+        IrInstruction& phi = values[value];
+        if (phi.op != IrOp::Phi) break;
+        if (index >= phi.operandCount) continue;
+        ValueId* list = operandsOf(value);
+        std::copy(list + index + 1, list + phi.operandCount, list + index);
+        --phi.operandCount;
+    }
+}
+
+// --- IrModule ---
+
+uint32_t IrModule::addString(std::string_view text) {
+    std::string_view stored = stringBytes.store(std::string(text) + '\0');
+    strings.push_back(stored.substr(0, text.size()));
+    return static_cast<uint32_t>(strings.size() - 1);
+}
+
+size_t IrModule::instructionCount() const {
+    size_t count = 0;
+    for (const IrFunction& function : functions) count += function.instructionCount();
+    return count;
+}
+
+// --- DominatorTree ---
+
+DominatorTree::DominatorTree(const IrFunction& function) {
+    const size_t blockCount = function.blocks.size();
+    idom.assign(blockCount, kNoBlock);
+    enter.assign(blockCount, 0);
+    leave.assign(blockCount, 0);
+    if (blockCount == 0) return;
+
+    // Postorder by an explicit DFS: (block, next successor to visit).
+    std::vector<uint8_t> visited(blockCount, 0);
+    std::vector<std::pair<BlockId, uint32_t>> stack;
+    stack.push_back({ 0, 0 });
+    visited[0] = 1;
+    while (!stack.empty()) {
+        BlockId successors[2];
+        auto& top = stack.back();
+        uint32_t count = function.successors(top.first, successors);
+        if (top.second < count) {
+            BlockId next = successors[top.second++];
+            if (!visited[next]) {
+                visited[next] = 1;
+                stack.push_back({ next, 0 });
+            }
+            continue;
+        }
+        reversePostorder.push_back(top.first);
+        stack.pop_back();
+    }
+    std::reverse(reversePostorder.begin(), reversePostorder.end());
+
+    std::vector<uint32_t> order(blockCount, 0);
+    for (uint32_t i = 0; i < reversePostorder.size(); ++i) order[reversePostorder[i]] = i;
+    auto intersect = [&](BlockId a, BlockId b) {
+        while (a != b) {
+            while (order[a] > order[b]) a = idom[a];
+            while (order[b] > order[a]) b = idom[b];
+        }
+        return a;
+    };
+    idom[0] = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < reversePostorder.size(); ++i) {
+            BlockId block = reversePostorder[i];
+            BlockId newIdom = kNoBlock;
+            for (BlockId predecessor : function.blocks[block].predecessors) {
+                if (idom[predecessor] == kNoBlock) continue; // Unreachable or not processed yet
+                newIdom = newIdom == kNoBlock ? predecessor : intersect(predecessor, newIdom);
+            }
+            if (newIdom != idom[block]) {
+                idom[block] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    // Preorder intervals of the tree make dominates() constant time.
+    std::vector<std::vector<BlockId>> children(blockCount);
+    for (BlockId block : reversePostorder) {
+        if (block != 0) children[idom[block]].push_back(block);
+    }
+    uint32_t clock = 0;
+    std::vector<std::pair<BlockId, size_t>> walk;
+    walk.push_back({ 0, 0 });
+    enter[0] = clock++;
+    while (!walk.empty()) {
+        auto& top = walk.back();
+        if (top.second < children[top.first].size()) {
+            BlockId child = children[top.first][top.second++];
+            enter[child] = clock++;
+            walk.push_back({ child, 0 });
+            continue;
+        }
+        leave[top.first] = clock++;
+        walk.pop_back();
+    }
+}
+
+// --- Verification ---
+
+std::string verifyIr(const IrFunction& function) {
+    const size_t valueCount = function.values.size();
+    const size_t blockCount = function.blocks.size();
+    if (blockCount == 0 || function.blocks[0].instructions.empty()) return "the entry block is missing";
+
+    // Where every linked instruction sits; each may be linked once.
+    std::vector<BlockId> blockOf(valueCount, kNoBlock);
+    std::vector<uint32_t> positionOf(valueCount, 0);
+    for (BlockId b = 0; b < blockCount; ++b) {
+        const std::vector<ValueId>& list = function.blocks[b].instructions;
+        for (uint32_t i = 0; i < list.size(); ++i) {
+            ValueId value = list[i];
+            if (value >= valueCount) return blockName(b) + ": instruction " + valueName(value) + " does not exist";
+            if (blockOf[value] != kNoBlock) return valueName(value) + " is in more than one place";
+            if (function[value].block != b) return valueName(value) + " is in " + blockName(b) + " but records another block";
+            blockOf[value] = b;
+            positionOf[value] = i;
+        }
+    }
+
+    for (BlockId b = 0; b < blockCount; ++b) {
+        const IrBlock& block = function.blocks[b];
+        if (block.instructions.empty()) {
+            if (!block.predecessors.empty()) return "deleted block " + blockName(b) + " still has predecessors";
+            continue;
+        }
+        // Successors and predecessors must agree, edge for edge.
+        BlockId successors[2];
+        uint32_t successorCount = function.successors(b, successors);
+        for (uint32_t s = 0; s < successorCount; ++s) {
+            BlockId target = successors[s];
+            if (target >= blockCount || function.blocks[target].instructions.empty()) {
+                return blockName(b) + " branches to a missing block";
+            }
+            size_t edges = std::count(successors, successors + successorCount, target);
+            const std::vector<BlockId>& predecessors = function.blocks[target].predecessors;
+            if (static_cast<size_t>(std::count(predecessors.begin(), predecessors.end(), b)) != edges) {
+                return blockName(target) + " does not list " + blockName(b) + " as a predecessor";
+            }
+        }
+        for (BlockId predecessor : block.predecessors) {
+            BlockId targets[2];
+            uint32_t count = predecessor < blockCount ? function.successors(predecessor, targets) : 0;
+            if (std::find(targets, targets + count, b) == targets + count) {
+                return blockName(b) + " lists " + blockName(predecessor) + " as a predecessor, which does not branch to it";
+            }
+        }
+
+        bool inPhis = true;
+        for (uint32_t i = 0; i < block.instructions.size(); ++i) {
+            ValueId value = block.instructions[i];
+            const IrInstruction& instruction = function[value];
+            // Only built for a message: this loop runs after every pass.
+            auto where = [&]() { return blockName(b) + ": " + valueName(value) + " (" + irOpName(instruction.op) + ")"; };
+            if (instruction.op == IrOp::Nop) return where() + " is deleted but still linked";
+            if (isTerminator(instruction.op) != (i + 1 == block.instructions.size())) {
+                return where() + (isTerminator(instruction.op) ? " terminates the block early" : " is last but no terminator");
+            }
+            if (instruction.op == IrOp::Phi) {
+                if (!inPhis) return where() + " follows a non-phi instruction";
+                if (instruction.operandCount != block.predecessors.size()) {
+                    return where() + " has " + std::to_string(instruction.operandCount) + " operands for "
+                        + std::to_string(block.predecessors.size()) + " predecessors";
+                }
+            }
+            else {
+                inPhis = false;
+            }
+            int expected = irOperandCount(instruction.op);
+            if (expected >= 0 && instruction.operandCount != static_cast<uint32_t>(expected)) {
+                return where() + " has " + std::to_string(instruction.operandCount) + " operands";
+            }
+            if (instruction.op == IrOp::Return && (instruction.operandCount == 1) != (function.returnType != IrType::Void)) {
+                return where() + " does not match the return type";
+            }
+            if (isMemoryAccess(instruction.op) && instruction.aux2 == 0) return where() + " accesses an empty array";
+
+            const ValueId* operands = function.operandsOf(value);
+            for (uint32_t k = 0; k < instruction.operandCount; ++k) {
+                ValueId operand = operands[k];
+                if (operand >= valueCount || blockOf[operand] == kNoBlock) {
+                    return where() + " uses " + valueName(operand) + ", which is not in any block";
+                }
+                const IrInstruction& definition = function[operand];
+                if (definition.type == IrType::Void) return where() + " uses " + valueName(operand) + ", which has no value";
+                IrType required;
+                if (requiredOperandType(instruction, k, required) && definition.type != required) {
+                    return where() + " needs " + irTypeToString(required) + " operands but " + valueName(operand)
+                        + " is " + irTypeToString(definition.type);
+                }
+            }
+        }
+    }
+
+    // Definitions dominate their uses (a phi's operand: the end of its predecessor).
+    DominatorTree dominators(function);
+    for (BlockId b = 0; b < blockCount; ++b) {
+        if (!dominators.reachable(b)) continue;
+        const IrBlock& block = function.blocks[b];
+        for (ValueId value : block.instructions) {
+            const IrInstruction& instruction = function[value];
+            const ValueId* operands = function.operandsOf(value);
+            for (uint32_t k = 0; k < instruction.operandCount; ++k) {
+                ValueId operand = operands[k];
+                BlockId user = instruction.op == IrOp::Phi ? block.predecessors[k] : b;
+                BlockId definer = blockOf[operand];
+                bool dominated = definer == user
+                    ? (instruction.op == IrOp::Phi || positionOf[operand] < positionOf[value])
+                    : dominators.reachable(definer) && dominators.dominates(definer, user);
+                if (!dominated && dominators.reachable(user)) {
+                    return blockName(b) + ": " + valueName(value) + " uses " + valueName(operand)
+                        + ", whose definition does not dominate the use";
+                }
+            }
+        }
+    }
+    return std::string();
+}
+
+// --- Printing ---
+
+void printIr(const IrModule& module, OutputBuffer& out) {
+    for (const IrGlobal& global : module.globals) {
+        out << "global " << irTypeToString(global.type) << ' ' << global.name;
+        if (global.isArray) {
+            out << '[';
+            out.writeInt(global.size);
+            out << ']';
+        }
+        out << " @";
+        out.writeInt(global.slot);
+        out << '\n';
+    }
+    for (const IrFunction& function : module.functions) {
+        out << "\nfunction " << function.name << '(';
+        for (size_t i = 0; i < function.parameterTypes.size(); ++i) {
+            if (i) out << ", ";
+            out << irTypeToString(function.parameterTypes[i]);
+        }
+        out << ") -> " << irTypeToString(function.returnType);
+        if (function.localMemory) {
+            out << ", local memory ";
+            out.writeInt(function.localMemory);
+        }
+        out << " {\n";
+        for (BlockId b = 0; b < function.blocks.size(); ++b) {
+            const IrBlock& block = function.blocks[b];
+            if (block.instructions.empty()) continue;
+            out << 'b';
+            out.writeInt(b);
+            out << ':';
+            if (!block.predecessors.empty()) {
+                out << "  ; preds";
+                for (size_t i = 0; i < block.predecessors.size(); ++i) {
+                    out << (i ? ", b" : " b");
+                    out.writeInt(block.predecessors[i]);
+                }
+            }
+            out << '\n';
+            for (ValueId value : block.instructions) printInstruction(module, function, value, out);
+        }
+        out << "}\n";
+    }
+}
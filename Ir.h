@@ -0,0 +1,194 @@
+// Ir.h
+#ifndef IR_H
+#define IR_H
+
+#include "OutputBuffer.h"
+#include "StringPool.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The SSA intermediate representation between the checked AST and the
+// optimizer (see IrBuilder.h for how it is built and PassManager.h for passes).
+//
+// A function is a vector of basic blocks and a vector of instructions. Both
+// are addressed by dense 32-bit IDs instead of pointers: an instruction's ID
+// is also the virtual register it defines, its operands are IDs in one shared
+// operand pool, and a block lists the IDs of its instructions in order (phis
+// first, one terminator last). Rewriting an operand is a store into the pool,
+// deleting an instruction turns it into a Nop that compact() drops from its
+// block, and the whole function is freed at once with its vectors.
+//
+// Only local scalars are in SSA form. Globals and arrays live in memory and
+// are read and written with explicit loads and stores, since calls may change
+// globals and arrays are indexed at run time.
+
+using ValueId = uint32_t;
+using BlockId = uint32_t;
+constexpr ValueId kNoValue = ~0u;
+constexpr BlockId kNoBlock = ~0u;
+
+// Registers are typed; chars are ints kept in signed char range by IToC.
+enum class IrType : uint8_t { Void, Int, Float, String };
+
+const char* irTypeToString(IrType type);
+
+// X(Name, mnemonic, operands): `operands` is the fixed operand count, or -1
+// for a variable one (phi, call, print, return).
+#define IR_OPCODE_LIST(X)                                                          \
+    X(Nop, "nop", 0)                /* A deleted instruction */                    \
+    X(Const, "const", 0)            /* constant.i or constant.f */                 \
+    X(String, "literal", 0)         /* aux: string index */                        \
+    X(Param, "param", 0)            /* aux: parameter index */                     \
+    X(Phi, "phi", -1)               /* one operand per predecessor, in order */    \
+    X(Copy, "copy", 1)                                                             \
+    X(Add, "add", 2) X(Sub, "sub", 2) X(Mul, "mul", 2) X(Div, "div", 2)            \
+    X(Mod, "mod", 2) X(Shl, "shl", 2) X(Shr, "shr", 2) X(And, "and", 2)            \
+    X(Or, "or", 2) X(Xor, "xor", 2)                                                \
+    X(Lt, "lt", 2) X(Le, "le", 2) X(Gt, "gt", 2) X(Ge, "ge", 2)                    \
+    X(Eq, "eq", 2) X(Ne, "ne", 2)                                                  \
+    X(Neg, "neg", 1) X(Not, "not", 1) X(BitNot, "bitnot", 1)                       \
+    X(FAdd, "fadd", 2) X(FSub, "fsub", 2) X(FMul, "fmul", 2) X(FDiv, "fdiv", 2)    \
+    X(FLt, "flt", 2) X(FLe, "fle", 2) X(FGt, "fgt", 2) X(FGe, "fge", 2)            \
+    X(FEq, "feq", 2) X(FNe, "fne", 2)                                              \
+    X(FNeg, "fneg", 1)                                                             \
+    X(IToF, "itof", 1) X(FToI, "ftoi", 1) X(IToC, "itoc", 1)                       \
+    X(LoadGlobal, "load", 0)        /* aux: global slot */                         \
+    X(StoreGlobal, "store", 1)                                                     \
+    X(LoadElem, "load.elem", 1)     /* index; aux: base slot, aux2: length */      \
+    X(StoreElem, "store.elem", 2)   /* index, value */                             \
+    X(FillArray, "fill", 1)         /* value */                                    \
+    X(Call, "call", -1)             /* arguments; aux: function index */           \
+    X(Print, "print", -1)           /* no operand or the argument; aux: format */  \
+    X(Scan, "scan", 1)              /* the old value, kept if reading fails;       \
+                                       aux: format, aux2: IoKind */                \
+    X(Jump, "jump", 0)              /* aux: target */                              \
+    X(Branch, "branch", 1)          /* aux: target if nonzero, aux2: otherwise */  \
+    X(Return, "return", -1)         /* no operand or the value */
+
+enum class IrOp : uint8_t {
+#define IR_OPCODE_ENUM(name, mnemonic, operands) name,
+    IR_OPCODE_LIST(IR_OPCODE_ENUM)
+#undef IR_OPCODE_ENUM
+};
+
+const char* irOpName(IrOp op);
+int irOperandCount(IrOp op); // -1 if variable
+inline bool isTerminator(IrOp op) { return op == IrOp::Jump || op == IrOp::Branch || op == IrOp::Return; }
+// Instructions whose only effect is their value (removable when it is unused).
+bool isPure(IrOp op);
+// The operators evaluateIr computes, Copy to IToC.
+inline bool isOperator(IrOp op) { return op >= IrOp::Copy && op <= IrOp::IToC; }
+
+// The value of a Const: ints (and chars) in i, floats in f.
+union IrConstant {
+    int32_t i;
+    double f;
+};
+
+// Computes an operator (Add to IToC, Copy included) on constant operands with
+// the run-time semantics of the VM; `b` is ignored by unary operators. Returns
+// false for other instructions and where the operation would fail at run time
+// (a zero divisor), so that it is left to fail there.
+bool evaluateIr(IrOp op, IrConstant a, IrConstant b, IrConstant& result);
+
+struct IrInstruction {
+    static const uint8_t kGlobalMemory = 1; // Elem and FillArray: a global array rather than a local one
+
+    IrOp op = IrOp::Nop;
+    IrType type = IrType::Void; // Of the value defined (Void if none)
+    uint8_t flags = 0;
+    BlockId block = kNoBlock;
+    uint32_t firstOperand = 0;  // Into IrFunction::operands
+    uint32_t operandCount = 0;
+    uint32_t aux = 0;
+    uint32_t aux2 = 0;
+    uint32_t sourceOffset = 0;  // Div, Mod, Elem and Call: for run-time errors
+    IrConstant constant = { 0 };
+};
+
+struct IrBlock {
+    std::vector<ValueId> instructions; // Phis, then the body, then one terminator
+    std::vector<BlockId> predecessors; // In the order of the phis' operands
+};
+
+// IrFunction: One function's blocks and instructions. Block 0 is the entry.
+// A block without instructions has been deleted (see removeUnreachableBlocks).
+struct IrFunction {
+    std::string_view name;
+    IrType returnType = IrType::Void;
+    std::vector<IrType> parameterTypes;
+    uint32_t localMemory = 0; // Slots of the function's local arrays
+
+    std::vector<IrInstruction> values; // By ValueId
+    std::vector<ValueId> operands;     // Operand pool
+    std::vector<IrBlock> blocks;       // By BlockId
+
+    const IrInstruction& operator[](ValueId value) const { return values[value]; }
+    IrInstruction& operator[](ValueId value) { return values[value]; }
+    ValueId operand(ValueId value, uint32_t index) const { return operands[values[value].firstOperand + index]; }
+    ValueId* operandsOf(ValueId value) { return operands.data() + values[value].firstOperand; }
+    const ValueId* operandsOf(ValueId value) const { return operands.data() + values[value].firstOperand; }
+
+    // Appends an instruction (without linking it into a block); its operands
+    // are copied into the pool.
+    ValueId create(const IrInstruction& instruction, const ValueId* operandList = nullptr, uint32_t count = 0);
+    void setOperands(ValueId value, const ValueId* operandList, uint32_t count);
+
+    ValueId terminator(BlockId block) const;
+    // Targets of the block's terminator; returns how many (0 to 2).
+    uint32_t successors(BlockId block, BlockId out[2]) const;
+    size_t instructionCount() const; // Live instructions
+    // Rewrites every operand through `replacement` (kNoValue: unchanged),
+    // following chains of replacements.
+    void replaceOperands(std::vector<ValueId>& replacement);
+    void compact(); // Drops Nops from the block lists
+    // Unlinks `block` from the predecessors (and phis) of its successors.
+    void removeEdge(BlockId from, BlockId to);
+};
+
+struct IrGlobal {
+    std::string_view name;
+    IrType type;
+    uint32_t slot;
+    uint32_t size;  // 1 for a scalar
+    bool isArray;
+};
+
+// IrModule: The lowered program. Globals occupy global memory slots and are
+// initialized by the synthetic function ".init", which runs before main.
+struct IrModule {
+    std::vector<IrFunction> functions;
+    std::vector<IrGlobal> globals;
+    uint32_t globalMemory = 0;
+    uint32_t initFunction = 0;
+    uint32_t mainFunction = 0;
+    StringPool stringBytes;
+    std::vector<std::string_view> strings; // By string index; NUL-terminated in stringBytes
+
+    uint32_t addString(std::string_view text);
+    size_t instructionCount() const;
+};
+
+// Dominator tree of the blocks reachable from the entry (Cooper, Harvey and
+// Kennedy's iterative algorithm over the reverse postorder).
+struct DominatorTree {
+    std::vector<BlockId> reversePostorder; // Reachable blocks only
+    std::vector<BlockId> idom;             // kNoBlock if unreachable; the entry is its own
+    std::vector<uint32_t> enter, leave;    // Preorder interval in the tree, for dominates()
+
+    explicit DominatorTree(const IrFunction& function);
+    bool reachable(BlockId block) const { return idom[block] != kNoBlock; }
+    bool dominates(BlockId a, BlockId b) const { return enter[a] <= enter[b] && leave[b] <= leave[a]; }
+};
+
+// Checks the SSA invariants: terminators, phi placement and arity, matching
+// predecessor lists, operand types and that definitions dominate their uses.
+// Returns an empty string if the function is well formed.
+std::string verifyIr(const IrFunction& function);
+
+// Prints the module as text, one instruction per line.
+void printIr(const IrModule& module, OutputBuffer& out);
+
+#endif // IR_H
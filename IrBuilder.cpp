@@ -0,0 +1,814 @@
+// IrBuilder.cpp
+#include "IrBuilder.h"
+#include "Bytecode.h"
+
+namespace {
+
+const uint32_t kNoStorage = ~0u;
+
+IrType irTypeOf(ValueType type) {
+    switch (type) {
+    case ValueType::Int: case ValueType::Char: return IrType::Int;
+    case ValueType::Float: return IrType::Float;
+    case ValueType::String: return IrType::String;
+    default: return IrType::Void;
+    }
+}
+
+IoKind ioKindOf(ValueType type) {
+    switch (type) {
+    case ValueType::Float: return IoKind::Float;
+    case ValueType::Char: return IoKind::Char;
+    case ValueType::String: return IoKind::String;
+    default: return IoKind::Int;
+    }
+}
+
+uint32_t arraySize(const TokenBuffer& tokens, const ArrayDeclarationNode* node) {
+    if (node->sizeToken == kNoToken) return node->elements.count;
+    return static_cast<uint32_t>(tokens.literal(node->sizeToken).integer);
+}
+
+// Operators whose result is already 0 or 1.
+bool isBoolean(IrOp op) {
+    return (op >= IrOp::Lt && op <= IrOp::Ne) || (op >= IrOp::FLt && op <= IrOp::FNe) || op == IrOp::Not;
+}
+
+IrOp binaryOp(BinaryOp op, bool isFloat) {
+    static const IrOp kInt[] = {
+        IrOp::Add, IrOp::Sub, IrOp::Mul, IrOp::Div, IrOp::Mod,
+        IrOp::Lt, IrOp::Le, IrOp::Gt, IrOp::Ge, IrOp::Eq, IrOp::Ne,
+        IrOp::Shl, IrOp::Shr, IrOp::And, IrOp::Or, IrOp::Xor,
+    };
+    static const IrOp kFloat[] = {
+        IrOp::FAdd, IrOp::FSub, IrOp::FMul, IrOp::FDiv, IrOp::Nop,
+        IrOp::FLt, IrOp::FLe, IrOp::FGt, IrOp::FGe, IrOp::FEq, IrOp::FNe,
+    };
+    return isFloat ? kFloat[static_cast<size_t>(op)] : kInt[static_cast<size_t>(op)];
+}
+
+} // namespace
+
+IrBuilder::IrBuilder(const TokenBuffer& tokens, const SemanticInfo& info) : tokens_(tokens), info_(info) {}
+
+bool IrBuilder::build(const ProgramNode* program, IrModule& out) {
+    module_ = &out;
+    storageOf_.assign(tokens_.size(), kNoStorage);
+    storages_.clear();
+    functions_.clear();
+
+    // User functions keep their declaration order; ".init" comes last.
+    const FunctionDefinitionNode* mainFunction = nullptr;
+    for (const FunctionDefinitionNode* function : program->functions) {
+        uint32_t index = static_cast<uint32_t>(functions_.size());
+        storageOf_[function->identifierToken] = static_cast<uint32_t>(storages_.size());
+        storages_.push_back(Storage{ StorageKind::Function,
+            valueTypeOfKeyword(tokens_.type(function->returnTypeToken)), index, 0 });
+        functions_.push_back(function);
+        if (tokens_.lexeme(function->identifierToken) == "main") {
+            mainFunction = function;
+            out.mainFunction = index;
+        }
+    }
+    if (!mainFunction) {
+        error_ = "Program has no main function";
+        return false;
+    }
+    if (!mainFunction->parameters.empty()) {
+        error_ = "main must not take parameters";
+        return false;
+    }
+    for (const StatementNode* global : program->globals) declareGlobal(global);
+
+    out.functions.resize(functions_.size() + 1);
+    for (size_t i = 0; i < functions_.size(); ++i) lowerFunction(out.functions[i], functions_[i]);
+    out.initFunction = static_cast<uint32_t>(functions_.size());
+    lowerGlobalInitializers(out.functions.back(), program);
+    return true;
+}
+
+// --- Blocks and instructions ---
+
+BlockId IrBuilder::newBlock() {
+    BlockId block = static_cast<BlockId>(function_->blocks.size());
+    function_->blocks.emplace_back();
+    sealed_.push_back(0);
+    incompletePhis_.emplace_back();
+    return block;
+}
+
+void IrBuilder::sealBlock(BlockId block) {
+    // Completing a phi may read through other unsealed blocks, but never adds
+    // to this block's list, which is taken first.
+    std::vector<std::pair<uint32_t, ValueId>> incomplete;
+    incomplete.swap(incompletePhis_[block]);
+    sealed_[block] = 1;
+    for (const auto& entry : incomplete) {
+        const size_t base = reads_.size();
+        const std::vector<BlockId>& predecessors = function_->blocks[block].predecessors;
+        reads_.push_back(PendingRead{ block, entry.second, 0, phiOperands_.size() });
+        if (predecessors.empty()) {
+            reads_.pop_back();
+            completePhi(entry.second, nullptr, 0);
+            continue;
+        }
+        continueReads(entry.first, base, predecessors[0]);
+    }
+}
+
+ValueId IrBuilder::emit(IrOp op, IrType type, std::initializer_list<ValueId> operands, uint32_t aux, uint32_t aux2) {
+    return emitList(op, type, operands.begin(), static_cast<uint32_t>(operands.size()), aux, aux2);
+}
+
+ValueId IrBuilder::emitList(IrOp op, IrType type, const ValueId* operands, uint32_t count, uint32_t aux, uint32_t aux2) {
+    IrInstruction instruction;
+    instruction.op = op;
+    instruction.type = type;
+    instruction.block = current_;
+    instruction.aux = aux;
+    instruction.aux2 = aux2;
+    ValueId value = function_->create(instruction, operands, count);
+    function_->blocks[current_].instructions.push_back(value);
+    return value;
+}
+
+void IrBuilder::jump(BlockId target) {
+    emit(IrOp::Jump, IrType::Void, {}, target);
+    function_->blocks[target].predecessors.push_back(current_);
+}
+
+void IrBuilder::branch(ValueId condition, BlockId ifTrue, BlockId ifFalse) {
+    emit(IrOp::Branch, IrType::Void, { condition }, ifTrue, ifFalse);
+    function_->blocks[ifTrue].predecessors.push_back(current_);
+    function_->blocks[ifFalse].predecessors.push_back(current_);
+}
+
+ValueId IrBuilder::constInt(int32_t value) {
+    ValueId id = emit(IrOp::Const, IrType::Int);
+    (*function_)[id].constant.i = value;
+    return id;
+}
+
+ValueId IrBuilder::constFloat(double value) {
+    ValueId id = emit(IrOp::Const, IrType::Float);
+    (*function_)[id].constant.f = value;
+    return id;
+}
+
+// The default value of a type, defined at the top of the entry block so that
+// it dominates every use (reads of variables that were never written on some
+// path, in unreachable code, find it).
+ValueId IrBuilder::zero(IrType type) {
+    ValueId& cached = zero_[static_cast<size_t>(type)];
+    if (cached != kNoValue) return cached;
+    IrInstruction instruction;
+    instruction.op = type == IrType::String ? IrOp::String : IrOp::Const;
+    instruction.type = type;
+    instruction.block = 0;
+    if (type == IrType::String) instruction.aux = module_->addString("");
+    else if (type == IrType::Float) instruction.constant.f = 0.0;
+    cached = function_->create(instruction);
+    std::vector<ValueId>& entry = function_->blocks[0].instructions;
+    entry.insert(entry.begin(), cached);
+    return cached;
+}
+
+// --- SSA construction ---
+
+void IrBuilder::writeVariable(uint32_t variable, BlockId block, ValueId value) {
+    definitions_[(static_cast<uint64_t>(variable) << 32) | block] = value;
+}
+
+ValueId IrBuilder::findDefinition(uint32_t variable, BlockId block) {
+    auto found = definitions_.find((static_cast<uint64_t>(variable) << 32) | block);
+    return found == definitions_.end() ? kNoValue : resolve(found->second);
+}
+
+ValueId IrBuilder::readVariable(uint32_t variable, BlockId block) {
+    ValueId value = findDefinition(variable, block);
+    if (value != kNoValue) return value;
+    return continueReads(variable, reads_.size(), block);
+}
+
+// Braun et al.'s readVariableRecursive with the recursion on reads_: descend
+// from `block` until the value is known or a phi needs operands, then hand
+// the value back to the pending reads above `base`.
+ValueId IrBuilder::continueReads(uint32_t variable, size_t base, BlockId block) {
+    const IrType type = variableTypes_[variable];
+    for (;;) {
+        ValueId value = kNoValue;
+        while (value == kNoValue) {
+            value = findDefinition(variable, block);
+            if (value != kNoValue) break;
+            const std::vector<BlockId>& predecessors = function_->blocks[block].predecessors;
+            if (!sealed_[block]) {
+                // More predecessors may come: an operandless phi, completed by sealBlock().
+                value = newPhi(block, type);
+                incompletePhis_[block].push_back({ variable, value });
+                writeVariable(variable, block, value);
+            }
+            else if (predecessors.size() == 1) {
+                reads_.push_back(PendingRead{ block, kNoValue, 0, 0 });
+                block = predecessors[0];
+            }
+            else if (predecessors.empty()) {
+                value = zero(type); // Unreachable, or read before any write
+                writeVariable(variable, block, value);
+            }
+            else {
+                // The phi is defined before its operands are read, which ends loops.
+                ValueId phi = newPhi(block, type);
+                writeVariable(variable, block, phi);
+                reads_.push_back(PendingRead{ block, phi, 0, phiOperands_.size() });
+                block = predecessors[0];
+            }
+        }
+
+        // Ascend until a phi needs the value of its next predecessor.
+        for (;;) {
+            if (reads_.size() == base) return value;
+            PendingRead& read = reads_.back();
+            if (read.phi == kNoValue) {
+                writeVariable(variable, read.block, value);
+                reads_.pop_back();
+                continue;
+            }
+            phiOperands_.push_back(value);
+            const std::vector<BlockId>& predecessors = function_->blocks[read.block].predecessors;
+            if (++read.nextPredecessor < predecessors.size()) {
+                block = predecessors[read.nextPredecessor];
+                break;
+            }
+            const size_t first = read.firstOperand;
+            value = completePhi(read.phi, phiOperands_.data() + first, static_cast<uint32_t>(phiOperands_.size() - first));
+            phiOperands_.resize(first);
+            reads_.pop_back();
+        }
+    }
+}
+
+ValueId IrBuilder::newPhi(BlockId block, IrType type) {
+    IrInstruction instruction;
+    instruction.op = IrOp::Phi;
+    instruction.type = type;
+    instruction.block = block;
+    ValueId phi = function_->create(instruction);
+    std::vector<ValueId>& list = function_->blocks[block].instructions;
+    auto at = list.begin();
+    while (at != list.end() && ((*function_)[*at].op == IrOp::Phi || (*function_)[*at].op == IrOp::Nop)) ++at;
+    list.insert(at, phi);
+    return phi;
+}
+
+// Sets the phi's operands; if they are all one value (besides the phi
+// itself), the phi is removed in favor of that value, which is returned.
+ValueId IrBuilder::completePhi(ValueId phi, const ValueId* operands, uint32_t count) {
+    std::vector<ValueId> resolved(operands, operands + count);
+    ValueId same = kNoValue;
+    bool trivial = true;
+    for (ValueId& operand : resolved) {
+        operand = resolve(operand);
+        if (operand == phi || operand == same) continue;
+        if (same != kNoValue) trivial = false;
+        same = operand;
+    }
+    function_->setOperands(phi, resolved.data(), count);
+    if (!trivial) return phi;
+    if (same == kNoValue) same = zero((*function_)[phi].type);
+    if (replacement_.size() <= phi) replacement_.resize(function_->values.size(), kNoValue);
+    replacement_[phi] = same;
+    (*function_)[phi].op = IrOp::Nop;
+    return same;
+}
+
+ValueId IrBuilder::resolve(ValueId value) {
+    while (value < replacement_.size() && replacement_[value] != kNoValue) value = replacement_[value];
+    return value;
+}
+
+// Phis that became trivial after the removal of another one; repeated until
+// none is left, then every operand is pointed at the surviving values.
+void IrBuilder::removeTrivialPhis() {
+    IrFunction& function = *function_;
+    replacement_.resize(function.values.size(), kNoValue);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (ValueId value = 0; value < function.values.size(); ++value) {
+            if (function[value].op != IrOp::Phi) continue;
+            ValueId same = kNoValue;
+            bool trivial = true;
+            const ValueId* operands = function.operandsOf(value);
+            for (uint32_t i = 0; i < function[value].operandCount && trivial; ++i) {
+                ValueId operand = resolve(operands[i]);
+                if (operand == value || operand == same) continue;
+                if (same != kNoValue) trivial = false;
+                same = operand;
+            }
+            if (!trivial) continue;
+            replacement_[value] = same == kNoValue ? zero(function[value].type) : same;
+            replacement_.resize(function.values.size(), kNoValue);
+            function[value].op = IrOp::Nop;
+            changed = true;
+        }
+    }
+    function.replaceOperands(replacement_);
+    function.compact();
+}
+
+// --- Declarations and statements ---
+
+void IrBuilder::declareGlobal(const StatementNode* declaration) {
+    const bool isArray = declaration->kind == NodeKind::ArrayDeclaration;
+    TokenIndex typeToken, nameToken;
+    uint32_t size = 1;
+    if (isArray) {
+        const ArrayDeclarationNode* node = static_cast<const ArrayDeclarationNode*>(declaration);
+        typeToken = node->typeToken;
+        nameToken = node->nameToken;
+        size = arraySize(tokens_, node);
+    }
+    else {
+        const VariableDeclarationNode* node = static_cast<const VariableDeclarationNode*>(declaration);
+        typeToken = node->typeToken;
+        nameToken = node->nameToken;
+    }
+    ValueType type = valueTypeOfKeyword(tokens_.type(typeToken));
+    storageOf_[nameToken] = static_cast<uint32_t>(storages_.size());
+    storages_.push_back(Storage{ StorageKind::Global, type, module_->globalMemory, size });
+    module_->globals.push_back(IrGlobal{ tokens_.lexeme(nameToken), irTypeOf(type), module_->globalMemory, size, isArray });
+    module_->globalMemory += size;
+}
+
+void IrBuilder::lowerDeclaration(const StatementNode* declaration, const Storage& storage) {
+    const IrType type = irTypeOf(storage.type);
+    if (declaration->kind == NodeKind::VariableDeclaration) {
+        const ExpressionNode* initializer = static_cast<const VariableDeclarationNode*>(declaration)->initializer;
+        ValueId value = initializer
+            ? convert(lowerExpression(initializer), typeOf(initializer), storage.type)
+            : zero(type);
+        store(storage, kNoValue, value);
+        return;
+    }
+
+    const NodeList<ExpressionNode>& elements = static_cast<const ArrayDeclarationNode*>(declaration)->elements;
+    ValueId fill = emit(IrOp::FillArray, IrType::Void, { zero(type) }, storage.index, storage.size);
+    if (storage.kind == StorageKind::Global) (*function_)[fill].flags = IrInstruction::kGlobalMemory;
+    for (uint32_t i = 0; i < elements.count && i < storage.size; ++i) {
+        ValueId value = convert(lowerExpression(elements[i]), typeOf(elements[i]), storage.type);
+        store(storage, constInt(static_cast<int32_t>(i)), value);
+    }
+}
+
+void IrBuilder::lowerFunction(IrFunction& function, const FunctionDefinitionNode* node) {
+    function_ = &function;
+    function.name = tokens_.lexeme(node->identifierToken);
+    returnType_ = valueTypeOfKeyword(tokens_.type(node->returnTypeToken));
+    function.returnType = irTypeOf(returnType_);
+    definitions_.clear();
+    sealed_.clear();
+    incompletePhis_.clear();
+    replacement_.clear();
+    variableTypes_.clear();
+    for (ValueId& cached : zero_) cached = kNoValue;
+    current_ = newBlock();
+    sealBlock(current_);
+
+    for (const ParameterNode* parameter : node->parameters) {
+        ValueType type = valueTypeOfKeyword(tokens_.type(parameter->typeToken));
+        uint32_t variable = static_cast<uint32_t>(variableTypes_.size());
+        variableTypes_.push_back(irTypeOf(type));
+        function.parameterTypes.push_back(irTypeOf(type));
+        storageOf_[parameter->nameToken] = static_cast<uint32_t>(storages_.size());
+        storages_.push_back(Storage{ StorageKind::Variable, type, variable, 1 });
+        ValueId value = emit(IrOp::Param, irTypeOf(type), {}, static_cast<uint32_t>(function.parameterTypes.size() - 1));
+        writeVariable(variable, current_, value);
+    }
+    pushBlock(node->body);
+    lowerStatements();
+    finishFunction();
+}
+
+void IrBuilder::lowerGlobalInitializers(IrFunction& function, const ProgramNode* program) {
+    function_ = &function;
+    function.name = ".init";
+    returnType_ = ValueType::Void;
+    definitions_.clear();
+    sealed_.clear();
+    incompletePhis_.clear();
+    replacement_.clear();
+    variableTypes_.clear();
+    for (ValueId& cached : zero_) cached = kNoValue;
+    current_ = newBlock();
+    sealBlock(current_);
+    for (const StatementNode* global : program->globals) {
+        TokenIndex nameToken = global->kind == NodeKind::ArrayDeclaration
+            ? static_cast<const ArrayDeclarationNode*>(global)->nameToken
+            : static_cast<const VariableDeclarationNode*>(global)->nameToken;
+        lowerDeclaration(global, storages_[storageOf_[nameToken]]);
+    }
+    finishFunction();
+}
+
+// Falling off the end returns (the default value of a non-void function).
+void IrBuilder::finishFunction() {
+    if (!terminated()) {
+        if (returnType_ == ValueType::Void) emit(IrOp::Return, IrType::Void);
+        else emit(IrOp::Return, IrType::Void, { zero(irTypeOf(returnType_)) });
+    }
+    removeTrivialPhis();
+}
+
+void IrBuilder::pushBlock(NodeList<StatementNode> block) {
+    for (size_t i = block.count; i-- > 0;) statements_.push_back(PendingStatement{ block[i], 0, 0, 0 });
+}
+
+void IrBuilder::lowerStatements() {
+    while (!statements_.empty()) {
+        PendingStatement item = statements_.back();
+        statements_.pop_back();
+        lowerStatement(item);
+    }
+}
+
+void IrBuilder::lowerStatement(const PendingStatement& item) {
+    const StatementNode* statement = item.node;
+    switch (statement->kind) {
+    case NodeKind::VariableDeclaration: {
+        const VariableDeclarationNode* node = static_cast<const VariableDeclarationNode*>(statement);
+        ValueType type = valueTypeOfKeyword(tokens_.type(node->typeToken));
+        uint32_t variable = static_cast<uint32_t>(variableTypes_.size());
+        variableTypes_.push_back(irTypeOf(type));
+        // The initializer was resolved before the name was declared.
+        Storage storage{ StorageKind::Variable, type, variable, 1 };
+        lowerDeclaration(statement, storage);
+        storageOf_[node->nameToken] = static_cast<uint32_t>(storages_.size());
+        storages_.push_back(storage);
+        break;
+    }
+    case NodeKind::ArrayDeclaration: {
+        const ArrayDeclarationNode* node = static_cast<const ArrayDeclarationNode*>(statement);
+        uint32_t size = arraySize(tokens_, node);
+        Storage storage{ StorageKind::LocalArray, valueTypeOfKeyword(tokens_.type(node->typeToken)), function_->localMemory, size };
+        function_->localMemory += size;
+        storageOf_[node->nameToken] = static_cast<uint32_t>(storages_.size());
+        storages_.push_back(storage);
+        lowerDeclaration(statement, storage);
+        break;
+    }
+    case NodeKind::Assignment:
+    case NodeKind::ExpressionStatement:
+    case NodeKind::IncrementStatement:
+        lowerSimpleStatement(statement);
+        break;
+    case NodeKind::IfStatement: {
+        // a: the else block (or the join without an else), b: the join.
+        const IfStatementNode* node = static_cast<const IfStatementNode*>(statement);
+        if (item.state == 0) {
+            ValueId condition = lowerCondition(node->condition);
+            BlockId thenBlock = newBlock();
+            BlockId join = newBlock();
+            BlockId elseBlock = node->elseBody.empty() ? join : newBlock();
+            branch(condition, thenBlock, elseBlock);
+            sealBlock(thenBlock);
+            if (elseBlock != join) sealBlock(elseBlock);
+            current_ = thenBlock;
+            statements_.push_back(PendingStatement{ statement, 1, elseBlock, join });
+            pushBlock(node->thenBody);
+            break;
+        }
+        jump(item.b);
+        if (item.state == 1 && item.a != item.b) {
+            current_ = item.a;
+            statements_.push_back(PendingStatement{ statement, 2, item.a, item.b });
+            pushBlock(node->elseBody);
+            break;
+        }
+        sealBlock(item.b);
+        current_ = item.b;
+        break;
+    }
+    case NodeKind::WhileStatement:
+    case NodeKind::ForStatement: {
+        // a: the loop header, which tests the condition, b: the exit.
+        const bool isFor = statement->kind == NodeKind::ForStatement;
+        const ForStatementNode* forNode = static_cast<const ForStatementNode*>(statement);
+        const WhileStatementNode* whileNode = static_cast<const WhileStatementNode*>(statement);
+        if (item.state == 0) {
+            if (isFor && forNode->init) lowerSimpleStatement(forNode->init);
+            const ExpressionNode* condition = isFor ? forNode->condition : whileNode->condition;
+            BlockId header = newBlock();
+            jump(header);
+            current_ = header; // Sealed once the back edge exists
+            BlockId body = newBlock();
+            BlockId exit = newBlock();
+            if (condition) branch(lowerCondition(condition), body, exit);
+            else jump(body);
+            sealBlock(body);
+            sealBlock(exit);
+            current_ = body;
+            statements_.push_back(PendingStatement{ statement, 1, header, exit });
+            pushBlock(isFor ? forNode->body : whileNode->body);
+            break;
+        }
+        if (isFor && forNode->update) lowerSimpleStatement(forNode->update);
+        jump(item.a);
+        sealBlock(item.a);
+        current_ = item.b;
+        break;
+    }
+    case NodeKind::ScanfStatement:
+        lowerScanf(static_cast<const ScanfStatementNode*>(statement));
+        break;
+    case NodeKind::PrintfStatement:
+        lowerPrintf(static_cast<const PrintfStatementNode*>(statement));
+        break;
+    case NodeKind::ReturnStatement: {
+        const ReturnStatementNode* node = static_cast<const ReturnStatementNode*>(statement);
+        if (node->returnValue) {
+            ValueId value = convert(lowerExpression(node->returnValue), typeOf(node->returnValue), returnType_);
+            emit(IrOp::Return, IrType::Void, { value });
+        }
+        else {
+            emit(IrOp::Return, IrType::Void);
+        }
+        // Statements after a return go to a block without predecessors.
+        current_ = newBlock();
+        sealBlock(current_);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void IrBuilder::lowerSimpleStatement(const StatementNode* statement) {
+    switch (statement->kind) {
+    case NodeKind::Assignment: {
+        const AssignmentNode* node = static_cast<const AssignmentNode*>(statement);
+        if (node->target->kind == NodeKind::ArrayIndex) {
+            const ArrayIndexNode* element = static_cast<const ArrayIndexNode*>(node->target);
+            const Storage& storage = storageOf(element->nameToken);
+            ValueId index = lowerExpression(element->index);
+            store(storage, index, convert(lowerExpression(node->value), typeOf(node->value), storage.type), element->nameToken);
+        }
+        else {
+            const Storage& storage = storageOf(static_cast<const IdentifierNode*>(node->target)->nameToken);
+            store(storage, kNoValue, convert(lowerExpression(node->value), typeOf(node->value), storage.type));
+        }
+        break;
+    }
+    case NodeKind::ExpressionStatement:
+        lowerExpression(static_cast<const ExpressionStatementNode*>(statement)->expression);
+        break;
+    case NodeKind::IncrementStatement: {
+        const IncrementStatementNode* node = static_cast<const IncrementStatementNode*>(statement);
+        const Storage& storage = storageOf(node->nameToken);
+        const int32_t delta = node->isIncrement ? 1 : -1;
+        ValueId value = load(storage, kNoValue);
+        if (storage.type == ValueType::Float) {
+            value = emit(IrOp::FAdd, IrType::Float, { value, constFloat(delta) });
+        }
+        else {
+            value = emit(IrOp::Add, IrType::Int, { value, constInt(delta) });
+            if (storage.type == ValueType::Char) value = emit(IrOp::IToC, IrType::Int, { value });
+        }
+        store(storage, kNoValue, value);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// `index` is kNoValue for a scalar; an element access is marked with `nameToken`.
+void IrBuilder::store(const Storage& storage, ValueId index, ValueId value, TokenIndex nameToken) {
+    if (storage.kind == StorageKind::Variable) {
+        writeVariable(storage.index, current_, value);
+        return;
+    }
+    if (index == kNoValue) {
+        emit(IrOp::StoreGlobal, IrType::Void, { value }, storage.index);
+        return;
+    }
+    ValueId access = emit(IrOp::StoreElem, IrType::Void, { index, value }, storage.index, storage.size);
+    if (storage.kind == StorageKind::Global) (*function_)[access].flags = IrInstruction::kGlobalMemory;
+    if (nameToken != kNoToken) mark(access, nameToken);
+}
+
+ValueId IrBuilder::load(const Storage& storage, ValueId index, TokenIndex nameToken) {
+    const IrType type = irTypeOf(storage.type);
+    if (storage.kind == StorageKind::Variable) return readVariable(storage.index, current_);
+    if (index == kNoValue) return emit(IrOp::LoadGlobal, type, {}, storage.index);
+    ValueId access = emit(IrOp::LoadElem, type, { index }, storage.index, storage.size);
+    if (storage.kind == StorageKind::Global) (*function_)[access].flags = IrInstruction::kGlobalMemory;
+    if (nameToken != kNoToken) mark(access, nameToken);
+    return access;
+}
+
+// An int that is nonzero when the condition holds.
+ValueId IrBuilder::lowerCondition(const ExpressionNode* condition) {
+    ValueId value = lowerExpression(condition);
+    if (typeOf(condition) != ValueType::Float) return value;
+    return emit(IrOp::FNe, IrType::Int, { value, constFloat(0.0) });
+}
+
+void IrBuilder::lowerPrintf(const PrintfStatementNode* node) {
+    std::string_view format = tokens_.literal(node->formatToken).stringValue();
+    if (!node->argument) {
+        emit(IrOp::Print, IrType::Void, {}, module_->addString(printfText(format)));
+        return;
+    }
+    ValueId value = lowerExpression(node->argument);
+    emit(IrOp::Print, IrType::Void, { value }, module_->addString(format));
+}
+
+// Scan yields the value read, or its operand if reading fails.
+void IrBuilder::lowerScanf(const ScanfStatementNode* node) {
+    const ExpressionNode* target = node->target;
+    const bool isElement = target->kind == NodeKind::ArrayIndex;
+    const TokenIndex nameToken = isElement
+        ? static_cast<const ArrayIndexNode*>(target)->nameToken
+        : static_cast<const IdentifierNode*>(target)->nameToken;
+    const Storage& storage = storageOf(nameToken);
+    ValueId index = isElement ? lowerExpression(static_cast<const ArrayIndexNode*>(target)->index) : kNoValue;
+    ValueId old = load(storage, index, nameToken);
+    IoKind kind = ioKindOf(storage.type);
+    std::string format = boundScanfWidth(tokens_.literal(node->formatToken).stringValue(), kind);
+    ValueId value = emit(IrOp::Scan, irTypeOf(storage.type), { old }, module_->addString(format), static_cast<uint32_t>(kind));
+    store(storage, index, value, nameToken);
+}
+
+// --- Expressions ---
+
+ValueId IrBuilder::lowerExpression(const ExpressionNode* root) {
+    const size_t expressionBase = expressions_.size();
+    const size_t valueBase = values_.size();
+    expressions_.push_back(PendingExpression{ root, 0, 0, 0 });
+    while (expressions_.size() > expressionBase) {
+        PendingExpression item = expressions_.back();
+        expressions_.pop_back();
+        lowerExpressionStep(item);
+    }
+    ValueId result = values_.size() > valueBase ? values_.back() : kNoValue;
+    values_.resize(valueBase);
+    return result;
+}
+
+void IrBuilder::lowerExpressionStep(PendingExpression item) {
+    const ExpressionNode* node = item.node;
+    switch (node->kind) {
+    case NodeKind::IntegerLiteral:
+        values_.push_back(constInt(static_cast<int32_t>(static_cast<uint32_t>(
+            static_cast<const IntegerLiteralNode*>(node)->getValue(tokens_)))));
+        break;
+    case NodeKind::FloatLiteral:
+        values_.push_back(constFloat(static_cast<const FloatLiteralNode*>(node)->getValue(tokens_)));
+        break;
+    case NodeKind::CharLiteral:
+        values_.push_back(constInt(static_cast<const CharLiteralNode*>(node)->getValue(tokens_)));
+        break;
+    case NodeKind::StringLiteral:
+        values_.push_back(emit(IrOp::String, IrType::String, {},
+            module_->addString(static_cast<const StringLiteralNode*>(node)->getValue(tokens_))));
+        break;
+    case NodeKind::Identifier:
+        values_.push_back(load(storageOf(static_cast<const IdentifierNode*>(node)->nameToken), kNoValue));
+        break;
+    case NodeKind::ArrayIndex: {
+        const ArrayIndexNode* element = static_cast<const ArrayIndexNode*>(node);
+        if (item.state == 0) {
+            expressions_.push_back(PendingExpression{ node, 1, 0, 0 });
+            expressions_.push_back(PendingExpression{ element->index, 0, 0, 0 });
+            break;
+        }
+        values_.back() = load(storageOf(element->nameToken), values_.back(), element->nameToken);
+        break;
+    }
+    case NodeKind::UnaryExpression: {
+        const UnaryExpressionNode* unary = static_cast<const UnaryExpressionNode*>(node);
+        if (item.state == 0) {
+            expressions_.push_back(PendingExpression{ node, 1, 0, 0 });
+            expressions_.push_back(PendingExpression{ unary->operand, 0, 0, 0 });
+            break;
+        }
+        ValueId operand = values_.back();
+        const bool isFloat = typeOf(unary->operand) == ValueType::Float;
+        switch (unary->op) {
+        case UnaryOp::Negate:
+            values_.back() = isFloat ? emit(IrOp::FNeg, IrType::Float, { operand }) : emit(IrOp::Neg, IrType::Int, { operand });
+            break;
+        case UnaryOp::LogicalNot:
+            values_.back() = isFloat ? emit(IrOp::FEq, IrType::Int, { operand, constFloat(0.0) }) : emit(IrOp::Not, IrType::Int, { operand });
+            break;
+        case UnaryOp::BitNot:
+            values_.back() = emit(IrOp::BitNot, IrType::Int, { operand });
+            break;
+        }
+        break;
+    }
+    case NodeKind::BinaryExpression: {
+        const BinaryExpressionNode* binary = static_cast<const BinaryExpressionNode*>(node);
+        if (binary->op == BinaryOp::LogicalAnd || binary->op == BinaryOp::LogicalOr) {
+            // The right operand gets its own block; the join's phi takes the
+            // deciding constant from the left side or the right operand.
+            const bool isAnd = binary->op == BinaryOp::LogicalAnd;
+            if (item.state == 0) {
+                expressions_.push_back(PendingExpression{ node, 1, 0, 0 });
+                expressions_.push_back(PendingExpression{ binary->left, 0, 0, 0 });
+            }
+            else if (item.state == 1) {
+                ValueId left = toBool(values_.back(), typeOf(binary->left));
+                values_.back() = constInt(isAnd ? 0 : 1);
+                BlockId right = newBlock();
+                BlockId join = newBlock();
+                BlockId leftEnd = current_;
+                if (isAnd) branch(left, right, join);
+                else branch(left, join, right);
+                sealBlock(right);
+                current_ = right;
+                expressions_.push_back(PendingExpression{ node, 2, leftEnd, join });
+                expressions_.push_back(PendingExpression{ binary->right, 0, 0, 0 });
+            }
+            else {
+                ValueId right = toBool(values_.back(), typeOf(binary->right));
+                values_.pop_back();
+                jump(item.join);
+                sealBlock(item.join);
+                current_ = item.join;
+                ValueId operands[2] = { values_.back(), right }; // In predecessor order: left end, right end
+                values_.back() = completePhi(newPhi(item.join, IrType::Int), operands, 2);
+            }
+            break;
+        }
+        const bool isFloat = typeOf(binary->left) == ValueType::Float || typeOf(binary->right) == ValueType::Float;
+        const ValueType operandType = isFloat ? ValueType::Float : ValueType::Int;
+        if (item.state == 0) {
+            expressions_.push_back(PendingExpression{ node, 1, 0, 0 });
+            expressions_.push_back(PendingExpression{ binary->left, 0, 0, 0 });
+        }
+        else if (item.state == 1) {
+            values_.back() = convert(values_.back(), typeOf(binary->left), operandType);
+            expressions_.push_back(PendingExpression{ node, 2, 0, 0 });
+            expressions_.push_back(PendingExpression{ binary->right, 0, 0, 0 });
+        }
+        else {
+            ValueId right = convert(values_.back(), typeOf(binary->right), operandType);
+            values_.pop_back();
+            IrOp op = binaryOp(binary->op, isFloat);
+            IrType type = isFloat && binary->op <= BinaryOp::Divide ? IrType::Float : IrType::Int;
+            values_.back() = emit(op, type, { values_.back(), right });
+            if (op == IrOp::Div || op == IrOp::Mod) mark(values_.back(), binary->opToken);
+        }
+        break;
+    }
+    case NodeKind::Call: {
+        const CallNode* call = static_cast<const CallNode*>(node);
+        if (item.state < call->arguments.count) {
+            expressions_.push_back(PendingExpression{ node, item.state + 1, 0, 0 });
+            expressions_.push_back(PendingExpression{ call->arguments[item.state], 0, 0, 0 });
+            break;
+        }
+        const Storage& callee = storageOf(call->nameToken);
+        const NodeList<ParameterNode>& parameters = functions_[callee.index]->parameters;
+        const uint32_t count = call->arguments.count;
+        ValueId* arguments = values_.data() + values_.size() - count;
+        for (uint32_t i = 0; i < count; ++i) {
+            arguments[i] = convert(arguments[i], typeOf(call->arguments[i]),
+                valueTypeOfKeyword(tokens_.type(parameters[i]->typeToken)));
+        }
+        ValueId result = emitList(IrOp::Call, irTypeOf(callee.type), arguments, count, callee.index);
+        mark(result, call->nameToken);
+        values_.resize(values_.size() - count);
+        values_.push_back(callee.type == ValueType::Void ? kNoValue : result);
+        break;
+    }
+    default:
+        values_.push_back(kNoValue);
+        break;
+    }
+}
+
+ValueId IrBuilder::convert(ValueId value, ValueType from, ValueType to) {
+    if (from == to) return value;
+    switch (to) {
+    case ValueType::Float:
+        if (isIntegral(from)) return emit(IrOp::IToF, IrType::Float, { value });
+        break;
+    case ValueType::Int:
+        if (from == ValueType::Float) return emit(IrOp::FToI, IrType::Int, { value });
+        break;
+    case ValueType::Char:
+        if (from == ValueType::Float) value = emit(IrOp::FToI, IrType::Int, { value });
+        if (isNumeric(from)) return emit(IrOp::IToC, IrType::Int, { value });
+        break;
+    default:
+        break;
+    }
+    return value;
+}
+
+ValueId IrBuilder::toBool(ValueId value, ValueType type) {
+    if (type == ValueType::Float) return emit(IrOp::FNe, IrType::Int, { value, constFloat(0.0) });
+    if (isBoolean((*function_)[value].op)) return value;
+    return emit(IrOp::Ne, IrType::Int, { value, constInt(0) });
+}
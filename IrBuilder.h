@@ -0,0 +1,137 @@
+// IrBuilder.h
+#ifndef IRBUILDER_H
+#define IRBUILDER_H
+
+#include "AstNode.h"
+#include "Ir.h"
+#include "SemanticInfo.h"
+#include "TokenBuffer.h"
+#include <unordered_map>
+#include <vector>
+
+// IrBuilder: Lowers a checked tree (see SemanticAnalyzer) to an SSA IrModule.
+//
+// SSA form is built directly while lowering, with the algorithm of Braun et
+// al., "Simple and Efficient Construction of Static Single Assignment Form"
+// (CC 2013): every local scalar is a variable whose current value is tracked
+// per block, a read in a block with several predecessors creates a phi, and a
+// block is sealed once all its predecessors are known, completing the phis
+// created while it was open. Trivial phis (all operands the same value or the
+// phi itself) are removed as they are completed and again once a function is
+// done, so no dominance frontiers are ever computed.
+//
+// Reads through long chains of blocks and deeply nested statements and
+// expressions use explicit stacks, like the other passes.
+class IrBuilder {
+public:
+    IrBuilder(const TokenBuffer& tokens, const SemanticInfo& info);
+
+    // Returns false (see error()) if the program has no main() without parameters.
+    bool build(const ProgramNode* program, IrModule& out);
+    const std::string& error() const { return error_; }
+
+private:
+    enum class StorageKind : uint8_t { Global, Variable, LocalArray, Function };
+    struct Storage {
+        StorageKind kind;
+        ValueType type;
+        uint32_t index; // Global or local memory slot, variable or function index
+        uint32_t size;  // Array length
+    };
+
+    struct PendingStatement {
+        const StatementNode* node;
+        uint8_t state;
+        BlockId a;
+        BlockId b;
+    };
+    struct PendingExpression {
+        const ExpressionNode* node;
+        uint32_t state;
+        BlockId block; // && and ||: where the left operand ended
+        BlockId join;
+    };
+    // A pending read of a variable: a block on a single-predecessor chain
+    // that will define the value found (phi == kNoValue), or a phi collecting
+    // one operand per predecessor.
+    struct PendingRead {
+        BlockId block;
+        ValueId phi;
+        uint32_t nextPredecessor;
+        size_t firstOperand; // Into phiOperands_
+    };
+
+    const TokenBuffer& tokens_;
+    const SemanticInfo& info_;
+    IrModule* module_ = nullptr;
+    std::string error_;
+    std::vector<uint32_t> storageOf_; // By declaring name token: index into storages_
+    std::vector<Storage> storages_;
+    std::vector<const FunctionDefinitionNode*> functions_;
+
+    // Per function
+    IrFunction* function_ = nullptr;
+    ValueType returnType_ = ValueType::Void;
+    BlockId current_ = 0;
+    std::vector<IrType> variableTypes_;
+    std::unordered_map<uint64_t, ValueId> definitions_; // (variable, block) -> value
+    std::vector<uint8_t> sealed_;
+    std::vector<std::vector<std::pair<uint32_t, ValueId>>> incompletePhis_; // By block: (variable, phi)
+    std::vector<ValueId> replacement_; // Removed trivial phis -> their value
+    ValueId zero_[4] = { kNoValue, kNoValue, kNoValue, kNoValue }; // By IrType, in the entry block
+    std::vector<PendingStatement> statements_;
+    std::vector<PendingExpression> expressions_;
+    std::vector<ValueId> values_; // Lowered operands of pending expressions
+    std::vector<PendingRead> reads_;
+    std::vector<ValueId> phiOperands_;
+
+    // --- Blocks and instructions ---
+    BlockId newBlock();
+    void sealBlock(BlockId block);
+    bool terminated() const { return function_->terminator(current_) != kNoValue; }
+    ValueId emit(IrOp op, IrType type, std::initializer_list<ValueId> operands = {}, uint32_t aux = 0, uint32_t aux2 = 0);
+    ValueId emitList(IrOp op, IrType type, const ValueId* operands, uint32_t count, uint32_t aux = 0, uint32_t aux2 = 0);
+    void jump(BlockId target);
+    void branch(ValueId condition, BlockId ifTrue, BlockId ifFalse);
+    // Records the token's source offset on an instruction that can fail at run time.
+    void mark(ValueId value, TokenIndex token) { (*function_)[value].sourceOffset = tokens_.offset(token); }
+    ValueId constInt(int32_t value);
+    ValueId constFloat(double value);
+    ValueId zero(IrType type);
+
+    // --- SSA construction ---
+    void writeVariable(uint32_t variable, BlockId block, ValueId value);
+    ValueId readVariable(uint32_t variable, BlockId block);
+    ValueId findDefinition(uint32_t variable, BlockId block);
+    ValueId continueReads(uint32_t variable, size_t base, BlockId block);
+    ValueId newPhi(BlockId block, IrType type);
+    ValueId completePhi(ValueId phi, const ValueId* operands, uint32_t count);
+    ValueId resolve(ValueId value);
+    void removeTrivialPhis();
+
+    // --- Declarations and statements ---
+    void declareGlobal(const StatementNode* declaration);
+    void lowerDeclaration(const StatementNode* declaration, const Storage& storage);
+    void lowerFunction(IrFunction& function, const FunctionDefinitionNode* node);
+    void lowerGlobalInitializers(IrFunction& function, const ProgramNode* program);
+    void finishFunction();
+    void pushBlock(NodeList<StatementNode> block);
+    void lowerStatements();
+    void lowerStatement(const PendingStatement& item);
+    void lowerSimpleStatement(const StatementNode* statement);
+    void store(const Storage& storage, ValueId index, ValueId value, TokenIndex nameToken = kNoToken);
+    ValueId load(const Storage& storage, ValueId index, TokenIndex nameToken = kNoToken);
+    ValueId lowerCondition(const ExpressionNode* condition);
+    void lowerPrintf(const PrintfStatementNode* node);
+    void lowerScanf(const ScanfStatementNode* node);
+
+    // --- Expressions ---
+    const Storage& storageOf(TokenIndex nameToken) const { return storages_[storageOf_[info_.declarationOf(nameToken)]]; }
+    ValueId lowerExpression(const ExpressionNode* root);
+    void lowerExpressionStep(PendingExpression item);
+    ValueId convert(ValueId value, ValueType from, ValueType to);
+    ValueId toBool(ValueId value, ValueType type);
+    ValueType typeOf(const ExpressionNode* node) const { return info_.typeOf(node); }
+};
+
+#endif // IRBUILDER_H
@@ -0,0 +1,228 @@
+// IrInterpreter.cpp
+#include "IrInterpreter.h"
+#include "Bytecode.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+std::string outOfBounds(int32_t index, uint32_t size) {
+    return "Array index " + std::to_string(index) + " is out of bounds (size " + std::to_string(size) + ")";
+}
+
+} // namespace
+
+IrInterpreter::IrInterpreter(const IrModule& module)
+    : module_(module),
+      stack_(new Register[kStackSlots]),
+      frames_(new Frame[kMaxCallDepth]),
+      scanBuffer_(new char[kMaxScanfString + 1]) {}
+
+bool IrInterpreter::run() {
+    Register zero;
+    zero.number.f = 0.0;
+    globals_.assign(module_.globalMemory, zero);
+    exitStatus_ = 0;
+    errorMessage_.clear();
+    errorOffset_ = 0;
+    executed_ = 0;
+    calls_ = 0;
+    std::fill(executedOps_, executedOps_ + kOpcodeCount, 0);
+    Register result = zero;
+    if (!execute(module_.initFunction, result) || !execute(module_.mainFunction, result)) return false;
+    if (module_.functions[module_.mainFunction].returnType == IrType::Int) exitStatus_ = result.number.i;
+    return true;
+}
+
+void IrInterpreter::scan(const char* format, uint32_t kind, Register& target) {
+    // A failed read leaves the target unchanged, as in C.
+    switch (static_cast<IoKind>(kind)) {
+    case IoKind::Int: {
+        int value;
+        if (std::fscanf(input_, format, &value) == 1) target.number.i = value;
+        break;
+    }
+    case IoKind::Float: {
+        float value;
+        if (std::fscanf(input_, format, &value) == 1) target.number.f = value;
+        break;
+    }
+    case IoKind::Char: {
+        char value;
+        if (std::fscanf(input_, format, &value) == 1) target.number.i = static_cast<signed char>(value);
+        break;
+    }
+    case IoKind::String:
+        // The builder bounded the width by kMaxScanfString.
+        if (std::fscanf(input_, format, scanBuffer_.get()) == 1) {
+            target.text = strings_.store(std::string_view(scanBuffer_.get(), std::strlen(scanBuffer_.get()) + 1)).data();
+        }
+        break;
+    }
+}
+
+void IrInterpreter::enterBlock(Frame& frame, BlockId to) {
+    const IrFunction& function = *frame.function;
+    const IrBlock& block = function.blocks[to];
+    const BlockId from = frame.block;
+    frame.block = to;
+    frame.position = 0;
+    if (block.instructions.empty() || function[block.instructions[0]].op != IrOp::Phi) return;
+
+    // All phis read their operands before any of them is written.
+    const uint32_t index = static_cast<uint32_t>(
+        std::find(block.predecessors.begin(), block.predecessors.end(), from) - block.predecessors.begin());
+    phiValues_.clear();
+    uint32_t count = 0;
+    while (count < block.instructions.size() && function[block.instructions[count]].op == IrOp::Phi) {
+        phiValues_.push_back(frame.registers[function.operand(block.instructions[count], index)]);
+        ++count;
+    }
+    for (uint32_t i = 0; i < count; ++i) frame.registers[block.instructions[i]] = phiValues_[i];
+    frame.position = count;
+    executed_ += count;
+    executedOps_[static_cast<size_t>(IrOp::Phi)] += count;
+}
+
+bool IrInterpreter::execute(uint32_t entry, Register& result) {
+    Frame* const framesBegin = frames_.get();
+    Frame* const framesEnd = framesBegin + kMaxCallDepth;
+    Register* const stackEnd = stack_.get() + kStackSlots;
+    Frame* fp = framesBegin;
+    Register* top = stack_.get();
+    auto frameSize = [](const IrFunction& function) {
+        return function.values.size() + function.localMemory + function.parameterTypes.size();
+    };
+
+    const IrFunction& first = module_.functions[entry];
+    if (frameSize(first) > kStackSlots) {
+        errorMessage_ = "Stack overflow in call to '" + std::string(first.name) + "'";
+        return false;
+    }
+    *fp = Frame{ &first, top, 0, 0, kNoValue };
+    top += frameSize(first);
+    ++calls_;
+
+    for (;;) {
+        Frame& frame = *fp;
+        const IrFunction& function = *frame.function;
+        const ValueId id = function.blocks[frame.block].instructions[frame.position++];
+        const IrInstruction& instruction = function[id];
+        const ValueId* operands = function.operandsOf(id);
+        Register* const r = frame.registers;
+        Register* const memory = r + function.values.size();
+        ++executed_;
+        ++executedOps_[static_cast<size_t>(instruction.op)];
+
+        switch (instruction.op) {
+        case IrOp::Nop:
+        case IrOp::Phi: // Evaluated on entering the block
+            break;
+        case IrOp::Const:
+            r[id].number = instruction.constant;
+            break;
+        case IrOp::String:
+            r[id].text = module_.strings[instruction.aux].data();
+            break;
+        case IrOp::Param:
+            r[id] = memory[function.localMemory + instruction.aux];
+            break;
+        case IrOp::Copy:
+            r[id] = r[operands[0]];
+            break;
+        case IrOp::Div:
+        case IrOp::Mod:
+            if (r[operands[1]].number.i == 0) {
+                errorMessage_ = instruction.op == IrOp::Div ? "Division by zero" : "Remainder by zero";
+                errorOffset_ = instruction.sourceOffset;
+                return false;
+            }
+            evaluateIr(instruction.op, r[operands[0]].number, r[operands[1]].number, r[id].number);
+            break;
+        case IrOp::LoadGlobal:
+            r[id] = globals_[instruction.aux];
+            break;
+        case IrOp::StoreGlobal:
+            globals_[instruction.aux] = r[operands[0]];
+            break;
+        case IrOp::LoadElem:
+        case IrOp::StoreElem: {
+            // Compared as unsigned, so a negative index is out of bounds too.
+            const int32_t index = r[operands[0]].number.i;
+            if (static_cast<uint32_t>(index) >= instruction.aux2) {
+                errorMessage_ = outOfBounds(index, instruction.aux2);
+                errorOffset_ = instruction.sourceOffset;
+                return false;
+            }
+            Register* base = (instruction.flags & IrInstruction::kGlobalMemory) ? globals_.data() : memory;
+            if (instruction.op == IrOp::LoadElem) r[id] = base[instruction.aux + index];
+            else base[instruction.aux + index] = r[operands[1]];
+            break;
+        }
+        case IrOp::FillArray: {
+            Register* base = (instruction.flags & IrInstruction::kGlobalMemory) ? globals_.data() : memory;
+            std::fill(base + instruction.aux, base + instruction.aux + instruction.aux2, r[operands[0]]);
+            break;
+        }
+        case IrOp::Call: {
+            const IrFunction& callee = module_.functions[instruction.aux];
+            const size_t size = frameSize(callee);
+            if (fp + 1 == framesEnd || size > static_cast<size_t>(stackEnd - top)) {
+                errorMessage_ = "Stack overflow in call to '" + std::string(callee.name) + "'";
+                errorOffset_ = instruction.sourceOffset;
+                return false;
+            }
+            Register* arguments = top + callee.values.size() + callee.localMemory;
+            for (uint32_t i = 0; i < instruction.operandCount; ++i) arguments[i] = r[operands[i]];
+            *++fp = Frame{ &callee, top, 0, 0, id };
+            top += size;
+            ++calls_;
+            break;
+        }
+        case IrOp::Print: {
+            const char* format = module_.strings[instruction.aux].data();
+            if (instruction.operandCount == 0) {
+                std::fputs(format, output_);
+                break;
+            }
+            const Register argument = r[operands[0]];
+            switch (function[operands[0]].type) {
+            case IrType::Float: std::fprintf(output_, format, argument.number.f); break;
+            case IrType::String: std::fprintf(output_, format, argument.text); break;
+            default: std::fprintf(output_, format, argument.number.i); break;
+            }
+            break;
+        }
+        case IrOp::Scan:
+            r[id] = r[operands[0]];
+            scan(module_.strings[instruction.aux].data(), instruction.aux2, r[id]);
+            break;
+        case IrOp::Jump:
+            enterBlock(frame, instruction.aux);
+            break;
+        case IrOp::Branch:
+            enterBlock(frame, r[operands[0]].number.i != 0 ? instruction.aux : instruction.aux2);
+            break;
+        case IrOp::Return: {
+            Register value;
+            value.number.f = 0.0;
+            if (instruction.operandCount) value = r[operands[0]];
+            top = frame.registers;
+            if (fp == framesBegin) {
+                result = value;
+                return true;
+            }
+            --fp;
+            fp->registers[frame.call] = value;
+            break;
+        }
+        default: {
+            // The operators: one or two operands.
+            const IrConstant a = r[operands[0]].number;
+            const IrConstant b = instruction.operandCount > 1 ? r[operands[1]].number : a;
+            evaluateIr(instruction.op, a, b, r[id].number);
+            break;
+        }
+        }
+    }
+}
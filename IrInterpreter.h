@@ -0,0 +1,82 @@
+// IrInterpreter.h
+#ifndef IRINTERPRETER_H
+#define IRINTERPRETER_H
+
+#include "Ir.h"
+#include "StringPool.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// IrInterpreter: Runs an IrModule as it is, to check what the passes did and
+// to measure it. Every instruction it executes is counted (phis and
+// terminators included), so one program built at two optimization levels can
+// be compared by the work left in it; the VM remains the fast way to run it.
+//
+// It behaves like the VM: ints wrap around the same way (see evaluateIr),
+// printf and scanf go through the C library, and division by zero, an index
+// out of bounds and too deep a recursion stop the program with the VM's
+// messages, located by the failing instruction's sourceOffset.
+//
+// A call's frame holds one register per ValueId of the callee, then its local
+// memory, then its arguments, on one contiguous stack. Calls do not recurse
+// on the C++ stack.
+class IrInterpreter {
+public:
+    static const size_t kStackSlots = size_t(1) << 23; // 64 MB of registers
+    static const size_t kMaxCallDepth = size_t(1) << 18;
+    static const size_t kOpcodeCount = static_cast<size_t>(IrOp::Return) + 1;
+
+    explicit IrInterpreter(const IrModule& module);
+
+    void setOutput(FILE* output) { output_ = output; }
+    void setInput(FILE* input) { input_ = input; }
+
+    // Runs ".init", then main. Returns false on a run-time error.
+    bool run();
+
+    int exitStatus() const { return exitStatus_; } // main's value, or 0 for void main
+    const std::string& errorMessage() const { return errorMessage_; }
+    uint32_t errorOffset() const { return errorOffset_; }
+    uint64_t executedInstructions() const { return executed_; }
+    uint64_t executedCalls() const { return calls_; }
+    uint64_t executedInstructions(IrOp op) const { return executedOps_[static_cast<size_t>(op)]; }
+
+private:
+    union Register {
+        IrConstant number;
+        const char* text; // NUL-terminated
+    };
+    struct Frame {
+        const IrFunction* function;
+        Register* registers;
+        BlockId block;
+        uint32_t position; // Of the next instruction in the block
+        ValueId call;      // The caller's Call, which receives the result
+    };
+
+    const IrModule& module_;
+    std::unique_ptr<Register[]> stack_;
+    std::unique_ptr<Frame[]> frames_;
+    std::vector<Register> globals_;
+    std::vector<Register> phiValues_;
+    StringPool strings_; // Strings read by scanf
+    std::unique_ptr<char[]> scanBuffer_;
+    FILE* output_ = stdout;
+    FILE* input_ = stdin;
+    int exitStatus_ = 0;
+    std::string errorMessage_;
+    uint32_t errorOffset_ = 0;
+    uint64_t executed_ = 0;
+    uint64_t calls_ = 0;
+    uint64_t executedOps_[kOpcodeCount] = {}; // By opcode
+
+    // Runs one function of the module, without arguments, to its return.
+    bool execute(uint32_t function, Register& result);
+    // Moves to `to` from its predecessor `from`, evaluating its phis together.
+    void enterBlock(Frame& frame, BlockId to);
+    void scan(const char* format, uint32_t kind, Register& target);
+};
+
+#endif // IRINTERPRETER_H
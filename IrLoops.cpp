@@ -0,0 +1,465 @@
+// IrLoops.cpp
+#include "IrLoops.h"
+#include "IrPasses.h"
+#include "Bytecode.h"
+#include <algorithm>
+
+namespace {
+
+// Full unrolling: loops of at most this many trips, growing the function by
+// at most this many instructions.
+const uint32_t kMaxUnrollTrips = 16;
+const size_t kMaxUnrolledInstructions = 256;
+
+bool isIntConstant(const IrFunction& function, ValueId value) {
+    return function[value].op == IrOp::Const && function[value].type == IrType::Int;
+}
+
+ValueId appendInstruction(IrFunction& function, BlockId block, IrOp op, IrType type,
+                          const ValueId* operands, uint32_t count, uint32_t aux = 0) {
+    IrInstruction instruction;
+    instruction.op = op;
+    instruction.type = type;
+    instruction.block = block;
+    instruction.aux = aux;
+    ValueId value = function.create(instruction, operands, count);
+    function.blocks[block].instructions.push_back(value);
+    return value;
+}
+
+// Creates an instruction in `block` just before its terminator.
+ValueId insertBeforeTerminator(IrFunction& function, BlockId block, const IrInstruction& instruction,
+                               const ValueId* operands = nullptr, uint32_t count = 0) {
+    IrInstruction copy = instruction;
+    copy.block = block;
+    ValueId value = function.create(copy, operands, count);
+    std::vector<ValueId>& list = function.blocks[block].instructions;
+    list.insert(list.end() - 1, value);
+    return value;
+}
+
+ValueId intConstantBefore(IrFunction& function, BlockId block, int32_t constant) {
+    IrInstruction instruction;
+    instruction.op = IrOp::Const;
+    instruction.type = IrType::Int;
+    instruction.constant.i = constant;
+    return insertBeforeTerminator(function, block, instruction);
+}
+
+// The trip count of a loop whose header branch compares a basic induction
+// variable with a constant, found by running the test with evaluateIr (so
+// wraparound counts as it would at run time); 0 if it is not such a loop or
+// makes more than kMaxUnrollTrips trips.
+uint32_t constantTripCount(const IrFunction& function, const Loop& loop, ValueId condition, bool continueIfTrue) {
+    const IrInstruction& compare = function[condition];
+    if (compare.block != loop.header || compare.op < IrOp::Lt || compare.op > IrOp::Ne) return 0;
+    for (const InductionVariable& variable : findInductionVariables(function, loop)) {
+        const bool variableFirst = function.operand(condition, 0) == variable.phi;
+        const ValueId bound = function.operand(condition, variableFirst ? 1 : 0);
+        if (function.operand(condition, variableFirst ? 0 : 1) != variable.phi) continue;
+        if (!isIntConstant(function, bound) || !isIntConstant(function, variable.initial)) return 0;
+        IrConstant value = function[variable.initial].constant;
+        IrConstant step;
+        step.i = variable.step;
+        for (uint32_t trips = 0; trips <= kMaxUnrollTrips; ++trips) {
+            IrConstant taken;
+            if (variableFirst) evaluateIr(compare.op, value, function[bound].constant, taken);
+            else evaluateIr(compare.op, function[bound].constant, value, taken);
+            if ((taken.i != 0) != continueIfTrue) return trips;
+            evaluateIr(IrOp::Add, value, step, value);
+        }
+        return 0;
+    }
+    return 0;
+}
+
+// Replaces the loop by `trips` copies of its body, each after a copy of its
+// header, and a last header copy that goes to the exit. The header's branch
+// is the only way out and its decisions are known, so every copy ends in a
+// jump; the header's phis become the values of the previous copy.
+bool unrollLoop(IrFunction& function, const LoopInfo& info, uint32_t index) {
+    const Loop& loop = info.loops[index];
+    if (loop.preheader == kNoBlock || loop.latches.size() != 1) return false;
+    const BlockId header = loop.header;
+    const BlockId latch = loop.latches[0];
+    const ValueId branch = function.terminator(header);
+    if (branch == kNoValue || function[branch].op != IrOp::Branch) return false;
+    const BlockId ifTrue = function[branch].aux;
+    const BlockId ifFalse = function[branch].aux2;
+    const bool continueIfTrue = info.contains(index, ifTrue);
+    if (continueIfTrue == info.contains(index, ifFalse)) return false;
+    const BlockId exit = continueIfTrue ? ifFalse : ifTrue;
+    const BlockId bodyEntry = continueIfTrue ? ifTrue : ifFalse;
+
+    size_t size = 0;
+    for (BlockId block : loop.blocks) {
+        size += function.blocks[block].instructions.size();
+        BlockId successors[2];
+        uint32_t count = function.successors(block, successors);
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!info.contains(index, successors[i]) && block != header) return false; // Another way out
+        }
+    }
+    const uint32_t trips = constantTripCount(function, loop, function.operand(branch, 0), continueIfTrue);
+    if (trips == 0 || size * trips > kMaxUnrolledInstructions) return false;
+
+    const std::vector<BlockId>& predecessors = function.blocks[header].predecessors;
+    const uint32_t fromPreheader = predecessors[0] == loop.preheader ? 0 : 1;
+    const uint32_t fromLatch = 1 - fromPreheader;
+    std::vector<ValueId> phis;
+    std::vector<ValueId> headerBody; // The header's other instructions, without the branch
+    for (ValueId value : function.blocks[header].instructions) {
+        if (function[value].op == IrOp::Phi) phis.push_back(value);
+        else if (value != branch) headerBody.push_back(value);
+    }
+    std::vector<ValueId> phiValues(phis.size());
+    for (size_t i = 0; i < phis.size(); ++i) phiValues[i] = function.operand(phis[i], fromPreheader);
+
+    // Every block is created first: the vector of blocks must not move below.
+    const std::vector<BlockId> body(loop.blocks.begin() + 1, loop.blocks.end());
+    const BlockId firstCopy = static_cast<BlockId>(function.blocks.size());
+    function.blocks.resize(function.blocks.size() + (trips + 1) + trips * body.size());
+    auto headerCopy = [&](uint32_t k) { return firstCopy + k; };
+    std::vector<BlockId> blockCopy(firstCopy, kNoBlock); // Of the copy being made
+
+    std::vector<ValueId> map(function.values.size(), kNoValue);
+    auto mapped = [&](ValueId value) { return value < map.size() && map[value] != kNoValue ? map[value] : value; };
+    auto clone = [&](ValueId original, BlockId block) {
+        IrInstruction instruction = function[original];
+        instruction.block = block;
+        std::vector<ValueId> operands(function.operandsOf(original), function.operandsOf(original) + instruction.operandCount);
+        ValueId value = function.create(instruction, operands.data(), instruction.operandCount);
+        function.blocks[block].instructions.push_back(value);
+        map[original] = value;
+        return value;
+    };
+    auto remap = [&](ValueId value) {
+        ValueId* operands = function.operandsOf(value);
+        for (uint32_t i = 0; i < function[value].operandCount; ++i) operands[i] = mapped(operands[i]);
+    };
+
+    for (uint32_t k = 0; k <= trips; ++k) {
+        const BlockId copy = headerCopy(k);
+        const BlockId from = k == 0 ? loop.preheader : (latch == header ? headerCopy(k - 1) : blockCopy[latch]);
+        function.blocks[copy].predecessors.assign(1, from);
+        for (size_t i = 0; i < phis.size(); ++i) map[phis[i]] = phiValues[i];
+        for (ValueId value : headerBody) remap(clone(value, copy));
+        if (k == trips) {
+            appendInstruction(function, copy, IrOp::Jump, IrType::Void, nullptr, 0, exit);
+            break;
+        }
+
+        const BlockId base = firstCopy + (trips + 1) + k * static_cast<BlockId>(body.size());
+        for (size_t i = 0; i < body.size(); ++i) blockCopy[body[i]] = base + static_cast<BlockId>(i);
+        auto mapBlock = [&](BlockId block) { return block == header ? headerCopy(k + 1) : blockCopy[block]; };
+        appendInstruction(function, copy, IrOp::Jump, IrType::Void, nullptr, 0, mapBlock(bodyEntry));
+        std::vector<ValueId> cloned;
+        for (BlockId block : body) {
+            for (ValueId value : function.blocks[block].instructions) cloned.push_back(clone(value, blockCopy[block]));
+            for (BlockId predecessor : function.blocks[block].predecessors) {
+                function.blocks[blockCopy[block]].predecessors.push_back(predecessor == header ? copy : blockCopy[predecessor]);
+            }
+        }
+        // Operands last: phis of inner loops use values defined later in the copy.
+        for (ValueId value : cloned) {
+            remap(value);
+            IrInstruction& instruction = function[value];
+            if (instruction.op == IrOp::Jump || instruction.op == IrOp::Branch) {
+                instruction.aux = mapBlock(instruction.aux);
+                if (instruction.op == IrOp::Branch) instruction.aux2 = mapBlock(instruction.aux2);
+            }
+        }
+        for (size_t i = 0; i < phis.size(); ++i) phiValues[i] = mapped(function.operand(phis[i], fromLatch));
+    }
+
+    // Enter the first copy and leave from the last one, which also provides
+    // the header's values to the code after the loop.
+    function[function.terminator(loop.preheader)].aux = headerCopy(0);
+    std::vector<BlockId>& exitPredecessors = function.blocks[exit].predecessors;
+    std::replace(exitPredecessors.begin(), exitPredecessors.end(), header, headerCopy(trips));
+    std::vector<ValueId> replacement(function.values.size(), kNoValue);
+    for (ValueId value : phis) replacement[value] = map[value];
+    for (ValueId value : headerBody) replacement[value] = map[value];
+    for (BlockId block : loop.blocks) {
+        for (ValueId value : function.blocks[block].instructions) function[value].op = IrOp::Nop;
+        function.blocks[block].instructions.clear();
+        function.blocks[block].predecessors.clear();
+    }
+    function.replaceOperands(replacement);
+    return true;
+}
+
+} // namespace
+
+// --- LoopInfo ---
+
+LoopInfo::LoopInfo(const IrFunction& function, const DominatorTree& dominators) {
+    const size_t blockCount = function.blocks.size();
+    loopOf.assign(blockCount, kNoLoop);
+    std::vector<uint32_t> order(blockCount, 0);
+    for (uint32_t i = 0; i < dominators.reversePostorder.size(); ++i) order[dominators.reversePostorder[i]] = i;
+
+    // Back edges, one loop per header.
+    std::vector<uint32_t> loopOfHeader(blockCount, kNoLoop);
+    for (BlockId block : dominators.reversePostorder) {
+        BlockId successors[2];
+        uint32_t count = function.successors(block, successors);
+        for (uint32_t i = 0; i < count; ++i) {
+            BlockId header = successors[i];
+            if (!dominators.dominates(header, block)) continue;
+            if (loopOfHeader[header] == kNoLoop) {
+                loopOfHeader[header] = static_cast<uint32_t>(loops.size());
+                loops.push_back(Loop{ header, kNoBlock, {}, {}, kNoLoop, 1 });
+            }
+            std::vector<BlockId>& latches = loops[loopOfHeader[header]].latches;
+            if (std::find(latches.begin(), latches.end(), block) == latches.end()) latches.push_back(block);
+        }
+    }
+
+    // Bodies: everything that reaches a latch backwards without passing the header.
+    std::vector<uint32_t> mark(blockCount, kNoLoop);
+    std::vector<BlockId> work;
+    for (uint32_t l = 0; l < loops.size(); ++l) {
+        Loop& loop = loops[l];
+        mark[loop.header] = l;
+        for (BlockId latch : loop.latches) {
+            if (mark[latch] == l) continue;
+            mark[latch] = l;
+            loop.blocks.push_back(latch);
+            work.push_back(latch);
+        }
+        while (!work.empty()) {
+            BlockId block = work.back();
+            work.pop_back();
+            for (BlockId predecessor : function.blocks[block].predecessors) {
+                if (mark[predecessor] == l || !dominators.reachable(predecessor)) continue;
+                mark[predecessor] = l;
+                loop.blocks.push_back(predecessor);
+                work.push_back(predecessor);
+            }
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end(), [&](BlockId a, BlockId b) { return order[a] < order[b]; });
+        loop.blocks.insert(loop.blocks.begin(), loop.header);
+
+        // The preheader: the one entry from outside, by a jump.
+        uint32_t entries = 0;
+        for (BlockId predecessor : function.blocks[loop.header].predecessors) {
+            if (mark[predecessor] == l) continue;
+            ++entries;
+            ValueId last = function.terminator(predecessor);
+            if (last != kNoValue && function[last].op == IrOp::Jump) loop.preheader = predecessor;
+        }
+        if (entries != 1) loop.preheader = kNoBlock;
+    }
+
+    // A loop contains only smaller ones: outer loops first, then nest.
+    std::stable_sort(loops.begin(), loops.end(), [](const Loop& a, const Loop& b) { return a.blocks.size() > b.blocks.size(); });
+    for (uint32_t l = 0; l < loops.size(); ++l) {
+        Loop& loop = loops[l];
+        loop.parent = loopOf[loop.header];
+        loop.depth = loop.parent == kNoLoop ? 1 : loops[loop.parent].depth + 1;
+        for (BlockId block : loop.blocks) loopOf[block] = l;
+    }
+}
+
+bool LoopInfo::contains(uint32_t loop, BlockId block) const {
+    for (uint32_t l = loopOf[block]; l != kNoLoop; l = loops[l].parent) {
+        if (l == loop) return true;
+    }
+    return false;
+}
+
+std::vector<InductionVariable> findInductionVariables(const IrFunction& function, const Loop& loop) {
+    std::vector<InductionVariable> variables;
+    const IrBlock& header = function.blocks[loop.header];
+    if (loop.preheader == kNoBlock || loop.latches.size() != 1 || header.predecessors.size() != 2) return variables;
+    const uint32_t fromPreheader = header.predecessors[0] == loop.preheader ? 0 : 1;
+    const uint32_t fromLatch = 1 - fromPreheader;
+    for (ValueId phi : header.instructions) {
+        if (function[phi].op != IrOp::Phi) break;
+        if (function[phi].type != IrType::Int) continue;
+        const ValueId update = function.operand(phi, fromLatch);
+        const IrInstruction& instruction = function[update];
+        if (instruction.op != IrOp::Add && instruction.op != IrOp::Sub) continue;
+        const ValueId a = function.operand(update, 0);
+        const ValueId b = function.operand(update, 1);
+        int32_t step;
+        if (a == phi && isIntConstant(function, b)) {
+            step = function[b].constant.i;
+            if (instruction.op == IrOp::Sub) step = wrapInt(0u - static_cast<uint32_t>(step));
+        }
+        else if (b == phi && instruction.op == IrOp::Add && isIntConstant(function, a)) {
+            step = function[a].constant.i;
+        }
+        else {
+            continue;
+        }
+        variables.push_back(InductionVariable{ phi, function.operand(phi, fromPreheader), update, step });
+    }
+    return variables;
+}
+
+// --- Loop passes ---
+
+bool hoistLoopInvariants(IrFunction& function, const IrModule& module) {
+    const DominatorTree dominators(function);
+    const LoopInfo info(function, dominators);
+    std::vector<uint8_t> stored(module.globalMemory, 0);
+    bool changed = false;
+    for (uint32_t l = static_cast<uint32_t>(info.loops.size()); l-- > 0;) {
+        // Inner loops first, so that what leaves one can leave the next as well.
+        const Loop& loop = info.loops[l];
+        if (loop.preheader == kNoBlock) continue;
+        bool calls = false; // A callee may store to any global
+        std::fill(stored.begin(), stored.end(), 0);
+        for (BlockId block : loop.blocks) {
+            for (ValueId value : function.blocks[block].instructions) {
+                if (function[value].op == IrOp::Call) calls = true;
+                else if (function[value].op == IrOp::StoreGlobal) stored[function[value].aux] = 1;
+            }
+        }
+        auto invariant = [&](ValueId value) {
+            const IrInstruction& instruction = function[value];
+            const IrOp op = instruction.op;
+            if (op == IrOp::Div || op == IrOp::Mod) {
+                // Only an int constant is read through constant.i; anything else may trap.
+                const ValueId divisor = function.operand(value, 1);
+                if (!isIntConstant(function, divisor) || function[divisor].constant.i == 0) return false;
+            }
+            else if (op == IrOp::LoadGlobal) {
+                if (calls || stored[instruction.aux]) return false;
+            }
+            else if (!isOperator(op) && op != IrOp::Const && op != IrOp::String) {
+                return false;
+            }
+            const ValueId* operands = function.operandsOf(value);
+            for (uint32_t i = 0; i < instruction.operandCount; ++i) {
+                if (info.contains(l, function[operands[i]].block)) return false;
+            }
+            return true;
+        };
+
+        // In reverse postorder an operand is hoisted before its users are looked at.
+        std::vector<ValueId> hoisted;
+        for (BlockId block : loop.blocks) {
+            std::vector<ValueId>& list = function.blocks[block].instructions;
+            size_t kept = 0;
+            for (ValueId value : list) {
+                if (invariant(value)) {
+                    function[value].block = loop.preheader;
+                    hoisted.push_back(value);
+                }
+                else {
+                    list[kept++] = value;
+                }
+            }
+            list.resize(kept);
+        }
+        if (hoisted.empty()) continue;
+        std::vector<ValueId>& target = function.blocks[loop.preheader].instructions;
+        target.insert(target.end() - 1, hoisted.begin(), hoisted.end());
+        changed = true;
+    }
+    return changed;
+}
+
+bool reduceStrength(IrFunction& function, const IrModule&) {
+    const DominatorTree dominators(function);
+    const LoopInfo info(function, dominators);
+    std::vector<ValueId> replacement(function.values.size(), kNoValue);
+    bool changed = false;
+    for (const Loop& loop : info.loops) {
+        const std::vector<InductionVariable> variables = findInductionVariables(function, loop);
+        if (variables.empty()) continue;
+        const uint32_t fromPreheader = function.blocks[loop.header].predecessors[0] == loop.preheader ? 0 : 1;
+        for (const InductionVariable& variable : variables) {
+            // One new variable per factor: i * c is a variable stepping by step * c.
+            std::vector<std::pair<uint32_t, ValueId>> reduced;
+            for (BlockId block : loop.blocks) {
+                // Indexed: creating instructions below may add to this block.
+                for (size_t i = 0; i < function.blocks[block].instructions.size(); ++i) {
+                    const ValueId value = function.blocks[block].instructions[i];
+                    const IrInstruction& instruction = function[value];
+                    if (instruction.op != IrOp::Mul && instruction.op != IrOp::Shl) continue;
+                    const ValueId a = function.operand(value, 0);
+                    const ValueId b = function.operand(value, 1);
+                    uint32_t factor;
+                    if (instruction.op == IrOp::Shl && a == variable.phi && isIntConstant(function, b)) {
+                        factor = 1u << (function[b].constant.i & 31);
+                    }
+                    else if (instruction.op == IrOp::Mul && a == variable.phi && isIntConstant(function, b)) {
+                        factor = static_cast<uint32_t>(function[b].constant.i);
+                    }
+                    else if (instruction.op == IrOp::Mul && b == variable.phi && isIntConstant(function, a)) {
+                        factor = static_cast<uint32_t>(function[a].constant.i);
+                    }
+                    else {
+                        continue;
+                    }
+                    if (factor == 0 || factor == 1) continue; // Left to sccp and gvn
+
+                    auto found = std::find_if(reduced.begin(), reduced.end(),
+                        [&](const std::pair<uint32_t, ValueId>& entry) { return entry.first == factor; });
+                    if (found == reduced.end()) {
+                        // start = initial * c in the preheader, then phi + step * c after the update.
+                        ValueId multiplier = intConstantBefore(function, loop.preheader, wrapInt(factor));
+                        ValueId startOperands[2] = { variable.initial, multiplier };
+                        IrInstruction multiply;
+                        multiply.op = IrOp::Mul;
+                        multiply.type = IrType::Int;
+                        ValueId start = insertBeforeTerminator(function, loop.preheader, multiply, startOperands, 2);
+                        ValueId step = intConstantBefore(function, loop.preheader,
+                            wrapInt(static_cast<uint32_t>(variable.step) * factor));
+
+                        IrInstruction phi;
+                        phi.op = IrOp::Phi;
+                        phi.type = IrType::Int;
+                        phi.block = loop.header;
+                        ValueId reducedPhi = function.create(phi);
+                        std::vector<ValueId>& headerList = function.blocks[loop.header].instructions;
+                        headerList.insert(headerList.begin(), reducedPhi);
+
+                        IrInstruction add;
+                        add.op = IrOp::Add;
+                        add.type = IrType::Int;
+                        add.block = function[variable.update].block;
+                        ValueId nextOperands[2] = { reducedPhi, step };
+                        ValueId next = function.create(add, nextOperands, 2);
+                        std::vector<ValueId>& updateList = function.blocks[add.block].instructions;
+                        updateList.insert(std::find(updateList.begin(), updateList.end(), variable.update) + 1, next);
+
+                        ValueId phiOperands[2];
+                        phiOperands[fromPreheader] = start;
+                        phiOperands[1 - fromPreheader] = next;
+                        function.setOperands(reducedPhi, phiOperands, 2);
+                        reduced.push_back({ factor, reducedPhi });
+                        found = reduced.end() - 1;
+                    }
+                    replacement.resize(function.values.size(), kNoValue);
+                    replacement[value] = found->second;
+                    function[value].op = IrOp::Nop;
+                    changed = true;
+                }
+            }
+        }
+    }
+    if (!changed) return false;
+    function.replaceOperands(replacement);
+    function.compact();
+    return true;
+}
+
+bool unrollLoops(IrFunction& function, const IrModule&) {
+    // One loop at a time, inner loops first; the analysis is redone after each.
+    bool changed = false;
+    for (bool unrolled = true; unrolled;) {
+        unrolled = false;
+        const DominatorTree dominators(function);
+        const LoopInfo info(function, dominators);
+        for (uint32_t l = static_cast<uint32_t>(info.loops.size()); l-- > 0 && !unrolled;) {
+            unrolled = unrollLoop(function, info, l);
+        }
+        changed = changed || unrolled;
+    }
+    return changed;
+}
@@ -0,0 +1,50 @@
+// IrLoops.h
+#ifndef IRLOOPS_H
+#define IRLOOPS_H
+
+#include "Ir.h"
+#include <vector>
+
+// Loop analysis for the loop passes (see IrPasses.h).
+//
+// A natural loop is found from a back edge, an edge whose target (the header)
+// dominates its source (a latch): it is the header and every block that
+// reaches a latch without passing through the header. Back edges to one
+// header make one loop. Blocks that leave the loop for good (a return) are
+// not part of it.
+struct Loop {
+    BlockId header;
+    // The only block that enters the header from outside the loop, if it does
+    // so with a jump (as IrBuilder lowers every while and for); kNoBlock if
+    // there is none, and then the loop passes leave the loop alone.
+    BlockId preheader = kNoBlock;
+    std::vector<BlockId> blocks;  // The header first, then in reverse postorder
+    std::vector<BlockId> latches;
+    uint32_t parent;              // Innermost enclosing loop, or LoopInfo::kNoLoop
+    uint32_t depth;               // 1 for an outermost loop
+};
+
+// LoopInfo: The loops of a function and how they nest.
+struct LoopInfo {
+    static constexpr uint32_t kNoLoop = ~0u;
+
+    std::vector<Loop> loops;      // Every loop after the loops that contain it
+    std::vector<uint32_t> loopOf; // Innermost loop of each block, or kNoLoop
+
+    LoopInfo(const IrFunction& function, const DominatorTree& dominators);
+    bool contains(uint32_t loop, BlockId block) const;
+};
+
+// A basic induction variable: a header phi that starts at `initial` (from the
+// preheader) and whose value from the only latch is `update`, the phi plus or
+// minus the constant `step`.
+struct InductionVariable {
+    ValueId phi;
+    ValueId initial;
+    ValueId update;
+    int32_t step;
+};
+
+std::vector<InductionVariable> findInductionVariables(const IrFunction& function, const Loop& loop);
+
+#endif // IRLOOPS_H
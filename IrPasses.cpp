@@ -0,0 +1,597 @@
+// IrPasses.cpp
+#include "IrPasses.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+// The users of every value: those of v are users[first[v]] up to
+// users[first[v + 1]]. Only instructions linked into a block count.
+struct UseLists {
+    std::vector<uint32_t> first;
+    std::vector<ValueId> users;
+
+    explicit UseLists(const IrFunction& function) {
+        const size_t valueCount = function.values.size();
+        first.assign(valueCount + 1, 0);
+        for (const IrBlock& block : function.blocks) {
+            for (ValueId value : block.instructions) {
+                const ValueId* operands = function.operandsOf(value);
+                for (uint32_t i = 0; i < function[value].operandCount; ++i) ++first[operands[i] + 1];
+            }
+        }
+        for (size_t v = 0; v < valueCount; ++v) first[v + 1] += first[v];
+        users.resize(first[valueCount]);
+        std::vector<uint32_t> next(first.begin(), first.end() - 1);
+        for (const IrBlock& block : function.blocks) {
+            for (ValueId value : block.instructions) {
+                const ValueId* operands = function.operandsOf(value);
+                for (uint32_t i = 0; i < function[value].operandCount; ++i) users[next[operands[i]]++] = value;
+            }
+        }
+    }
+};
+
+uint64_t constantBits(IrType type, IrConstant constant) {
+    if (type != IrType::Float) return static_cast<uint32_t>(constant.i);
+    uint64_t bits;
+    std::memcpy(&bits, &constant.f, sizeof(bits));
+    return bits;
+}
+
+bool isIntConstant(const IrFunction& function, ValueId value, int32_t constant) {
+    const IrInstruction& instruction = function[value];
+    return instruction.op == IrOp::Const && instruction.type == IrType::Int && instruction.constant.i == constant;
+}
+
+// What value numbering compares: the opcode and everything it reads.
+struct ValueKey {
+    IrOp op;
+    IrType type;
+    uint8_t flags;
+    uint32_t aux;
+    uint32_t aux2;
+    uint64_t constant;
+    ValueId a;
+    ValueId b;
+
+    bool operator==(const ValueKey& other) const {
+        return op == other.op && type == other.type && flags == other.flags && aux == other.aux
+            && aux2 == other.aux2 && constant == other.constant && a == other.a && b == other.b;
+    }
+};
+
+struct ValueKeyHash {
+    size_t operator()(const ValueKey& key) const {
+        uint64_t hash = (static_cast<uint64_t>(key.op) << 8) ^ static_cast<uint64_t>(key.type) ^ (static_cast<uint64_t>(key.flags) << 16);
+        for (uint64_t part : { static_cast<uint64_t>(key.aux), static_cast<uint64_t>(key.aux2), key.constant,
+                 static_cast<uint64_t>(key.a), static_cast<uint64_t>(key.b) }) {
+            hash = (hash ^ part) * 0x9E3779B97F4A7C15ull;
+            hash ^= hash >> 29;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+bool isCommutative(IrOp op) {
+    switch (op) {
+    case IrOp::Add: case IrOp::Mul: case IrOp::And: case IrOp::Or: case IrOp::Xor:
+    case IrOp::Eq: case IrOp::Ne:
+    case IrOp::FAdd: case IrOp::FMul: case IrOp::FEq: case IrOp::FNe:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Turns an instruction into a copy of `value` or into an int constant.
+void makeCopy(IrFunction& function, ValueId instruction, ValueId value) {
+    function[instruction].op = IrOp::Copy;
+    function.setOperands(instruction, &value, 1);
+}
+
+void makeConstant(IrFunction& function, ValueId instruction, int32_t constant) {
+    IrInstruction& target = function[instruction];
+    target.op = IrOp::Const;
+    target.operandCount = 0;
+    target.constant.i = constant;
+}
+
+// Int identities of an operator with resolved operands; true if the
+// instruction was rewritten into a copy or a constant.
+bool simplify(IrFunction& function, ValueId value) {
+    const IrInstruction& instruction = function[value];
+    if (instruction.type != IrType::Int || instruction.operandCount == 0) return false;
+    const ValueId a = function.operand(value, 0);
+    if (instruction.operandCount == 1) {
+        const IrInstruction& inner = function[a];
+        // -(-x), ~~x and the char of a char.
+        if ((instruction.op == IrOp::Neg || instruction.op == IrOp::BitNot) && inner.op == instruction.op) {
+            makeCopy(function, value, function.operand(a, 0));
+            return true;
+        }
+        if (instruction.op == IrOp::IToC && inner.op == IrOp::IToC) {
+            makeCopy(function, value, a);
+            return true;
+        }
+        return false;
+    }
+    const ValueId b = function.operand(value, 1);
+    if (function[a].type != IrType::Int) return false; // Float comparisons
+    switch (instruction.op) {
+    case IrOp::Add:
+    case IrOp::Or:
+    case IrOp::Xor:
+        if (isIntConstant(function, b, 0)) { makeCopy(function, value, a); return true; }
+        if (isIntConstant(function, a, 0)) { makeCopy(function, value, b); return true; }
+        if (a == b && instruction.op == IrOp::Or) { makeCopy(function, value, a); return true; }
+        if (a == b && instruction.op == IrOp::Xor) { makeConstant(function, value, 0); return true; }
+        return false;
+    case IrOp::Sub:
+        if (isIntConstant(function, b, 0)) { makeCopy(function, value, a); return true; }
+        if (a == b) { makeConstant(function, value, 0); return true; }
+        return false;
+    case IrOp::Mul:
+        if (isIntConstant(function, b, 1)) { makeCopy(function, value, a); return true; }
+        if (isIntConstant(function, a, 1)) { makeCopy(function, value, b); return true; }
+        if (isIntConstant(function, a, 0) || isIntConstant(function, b, 0)) { makeConstant(function, value, 0); return true; }
+        return false;
+    case IrOp::Div:
+        if (isIntConstant(function, b, 1)) { makeCopy(function, value, a); return true; }
+        return false;
+    case IrOp::Mod:
+        if (isIntConstant(function, b, 1) || isIntConstant(function, b, -1)) { makeConstant(function, value, 0); return true; }
+        return false;
+    case IrOp::And:
+        if (isIntConstant(function, b, -1) || a == b) { makeCopy(function, value, a); return true; }
+        if (isIntConstant(function, a, -1)) { makeCopy(function, value, b); return true; }
+        if (isIntConstant(function, a, 0) || isIntConstant(function, b, 0)) { makeConstant(function, value, 0); return true; }
+        return false;
+    case IrOp::Shl:
+    case IrOp::Shr:
+        if (function[b].op == IrOp::Const && (function[b].constant.i & 31) == 0) { makeCopy(function, value, a); return true; }
+        return false;
+    case IrOp::Eq: case IrOp::Le: case IrOp::Ge:
+        if (a == b) { makeConstant(function, value, 1); return true; }
+        return false;
+    case IrOp::Ne: case IrOp::Lt: case IrOp::Gt:
+        if (a == b) { makeConstant(function, value, 0); return true; }
+        return false;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+bool removeTrivialPhis(IrFunction& function) {
+    std::vector<ValueId> replacement(function.values.size(), kNoValue);
+    bool removed = false;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (IrBlock& block : function.blocks) {
+            for (ValueId value : block.instructions) {
+                IrInstruction& phi = function[value];
+                if (phi.op != IrOp::Phi) {
+                    if (phi.op == IrOp::Nop) continue;
+                    break;
+                }
+                ValueId same = kNoValue;
+                bool trivial = true;
+                const ValueId* operands = function.operandsOf(value);
+                for (uint32_t i = 0; i < phi.operandCount && trivial; ++i) {
+                    ValueId operand = operands[i];
+                    while (replacement[operand] != kNoValue) operand = replacement[operand];
+                    if (operand == value || operand == same) continue;
+                    if (same != kNoValue) trivial = false;
+                    same = operand;
+                }
+                // A phi of nothing but itself only occurs in unreachable code, which is gone.
+                if (!trivial || same == kNoValue) continue;
+                replacement[value] = same;
+                phi.op = IrOp::Nop;
+                changed = removed = true;
+            }
+        }
+    }
+    if (!removed) return false;
+    function.replaceOperands(replacement);
+    function.compact();
+    return true;
+}
+
+bool removeUnreachableBlocks(IrFunction& function, const IrModule&) {
+    const size_t blockCount = function.blocks.size();
+    std::vector<uint8_t> reachable(blockCount, 0);
+    std::vector<BlockId> work{ 0 };
+    reachable[0] = 1;
+    while (!work.empty()) {
+        BlockId successors[2];
+        uint32_t count = function.successors(work.back(), successors);
+        work.pop_back();
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!reachable[successors[i]]) {
+                reachable[successors[i]] = 1;
+                work.push_back(successors[i]);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (BlockId b = 0; b < blockCount; ++b) {
+        if (reachable[b] || function.blocks[b].instructions.empty()) continue;
+        BlockId successors[2];
+        uint32_t count = function.successors(b, successors);
+        for (uint32_t i = 0; i < count; ++i) function.removeEdge(b, successors[i]);
+        for (ValueId value : function.blocks[b].instructions) function[value].op = IrOp::Nop;
+        function.blocks[b].instructions.clear();
+        changed = true;
+    }
+    // Deleted blocks may still be listed by each other.
+    for (BlockId b = 0; b < blockCount; ++b) {
+        if (!reachable[b]) function.blocks[b].predecessors.clear();
+    }
+    if (changed) removeTrivialPhis(function);
+    return changed;
+}
+
+bool propagateConstants(IrFunction& function, const IrModule& module) {
+    enum : uint8_t { kUnknown, kConstant, kVarying };
+    const size_t valueCount = function.values.size();
+    const size_t blockCount = function.blocks.size();
+    std::vector<uint8_t> state(valueCount, kUnknown);
+    std::vector<IrConstant> constant(valueCount);
+    std::vector<uint8_t> executed(blockCount, 0);
+    // Whether each edge executes, by block and predecessor index.
+    std::vector<uint32_t> firstEdge(blockCount + 1, 0);
+    for (BlockId b = 0; b < blockCount; ++b) {
+        firstEdge[b + 1] = firstEdge[b] + static_cast<uint32_t>(function.blocks[b].predecessors.size());
+    }
+    std::vector<uint8_t> edgeExecuted(firstEdge[blockCount], 0);
+    const UseLists uses(function);
+    std::vector<ValueId> valueWork; // Instructions to evaluate again
+    std::vector<BlockId> blockWork; // Blocks to evaluate for the first time
+
+    auto markEdge = [&](BlockId from, BlockId to) {
+        const std::vector<BlockId>& predecessors = function.blocks[to].predecessors;
+        bool added = false;
+        for (uint32_t k = 0; k < predecessors.size(); ++k) {
+            if (predecessors[k] == from && !edgeExecuted[firstEdge[to] + k]) {
+                edgeExecuted[firstEdge[to] + k] = 1;
+                added = true;
+            }
+        }
+        if (!added) return;
+        if (!executed[to]) {
+            executed[to] = 1;
+            blockWork.push_back(to);
+            return;
+        }
+        // Only the phis see the new edge.
+        for (ValueId value : function.blocks[to].instructions) {
+            if (function[value].op != IrOp::Phi) break;
+            valueWork.push_back(value);
+        }
+    };
+    auto lower = [&](ValueId value, uint8_t newState, IrConstant newConstant) {
+        if (newState <= state[value]) return;
+        state[value] = newState;
+        constant[value] = newConstant;
+        for (uint32_t u = uses.first[value]; u < uses.first[value + 1]; ++u) {
+            if (executed[function[uses.users[u]].block]) valueWork.push_back(uses.users[u]);
+        }
+    };
+    auto evaluate = [&](ValueId value) {
+        const IrInstruction& instruction = function[value];
+        const ValueId* operands = function.operandsOf(value);
+        const IrConstant none = { 0 };
+        switch (instruction.op) {
+        case IrOp::Nop:
+            return;
+        case IrOp::Const:
+            lower(value, kConstant, instruction.constant);
+            return;
+        case IrOp::Phi: {
+            // The meet of the operands on executed edges.
+            uint8_t result = kUnknown;
+            IrConstant value0 = none;
+            for (uint32_t k = 0; k < instruction.operandCount && result != kVarying; ++k) {
+                if (!edgeExecuted[firstEdge[instruction.block] + k]) continue;
+                ValueId operand = operands[k];
+                if (state[operand] == kUnknown) continue;
+                if (state[operand] == kVarying) result = kVarying;
+                else if (result == kUnknown) {
+                    result = kConstant;
+                    value0 = constant[operand];
+                }
+                else if (constantBits(instruction.type, value0) != constantBits(instruction.type, constant[operand])) {
+                    result = kVarying;
+                }
+            }
+            lower(value, result, value0);
+            return;
+        }
+        case IrOp::Jump:
+            markEdge(instruction.block, instruction.aux);
+            return;
+        case IrOp::Branch: {
+            ValueId condition = operands[0];
+            if (state[condition] == kUnknown) return;
+            if (state[condition] == kConstant) {
+                markEdge(instruction.block, constant[condition].i != 0 ? instruction.aux : instruction.aux2);
+                return;
+            }
+            markEdge(instruction.block, instruction.aux);
+            markEdge(instruction.block, instruction.aux2);
+            return;
+        }
+        default:
+            break;
+        }
+        if (instruction.type == IrType::Void) return;
+        if (!isOperator(instruction.op)) {
+            lower(value, kVarying, none); // Parameters, strings, loads, calls and input
+            return;
+        }
+        if (instruction.op == IrOp::Mul || instruction.op == IrOp::And) {
+            // x * 0 and x & 0 are 0 whatever x is.
+            for (uint32_t k = 0; k < 2; ++k) {
+                if (state[operands[k]] == kConstant && constant[operands[k]].i == 0) {
+                    lower(value, kConstant, none);
+                    return;
+                }
+            }
+        }
+        IrConstant arguments[2] = { none, none };
+        for (uint32_t k = 0; k < instruction.operandCount; ++k) {
+            if (state[operands[k]] == kUnknown) return;
+            if (state[operands[k]] == kVarying) {
+                lower(value, kVarying, none);
+                return;
+            }
+            arguments[k] = constant[operands[k]];
+        }
+        IrConstant result;
+        if (evaluateIr(instruction.op, arguments[0], arguments[1], result)) lower(value, kConstant, result);
+        else lower(value, kVarying, none);
+    };
+
+    executed[0] = 1;
+    blockWork.push_back(0);
+    while (!blockWork.empty() || !valueWork.empty()) {
+        if (!valueWork.empty()) {
+            ValueId value = valueWork.back();
+            valueWork.pop_back();
+            evaluate(value);
+            continue;
+        }
+        BlockId block = blockWork.back();
+        blockWork.pop_back();
+        for (ValueId value : function.blocks[block].instructions) evaluate(value);
+    }
+
+    // Rewrite: one entry block constant per distinct value replaces the
+    // instructions found constant.
+    bool changed = false;
+    std::vector<ValueId> replacement(valueCount, kNoValue);
+    std::unordered_map<uint64_t, ValueId> constants[2]; // Int, float
+    std::vector<ValueId> created;
+    for (BlockId b = 0; b < blockCount; ++b) {
+        if (!executed[b]) continue;
+        for (ValueId value : function.blocks[b].instructions) {
+            const IrOp op = function[value].op;
+            if (op == IrOp::Branch) {
+                ValueId condition = function.operand(value, 0);
+                if (state[condition] != kConstant) continue;
+                IrInstruction& branch = function[value];
+                const bool taken = constant[condition].i != 0;
+                const BlockId target = taken ? branch.aux : branch.aux2;
+                const BlockId other = taken ? branch.aux2 : branch.aux;
+                branch.op = IrOp::Jump;
+                branch.aux = target;
+                branch.aux2 = 0;
+                branch.operandCount = 0;
+                function.removeEdge(b, other);
+                changed = true;
+                continue;
+            }
+            if (state[value] != kConstant || op == IrOp::Const) continue;
+            const IrType type = function[value].type;
+            std::unordered_map<uint64_t, ValueId>& known = constants[type == IrType::Float];
+            auto found = known.find(constantBits(type, constant[value]));
+            if (found == known.end()) {
+                IrInstruction definition;
+                definition.op = IrOp::Const;
+                definition.type = type;
+                definition.block = 0;
+                definition.constant = constant[value];
+                found = known.emplace(constantBits(type, constant[value]), function.create(definition)).first;
+                created.push_back(found->second);
+            }
+            replacement[value] = found->second;
+            function[value].op = IrOp::Nop;
+            changed = true;
+        }
+    }
+    if (!changed) return false;
+    std::vector<ValueId>& entry = function.blocks[0].instructions;
+    entry.insert(entry.begin(), created.begin(), created.end());
+    function.replaceOperands(replacement);
+    function.compact();
+    if (!removeUnreachableBlocks(function, module)) removeTrivialPhis(function);
+    return true;
+}
+
+bool numberValues(IrFunction& function, const IrModule&) {
+    const DominatorTree dominators(function);
+    const size_t blockCount = function.blocks.size();
+    std::vector<std::vector<BlockId>> children(blockCount);
+    for (BlockId block : dominators.reversePostorder) {
+        if (block != 0) children[dominators.idom[block]].push_back(block);
+    }
+
+    std::unordered_map<ValueKey, ValueId, ValueKeyHash> available;
+    std::vector<ValueKey> scope; // Keys added by the blocks on the walk, for removal on the way back
+    struct Visit {
+        BlockId block;
+        size_t nextChild;
+        size_t scopeSize;
+    };
+    std::vector<Visit> walk;
+    bool changed = false;
+
+    auto visitBlock = [&](BlockId block) {
+        for (ValueId value : function.blocks[block].instructions) {
+            if (function[value].op == IrOp::Phi) continue; // Back edge operands are not numbered yet
+            // Operands are defined in dominating blocks, numbered already: look through their copies.
+            ValueId* operands = function.operandsOf(value);
+            for (uint32_t k = 0; k < function[value].operandCount; ++k) {
+                while (function[operands[k]].op == IrOp::Copy) operands[k] = function.operand(operands[k], 0);
+            }
+            IrOp op = function[value].op;
+            if (op != IrOp::Const && op != IrOp::String && !(isOperator(op) && op != IrOp::Copy)) continue;
+            if (op != IrOp::Const && simplify(function, value)) {
+                changed = true;
+                if (function[value].op == IrOp::Copy) continue;
+            }
+
+            const IrInstruction& instruction = function[value];
+            ValueKey key{ instruction.op, instruction.type, instruction.flags, instruction.aux, instruction.aux2,
+                instruction.op == IrOp::Const ? constantBits(instruction.type, instruction.constant) : 0,
+                instruction.operandCount > 0 ? function.operand(value, 0) : kNoValue,
+                instruction.operandCount > 1 ? function.operand(value, 1) : kNoValue };
+            if (isCommutative(key.op) && key.b < key.a) std::swap(key.a, key.b);
+            if (key.op == IrOp::Gt || key.op == IrOp::Ge || key.op == IrOp::FGt || key.op == IrOp::FGe) {
+                key.op = key.op == IrOp::Gt ? IrOp::Lt : key.op == IrOp::Ge ? IrOp::Le : key.op == IrOp::FGt ? IrOp::FLt : IrOp::FLe;
+                std::swap(key.a, key.b);
+            }
+            auto inserted = available.emplace(key, value);
+            if (inserted.second) {
+                scope.push_back(key);
+                continue;
+            }
+            makeCopy(function, value, inserted.first->second);
+            changed = true;
+        }
+    };
+
+    walk.push_back(Visit{ 0, 0, 0 });
+    visitBlock(0);
+    while (!walk.empty()) {
+        Visit& top = walk.back();
+        if (top.nextChild < children[top.block].size()) {
+            BlockId child = children[top.block][top.nextChild++];
+            walk.push_back(Visit{ child, 0, scope.size() });
+            visitBlock(child);
+            continue;
+        }
+        for (size_t i = scope.size(); i > top.scopeSize; --i) available.erase(scope[i - 1]);
+        scope.resize(top.scopeSize);
+        walk.pop_back();
+    }
+    return changed;
+}
+
+bool propagateCopies(IrFunction& function, const IrModule&) {
+    std::vector<ValueId> replacement(function.values.size(), kNoValue);
+    bool changed = false;
+    for (IrBlock& block : function.blocks) {
+        for (ValueId value : block.instructions) {
+            if (function[value].op != IrOp::Copy) continue;
+            replacement[value] = function.operand(value, 0);
+            function[value].op = IrOp::Nop;
+            changed = true;
+        }
+    }
+    if (changed) {
+        function.replaceOperands(replacement);
+        function.compact();
+    }
+    return removeTrivialPhis(function) || changed;
+}
+
+bool removeDeadCode(IrFunction& function, const IrModule&) {
+    auto removable = [&](ValueId value) {
+        const IrInstruction& instruction = function[value];
+        if (isPure(instruction.op)) return true;
+        if (instruction.op == IrOp::Div || instruction.op == IrOp::Mod) {
+            const IrInstruction& divisor = function[function.operand(value, 1)];
+            return divisor.op == IrOp::Const && divisor.type == IrType::Int && divisor.constant.i != 0;
+        }
+        if (instruction.op == IrOp::LoadElem) {
+            const IrInstruction& index = function[function.operand(value, 0)];
+            return index.op == IrOp::Const && static_cast<uint32_t>(index.constant.i) < instruction.aux2;
+        }
+        return false;
+    };
+
+    std::vector<uint8_t> live(function.values.size(), 0);
+    std::vector<ValueId> work;
+    for (const IrBlock& block : function.blocks) {
+        for (ValueId value : block.instructions) {
+            if (removable(value)) continue;
+            live[value] = 1;
+            work.push_back(value);
+        }
+    }
+    while (!work.empty()) {
+        ValueId value = work.back();
+        work.pop_back();
+        const ValueId* operands = function.operandsOf(value);
+        for (uint32_t k = 0; k < function[value].operandCount; ++k) {
+            if (live[operands[k]]) continue;
+            live[operands[k]] = 1;
+            work.push_back(operands[k]);
+        }
+    }
+
+    bool changed = false;
+    for (const IrBlock& block : function.blocks) {
+        for (ValueId value : block.instructions) {
+            if (live[value]) continue;
+            function[value].op = IrOp::Nop;
+            changed = true;
+        }
+    }
+    if (changed) function.compact();
+    return changed;
+}
+
+bool mergeBlocks(IrFunction& function, const IrModule&) {
+    std::vector<ValueId> replacement(function.values.size(), kNoValue);
+    bool changed = false;
+    for (BlockId b = 0; b < function.blocks.size(); ++b) {
+        // Absorb successors for as long as the block ends in a jump to a block only it reaches.
+        for (;;) {
+            ValueId last = function.terminator(b);
+            if (last == kNoValue || function[last].op != IrOp::Jump) break;
+            const BlockId successor = function[last].aux;
+            if (successor == b || successor == 0 || function.blocks[successor].predecessors.size() != 1) break;
+
+            std::vector<ValueId>& into = function.blocks[b].instructions;
+            function[last].op = IrOp::Nop;
+            into.pop_back();
+            for (ValueId value : function.blocks[successor].instructions) {
+                if (function[value].op == IrOp::Phi) {
+                    replacement[value] = function.operand(value, 0);
+                    function[value].op = IrOp::Nop;
+                    continue;
+                }
+                function[value].block = b;
+                into.push_back(value);
+            }
+            BlockId successors[2];
+            uint32_t count = function.successors(b, successors);
+            for (uint32_t i = 0; i < count; ++i) {
+                std::vector<BlockId>& predecessors = function.blocks[successors[i]].predecessors;
+                std::replace(predecessors.begin(), predecessors.end(), successor, b);
+            }
+            function.blocks[successor].instructions.clear();
+            function.blocks[successor].predecessors.clear();
+            changed = true;
+        }
+    }
+    if (changed) function.replaceOperands(replacement);
+    return changed;
+}
@@ -0,0 +1,85 @@
+// IrPasses.h
+#ifndef IRPASSES_H
+#define IRPASSES_H
+
+#include "Ir.h"
+
+// Transformations of one IrFunction. Each returns whether it changed
+// anything and leaves the function in valid SSA form (see verifyIr).
+using IrPassFunction = bool (*)(IrFunction& function, const IrModule& module);
+
+// Every pass the PassManager can run by name: X(name, function).
+#define IR_PASS_LIST(X)                                  \
+    X("unreachable-blocks", removeUnreachableBlocks)     \
+    X("sccp", propagateConstants)                        \
+    X("gvn", numberValues)                               \
+    X("copy-propagation", propagateCopies)               \
+    X("dce", removeDeadCode)                             \
+    X("simplify-cfg", mergeBlocks)                       \
+    X("licm", hoistLoopInvariants)                       \
+    X("strength-reduction", reduceStrength)              \
+    X("unroll", unrollLoops)
+
+// Deletes the blocks the entry cannot reach (code after a return, or the
+// join of an if whose branches both return), unlinks them from their
+// successors and replaces the phis this leaves trivial.
+bool removeUnreachableBlocks(IrFunction& function, const IrModule& module);
+
+// Sparse conditional constant propagation (Wegman and Zadeck): values start
+// unknown and only move down to constant and then to varying, and a block is
+// evaluated only once an edge into it is known to execute, so constants that
+// flow around loops are found along with the branches they decide. Constant
+// values are replaced by constants at the top of the entry block, decided
+// branches become jumps and the blocks no longer reached are deleted. Folding
+// uses evaluateIr, so it never folds away a division that fails at run time.
+bool propagateConstants(IrFunction& function, const IrModule& module);
+
+// Global value numbering over the dominator tree: an operator whose operands
+// and opcode match one already computed in a dominating block becomes a copy
+// of it (commutative operands are ordered; a > b is b < a). Int identities
+// such as x + 0, x * 1, x - x and x == x are simplified on the way. Loads,
+// calls and I/O are never numbered.
+bool numberValues(IrFunction& function, const IrModule& module);
+
+// Replaces every use of a copy by its operand, then the phis this leaves
+// trivial.
+bool propagateCopies(IrFunction& function, const IrModule& module);
+
+// Mark-and-sweep dead code elimination: everything with an effect is live,
+// and so is what a live instruction uses; the rest, dead phi cycles included,
+// is deleted. A division or an element load may fail at run time, so it is
+// only deleted when its divisor is a nonzero constant or its index a constant
+// in bounds.
+bool removeDeadCode(IrFunction& function, const IrModule& module);
+
+// Merges a block into its predecessor when that is its only predecessor and
+// ends with a jump to it, as folded branches leave behind.
+bool mergeBlocks(IrFunction& function, const IrModule& module);
+
+// The loop passes (IrLoops.cpp) work on the natural loops of IrLoops.h and
+// leave loops without a preheader alone.
+
+// Loop-invariant code motion: moves the operators of a loop whose operands
+// are all defined outside it to the end of its preheader, inner loops first,
+// so that a nest hoists them as far out as they go. Like dce, it only moves
+// a division with a nonzero constant divisor; a global is loaded there when
+// the loop neither stores to it nor calls a function.
+bool hoistLoopInvariants(IrFunction& function, const IrModule& module);
+
+// Strength reduction: replaces i * c and i << c, where i is an induction
+// variable stepping by s, by a new induction variable that starts at
+// initial * c and steps by s * c, so that an array index computed from the
+// loop counter is advanced with an add instead of a multiply.
+bool reduceStrength(IrFunction& function, const IrModule& module);
+
+// Fully unrolls a loop whose only exit is its header's branch on comparing
+// an induction variable that starts at a constant with a constant, when it
+// makes at most 16 trips and the copies add at most 256 instructions. The
+// copies are straight-line code for sccp, gvn and simplify-cfg to finish.
+bool unrollLoops(IrFunction& function, const IrModule& module);
+
+// Replaces phis whose operands are all one value (or the phi itself) by
+// that value, until none is left. Shared by the passes that delete edges.
+bool removeTrivialPhis(IrFunction& function);
+
+#endif // IRPASSES_H
@@ -0,0 +1,142 @@
+// Keywords.h
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include "Token.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Keyword recognition without allocation or tree walks.
+// The keyword list below is turned into a collision-free (perfect) hash table
+// at compile time: the hash only reads the length and three bytes of the
+// identifier in place, and a single memcmp confirms the hit.
+
+namespace keyword_detail {
+
+struct Entry {
+    std::string_view spelling;
+    TokenType type;
+};
+
+// Every keyword listed in TokenType.
+inline constexpr Entry kKeywords[] = {
+    {"if",        TokenType::KEYWORD_IF},
+    {"else",      TokenType::KEYWORD_ELSE},
+    {"while",     TokenType::KEYWORD_WHILE},
+    {"return",    TokenType::KEYWORD_RETURN},
+    {"for",       TokenType::KEYWORD_FOR},
+    {"int",       TokenType::KEYWORD_INT},
+    {"void",      TokenType::KEYWORD_VOID},
+    {"char",      TokenType::KEYWORD_CHAR},
+    {"struct",    TokenType::KEYWORD_STRUCT},
+    {"class",     TokenType::KEYWORD_CLASS},
+    {"true",      TokenType::KEYWORD_TRUE},
+    {"false",     TokenType::KEYWORD_FALSE},
+    {"nullptr",   TokenType::KEYWORD_NULLPTR},
+    {"const",     TokenType::KEYWORD_CONST},
+    {"static",    TokenType::KEYWORD_STATIC},
+    {"public",    TokenType::KEYWORD_PUBLIC},
+    {"private",   TokenType::KEYWORD_PRIVATE},
+    {"protected", TokenType::KEYWORD_PROTECTED},
+    {"auto",      TokenType::KEYWORD_AUTO},
+    {"break",     TokenType::KEYWORD_BREAK},
+    {"case",      TokenType::KEYWORD_CASE},
+    {"continue",  TokenType::KEYWORD_CONTINUE},
+    {"default",   TokenType::KEYWORD_DEFAULT},
+    {"do",        TokenType::KEYWORD_DO},
+    {"double",    TokenType::KEYWORD_DOUBLE},
+    {"enum",      TokenType::KEYWORD_ENUM},
+    {"extern",    TokenType::KEYWORD_EXTERN},
+    {"float",     TokenType::KEYWORD_FLOAT},
+    {"goto",      TokenType::KEYWORD_GOTO},
+    {"long",      TokenType::KEYWORD_LONG},
+    {"register",  TokenType::KEYWORD_REGISTER},
+    {"short",     TokenType::KEYWORD_SHORT},
+    {"signed",    TokenType::KEYWORD_SIGNED},
+    {"sizeof",    TokenType::KEYWORD_SIZEOF},
+    {"switch",    TokenType::KEYWORD_SWITCH},
+    {"typedef",   TokenType::KEYWORD_TYPEDEF},
+    {"union",     TokenType::KEYWORD_UNION},
+    {"unsigned",  TokenType::KEYWORD_UNSIGNED},
+    {"volatile",  TokenType::KEYWORD_VOLATILE},
+    {"string",    TokenType::KEYWORD_STRING},
+    {"scanf",     TokenType::KEYWORD_SCANF},
+    {"printf",    TokenType::KEYWORD_PRINTF},
+};
+
+inline constexpr size_t kKeywordCount = sizeof(kKeywords) / sizeof(kKeywords[0]);
+inline constexpr unsigned kTableBits = 7;
+inline constexpr size_t kTableSize = size_t(1) << kTableBits;
+inline constexpr uint8_t kEmptySlot = 0xFF;
+
+constexpr size_t minLength() {
+    size_t result = kKeywords[0].spelling.size();
+    for (const Entry& e : kKeywords) result = e.spelling.size() < result ? e.spelling.size() : result;
+    return result;
+}
+
+constexpr size_t maxLength() {
+    size_t result = 0;
+    for (const Entry& e : kKeywords) result = e.spelling.size() > result ? e.spelling.size() : result;
+    return result;
+}
+
+inline constexpr size_t kMinLength = minLength();
+inline constexpr size_t kMaxLength = maxLength();
+static_assert(kMinLength >= 2, "slot() reads the second byte of the identifier");
+
+// Multiplicative hash of (length, first, second, last byte). Callers guarantee len >= kMinLength.
+constexpr uint32_t slot(const char* s, size_t len, uint32_t seed) {
+    uint32_t key = static_cast<uint32_t>(len) << 24
+        ^ static_cast<uint32_t>(static_cast<unsigned char>(s[0])) << 16
+        ^ static_cast<uint32_t>(static_cast<unsigned char>(s[1])) << 8
+        ^ static_cast<uint32_t>(static_cast<unsigned char>(s[len - 1]));
+    return (key * seed) >> (32 - kTableBits);
+}
+
+// Searches for the first odd multiplier that maps every keyword to its own slot.
+constexpr uint32_t findSeed() {
+    for (uint32_t seed = 0x9E3779B1u; ; seed += 2) {
+        bool used[kTableSize] = {};
+        bool collision = false;
+        for (const Entry& e : kKeywords) {
+            uint32_t s = slot(e.spelling.data(), e.spelling.size(), seed);
+            if (used[s]) { collision = true; break; }
+            used[s] = true;
+        }
+        if (!collision) return seed;
+    }
+}
+
+inline constexpr uint32_t kSeed = findSeed();
+
+constexpr std::array<uint8_t, kTableSize> buildTable() {
+    std::array<uint8_t, kTableSize> table{};
+    for (size_t i = 0; i < kTableSize; ++i) table[i] = kEmptySlot;
+    for (size_t i = 0; i < kKeywordCount; ++i) {
+        const Entry& e = kKeywords[i];
+        table[slot(e.spelling.data(), e.spelling.size(), kSeed)] = static_cast<uint8_t>(i);
+    }
+    return table;
+}
+
+inline constexpr std::array<uint8_t, kTableSize> kTable = buildTable();
+
+} // namespace keyword_detail
+
+// Returns the keyword TokenType for `text`, or TokenType::IDENTIFIER if it is not a keyword.
+inline TokenType lookupKeyword(std::string_view text) {
+    using namespace keyword_detail;
+    if (text.size() < kMinLength || text.size() > kMaxLength) return TokenType::IDENTIFIER;
+    uint8_t index = kTable[slot(text.data(), text.size(), kSeed)];
+    if (index == kEmptySlot) return TokenType::IDENTIFIER;
+    const Entry& e = kKeywords[index];
+    if (e.spelling.size() != text.size() || std::memcmp(e.spelling.data(), text.data(), text.size()) != 0) {
+        return TokenType::IDENTIFIER;
+    }
+    return e.type;
+}
+
+#endif // KEYWORDS_H
@@ -0,0 +1,154 @@
+// LexTables.h
+#ifndef LEXTABLES_H
+#define LEXTABLES_H
+
+#include "Token.h"
+#include <cstdint>
+#include <string_view>
+
+// Compile-time tables for the table-driven lexer core (LexerMode::Table).
+// kCharClass replaces <cctype> (which is locale-dependent and undefined for
+// bytes >= 0x80), and kOperatorDfa is a trie-shaped DFA over every operator
+// and punctuator in TokenType, so "<<=" or "->" is one tight loop instead of
+// nested match() calls.
+
+namespace lex_tables {
+
+// What a byte can start (or continue) in the table-driven lexer.
+enum CharClass : uint8_t {
+    CC_INVALID = 0,   // Not valid outside literals and comments (includes all bytes >= 0x80)
+    CC_BLANK,         // ' ', '\t', '\r', '\n'
+    CC_IDENT_START,   // [A-Za-z_]
+    CC_DIGIT,         // [0-9]
+    CC_OPERATOR,      // Starts an operator or punctuator
+    CC_DOUBLE_QUOTE,  // "
+    CC_SINGLE_QUOTE,  // '
+};
+
+struct OperatorSpelling {
+    std::string_view text;
+    TokenType type;
+};
+
+// Every operator and punctuator. Each prefix of an entry is itself an entry,
+// so walking the DFA as far as it goes is exactly maximal munch.
+inline constexpr OperatorSpelling kOperators[] = {
+    {"(", TokenType::LPAREN},       {")", TokenType::RPAREN},
+    {"{", TokenType::LBRACE},       {"}", TokenType::RBRACE},
+    {"[", TokenType::LBRACKET},     {"]", TokenType::RBRACKET},
+    {",", TokenType::COMMA},        {".", TokenType::DOT},
+    {";", TokenType::SEMICOLON},    {"?", TokenType::QUESTION},
+    {":", TokenType::COLON},        {"::", TokenType::DOUBLE_COLON},
+    {"~", TokenType::TILDE},
+    {"!", TokenType::BANG},         {"!=", TokenType::BANG_EQUAL},
+    {"=", TokenType::EQUAL},        {"==", TokenType::EQUAL_EQUAL},
+    {"+", TokenType::PLUS},         {"++", TokenType::PLUS_PLUS},     {"+=", TokenType::PLUS_EQUAL},
+    {"-", TokenType::MINUS},        {"--", TokenType::MINUS_MINUS},   {"-=", TokenType::MINUS_EQUAL},
+    {"->", TokenType::ARROW},
+    {"*", TokenType::STAR},         {"*=", TokenType::STAR_EQUAL},
+    {"/", TokenType::SLASH},        {"/=", TokenType::SLASH_EQUAL},
+    {"%", TokenType::PERCENT},      {"%=", TokenType::PERCENT_EQUAL},
+    {"<", TokenType::LESS},         {"<=", TokenType::LESS_EQUAL},
+    {"<<", TokenType::LESS_LESS},   {"<<=", TokenType::LESS_LESS_EQUAL},
+    {">", TokenType::GREATER},      {">=", TokenType::GREATER_EQUAL},
+    {">>", TokenType::GREATER_GREATER}, {">>=", TokenType::GREATER_GREATER_EQUAL},
+    {"&", TokenType::AMPERSAND},    {"&&", TokenType::AMPERSAND_AMPERSAND}, {"&=", TokenType::AMPERSAND_EQUAL},
+    {"|", TokenType::PIPE},         {"||", TokenType::PIPE_PIPE},     {"|=", TokenType::PIPE_EQUAL},
+    {"^", TokenType::CARET},        {"^=", TokenType::CARET_EQUAL},
+};
+
+constexpr bool isAsciiLetter(unsigned c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+
+struct CharClassTable {
+    uint8_t cls[256];
+};
+
+constexpr CharClassTable buildCharClasses() {
+    CharClassTable t{};
+    for (unsigned c = 0; c < 256; ++c) {
+        uint8_t cls = CC_INVALID;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') cls = CC_BLANK;
+        else if (isAsciiLetter(c) || c == '_') cls = CC_IDENT_START;
+        else if (c >= '0' && c <= '9') cls = CC_DIGIT;
+        else if (c == '"') cls = CC_DOUBLE_QUOTE;
+        else if (c == '\'') cls = CC_SINGLE_QUOTE;
+        t.cls[c] = cls;
+    }
+    for (const OperatorSpelling& op : kOperators) {
+        t.cls[static_cast<unsigned char>(op.text[0])] = CC_OPERATOR;
+    }
+    return t;
+}
+
+inline constexpr CharClassTable kCharClass = buildCharClasses();
+
+// [A-Za-z0-9_]: bytes that continue an identifier.
+struct IdentTable {
+    bool continues[256];
+};
+
+constexpr IdentTable buildIdentContinue() {
+    IdentTable t{};
+    for (unsigned c = 0; c < 256; ++c) {
+        t.continues[c] = isAsciiLetter(c) || c == '_' || (c >= '0' && c <= '9');
+    }
+    return t;
+}
+
+inline constexpr IdentTable kIdentContinue = buildIdentContinue();
+
+inline bool isDigit(char c) { return static_cast<unsigned>(static_cast<unsigned char>(c) - '0') < 10u; }
+inline bool continuesIdentifier(char c) { return kIdentContinue.continues[static_cast<unsigned char>(c)]; }
+inline uint8_t charClass(char c) { return kCharClass.cls[static_cast<unsigned char>(c)]; }
+
+// --- Operator DFA ---
+// Input bytes are first mapped to a small operator-byte class so the
+// transition table is kMaxStates x kMaxOpBytes instead of kMaxStates x 256.
+
+inline constexpr int kMaxStates = 64;
+inline constexpr int kMaxOpBytes = 32;
+inline constexpr uint8_t kDeadState = 0;  // Also the start state: nothing transitions back into it
+inline constexpr uint8_t kStartState = 0;
+
+struct OperatorDfa {
+    uint8_t byteClass[256];                 // 0 = byte never appears in an operator
+    uint8_t next[kMaxStates][kMaxOpBytes];  // kDeadState = no transition
+    TokenType accept[kMaxStates];           // TokenType::UNKNOWN = not an accepting state
+    int stateCount;
+    int byteClassCount;
+};
+
+constexpr OperatorDfa buildOperatorDfa() {
+    OperatorDfa dfa{};
+    for (int s = 0; s < kMaxStates; ++s) dfa.accept[s] = TokenType::UNKNOWN;
+    dfa.stateCount = 1;
+    dfa.byteClassCount = 1;
+    for (const OperatorSpelling& op : kOperators) {
+        int state = kStartState;
+        for (char ch : op.text) {
+            unsigned char c = static_cast<unsigned char>(ch);
+            if (dfa.byteClass[c] == 0) dfa.byteClass[c] = static_cast<uint8_t>(dfa.byteClassCount++);
+            uint8_t& target = dfa.next[state][dfa.byteClass[c]];
+            if (target == kDeadState) target = static_cast<uint8_t>(dfa.stateCount++);
+            state = target;
+        }
+        dfa.accept[state] = op.type;
+    }
+    return dfa;
+}
+
+inline constexpr OperatorDfa kOperatorDfa = buildOperatorDfa();
+static_assert(kOperatorDfa.stateCount <= kMaxStates, "raise kMaxStates");
+static_assert(kOperatorDfa.byteClassCount <= kMaxOpBytes, "raise kMaxOpBytes");
+
+constexpr bool everyStateAccepts() {
+    for (int s = 1; s < kOperatorDfa.stateCount; ++s) {
+        if (kOperatorDfa.accept[s] == TokenType::UNKNOWN) return false;
+    }
+    return true;
+}
+static_assert(everyStateAccepts(), "operator prefixes must be operators for single-pass maximal munch");
+
+} // namespace lex_tables
+
+#endif // LEXTABLES_H
@@ -1,60 +1,111 @@
 ﻿// Lexer.cpp
 #include "Lexer.h"
+#include "Keywords.h" // Compile-time perfect hash of all keywords
+#include "TextScan.h" // Vectorized whitespace/comment skipping
+#include "LexTables.h" // Character classes and operator DFA for LexerMode::Table
 #include <cctype>   
+#include <charconv> // std::from_chars for literal values
 #include <iostream> 
 
-// --- Static Keyword Map Definition ---
-// This map stores all reserved keywords of our language and their corresponding TokenType.
-const std::map<std::string, TokenType> Lexer::keywords_ = {
-    {"if",     TokenType::KEYWORD_IF},
-    {"else",   TokenType::KEYWORD_ELSE},
-    {"return", TokenType::KEYWORD_RETURN},
-    {"while",  TokenType::KEYWORD_WHILE},
-    {"for",    TokenType::KEYWORD_FOR},     
-    {"int",    TokenType::KEYWORD_INT},
-    {"void",   TokenType::KEYWORD_VOID},
-    {"char",   TokenType::KEYWORD_CHAR},    
-    {"double", TokenType::KEYWORD_DOUBLE}, 
-    {"struct", TokenType::KEYWORD_STRUCT},  
-    {"class",  TokenType::KEYWORD_CLASS},   
-    {"true",   TokenType::KEYWORD_TRUE},    
-    {"false",  TokenType::KEYWORD_FALSE},   
-    {"nullptr",TokenType::KEYWORD_NULLPTR},
-    {"const",  TokenType::KEYWORD_CONST},
-    {"static", TokenType::KEYWORD_STATIC},
-    {"public", TokenType::KEYWORD_PUBLIC},
-    {"private",TokenType::KEYWORD_PRIVATE},
-    {"protected",TokenType::KEYWORD_PROTECTED}
-    
-};
-
 // --- Constructor ---
-Lexer::Lexer(const std::string& source):
-    source_code_(source),
+Lexer::Lexer(std::shared_ptr<const SourceBuffer> source, LexerMode mode):
+    source_(std::move(source)),
+    source_code_(source_->text()),
+    mode_(mode),
     current_pos_(0),
     start_pos_(0),
-    line_of_current_pos_(1), 
-    col_of_current_pos_(1), 
-    token_start_line_(1),
-    token_start_col_(1) {
+    interner_(&Interner::global()) {
+}
+
+// --- Main Public Methods ---
+
+size_t Lexer::lexUntil(size_t limit, TokenBuffer& out) {
+    while (true) {
+        Token token = getNextToken();
+        if (token.offset >= limit) {
+            seek(token.offset); // Not ours: leave it for whoever lexes from `limit` on
+            return token.offset;
+        }
+        out.push(token);
+        if (token.type == TokenType::END_OF_FILE) return source_code_.length();
+    }
+}
+
+TokenBuffer Lexer::getAllTokens() {
+    TokenBuffer tokens(source_);
+    tokens.reserve(TokenBuffer::estimateTokenCount(source_code_.length() - current_pos_));
+    while (true) {
+        Token token = getNextToken();
+        tokens.push(token);
+        if (token.type == TokenType::END_OF_FILE) break;
+    }
+    return tokens;
 }
 
-// --- Main Public Method ---
 Token Lexer::getNextToken() {
     skipWhitespaceAndComments();
 
     //mark start position
     start_pos_ = current_pos_;
-    token_start_line_ = line_of_current_pos_;
-    token_start_col_ = col_of_current_pos_;
 
 
     //check END
     if (isAtEnd()) {
-        return Token(TokenType::END_OF_FILE, "", token_start_line_, token_start_col_);
+        return Token(TokenType::END_OF_FILE, source_code_.substr(current_pos_, 0), static_cast<uint32_t>(start_pos_));
+    }
+
+    if (mode_ == LexerMode::Table) {
+        return scanTokenTable();
+    }
+    return scanTokenReference();
+}
+
+Token Lexer::scanTokenTable() {
+    // One table lookup picks the token kind; identifiers, numbers and operators
+    // are then scanned with plain index loops.
+    using namespace lex_tables;
+    const char* src = source_code_.data();
+    const size_t length = source_code_.length();
+    size_t pos = current_pos_ + 1;
+
+    switch (charClass(src[current_pos_])) {
+    case CC_IDENT_START:
+        while (pos < length && continuesIdentifier(src[pos])) ++pos;
+        advanceTo(pos);
+        return makeWordToken();
+
+    case CC_DIGIT:
+        advanceTo(pos);
+        return scanNumber();
+
+    case CC_OPERATOR: {
+        // Walk the DFA as far as it goes: maximal munch without backtracking.
+        uint8_t state = kOperatorDfa.next[kStartState][kOperatorDfa.byteClass[static_cast<unsigned char>(src[current_pos_])]];
+        while (pos < length) {
+            uint8_t next = kOperatorDfa.next[state][kOperatorDfa.byteClass[static_cast<unsigned char>(src[pos])]];
+            if (next == kDeadState) break;
+            state = next;
+            ++pos;
+        }
+        advanceTo(pos);
+        return makeToken(kOperatorDfa.accept[state]);
     }
 
+    case CC_DOUBLE_QUOTE:
+        advance();
+        return scanStringLiteral();
+
+    case CC_SINGLE_QUOTE:
+        advance();
+        return scanCharLiteral();
+
+    default:
+        advance();
+        return errorToken("Unexpected character.");
+    }
+}
 
+Token Lexer::scanTokenReference() {
     char c = advance();
 
    //Wenn das c ist Identifer 
@@ -145,21 +196,8 @@ bool Lexer::isAtEnd() const {
 }
 
 char Lexer::advance() {
-    
     if (current_pos_ >= source_code_.length()) return '\0';
-
-    char current_char = source_code_[current_pos_];
-    current_pos_++; 
-
-    //deal line and col 's num 
-    if (current_char == '\n') {
-        line_of_current_pos_++;
-        col_of_current_pos_ = 1; 
-    }
-    else {
-        col_of_current_pos_++;
-    }
-    return current_char;
+    return source_code_[current_pos_++];
 }
 
 char Lexer::peek() const {
@@ -167,6 +205,11 @@ char Lexer::peek() const {
     return source_code_[current_pos_];
 }
 
+char Lexer::peekAt(size_t distance) const {
+    if (current_pos_ + distance >= source_code_.length()) return '\0';
+    return source_code_[current_pos_ + distance];
+}
+
 char Lexer::peekNext() const {
     if (current_pos_ + 1 >= source_code_.length()) return '\0';
     return source_code_[current_pos_ + 1];
@@ -175,95 +218,54 @@ char Lexer::peekNext() const {
 bool Lexer::match(char expected) {
     if (isAtEnd()) return false;
     if (source_code_[current_pos_] != expected) return false;
-
-    
-    current_pos_++; 
-    if (expected == '\n') { 
-        line_of_current_pos_++;
-        col_of_current_pos_ = 1;
-    }
-    else {
-        col_of_current_pos_++;
-    }
+    current_pos_++;
     return true;
 }
 
+void Lexer::advanceTo(size_t new_pos) {
+    current_pos_ = new_pos;
+}
+
 void Lexer::skipWhitespaceAndComments() {
+    const char* begin = source_code_.data();
+    const char* end = begin + source_code_.length();
     while (true) {
+        // Jump over the whole run of ' ', '\r', '\t' and '\n' at once.
+        const char* p = textscan::skipBlanks(begin + current_pos_, end);
+        if (p != begin + current_pos_) {
+            advanceTo(static_cast<size_t>(p - begin));
+        }
         if (isAtEnd()) break;
-        char c = peek();
 
-        switch (c) {
-        case ' ':
-        case '\r': 
-        case '\t': 
-            advance();
-            break;
-        case '\n': 
-            advance();
-            break;
-        case '/':
-            if (peekNext() == '/') {
-                skipSingleLineComment();
-            }
-            else if (peekNext() == '*') {
-                skipMultiLineComment();
-            }
-            else {
-                return;//das ist division
-            }
-            break;
-        default:
-            return; 
+        if (peek() == '/' && peekNext() == '/') {
+            skipSingleLineComment();
+        }
+        else if (peek() == '/' && peekNext() == '*') {
+            skipMultiLineComment();
+        }
+        else {
+            return; // Start of a token (a lone '/' is division)
         }
     }
 }
 
 void Lexer::skipSingleLineComment() {
-    
-    advance(); 
-    advance(); 
-
-    while (peek() != '\n' && !isAtEnd()) {
-        advance();
-    }
-    
+    // Consume the leading '//' and everything up to (not including) the next newline.
+    // The newline itself is left for skipWhitespaceAndComments.
+    const char* begin = source_code_.data();
+    const char* end = begin + source_code_.length();
+    const char* newline = textscan::findByte(begin + current_pos_ + 2, end, '\n');
+    advanceTo(static_cast<size_t>(newline - begin));
 }
 
 void Lexer::skipMultiLineComment() {
-    // Assumes '/*' has been identified. Consume them.
-    advance(); // Consume /
-    advance(); // Consume *
-
-    int nesting = 1; // Handle nested block comments (though C/C++ don't support them natively, some lexers do)
-    // For standard C/C++, nesting can be ignored, first '*/' closes.
-    // Let's implement standard C/C++ behavior (no nesting).
-
-    while (!isAtEnd()) {
-        if (peek() == '*' && peekNext() == '/') {
-            advance(); // Consume *
-            advance(); // Consume /
-            return;    // End of comment
-        }
-        // For C/C++ standard, no need to check for nested /*
-        // else if (peek() == '/' && peekNext() == '*') {
-        //     advance(); advance(); nesting++;
-        // }
-        else {
-            advance(); // Consume any other character within the comment
-        }
-    }
-    // If we reach here, it's an unterminated multi-line comment (error)
-    // We can't make an error token here directly as this is a void function.
-    // The main getNextToken loop will eventually hit EOF.
-    // A more robust lexer might flag this error earlier.
-    // For now, it will just consume until EOF.
-    // To report error:
-    // if (isAtEnd()) {
-    //     // Need a way to signal error from here, or let getNextToken produce an error token based on current state
-    //     std::cerr << "Lexical Error [Line " << token_start_line_ // This might be tricky to get right from here
-    //               << "]: Unterminated multi-line comment." << std::endl;
-    // }
+    // Assumes '/*' has been identified. Standard C/C++ behavior: no nesting, the first '*/' closes.
+    const char* begin = source_code_.data();
+    const char* end = begin + source_code_.length();
+    const char* close = textscan::findCommentClose(begin + current_pos_ + 2, end);
+
+    // An unterminated comment simply runs to EOF; getNextToken then returns END_OF_FILE.
+    advanceTo(close == end ? source_code_.length() : static_cast<size_t>(close - begin) + 2);
 }
 
 
@@ -275,44 +277,101 @@ Token Lexer::scanIdentifier() {
         advance();
     }
 
-    std::string lexeme = source_code_.substr(start_pos_, current_pos_ - start_pos_);
-    auto it = keywords_.find(lexeme);
-    if (it != keywords_.end()) {
-        return makeToken(it->second); // It's a keyword
+    return makeWordToken();
+}
+
+Token Lexer::makeWordToken() {
+    // Classified in place: IDENTIFIER unless the bytes spell a keyword
+    Token token = makeToken(lookupKeyword(source_code_.substr(start_pos_, current_pos_ - start_pos_)));
+    if (token.type == TokenType::IDENTIFIER && interner_) {
+        token.symbol = interner_->intern(token.lexeme);
     }
-    return makeToken(TokenType::IDENTIFIER); // It's a user-defined identifier
+    return token;
 }
 
 Token Lexer::scanNumber() {
     // The first digit was already consumed by advance() in getNextToken().
     // `start_pos_` points to it. `current_pos_` is after it.
-    while (std::isdigit(peek())) {
+    using lex_tables::isDigit;
+    while (isDigit(peek())) {
         advance();
     }
 
-    // Look for a fractional part (for floating point numbers)
-    // For a simple integer-only lexer, the above is enough.
-    // If supporting floats:
-    /*
-    if (peek() == '.' && std::isdigit(peekNext())) {
+    // Fractional part and exponent make it a floating point literal: 1.5, 2e10, 3.0e-2
+    bool isReal = false;
+    if (peek() == '.' && isDigit(peekNext())) {
+        isReal = true;
         advance(); // Consume the '.'
-        while (std::isdigit(peek())) {
+        while (isDigit(peek())) {
             advance();
         }
-        // Could also look for an exponent part (e.g., e+10, E-5)
-        // if (std::tolower(peek()) == 'e') { ... }
-        return makeToken(TokenType::DOUBLE_LITERAL); // Or FLOAT_LITERAL
     }
-    */
-    return makeToken(TokenType::INTEGER_LITERAL);
+    if (peek() == 'e' || peek() == 'E') {
+        size_t digitAt = (peekNext() == '+' || peekNext() == '-') ? 2 : 1;
+        if (isDigit(peekAt(digitAt))) {
+            isReal = true;
+            advanceTo(current_pos_ + digitAt);
+            while (isDigit(peek())) {
+                advance();
+            }
+        }
+    }
+
+    // Decode the value once, here, with std::from_chars (locale-independent, no allocation).
+    const char* first = source_code_.data() + start_pos_;
+    const char* last = source_code_.data() + current_pos_;
+    if (!isReal) {
+        long long value = 0;
+        if (std::from_chars(first, last, value).ec != std::errc()) {
+            return errorToken("Integer literal out of range.");
+        }
+        Token token = makeToken(TokenType::INTEGER_LITERAL);
+        token.value = LiteralValue::ofInteger(value);
+        return token;
+    }
+
+    if (peek() == 'f' || peek() == 'F') {
+        advance(); // The suffix is part of the lexeme but not of the number
+        float value = 0;
+        if (std::from_chars(first, last, value).ec != std::errc()) {
+            return errorToken("Floating-point literal out of range.");
+        }
+        Token token = makeToken(TokenType::FLOAT_LITERAL);
+        token.value = LiteralValue::ofFloat(value);
+        return token;
+    }
+
+    double value = 0;
+    if (std::from_chars(first, last, value).ec != std::errc()) {
+        return errorToken("Floating-point literal out of range.");
+    }
+    Token token = makeToken(TokenType::DOUBLE_LITERAL);
+    token.value = LiteralValue::ofDouble(value);
+    return token;
+}
+
+char Lexer::decodeEscape(char escaped) {
+    switch (escaped) {
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case '0': return '\0';
+    case 'a': return '\a';
+    case 'b': return '\b';
+    case 'f': return '\f';
+    case 'v': return '\v';
+    default: return escaped; // \\ \' \" \? and unknown escapes stand for the character itself
+    }
 }
 
 Token Lexer::scanStringLiteral() {
     // The opening quote `"` was consumed by advance() in getNextToken().
     // `start_pos_` points to the opening quote.
     // `current_pos_` is at the first character *inside* the string.
+    bool hasEscapes = false;
     while (peek() != '"' && !isAtEnd()) {
         if (peek() == '\\') { // Handle escape sequences
+            hasEscapes = true;
             advance(); // Consume '\'
             if (!isAtEnd()) {
                 // Consume the character being escaped (e.g., n, t, ", \)
@@ -333,9 +392,19 @@ Token Lexer::scanStringLiteral() {
     // Found the closing quote.
     advance(); // Consume the closing quote.
 
-    // The lexeme includes the quotes.
-    // The actual string value (unescaped) could be stored in token.literal_value if needed.
-    return makeToken(TokenType::STRING_LITERAL);
+    // The lexeme includes the quotes; the value does not.
+    Token token = makeToken(TokenType::STRING_LITERAL);
+    std::string_view body = token.lexeme.substr(1, token.lexeme.size() - 2);
+    if (!hasEscapes) {
+        token.value = LiteralValue::ofString(body); // Just a view into the source
+        return token;
+    }
+    decode_scratch_.clear();
+    for (size_t i = 0; i < body.size(); ++i) {
+        decode_scratch_.push_back(body[i] == '\\' ? decodeEscape(body[++i]) : body[i]);
+    }
+    token.value = LiteralValue::ofString(string_pool_.store(decode_scratch_));
+    return token;
 }
 
 Token Lexer::scanCharLiteral() {
@@ -344,13 +413,14 @@ Token Lexer::scanCharLiteral() {
     // `current_pos_` is at the first character *inside* the char literal.
     if (isAtEnd()) return errorToken("Unterminated character literal.");
 
+    char value;
     if (peek() == '\\') { // Escape sequence
         advance(); // Consume '\'
         if (isAtEnd()) return errorToken("Unterminated escape sequence in char literal.");
-        advance(); // Consume escaped character
+        value = decodeEscape(advance()); // Consume escaped character
     }
     else { // Regular character
-        advance(); // Consume the character
+        value = advance(); // Consume the character
     }
 
     if (peek() != '\'') {
@@ -363,29 +433,31 @@ Token Lexer::scanCharLiteral() {
     }
 
     advance(); // Consume the closing quote.
-    return makeToken(TokenType::CHAR_LITERAL);
+    Token token = makeToken(TokenType::CHAR_LITERAL);
+    token.value = LiteralValue::ofChar(value);
+    return token;
 }
 
 
 // --- Token Creation Helpers ---
 Token Lexer::makeToken(TokenType type) const {
-    std::string lexeme = "";
+    std::string_view lexeme;
     if (start_pos_ < current_pos_ && current_pos_ <= source_code_.length()) { // Ensure valid substring
         lexeme = source_code_.substr(start_pos_, current_pos_ - start_pos_);
     }
-    return Token(type, lexeme, token_start_line_, token_start_col_);
+    return Token(type, lexeme, static_cast<uint32_t>(start_pos_));
 }
 
-Token Lexer::makeToken(TokenType type, const std::string& custom_lexeme) const {
+Token Lexer::makeToken(TokenType type, std::string_view custom_lexeme) const {
     // This version is less used now that the primary makeToken correctly extracts the lexeme.
     // It's useful if the lexeme is not a direct substring, e.g. for EOF or if we were unescaping strings here.
-    return Token(type, custom_lexeme, token_start_line_, token_start_col_);
+    return Token(type, custom_lexeme, static_cast<uint32_t>(start_pos_));
 }
 
 // --- Error Handling ---
 Token Lexer::errorToken(const std::string& message) const {
-    // For now, just prints to cerr. A real compiler would collect errors.
-    std::string problematic_lexeme = "";
+    // Reports into the error sink (see setErrorSink) or, without one, prints to cerr.
+    std::string_view problematic_lexeme;
     // Try to get the character(s) that caused the error for the lexeme
     if (start_pos_ < source_code_.length()) {
         // If current_pos_ advanced, use the range. Otherwise, just start_pos_ char.
@@ -399,12 +471,14 @@ Token Lexer::errorToken(const std::string& message) const {
     }
 
 
-    std::cerr << "Lexical Error [Line " << token_start_line_
-        << ", Col " << token_start_col_
-        << " near '" << problematic_lexeme << "'"
-        << "]: " << message << std::endl;
+    if (error_sink_) {
+        error_sink_->report(DiagnosticKind::Lexical, static_cast<uint32_t>(start_pos_), problematic_lexeme, message);
+    }
+    else {
+        Diagnostics::print(*source_, Diagnostic{ DiagnosticKind::Lexical, static_cast<uint32_t>(start_pos_), problematic_lexeme, message }, std::cerr);
+    }
 
-    return Token(TokenType::UNKNOWN, problematic_lexeme, token_start_line_, token_start_col_);
+    return Token(TokenType::UNKNOWN, problematic_lexeme, static_cast<uint32_t>(start_pos_));
 }
 
 // Just a Helper .
@@ -466,7 +540,8 @@ std::string tokenTypeToString(TokenType type) {
     case TokenType::STRING_LITERAL: return "STRING_LITERAL";
     case TokenType::INTEGER_LITERAL: return "INTEGER_LITERAL";
     case TokenType::CHAR_LITERAL: return "CHAR_LITERAL";
-        // case TokenType::DOUBLE_LITERAL: return "DOUBLE_LITERAL";
+    case TokenType::FLOAT_LITERAL: return "FLOAT_LITERAL";
+    case TokenType::DOUBLE_LITERAL: return "DOUBLE_LITERAL";
 
 
     case TokenType::KEYWORD_IF: return "KEYWORD_IF";
@@ -488,6 +563,29 @@ std::string tokenTypeToString(TokenType type) {
     case TokenType::KEYWORD_PUBLIC: return "KEYWORD_PUBLIC";
     case TokenType::KEYWORD_PRIVATE: return "KEYWORD_PRIVATE";
     case TokenType::KEYWORD_PROTECTED: return "KEYWORD_PROTECTED";
+    case TokenType::KEYWORD_AUTO: return "KEYWORD_AUTO";
+    case TokenType::KEYWORD_BREAK: return "KEYWORD_BREAK";
+    case TokenType::KEYWORD_CASE: return "KEYWORD_CASE";
+    case TokenType::KEYWORD_CONTINUE: return "KEYWORD_CONTINUE";
+    case TokenType::KEYWORD_DEFAULT: return "KEYWORD_DEFAULT";
+    case TokenType::KEYWORD_DO: return "KEYWORD_DO";
+    case TokenType::KEYWORD_ENUM: return "KEYWORD_ENUM";
+    case TokenType::KEYWORD_EXTERN: return "KEYWORD_EXTERN";
+    case TokenType::KEYWORD_FLOAT: return "KEYWORD_FLOAT";
+    case TokenType::KEYWORD_GOTO: return "KEYWORD_GOTO";
+    case TokenType::KEYWORD_LONG: return "KEYWORD_LONG";
+    case TokenType::KEYWORD_REGISTER: return "KEYWORD_REGISTER";
+    case TokenType::KEYWORD_SHORT: return "KEYWORD_SHORT";
+    case TokenType::KEYWORD_SIGNED: return "KEYWORD_SIGNED";
+    case TokenType::KEYWORD_SIZEOF: return "KEYWORD_SIZEOF";
+    case TokenType::KEYWORD_SWITCH: return "KEYWORD_SWITCH";
+    case TokenType::KEYWORD_TYPEDEF: return "KEYWORD_TYPEDEF";
+    case TokenType::KEYWORD_UNION: return "KEYWORD_UNION";
+    case TokenType::KEYWORD_UNSIGNED: return "KEYWORD_UNSIGNED";
+    case TokenType::KEYWORD_VOLATILE: return "KEYWORD_VOLATILE";
+    case TokenType::KEYWORD_STRING: return "KEYWORD_STRING";
+    case TokenType::KEYWORD_SCANF: return "KEYWORD_SCANF";
+    case TokenType::KEYWORD_PRINTF: return "KEYWORD_PRINTF";
 
 
     case TokenType::UNKNOWN: return "UNKNOWN";
@@ -3,29 +3,66 @@
 #define LEXER_H
 
 #include "Token.h"  // Assumes Token.h now has all the new TokenTypes
+#include "SourceBuffer.h"
+#include "TokenBuffer.h"
+#include "StringPool.h"
+#include "Diagnostics.h"
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
+#include <memory>
+
+// How getNextToken classifies the first byte of a token.
+enum class LexerMode {
+    Table,      // 256-entry character-class table plus compile-time operator DFA (LexTables.h)
+    Reference   // The original <cctype> + switch/match() implementation, kept to cross-check Table
+};
 
 class Lexer {
 public:
-    explicit Lexer(const std::string& source);
+    explicit Lexer(std::shared_ptr<const SourceBuffer> source, LexerMode mode = LexerMode::Table);
     Token getNextToken();
-    // std::vector<Token> getAllTokens(); // Optional
+
+    // Bulk mode: lexes the rest of the input in one pass, END_OF_FILE included.
+    TokenBuffer getAllTokens();
+
+    // Bytes past the end of a token that scanning it may examine (the exponent
+    // check of "1e+5" reads 'e', '+' and '5'). IncrementalLexer relies on it.
+    static const size_t kMaxLookahead = 3;
+
+    // Restartable scanning, used to lex one chunk of the input:
+    // seek() moves to a byte offset (which must be where a token may start),
+    // lexUntil() appends tokens until the next one would start at or after
+    // `limit` and returns that start (the source length after END_OF_FILE).
+    void seek(size_t pos) { current_pos_ = pos; start_pos_ = pos; }
+    size_t lexUntil(size_t limit, TokenBuffer& out);
+
+    // Lexical errors are printed to std::cerr right away unless the Lexer has an
+    // error sink, in which case they are recorded there (nullptr restores printing).
+    void setErrorSink(Diagnostics* sink) { error_sink_ = sink; }
+
+    // IDENTIFIER tokens get their Token::symbol from this interner (by default
+    // Interner::global()). With nullptr they are left at kNoSymbol, for lexers
+    // running off the main thread; TokenBuffer::internIdentifiers() fills them later.
+    void setInterner(Interner* interner) { interner_ = interner; }
+
+    // The buffer every returned Token::lexeme points into.
+    const std::shared_ptr<const SourceBuffer>& source() const { return source_; }
+    LexerMode mode() const { return mode_; }
 
 private:
     // --- Member Variables (State) ---
-    const std::string& source_code_;
+    std::shared_ptr<const SourceBuffer> source_; // Keeps the lexemes of returned tokens alive
+    std::string_view source_code_;
+    LexerMode mode_;
     size_t current_pos_;
     size_t start_pos_; // Marks beginning of current lexeme
-
-    int line_of_current_pos_;      // Line number of the character at current_pos_
-    int col_of_current_pos_;       // Column number of the character at current_pos_
-
-    int token_start_line_;         // Line where the current token started
-    int token_start_col_;          // Column where the current token started
-
-    static const std::map<std::string, TokenType> keywords_;
+    Diagnostics* error_sink_ = nullptr;
+    Interner* interner_;
+    StringPool string_pool_;        // Decoded bytes of string literals that contain escapes
+    std::string decode_scratch_;    // Reused while decoding escapes
+    // No line/column state: tokens carry byte offsets and SourceBuffer::locate()
+    // turns them into positions when a diagnostic is printed.
 
     // --- Private Helper Methods ---
 
@@ -34,7 +71,9 @@ private:
     char advance();
     char peek() const;
     char peekNext() const;
+    char peekAt(size_t distance) const;
     bool match(char expected);
+    void advanceTo(size_t new_pos); // Skips [current_pos_, new_pos) in one step
 
     // Skipping utility
     void skipWhitespaceAndComments();
@@ -42,16 +81,20 @@ private:
     void skipMultiLineComment(); // Now fully implemented
 
     // Token scanning methods for different types
+    Token scanTokenTable();      // LexerMode::Table dispatch
+    Token scanTokenReference();  // LexerMode::Reference dispatch
     Token scanIdentifier();
     Token scanNumber();
     Token scanStringLiteral();
     Token scanCharLiteral(); // Added declaration
+    static char decodeEscape(char escaped); // The value of '\\' + escaped
 
     // Token creation helper
     Token makeToken(TokenType type) const;
+    Token makeWordToken(); // Keyword or interned IDENTIFIER spelled by [start_pos_, current_pos_)
     // The following overload is less critical now that the main makeToken is robust,
     // but can be kept if specific custom lexemes are needed (e.g. for EOF, or future processed literals)
-    Token makeToken(TokenType type, const std::string& custom_lexeme) const;
+    Token makeToken(TokenType type, std::string_view custom_lexeme) const;
 
     // Error handling
     Token errorToken(const std::string& message) const;
@@ -0,0 +1,19 @@
+// LineIndex.cpp
+#include "LineIndex.h"
+#include "TextScan.h"
+#include <algorithm>
+
+LineIndex::LineIndex(std::string_view text) {
+    // Every line after the first starts one byte past a '\n', hence base 1.
+    lineStarts_.reserve(text.size() / 32 + 1);
+    lineStarts_.push_back(0);
+    textscan::collectNewlines(text.data(), text.data() + text.size(), 1, lineStarts_);
+}
+
+void LineIndex::locate(uint32_t offset, int& line, int& column) const {
+    // The line is the last line start that is <= offset.
+    auto it = std::upper_bound(lineStarts_.begin(), lineStarts_.end(), offset);
+    size_t lineNumber = static_cast<size_t>(it - lineStarts_.begin()); // 1-based
+    line = static_cast<int>(lineNumber);
+    column = static_cast<int>(offset - lineStarts_[lineNumber - 1]) + 1;
+}
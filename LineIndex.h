@@ -0,0 +1,24 @@
+// LineIndex.h
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// LineIndex: Start offset of every line of a source, built once with a
+// vectorized newline scan. Tokens only carry byte offsets; line and column
+// are computed from this index when a diagnostic or printout needs them.
+// Columns count bytes from the start of the line, starting at 1.
+class LineIndex {
+public:
+    explicit LineIndex(std::string_view text);
+
+    void locate(uint32_t offset, int& line, int& column) const;
+    size_t lineCount() const { return lineStarts_.size(); }
+
+private:
+    std::vector<uint32_t> lineStarts_; // lineStarts_[0] == 0
+};
+
+#endif // LINEINDEX_H
@@ -0,0 +1,91 @@
+// OutputBuffer.cpp
+#include "OutputBuffer.h"
+#include <charconv>
+
+namespace {
+// Longest text any of the number writers produce.
+const size_t kMaxNumberLength = 32;
+}
+
+OutputBuffer::OutputBuffer(std::FILE* file, size_t capacity)
+    : file_(file), data_(new char[capacity]), capacity_(capacity) {
+}
+
+void OutputBuffer::drain() {
+    if (size_ == 0) return;
+    std::fwrite(data_.get(), 1, size_, file_);
+    ++writeCount_;
+    size_ = 0;
+}
+
+void OutputBuffer::flush() {
+    drain();
+    std::fflush(file_);
+}
+
+void OutputBuffer::writeSlow(std::string_view text) {
+    drain();
+    if (text.size() >= capacity_) {
+        std::fwrite(text.data(), 1, text.size(), file_); // Would not fit anyway
+        ++writeCount_;
+        return;
+    }
+    std::memcpy(data_.get(), text.data(), text.size());
+    size_ = text.size();
+}
+
+void OutputBuffer::spaces(size_t count) {
+    while (count > capacity_ - size_) {
+        size_t part = capacity_ - size_;
+        std::memset(data_.get() + size_, ' ', part);
+        size_ += part;
+        count -= part;
+        drain();
+    }
+    std::memset(data_.get() + size_, ' ', count);
+    size_ += count;
+}
+
+void OutputBuffer::writeInt(long long value) {
+    if (capacity_ - size_ < kMaxNumberLength) drain();
+    char* at = data_.get() + size_;
+    size_ += std::to_chars(at, at + kMaxNumberLength, value).ptr - at;
+}
+
+void OutputBuffer::writeDouble(double value) {
+    if (capacity_ - size_ < kMaxNumberLength) drain();
+    char* at = data_.get() + size_;
+    size_ += std::to_chars(at, at + kMaxNumberLength, value, std::chars_format::general, 6).ptr - at;
+}
+
+void OutputBuffer::writeDoubleExact(double value) {
+    if (capacity_ - size_ < kMaxNumberLength) drain();
+    char* at = data_.get() + size_;
+    size_ += std::to_chars(at, at + kMaxNumberLength, value).ptr - at;
+}
+
+void OutputBuffer::writeJsonString(std::string_view text) {
+    static const char kHex[] = "0123456789abcdef";
+    put('"');
+    size_t runStart = 0; // Characters that need no escape are copied in runs
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        write(text.substr(runStart, i - runStart));
+        runStart = i + 1;
+        put('\\');
+        switch (c) {
+        case '"': put('"'); break;
+        case '\\': put('\\'); break;
+        case '\n': put('n'); break;
+        case '\t': put('t'); break;
+        case '\r': put('r'); break;
+        default:
+            write("u00");
+            put(kHex[c >> 4]);
+            put(kHex[c & 0xF]);
+        }
+    }
+    write(text.substr(runStart));
+    put('"');
+}
@@ -0,0 +1,65 @@
+// OutputBuffer.h
+#ifndef OUTPUTBUFFER_H
+#define OUTPUTBUFFER_H
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+// OutputBuffer: Collects output in one large buffer and hands it to the FILE
+// in a single fwrite when the buffer is full, on flush() and on destruction.
+// Unlike std::endl, '\n' never flushes, so printing a large tree costs a few
+// write syscalls instead of one per line. The buffer is reused after each
+// flush; keep one OutputBuffer per stream for the whole run.
+//
+// Anything written to the same FILE through other means (std::cout is synced
+// with stdout) must be flushed by hand first, or it may overtake this output.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(std::FILE* file, size_t capacity = 1 << 20);
+    ~OutputBuffer() { flush(); }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void put(char c) {
+        if (size_ == capacity_) drain();
+        data_[size_++] = c;
+    }
+    void write(std::string_view text) {
+        if (text.empty()) return; // A default string_view has no data() to copy from
+        if (text.size() > capacity_ - size_) {
+            writeSlow(text);
+            return;
+        }
+        std::memcpy(data_.get() + size_, text.data(), text.size());
+        size_ += text.size();
+    }
+    void spaces(size_t count); // Indentation
+    void writeInt(long long value);
+    void writeDouble(double value);         // Like std::ostream's default (%g, 6 digits)
+    void writeDoubleExact(double value);    // Shortest form that reads back the same value
+    void writeJsonString(std::string_view text); // Quoted, with JSON escapes
+
+    OutputBuffer& operator<<(std::string_view text) { write(text); return *this; }
+    OutputBuffer& operator<<(const char* text) { write(text); return *this; }
+    OutputBuffer& operator<<(char c) { put(c); return *this; }
+
+    // Writes the buffered bytes to the FILE and flushes it.
+    void flush();
+    size_t writeCount() const { return writeCount_; } // fwrite calls so far
+
+private:
+    std::FILE* file_;
+    std::unique_ptr<char[]> data_;
+    size_t capacity_;
+    size_t size_ = 0;
+    size_t writeCount_ = 0;
+
+    void drain(); // Hands the buffered bytes to the FILE without flushing it
+    void writeSlow(std::string_view text);
+};
+
+#endif // OUTPUTBUFFER_H
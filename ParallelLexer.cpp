@@ -0,0 +1,167 @@
+// ParallelLexer.cpp
+#include "ParallelLexer.h"
+#include "TextScan.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Below this many bytes per chunk, thread start-up costs more than it saves.
+const size_t kMinChunkBytes = 256 * 1024;
+const size_t kNoLimit = std::numeric_limits<size_t>::max();
+const size_t kNotFound = std::numeric_limits<size_t>::max();
+
+struct Chunk {
+    explicit Chunk(const std::shared_ptr<const SourceBuffer>& source) : tokens(source) {}
+
+    size_t start = 0;         // Speculative first token position
+    size_t limit = 0;         // Start of the next chunk (kNoLimit for the last one)
+    size_t continuation = 0;  // First token start >= limit, as seen from this chunk
+    TokenBuffer tokens;
+    Diagnostics errors;
+};
+
+// Index of the token starting exactly at `offset`, or kNotFound.
+size_t findTokenStart(const TokenBuffer& tokens, size_t offset) {
+    size_t lo = 0;
+    size_t hi = tokens.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (tokens.offset(mid) < offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < tokens.size() && tokens.offset(lo) == offset) ? lo : kNotFound;
+}
+
+} // namespace
+
+ParallelLexer::ParallelLexer(std::shared_ptr<const SourceBuffer> source, LexerMode mode)
+    : source_(std::move(source)), mode_(mode) {
+}
+
+TokenBuffer ParallelLexer::lexAll(unsigned threadCount) {
+    std::string_view text = source_->text();
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t chunkCount = std::min<size_t>(threadCount, std::max<size_t>(1, text.size() / kMinChunkBytes));
+    chunkCount_ = static_cast<unsigned>(chunkCount);
+    resyncCount_ = 0;
+
+    if (chunkCount <= 1) {
+        Lexer lexer(source_, mode_);
+        lexer.setErrorSink(error_sink_);
+        lexer.setInterner(interner_);
+        return lexer.getAllTokens();
+    }
+
+    // --- Pass 1: speculative start of every chunk ---
+    // A line start is almost always outside strings and comments; the stitching
+    // pass below corrects the cases where it is not.
+    std::vector<Chunk> chunks;
+    chunks.reserve(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        chunks.emplace_back(source_);
+        Chunk& chunk = chunks.back();
+        if (i == 0) {
+            chunk.start = 0;
+        }
+        else {
+            const char* cut = text.data() + text.size() * i / chunkCount;
+            const char* newline = textscan::findByte(cut, text.data() + text.size(), '\n');
+            chunk.start = std::max(chunks[i - 1].start, std::min(text.size(), static_cast<size_t>(newline - text.data()) + 1));
+            chunks[i - 1].limit = chunk.start;
+        }
+    }
+    chunks.back().limit = kNoLimit;
+
+    // --- Pass 2: lex all chunks concurrently ---
+    auto lexChunk = [this](Chunk& chunk) {
+        Lexer lexer(source_, mode_);
+        lexer.setErrorSink(&chunk.errors);
+        lexer.setInterner(nullptr);
+        lexer.seek(chunk.start);
+        size_t end = std::min(chunk.limit, source_->size());
+        chunk.tokens.reserve(TokenBuffer::estimateTokenCount(end - chunk.start));
+        chunk.continuation = lexer.lexUntil(chunk.limit, chunk.tokens);
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(chunkCount - 1);
+    for (size_t i = 1; i < chunkCount; ++i) {
+        workers.emplace_back(lexChunk, std::ref(chunks[i]));
+    }
+    lexChunk(chunks[0]);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // --- Pass 3: stitch, fixing up wrong guesses ---
+    size_t total = 0;
+    for (const Chunk& chunk : chunks) total += chunk.tokens.size();
+    TokenBuffer result(source_);
+    result.reserve(total + 16);
+    Diagnostics errors;
+
+    size_t pos = 0; // Start of the next token of the true stream
+    bool done = false;
+    for (Chunk& chunk : chunks) {
+        if (done) break;
+        if (pos >= chunk.limit) continue; // A fix-up already lexed past this chunk
+
+        size_t first = findTokenStart(chunk.tokens, pos);
+        if (first == kNotFound) {
+            // The speculative start was wrong: lex the true stream until it meets this chunk's.
+            ++resyncCount_;
+            Lexer lexer(source_, mode_);
+            lexer.setErrorSink(&errors);
+            lexer.setInterner(nullptr);
+            lexer.seek(pos);
+            size_t candidate = 0;
+            while (true) {
+                Token token = lexer.getNextToken();
+                if (token.offset >= chunk.limit || token.type == TokenType::END_OF_FILE) {
+                    if (token.offset < chunk.limit) {
+                        result.push(token);
+                        done = true;
+                    }
+                    else {
+                        // Belongs to the next chunk; so does any error it raised.
+                        errors.discardFrom(token.offset);
+                    }
+                    pos = token.offset;
+                    break;
+                }
+                while (candidate < chunk.tokens.size() && chunk.tokens.offset(candidate) < token.offset) ++candidate;
+                if (candidate < chunk.tokens.size() && chunk.tokens.offset(candidate) == token.offset) {
+                    errors.discardFrom(token.offset);
+                    first = candidate; // In sync again
+                    break;
+                }
+                result.push(token);
+            }
+            if (first == kNotFound) continue;
+        }
+
+        // From `first` on, the speculative stream is the true stream.
+        uint32_t from = chunk.tokens.offset(first);
+        result.append(chunk.tokens, first, chunk.tokens.size());
+        for (const Diagnostic& error : chunk.errors) {
+            if (error.offset >= from && error.offset < chunk.continuation) errors.add(error);
+        }
+        pos = chunk.continuation;
+        done = !chunk.tokens.empty() && chunk.tokens.type(chunk.tokens.size() - 1) == TokenType::END_OF_FILE;
+    }
+
+    if (interner_) result.internIdentifiers(*interner_);
+
+    if (error_sink_) {
+        for (const Diagnostic& error : errors) error_sink_->add(error);
+    }
+    else {
+        errors.printAll(*source_, std::cerr);
+    }
+    return result;
+}
@@ -0,0 +1,49 @@
+// ParallelLexer.h
+#ifndef PARALLELLEXER_H
+#define PARALLELLEXER_H
+
+#include "Lexer.h"
+#include "TokenBuffer.h"
+#include <memory>
+
+// Lexes one large source on several threads and produces exactly the token
+// stream (and lexical errors, in the same order) that a single Lexer would.
+//
+// The source is cut into one chunk per thread. Every chunk after the first
+// is lexed speculatively from the first line start after its cut, assuming
+// that nothing (string, comment) is open there. The chunks are then stitched
+// in order: the Lexer's only state is its byte position, so once the true
+// token stream of the previous chunk reaches a token start that the
+// speculative stream also produced, both streams are identical from there
+// on. When a guess was wrong (e.g. the cut fell inside a block comment), the
+// stitcher re-lexes sequentially from the true position until the streams
+// meet again.
+class ParallelLexer {
+public:
+    ParallelLexer(std::shared_ptr<const SourceBuffer> source, LexerMode mode = LexerMode::Table);
+
+    // threadCount == 0 uses std::thread::hardware_concurrency(). Small inputs
+    // are lexed on the calling thread.
+    TokenBuffer lexAll(unsigned threadCount = 0);
+
+    // Lexical errors go to `sink`, in source order, instead of std::cerr.
+    void setErrorSink(Diagnostics* sink) { error_sink_ = sink; }
+    // See Lexer::setInterner(). Chunks are lexed without one; identifiers are
+    // interned on the calling thread once the stream is stitched.
+    void setInterner(Interner* interner) { interner_ = interner; }
+
+    // Per-chunk statistics of the last lexAll(): how many chunks were used and
+    // how many of their speculative starts were wrong.
+    unsigned chunkCount() const { return chunkCount_; }
+    unsigned resyncCount() const { return resyncCount_; }
+
+private:
+    std::shared_ptr<const SourceBuffer> source_;
+    LexerMode mode_;
+    unsigned chunkCount_ = 0;
+    unsigned resyncCount_ = 0;
+    Diagnostics* error_sink_ = nullptr;
+    Interner* interner_ = &Interner::global();
+};
+
+#endif // PARALLELLEXER_H
@@ -0,0 +1,156 @@
+// ParallelParser.cpp
+#include "ParallelParser.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+// Below this many tokens per worker, thread start-up costs more than it saves.
+const size_t kMinTokensPerWorker = 64 * 1024;
+// Functions a worker claims at once; keeps the shared counter off the hot path
+// while still balancing functions of very different sizes.
+const size_t kFunctionBatch = 16;
+
+bool isBaseType(TokenType type) {
+    return type == TokenType::KEYWORD_INT || type == TokenType::KEYWORD_FLOAT
+        || type == TokenType::KEYWORD_CHAR || type == TokenType::KEYWORD_STRING;
+}
+
+} // namespace
+
+ParallelParser::ParallelParser(CompilationUnit& unit) : unit_(unit) {
+}
+
+bool ParallelParser::prescan() {
+    const TokenBuffer& tokens = unit_.tokens;
+    globalStarts_.clear();
+    functionStarts_.clear();
+    if (tokens.empty() || tokens.type(tokens.size() - 1) != TokenType::END_OF_FILE) return false;
+    endIndex_ = static_cast<TokenIndex>(tokens.size() - 1);
+
+    // The same decision as Parser::parseProgram: "void", or "type IDENTIFIER (",
+    // starts a function; any other "type" a global.
+    TokenIndex i = 0;
+    while (i < endIndex_) {
+        TokenType type = tokens.type(i);
+        bool isFunction = type == TokenType::KEYWORD_VOID
+            || (isBaseType(type) && i + 2 < endIndex_ && tokens.type(i + 2) == TokenType::LPAREN);
+        if (isFunction) {
+            functionStarts_.push_back(i);
+            // The header holds no braces or semicolons; the body ends at the '}'
+            // matching its first '{'.
+            while (i < endIndex_ && tokens.type(i) != TokenType::LBRACE) {
+                if (tokens.type(i) == TokenType::SEMICOLON || tokens.type(i) == TokenType::RBRACE) return false;
+                ++i;
+            }
+            size_t depth = 0;
+            for (; i < endIndex_; ++i) {
+                TokenType t = tokens.type(i);
+                if (t == TokenType::LBRACE) ++depth;
+                else if (t == TokenType::RBRACE && --depth == 0) break;
+            }
+            if (i == endIndex_) return false; // Unbalanced
+            ++i;
+        }
+        else if (isBaseType(type) && functionStarts_.empty()) {
+            globalStarts_.push_back(i);
+            // Ends at the first ';' outside an array initializer's braces.
+            size_t depth = 0;
+            for (; i < endIndex_; ++i) {
+                TokenType t = tokens.type(i);
+                if (t == TokenType::LBRACE) ++depth;
+                else if (t == TokenType::RBRACE && depth-- == 0) return false;
+                else if (t == TokenType::SEMICOLON && depth == 0) break;
+            }
+            if (i == endIndex_) return false;
+            ++i;
+        }
+        else {
+            return false; // A syntax error; let Parser report it
+        }
+    }
+    return true;
+}
+
+ProgramNode* ParallelParser::parseSequentially() {
+    fellBack_ = true;
+    unit_.workerArenas.clear();
+    return Parser(unit_.tokens, unit_.astArena, unit_.diagnostics).parseProgram();
+}
+
+ProgramNode* ParallelParser::parseProgram(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    fellBack_ = false;
+    workerCount_ = 1;
+    if (!prescan()) return parseSequentially();
+
+    size_t workerCount = std::min<size_t>(threadCount, std::max<size_t>(1, unit_.tokens.size() / kMinTokensPerWorker));
+    workerCount = std::min(workerCount, std::max<size_t>(1, functionStarts_.size() / kFunctionBatch));
+    if (workerCount <= 1) {
+        return Parser(unit_.tokens, unit_.astArena, unit_.diagnostics).parseProgram();
+    }
+    workerCount_ = static_cast<unsigned>(workerCount);
+
+    // Where each construct must end: at the start of the next one.
+    auto endOf = [](const std::vector<TokenIndex>& starts, size_t index, TokenIndex after) {
+        return index + 1 < starts.size() ? starts[index + 1] : after;
+    };
+
+    // --- Functions, on the workers ---
+    // Every worker owns an Arena and a Diagnostics, so parsing shares nothing
+    // but the read-only token buffer; a worker that sees an error stops them all.
+    size_t functionCount = functionStarts_.size();
+    std::vector<FunctionDefinitionNode*> functions(functionCount);
+    unit_.workerArenas.clear();
+    unit_.workerArenas.resize(workerCount);
+    std::atomic<size_t> nextBatch(0);
+    std::atomic<bool> failed(false);
+    auto parseFunctions = [&](size_t worker) {
+        Diagnostics diagnostics;
+        Parser parser(unit_.tokens, unit_.workerArenas[worker], diagnostics);
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t first = nextBatch.fetch_add(kFunctionBatch, std::memory_order_relaxed);
+            if (first >= functionCount) break;
+            size_t last = std::min(functionCount, first + kFunctionBatch);
+            for (size_t i = first; i < last; ++i) {
+                functions[i] = parser.parseFunctionAt(functionStarts_[i]);
+                if (parser.syntaxErrorCount() != 0 || parser.position() != endOf(functionStarts_, i, endIndex_)) {
+                    failed.store(true, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount - 1);
+    for (size_t i = 1; i < workerCount; ++i) {
+        workers.emplace_back(parseFunctions, i);
+    }
+    parseFunctions(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // --- Globals, on this thread ---
+    std::vector<StatementNode*> globals(globalStarts_.size());
+    if (!failed) {
+        TokenIndex firstFunction = functionStarts_.empty() ? endIndex_ : functionStarts_.front();
+        Diagnostics diagnostics;
+        Parser parser(unit_.tokens, unit_.astArena, diagnostics);
+        for (size_t i = 0; i < globals.size() && !failed; ++i) {
+            globals[i] = parser.parseGlobalAt(globalStarts_[i]);
+            failed = parser.syntaxErrorCount() != 0 || parser.position() != endOf(globalStarts_, i, firstFunction);
+        }
+    }
+    if (failed) return parseSequentially();
+
+    ProgramNode* program = unit_.astArena.make<ProgramNode>();
+    program->globals.items = unit_.astArena.copyArray(globals.data(), globals.size());
+    program->globals.count = static_cast<uint32_t>(globals.size());
+    program->functions.items = unit_.astArena.copyArray(functions.data(), functions.size());
+    program->functions.count = static_cast<uint32_t>(functions.size());
+    return program;
+}
@@ -0,0 +1,49 @@
+// ParallelParser.h
+#ifndef PARALLELPARSER_H
+#define PARALLELPARSER_H
+
+#include "CompilationUnit.h"
+#include "Parser.h"
+#include <vector>
+
+// Parses the function definitions of one lexed unit on several threads and
+// produces the same tree (and diagnostics) as Parser::parseProgram.
+//
+// A pre-scan over the token types finds the top-level constructs: globals end
+// at the first ';' outside braces, functions at the '}' matching their first
+// '{'. Globals are parsed on the calling thread into unit.astArena; functions
+// are handed out in batches to workers that each parse into their own Arena
+// (kept alive in unit.workerArenas). ProgramNode::functions lists them in
+// source order.
+//
+// Brace matching only trusts well-formed input. If the pre-scan finds anything
+// the grammar does not allow, or any construct reports a syntax error or stops
+// short of the next start, the results are dropped and the unit is parsed
+// again sequentially, so error recovery and its diagnostics stay exactly
+// those of Parser.
+class ParallelParser {
+public:
+    explicit ParallelParser(CompilationUnit& unit);
+
+    // threadCount == 0 uses std::thread::hardware_concurrency(). Small inputs
+    // are parsed on the calling thread.
+    ProgramNode* parseProgram(unsigned threadCount = 0);
+
+    // Statistics of the last parseProgram().
+    size_t functionCount() const { return functionStarts_.size(); }
+    unsigned workerCount() const { return workerCount_; }
+    bool fellBack() const { return fellBack_; } // Parsed sequentially after a pre-scan or syntax error
+
+private:
+    CompilationUnit& unit_;
+    std::vector<TokenIndex> globalStarts_;
+    std::vector<TokenIndex> functionStarts_;
+    TokenIndex endIndex_ = 0; // The END_OF_FILE token
+    unsigned workerCount_ = 0;
+    bool fellBack_ = false;
+
+    bool prescan(); // Fills the start lists; false if brace matching cannot be trusted
+    ProgramNode* parseSequentially();
+};
+
+#endif // PARALLELPARSER_H
@@ -1,119 +1,726 @@
 // Parser.cpp///////////////////////////////////
 #include "Parser.h"
-#include <iostream> // For error messages (temporary)
+#include <array>
 
-Parser::Parser(Lexer& lexer) : lexer_(lexer) {
-    // Initialize currentToken_ by consuming the first token from the lexer
-    consumeToken();
+Parser::Parser(Lexer& lexer, TokenBuffer& tokens, Arena& arena, Diagnostics& diagnostics)
+    : lexer_(&lexer), streamTokens_(&tokens), tokens_(&tokens), currentIndex_(0),
+    currentType_(TokenType::UNKNOWN), arena_(arena), diagnostics_(diagnostics) {
+    // Pull the first token from the lexer
+    Token first = lexer_->getNextToken();
+    streamTokens_->push(first);
+    currentIndex_ = static_cast<TokenIndex>(streamTokens_->size() - 1);
+    currentType_ = first.type;
+}
+
+Parser::Parser(const TokenBuffer& tokens, Arena& arena, Diagnostics& diagnostics)
+    : lexer_(nullptr), streamTokens_(nullptr), tokens_(&tokens), currentIndex_(0),
+    currentType_(tokens.type(0)), arena_(arena), diagnostics_(diagnostics) {
 }
 
 void Parser::consumeToken() {
-    currentToken_ = lexer_.getNextToken();
+    if (currentType_ == TokenType::END_OF_FILE) return; // Stay on END_OF_FILE
+    if (streamTokens_ && currentIndex_ + 1 == streamTokens_->size()) {
+        streamTokens_->push(lexer_->getNextToken()); // Not peeked at yet
+    }
+    ++currentIndex_;
+    currentType_ = tokens_->type(currentIndex_);
 }
 
-Token Parser::eat(TokenType expectedType, const std::string& errorMessage) {
-    if (currentToken_.type == expectedType) {
-        Token consumedToken = currentToken_;
+void Parser::seek(TokenIndex index) {
+    currentIndex_ = index;
+    currentType_ = tokens_->type(index);
+}
+
+TokenType Parser::peek(size_t distance) {
+    // Bulk mode already has every token; streaming mode lexes ahead into the same
+    // store, so a peeked token is pulled from the lexer only once.
+    size_t index = currentIndex_ + distance;
+    if (streamTokens_) {
+        while (streamTokens_->size() <= index) {
+            if (streamTokens_->type(streamTokens_->size() - 1) == TokenType::END_OF_FILE) return TokenType::END_OF_FILE;
+            streamTokens_->push(lexer_->getNextToken());
+        }
+    }
+    return index < tokens_->size() ? tokens_->type(index) : TokenType::END_OF_FILE;
+}
+
+template <typename T>
+NodeList<T> Parser::finishList(size_t mark) {
+    // Lists are collected on one shared stack, so nested lists need no vector of their own;
+    // only the final, exactly sized pointer array is copied into the Arena.
+    NodeList<T> list;
+    list.count = static_cast<uint32_t>(scratch_.size() - mark);
+    list.items = reinterpret_cast<T**>(arena_.copyArray(scratch_.data() + mark, list.count));
+    scratch_.resize(mark);
+    return list;
+}
+
+TokenIndex Parser::eat(TokenType expectedType, const char* errorMessage) {
+    if (currentType_ == expectedType) {
+        TokenIndex consumedToken = currentIndex_;
         consumeToken(); // Move to the next token
         return consumedToken;
     }
-    else {
-        // Throw a more informative error using the custom ParseError
-        throw ParseError(errorMessage + ". Expected " + tokenTypeToString(expectedType) +
-            ", but got " + tokenTypeToString(currentToken_.type) +
-            " ('" + currentToken_.lexeme + "')",
-            currentToken_.line, currentToken_.column);
+    if (!panic_) { // Only build the message if it will be reported
+        error(std::string(errorMessage) + ". Expected " + tokenTypeToString(expectedType) +
+            ", but got " + tokenTypeToString(currentType_) +
+            " ('" + std::string(tokens_->lexeme(currentIndex_)) + "')");
     }
+    return currentIndex_;
+}
+
+bool Parser::accept(TokenType type) {
+    if (currentType_ != type) return false;
+    consumeToken();
+    return true;
 }
 
 void Parser::error(const std::string& message) {
-    // More sophisticated error handling might involve collecting multiple errors
-    // or attempting recovery. For now, we throw.
-    throw ParseError(message, currentToken_.line, currentToken_.column);
+    // In panic mode the error is a consequence of the one already reported.
+    if (panic_) return;
+    panic_ = true;
+    // An UNKNOWN token was already reported by the Lexer; don't report it twice.
+    if (currentType_ == TokenType::UNKNOWN) {
+        ++errorCount_;
+        return;
+    }
+    reportAt(currentIndex_, message);
+}
+
+void Parser::reportAt(TokenIndex token, const std::string& message) {
+    ++errorCount_;
+    diagnostics_.report(DiagnosticKind::Syntax, tokens_->offset(token), tokens_->lexeme(token), message);
+}
+
+bool Parser::atBoundary() const {
+    if (currentIndex_ == 0) return true;
+    TokenType previous = tokens_->type(currentIndex_ - 1);
+    return previous == TokenType::SEMICOLON || previous == TokenType::RBRACE;
 }
 
-// program ::= function_definition* EOF
-std::unique_ptr<ProgramNode> Parser::parseProgram() {
-    auto programNode = std::make_unique<ProgramNode>();
-    // For V0.1, we expect exactly one function definition.
-    // Later, this will be a loop: while (currentToken_.type != TokenType::END_OF_FILE && /* other top-level constructs */)
-    if (currentToken_.type == TokenType::KEYWORD_INT) { // Assuming 'int' is the start of a function def for now
-        programNode->functions.push_back(parseFunctionDefinition());
+void Parser::synchronize(TokenIndex start) {
+    panic_ = false;
+    if (currentIndex_ == start) {
+        consumeToken(); // Nothing of the statement was consumed: skip the offending token
     }
-    else if (currentToken_.type != TokenType::END_OF_FILE) {
-        error("Expected function definition or EOF.");
+    else if (atBoundary()) {
+        return; // The statement still reached its ';' (or closed its block)
     }
+    for (;;) {
+        switch (currentType_) {
+        case TokenType::SEMICOLON:
+            consumeToken();
+            return;
+        case TokenType::RBRACE: // Ends the enclosing block
+        case TokenType::END_OF_FILE:
+        case TokenType::KEYWORD_IF:
+        case TokenType::KEYWORD_WHILE:
+        case TokenType::KEYWORD_FOR:
+        case TokenType::KEYWORD_RETURN:
+        case TokenType::KEYWORD_SCANF:
+        case TokenType::KEYWORD_PRINTF:
+        case TokenType::KEYWORD_INT:
+        case TokenType::KEYWORD_FLOAT:
+        case TokenType::KEYWORD_CHAR:
+        case TokenType::KEYWORD_STRING:
+            return;
+        default:
+            consumeToken();
+        }
+    }
+}
+
+void Parser::synchronizeTopLevel(TokenIndex start) {
+    panic_ = false;
+    if (currentIndex_ == start) consumeToken();
+    // Skip to the next "void" or type keyword outside any braces opened here.
+    int depth = 0;
+    while (currentType_ != TokenType::END_OF_FILE) {
+        if (depth == 0 && (currentType_ == TokenType::KEYWORD_VOID || isBaseType(currentType_))) return;
+        if (currentType_ == TokenType::LBRACE) ++depth;
+        else if (currentType_ == TokenType::RBRACE && depth > 0) --depth;
+        consumeToken();
+    }
+}
+
+// program ::= { global_decl } { function_def } EOF
+ProgramNode* Parser::parseProgram() {
+    ProgramNode* programNode = arena_.make<ProgramNode>();
 
+    // "type IDENTIFIER (" starts a function; any other "type IDENTIFIER" a global.
+    // Globals are collected until the first function, then the functions.
+    size_t mark = scratch_.size();
+    bool inFunctions = false;
+    while (currentType_ != TokenType::END_OF_FILE) {
+        TokenIndex start = currentIndex_;
+        if (currentType_ == TokenType::KEYWORD_VOID
+            || (isBaseType(currentType_) && peek(2) == TokenType::LPAREN)) {
+            if (!inFunctions) {
+                programNode->globals = finishList<StatementNode>(mark);
+                mark = scratch_.size();
+                inFunctions = true;
+            }
+            scratch_.push_back(parseFunctionDefinition());
+        }
+        else if (isBaseType(currentType_)) {
+            StatementNode* declaration = parseDeclaration();
+            if (!inFunctions) {
+                scratch_.push_back(declaration);
+            }
+            else if (!panic_) {
+                reportAt(start, "Global declarations must come before the first function definition");
+            }
+        }
+        else {
+            error("Expected function definition or EOF.");
+        }
+        if (panic_) synchronizeTopLevel(start);
+    }
 
-    eat(TokenType::END_OF_FILE, "Expected EOF at the end of the program");
+    if (inFunctions) {
+        programNode->functions = finishList<FunctionDefinitionNode>(mark);
+    }
+    else {
+        programNode->globals = finishList<StatementNode>(mark);
+    }
     return programNode;
 }
 
-// function_definition ::= type IDENTIFIER "(" ")" "{" statement* "}"
-std::unique_ptr<FunctionDefinitionNode> Parser::parseFunctionDefinition() {
-    Token typeToken = parseType(); // Expects "int" for now
-    Token idToken = eat(TokenType::IDENTIFIER, "Expected function name");
+StatementNode* Parser::parseGlobalAt(TokenIndex start) {
+    seek(start);
+    return parseDeclaration();
+}
+
+FunctionDefinitionNode* Parser::parseFunctionAt(TokenIndex start) {
+    seek(start);
+    return parseFunctionDefinition();
+}
+
+bool Parser::isBaseType(TokenType type) {
+    return type == TokenType::KEYWORD_INT || type == TokenType::KEYWORD_FLOAT
+        || type == TokenType::KEYWORD_CHAR || type == TokenType::KEYWORD_STRING;
+}
+
+// base_type ::= "int" | "float" | "char" | "string"
+TokenIndex Parser::parseType() {
+    if (!isBaseType(currentType_)) {
+        error("Expected a type ('int', 'float', 'char' or 'string')");
+        return currentIndex_;
+    }
+    TokenIndex typeToken = currentIndex_;
+    consumeToken();
+    return typeToken;
+}
+
+// global_decl ::= base_type IDENTIFIER [ "=" expression ] ";"
+//               | base_type IDENTIFIER "[" [ INTEGER_LITERAL ] "]" [ "=" "{" literal { [","] literal } "}" ] ";"
+StatementNode* Parser::parseDeclaration() {
+    TokenIndex typeToken = parseType();
+    TokenIndex nameToken = eat(TokenType::IDENTIFIER, "Expected a variable name");
+
+    if (accept(TokenType::LBRACKET)) {
+        TokenIndex sizeToken = kNoToken;
+        if (currentType_ == TokenType::INTEGER_LITERAL) {
+            sizeToken = eat(TokenType::INTEGER_LITERAL);
+        }
+        eat(TokenType::RBRACKET, "Expected ']' in array declaration");
+
+        size_t mark = scratch_.size();
+        if (accept(TokenType::EQUAL)) {
+            eat(TokenType::LBRACE, "Expected '{' before array initializer");
+            do {
+                if (currentType_ != TokenType::INTEGER_LITERAL && currentType_ != TokenType::STRING_LITERAL
+                    && currentType_ != TokenType::FLOAT_LITERAL && currentType_ != TokenType::DOUBLE_LITERAL
+                    && currentType_ != TokenType::CHAR_LITERAL) {
+                    error("Expected a literal in array initializer");
+                }
+                scratch_.push_back(parsePrimaryExpression());
+                accept(TokenType::COMMA); // The grammar lists elements without separators; allow both
+            } while (currentType_ != TokenType::RBRACE && currentType_ != TokenType::END_OF_FILE && !panic_);
+            eat(TokenType::RBRACE, "Expected '}' after array initializer");
+        }
+        eat(TokenType::SEMICOLON, "Expected ';' after array declaration");
+        return arena_.make<ArrayDeclarationNode>(typeToken, nameToken, sizeToken, finishList<ExpressionNode>(mark));
+    }
+
+    ExpressionNode* initializer = nullptr;
+    if (accept(TokenType::EQUAL)) {
+        initializer = parseExpression();
+    }
+    eat(TokenType::SEMICOLON, "Expected ';' after declaration");
+    return arena_.make<VariableDeclarationNode>(typeToken, nameToken, initializer);
+}
+
+// function_def ::= ( "void" | base_type ) IDENTIFIER "(" [ param { "," param } ] ")" "{" { statement } "}"
+FunctionDefinitionNode* Parser::parseFunctionDefinition() {
+    TokenIndex typeToken = currentType_ == TokenType::KEYWORD_VOID ? eat(TokenType::KEYWORD_VOID) : parseType();
+    TokenIndex idToken = eat(TokenType::IDENTIFIER, "Expected function name");
     eat(TokenType::LPAREN, "Expected '(' after function name");
-    eat(TokenType::RPAREN, "Expected ')' after function parameters"); // Parameters later
-    eat(TokenType::LBRACE, "Expected '{' before function body");
 
-    std::vector<std::unique_ptr<StatementNode>> bodyStatements;
-    while (currentToken_.type != TokenType::RBRACE && currentToken_.type != TokenType::END_OF_FILE) {
-        bodyStatements.push_back(parseStatement());
+    size_t mark = scratch_.size();
+    if (currentType_ != TokenType::RPAREN) {
+        do {
+            scratch_.push_back(parseParameter());
+        } while (accept(TokenType::COMMA));
+    }
+    NodeList<ParameterNode> parameters = finishList<ParameterNode>(mark);
+    eat(TokenType::RPAREN, "Expected ')' after function parameters");
+    if (accept(TokenType::LBRACE)) {
+        panic_ = false; // A broken header does not spill into the body
+    }
+    else {
+        eat(TokenType::LBRACE, "Expected '{' before function body");
+    }
+
+    mark = scratch_.size();
+    while (currentType_ != TokenType::RBRACE && currentType_ != TokenType::END_OF_FILE) {
+        parseStatementInList();
     }
 
     eat(TokenType::RBRACE, "Expected '}' after function body");
 
-    return std::make_unique<FunctionDefinitionNode>(typeToken, idToken, std::move(bodyStatements));
+    return arena_.make<FunctionDefinitionNode>(typeToken, idToken, parameters, finishList<StatementNode>(mark));
 }
 
-// type ::= "int"
-Token Parser::parseType() {
-    // For V0.1, we only support "int"
-    // Later, this can be expanded: KEYWORD_VOID, KEYWORD_CHAR, IDENTIFIER (for custom types)
-    return eat(TokenType::KEYWORD_INT, "Expected 'int' as return type");
+// param ::= base_type IDENTIFIER
+ParameterNode* Parser::parseParameter() {
+    TokenIndex typeToken = parseType();
+    TokenIndex nameToken = eat(TokenType::IDENTIFIER, "Expected parameter name");
+    return arena_.make<ParameterNode>(typeToken, nameToken);
 }
 
-// statement ::= return_statement
-std::unique_ptr<StatementNode> Parser::parseStatement() {
+// statement ::= global_decl | io_statement ";" | simple_statement ";"
+//             | if_statement | while_statement | for_statement | return_statement
+StatementNode* Parser::parseStatement() {
     // Based on the current token, decide which kind of statement it is.
-    // For V0.1, only return statements.
-    if (currentToken_.type == TokenType::KEYWORD_RETURN) {
+    StatementNode* statement = nullptr;
+    switch (currentType_) {
+    case TokenType::KEYWORD_INT:
+    case TokenType::KEYWORD_FLOAT:
+    case TokenType::KEYWORD_CHAR:
+    case TokenType::KEYWORD_STRING:
+        return parseDeclaration();
+    case TokenType::KEYWORD_RETURN:
         return parseReturnStatement();
+    case TokenType::KEYWORD_SCANF:
+        statement = parseScanfStatement();
+        break;
+    case TokenType::KEYWORD_PRINTF:
+        statement = parsePrintfStatement();
+        break;
+    case TokenType::IDENTIFIER:
+    case TokenType::PLUS_PLUS:
+    case TokenType::MINUS_MINUS:
+        statement = parseSimpleStatement();
+        break;
+    default:
+        error("Expected a statement");
+        return nullptr;
+    }
+    eat(TokenType::SEMICOLON, "Expected ';' after statement");
+    return statement;
+}
+
+// block ::= "{" { statement } "}" | statement
+void Parser::parseStatementInList() {
+    const size_t base = pending_.size(); // Compound statements of enclosing lists stay below
+    for (;;) {
+        // Begin a statement: a simple one is parsed whole, a compound one opens its body.
+        const TokenIndex start = currentIndex_;
+        if (currentType_ == TokenType::KEYWORD_IF || currentType_ == TokenType::KEYWORD_WHILE
+            || currentType_ == TokenType::KEYWORD_FOR) {
+            pending_.push_back(parseStatementHeader());
+            pending_.back().start = start;
+            openBody(pending_.back());
+            if (!pending_.back().braced) continue; // Its one statement is next
+        }
+        else {
+            StatementNode* statement = parseStatement();
+            if (statement) scratch_.push_back(statement);
+            if (panic_) synchronize(start);
+        }
+
+        // Close the bodies this ends, innermost first, until one still has statements to come.
+        for (;;) {
+            if (pending_.size() == base) return;
+            PendingStatement& open = pending_.back();
+            if (open.braced) {
+                if (currentType_ != TokenType::RBRACE && currentType_ != TokenType::END_OF_FILE) break;
+                eat(TokenType::RBRACE, "Expected '}' after block");
+            }
+            NodeList<StatementNode> body = finishList<StatementNode>(open.mark);
+            if (open.keyword == TokenType::KEYWORD_IF && open.elseToken == kNoToken
+                && currentType_ == TokenType::KEYWORD_ELSE) {
+                open.thenBody = body;
+                open.elseToken = eat(TokenType::KEYWORD_ELSE);
+                openBody(open);
+                if (!open.braced) break; // Its one statement is next
+                continue;
+            }
+
+            StatementNode* statement;
+            if (open.keyword == TokenType::KEYWORD_IF) {
+                statement = open.elseToken == kNoToken
+                    ? arena_.make<IfStatementNode>(open.keywordToken, open.condition, body, kNoToken, NodeList<StatementNode>())
+                    : arena_.make<IfStatementNode>(open.keywordToken, open.condition, open.thenBody, open.elseToken, body);
+            }
+            else if (open.keyword == TokenType::KEYWORD_WHILE) {
+                statement = arena_.make<WhileStatementNode>(open.keywordToken, open.condition, body);
+            }
+            else {
+                statement = arena_.make<ForStatementNode>(open.keywordToken, open.init, open.condition, open.update, body);
+            }
+            const TokenIndex statementStart = open.start;
+            pending_.pop_back();
+            scratch_.push_back(statement);
+            if (panic_) synchronize(statementStart);
+        }
+    }
+}
+
+void Parser::openBody(PendingStatement& statement) {
+    statement.mark = scratch_.size();
+    statement.braced = accept(TokenType::LBRACE);
+    if (statement.braced) panic_ = false; // A broken condition does not spill into the body
+}
+
+Parser::PendingStatement Parser::parseStatementHeader() {
+    PendingStatement statement = {};
+    statement.keyword = currentType_;
+    statement.elseToken = kNoToken;
+    statement.keywordToken = currentIndex_;
+    consumeToken();
+    if (statement.keyword == TokenType::KEYWORD_FOR) {
+        // "for" "(" [ simple_statement ] ";" [ condition ] ";" [ simple_statement ] ")"
+        eat(TokenType::LPAREN, "Expected '(' after 'for'");
+        statement.init = currentType_ != TokenType::SEMICOLON ? parseSimpleStatement() : nullptr;
+        eat(TokenType::SEMICOLON, "Expected ';' after for-loop initializer");
+        statement.condition = currentType_ != TokenType::SEMICOLON ? parseCondition() : nullptr;
+        eat(TokenType::SEMICOLON, "Expected ';' after for-loop condition");
+        statement.update = currentType_ != TokenType::RPAREN ? parseSimpleStatement() : nullptr;
+        eat(TokenType::RPAREN, "Expected ')' after for-loop header");
+        return statement;
+    }
+    // ( "if" | "while" ) "(" condition ")"
+    eat(TokenType::LPAREN, statement.keyword == TokenType::KEYWORD_IF ? "Expected '(' after 'if'" : "Expected '(' after 'while'");
+    statement.condition = parseCondition();
+    eat(TokenType::RPAREN, "Expected ')' after condition");
+    return statement;
+}
+
+// simple_statement ::= lvalue "=" expression | call | increment
+StatementNode* Parser::parseSimpleStatement() {
+    if (currentType_ == TokenType::PLUS_PLUS || currentType_ == TokenType::MINUS_MINUS) {
+        bool increment = currentType_ == TokenType::PLUS_PLUS;
+        TokenIndex opToken = currentIndex_;
+        consumeToken();
+        TokenIndex nameToken = eat(TokenType::IDENTIFIER, "Expected a variable after increment operator");
+        return arena_.make<IncrementStatementNode>(nameToken, opToken, increment, true);
+    }
+
+    TokenIndex nameToken = eat(TokenType::IDENTIFIER, "Expected a statement");
+    if (currentType_ == TokenType::PLUS_PLUS || currentType_ == TokenType::MINUS_MINUS) {
+        bool increment = currentType_ == TokenType::PLUS_PLUS;
+        TokenIndex opToken = currentIndex_;
+        consumeToken();
+        return arena_.make<IncrementStatementNode>(nameToken, opToken, increment, false);
+    }
+
+    ExpressionNode* target = parseNameExpression(nameToken);
+    if (currentType_ != TokenType::EQUAL && target->kind == NodeKind::Call) {
+        return arena_.make<ExpressionStatementNode>(target);
+    }
+    TokenIndex equalToken = eat(TokenType::EQUAL, "Expected '=' in assignment");
+    if (target->kind == NodeKind::Call && !panic_) {
+        reportAt(equalToken, "Cannot assign to the result of a function call");
+    }
+    ExpressionNode* value = parseExpression();
+    return arena_.make<AssignmentNode>(target, value);
+}
+
+// "scanf" "(" STRING_LITERAL "," ( "&" IDENTIFIER | array_ref ) ")"
+ScanfStatementNode* Parser::parseScanfStatement() {
+    TokenIndex keywordToken = eat(TokenType::KEYWORD_SCANF, "Expected 'scanf'");
+    eat(TokenType::LPAREN, "Expected '(' after 'scanf'");
+    TokenIndex formatToken = eat(TokenType::STRING_LITERAL, "Expected a format string");
+    eat(TokenType::COMMA, "Expected ',' after format string");
+
+    ExpressionNode* target = nullptr;
+    if (accept(TokenType::AMPERSAND)) {
+        target = arena_.make<IdentifierNode>(eat(TokenType::IDENTIFIER, "Expected a variable after '&'"));
     }
-    // else if (currentToken_.type == ...) { parseOtherStatement(); }
     else {
-        error("Expected a statement (e.g., 'return')");
-        return nullptr; // Should not be reached if error throws
+        TokenIndex nameToken = eat(TokenType::IDENTIFIER, "Expected '&variable' or an array element");
+        eat(TokenType::LBRACKET, "Expected '&variable' or an array element");
+        ExpressionNode* index = parseExpression();
+        eat(TokenType::RBRACKET, "Expected ']' after array index");
+        target = arena_.make<ArrayIndexNode>(nameToken, index);
+    }
+    eat(TokenType::RPAREN, "Expected ')' after scanf arguments");
+    return arena_.make<ScanfStatementNode>(keywordToken, formatToken, target);
+}
+
+// "printf" "(" STRING_LITERAL [ "," expression ] ")"
+PrintfStatementNode* Parser::parsePrintfStatement() {
+    TokenIndex keywordToken = eat(TokenType::KEYWORD_PRINTF, "Expected 'printf'");
+    eat(TokenType::LPAREN, "Expected '(' after 'printf'");
+    TokenIndex formatToken = eat(TokenType::STRING_LITERAL, "Expected a format string");
+    ExpressionNode* argument = nullptr;
+    if (accept(TokenType::COMMA)) {
+        argument = parseExpression();
     }
+    eat(TokenType::RPAREN, "Expected ')' after printf arguments");
+    return arena_.make<PrintfStatementNode>(keywordToken, formatToken, argument);
 }
 
-// return_statement ::= "return" expression ";"
-std::unique_ptr<ReturnStatementNode> Parser::parseReturnStatement() {
-    Token keywordToken = eat(TokenType::KEYWORD_RETURN, "Expected 'return' keyword");
-    std::unique_ptr<ExpressionNode> expr = parseExpression();
+// return_statement ::= "return" [ expression ] ";"
+ReturnStatementNode* Parser::parseReturnStatement() {
+    TokenIndex keywordToken = eat(TokenType::KEYWORD_RETURN, "Expected 'return' keyword");
+    ExpressionNode* expr = currentType_ != TokenType::SEMICOLON ? parseExpression() : nullptr;
     eat(TokenType::SEMICOLON, "Expected ';' after return statement");
-    return std::make_unique<ReturnStatementNode>(keywordToken, std::move(expr));
+    return arena_.make<ReturnStatementNode>(keywordToken, expr);
 }
 
-// expression ::= INTEGER_LITERAL (for V0.1)
-std::unique_ptr<ExpressionNode> Parser::parseExpression() {
-    // For V0.1, expressions are just integer literals.
-    // This will become the entry point for operator-precedence parsing later.
-    return parsePrimaryExpression();
+// condition ::= expression  (non-zero is true; usually a comparison)
+ExpressionNode* Parser::parseCondition() {
+    return parseExpression();
 }
 
-// primary_expression ::= INTEGER_LITERAL | ...
-std::unique_ptr<ExpressionNode> Parser::parsePrimaryExpression() {
-    if (currentToken_.type == TokenType::INTEGER_LITERAL) {
-        Token intToken = currentToken_; // Copy before consuming
-        consumeToken(); // or eat(TokenType::INTEGER_LITERAL)
-        return std::make_unique<IntegerLiteralNode>(intToken);
+namespace {
+
+enum OperatorKind : uint8_t { OPERATOR_BINARY, OPERATOR_PREFIX, OPERATOR_PAREN, OPERATOR_INDEX, OPERATOR_CALL };
+
+// Precedence and BinaryOp of every binary operator token, indexed by TokenType.
+// Higher binds tighter; 0 means "not a binary operator". All are left-associative.
+struct BinaryOperatorInfo {
+    uint8_t precedence;
+    BinaryOp op;
+};
+
+constexpr size_t kTokenTypeCount = static_cast<size_t>(TokenType::END_OF_FILE) + 1;
+constexpr uint8_t kPrefixPrecedence = 11; // Above every binary operator
+
+constexpr std::array<BinaryOperatorInfo, kTokenTypeCount> buildBinaryOperatorTable() {
+    std::array<BinaryOperatorInfo, kTokenTypeCount> table{};
+    auto set = [&table](TokenType type, uint8_t precedence, BinaryOp op) {
+        table[static_cast<size_t>(type)] = BinaryOperatorInfo{ precedence, op };
+    };
+    set(TokenType::PIPE_PIPE, 1, BinaryOp::LogicalOr);
+    set(TokenType::AMPERSAND_AMPERSAND, 2, BinaryOp::LogicalAnd);
+    set(TokenType::PIPE, 3, BinaryOp::BitOr);
+    set(TokenType::CARET, 4, BinaryOp::BitXor);
+    set(TokenType::AMPERSAND, 5, BinaryOp::BitAnd);
+    set(TokenType::EQUAL_EQUAL, 6, BinaryOp::Equal);
+    set(TokenType::BANG_EQUAL, 6, BinaryOp::NotEqual);
+    set(TokenType::LESS, 7, BinaryOp::Less);
+    set(TokenType::LESS_EQUAL, 7, BinaryOp::LessEqual);
+    set(TokenType::GREATER, 7, BinaryOp::Greater);
+    set(TokenType::GREATER_EQUAL, 7, BinaryOp::GreaterEqual);
+    set(TokenType::LESS_LESS, 8, BinaryOp::ShiftLeft);
+    set(TokenType::GREATER_GREATER, 8, BinaryOp::ShiftRight);
+    set(TokenType::PLUS, 9, BinaryOp::Add);
+    set(TokenType::MINUS, 9, BinaryOp::Subtract);
+    set(TokenType::STAR, 10, BinaryOp::Multiply);
+    set(TokenType::SLASH, 10, BinaryOp::Divide);
+    set(TokenType::PERCENT, 10, BinaryOp::Modulo);
+    return table;
+}
+
+constexpr std::array<BinaryOperatorInfo, kTokenTypeCount> kBinaryOperators = buildBinaryOperatorTable();
+static_assert(kBinaryOperators[static_cast<size_t>(TokenType::STAR)].precedence
+    > kBinaryOperators[static_cast<size_t>(TokenType::PLUS)].precedence, "'*' binds tighter than '+'");
+
+} // namespace
+
+void Parser::reduceOperator() {
+    PendingOperator top = operators_.back();
+    operators_.pop_back();
+    if (top.kind == OPERATOR_PREFIX) {
+        operands_.back() = arena_.make<UnaryExpressionNode>(static_cast<UnaryOp>(top.op), top.token, operands_.back());
+        return;
     }
-    // else if (currentToken_.type == TokenType::IDENTIFIER) { ... }
-    // else if (currentToken_.type == TokenType::LPAREN) { parse parenthesized expression ... }
-    else {
-        error("Expected an integer literal or other primary expression");
-        return nullptr; // Should not be reached
+    ExpressionNode* right = operands_.back();
+    operands_.pop_back();
+    operands_.back() = arena_.make<BinaryExpressionNode>(static_cast<BinaryOp>(top.op), top.token, operands_.back(), right);
+}
+
+// expression ::= unary { binary_op unary }
+// unary      ::= { "-" | "!" | "~" } ( "(" expression ")" | primary )
+ExpressionNode* Parser::parseExpression() {
+    // Operands and operators of enclosing expressions (we may be inside a call's
+    // arguments) stay below these marks.
+    const size_t operandBase = operands_.size();
+    const size_t operatorBase = operators_.size();
+    // The innermost open parenthesis, index or call of this expression (reduces
+    // the operators above it first), or nullptr if there is none.
+    auto openGroup = [&]() -> PendingOperator* {
+        while (operators_.size() > operatorBase && operators_.back().precedence != 0) reduceOperator();
+        return operators_.size() > operatorBase ? &operators_.back() : nullptr;
+    };
+
+    for (;;) {
+        // Prefix operators and open parentheses, then one operand.
+        for (;;) {
+            UnaryOp op;
+            if (currentType_ == TokenType::MINUS) op = UnaryOp::Negate;
+            else if (currentType_ == TokenType::BANG) op = UnaryOp::LogicalNot;
+            else if (currentType_ == TokenType::TILDE) op = UnaryOp::BitNot;
+            else if (currentType_ == TokenType::LPAREN) {
+                operators_.push_back(PendingOperator{ OPERATOR_PAREN, 0, 0, currentIndex_ });
+                consumeToken();
+                continue;
+            }
+            else break;
+            operators_.push_back(PendingOperator{ OPERATOR_PREFIX, static_cast<uint8_t>(op), kPrefixPrecedence, currentIndex_ });
+            consumeToken();
+        }
+
+        // array_ref ::= IDENTIFIER "[" expression "]"
+        // call      ::= IDENTIFIER "(" [ expression { "," expression } ] ")"
+        // An index or a call is opened here and its contents are parsed by this
+        // loop; the node is built when its ']' or ')' closes it below.
+        if (currentType_ == TokenType::IDENTIFIER && peek(1) == TokenType::LBRACKET) {
+            operators_.push_back(PendingOperator{ OPERATOR_INDEX, 0, 0, currentIndex_ });
+            consumeToken();
+            consumeToken();
+            continue;
+        }
+        if (currentType_ == TokenType::IDENTIFIER && peek(1) == TokenType::LPAREN) {
+            const TokenIndex nameToken = currentIndex_;
+            consumeToken();
+            consumeToken();
+            if (currentType_ != TokenType::RPAREN) {
+                operators_.push_back(PendingOperator{ OPERATOR_CALL, 0, 0, nameToken, static_cast<uint32_t>(operands_.size()) });
+                continue;
+            }
+            consumeToken();
+            operands_.push_back(arena_.make<CallNode>(nameToken, NodeList<ExpressionNode>()));
+        }
+        else {
+            operands_.push_back(parsePrimaryExpression());
+        }
+        if (panic_) break; // Leave the rest of the expression to error recovery
+
+        // Close the parentheses, indices and calls this operand completes, and
+        // move on to the next argument of a call at a ','.
+        bool nextArgument = false;
+        for (;;) {
+            if (currentType_ != TokenType::RPAREN && currentType_ != TokenType::RBRACKET
+                && currentType_ != TokenType::COMMA) {
+                break;
+            }
+            PendingOperator* group = openGroup();
+            if (!group) break; // The token belongs to an enclosing construct
+            if (currentType_ == TokenType::COMMA) {
+                if (group->kind != OPERATOR_CALL) break;
+                consumeToken();
+                nextArgument = true;
+                break;
+            }
+            if (currentType_ == TokenType::RBRACKET) {
+                if (group->kind != OPERATOR_INDEX) break;
+                const TokenIndex nameToken = group->token;
+                operators_.pop_back();
+                operands_.back() = arena_.make<ArrayIndexNode>(nameToken, operands_.back());
+            }
+            else if (group->kind == OPERATOR_CALL) {
+                finishCall();
+            }
+            else if (group->kind == OPERATOR_PAREN) {
+                operators_.pop_back();
+            }
+            else {
+                break; // A ')' in an index
+            }
+            consumeToken();
+        }
+        if (nextArgument) continue;
+
+        const BinaryOperatorInfo& info = kBinaryOperators[static_cast<size_t>(currentType_)];
+        if (info.precedence == 0) break;
+        while (operators_.size() > operatorBase && operators_.back().precedence >= info.precedence) {
+            reduceOperator();
+        }
+        operators_.push_back(PendingOperator{ OPERATOR_BINARY, static_cast<uint8_t>(info.op), info.precedence, currentIndex_ });
+        consumeToken();
+    }
+
+    // Whatever is still open lacks its closing token.
+    while (PendingOperator* group = openGroup()) {
+        if (group->kind == OPERATOR_PAREN) {
+            eat(TokenType::RPAREN, "Expected ')' after expression");
+            operators_.pop_back();
+        }
+        else if (group->kind == OPERATOR_INDEX) {
+            eat(TokenType::RBRACKET, "Expected ']' after array index");
+            const TokenIndex nameToken = group->token;
+            operators_.pop_back();
+            operands_.back() = arena_.make<ArrayIndexNode>(nameToken, operands_.back());
+        }
+        else {
+            eat(TokenType::RPAREN, "Expected ')' after call arguments");
+            finishCall();
+        }
+    }
+    ExpressionNode* result = operands_.back();
+    operands_.resize(operandBase);
+    return result;
+}
+
+void Parser::finishCall() {
+    const PendingOperator call = operators_.back();
+    operators_.pop_back();
+    NodeList<ExpressionNode> arguments;
+    arguments.count = static_cast<uint32_t>(operands_.size() - call.mark);
+    arguments.items = arena_.copyArray(operands_.data() + call.mark, arguments.count);
+    operands_.resize(call.mark);
+    operands_.push_back(arena_.make<CallNode>(call.token, arguments));
+}
+
+// primary ::= literal | IDENTIFIER | array_ref | call  (parentheses are handled by parseExpression)
+ExpressionNode* Parser::parsePrimaryExpression() {
+    TokenIndex token = currentIndex_;
+    switch (currentType_) {
+    case TokenType::INTEGER_LITERAL:
+        consumeToken();
+        return arena_.make<IntegerLiteralNode>(token);
+    case TokenType::FLOAT_LITERAL:
+    case TokenType::DOUBLE_LITERAL:
+        consumeToken();
+        return arena_.make<FloatLiteralNode>(token);
+    case TokenType::CHAR_LITERAL:
+        consumeToken();
+        return arena_.make<CharLiteralNode>(token);
+    case TokenType::STRING_LITERAL:
+        consumeToken();
+        return arena_.make<StringLiteralNode>(token);
+    case TokenType::IDENTIFIER:
+        consumeToken();
+        return parseNameExpression(token);
+    default:
+        error("Expected an expression");
+        return arena_.make<ErrorExpressionNode>(token);
+    }
+}
+
+// array_ref ::= IDENTIFIER "[" expression "]"
+// call      ::= IDENTIFIER "(" [ expression { "," expression } ] ")"
+ExpressionNode* Parser::parseNameExpression(TokenIndex nameToken) {
+    if (accept(TokenType::LBRACKET)) {
+        ExpressionNode* index = parseExpression();
+        eat(TokenType::RBRACKET, "Expected ']' after array index");
+        return arena_.make<ArrayIndexNode>(nameToken, index);
+    }
+    if (accept(TokenType::LPAREN)) {
+        size_t mark = scratch_.size();
+        if (currentType_ != TokenType::RPAREN) {
+            do {
+                scratch_.push_back(parseExpression());
+            } while (accept(TokenType::COMMA));
+        }
+        NodeList<ExpressionNode> arguments = finishList<ExpressionNode>(mark);
+        eat(TokenType::RPAREN, "Expected ')' after call arguments");
+        return arena_.make<CallNode>(nameToken, arguments);
     }
+    return arena_.make<IdentifierNode>(nameToken);
 }
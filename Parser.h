@@ -4,66 +4,177 @@
 
 #include "Lexer.h"    // Needs Lexer to get tokens
 #include "AstNode.h"  // Needs AST node definitions
+#include "Arena.h"    // Every node is allocated in the caller's Arena
+#include "Diagnostics.h"
 #include <vector>
-#include <memory>     // For std::unique_ptr
-#include <stdexcept>  // For std::runtime_error (or custom error class)
 
+// Recursive-descent parser for the grammar in 文法英文版.txt.
+// Decisions look at most kMaxLookahead tokens past the current one (a global
+// declaration and a function definition share "type IDENTIFIER" and differ at
+// the third token). Nodes refer to tokens by index, so no Token is ever copied.
+//
+// Syntax errors never throw. The first error of a construct is reported to the
+// Diagnostics sink and puts the parser in panic mode, which silences the
+// follow-on errors; the enclosing statement list then skips to the next ';',
+// '}' or statement keyword (at top level: the next "void" or type keyword) and
+// parsing resumes, so one run reports every independent error.
 class Parser {
 public:
-    Parser(Lexer& lexer);
-
-    // Top-level parsing function, returns the root of the AST
-    std::unique_ptr<ProgramNode> parseProgram();
+    // Streaming mode: pulls one token at a time from the lexer and appends it to
+    // `tokens`, which the AST refers to by index.
+    Parser(Lexer& lexer, TokenBuffer& tokens, Arena& arena, Diagnostics& diagnostics);
+    // Bulk mode: reads a pre-lexed token stream by index (see Lexer::getAllTokens).
+    Parser(const TokenBuffer& tokens, Arena& arena, Diagnostics& diagnostics);
+
+    // Top-level parsing function, returns the root of the AST.
+    // The tree lives in the Arena passed to the constructor (see CompilationUnit).
+    // It is always returned; if syntaxErrorCount() > 0 it contains ErrorExpression
+    // nodes and must not be used beyond debugging.
+    ProgramNode* parseProgram();
+    size_t syntaxErrorCount() const { return errorCount_; }
+
+    // Bulk mode only: parse the single top-level construct that starts at token
+    // `start` (see ParallelParser, which finds those starts in a pre-scan).
+    // position() is the index of the first token after it.
+    StatementNode* parseGlobalAt(TokenIndex start);
+    FunctionDefinitionNode* parseFunctionAt(TokenIndex start);
+    TokenIndex position() const { return currentIndex_; }
+
+    static const size_t kMaxLookahead = 2;
 
 private:
-    Lexer& lexer_;
-    Token currentToken_;
-    // Token peekToken_; // For LL(k) where k > 1, not needed for simple LL(1)
+    Lexer* lexer_;              // Streaming source (nullptr in bulk mode)
+    TokenBuffer* streamTokens_; // Where streamed tokens are appended (nullptr in bulk mode)
+    const TokenBuffer* tokens_; // Token store the AST indexes into (in both modes)
+    TokenIndex currentIndex_;   // Index of the current token in tokens_
+    TokenType currentType_;     // Its type, read on every decision
+    Arena& arena_;              // Owner of every node this parser creates
+    Diagnostics& diagnostics_;  // Where syntax errors are reported
+    bool panic_ = false;        // An error was reported and not yet recovered from
+    size_t errorCount_ = 0;
+    std::vector<AstNode*> scratch_; // Children of the lists still being parsed (shared stack)
+
+    // Stacks of parseExpression. An open array index or call is an entry of
+    // operators_ like an open parenthesis, so its contents nest on the same stacks.
+    struct PendingOperator {
+        uint8_t kind;       // OperatorKind in Parser.cpp: binary, prefix, open parenthesis, index or call
+        uint8_t op;         // BinaryOp or UnaryOp
+        uint8_t precedence; // 0 for an open parenthesis, index or call, so it stops every reduction
+        TokenIndex token;   // The operator, or the name of an index or call
+        uint32_t mark = 0;  // Call: operands_.size() before its first argument
+    };
+    std::vector<ExpressionNode*> operands_;
+    std::vector<PendingOperator> operators_;
+    void reduceOperator(); // Pops the top operator and its operands and pushes the new node
+
+    // Copies scratch_[mark..] into the Arena as a NodeList and pops them off the stack.
+    template <typename T>
+    NodeList<T> finishList(size_t mark);
 
     // Helper to advance to the next token
     void consumeToken();
+    void seek(TokenIndex index); // Bulk mode: continue at token `index`
+
+    // Type of the token `distance` (1..kMaxLookahead) past the current one.
+    // In streaming mode this lexes ahead into the token store.
+    TokenType peek(size_t distance);
 
     // Helper to check current token type and consume it if it matches.
-    // Throws an error (or logs and attempts recovery) if it doesn't match.
-    Token eat(TokenType expectedType, const std::string& errorMessage = "Unexpected token");
+    // Otherwise reports an error and consumes nothing.
+    // Returns the index of the consumed (or, on error, the current) token.
+    TokenIndex eat(TokenType expectedType, const char* errorMessage = "Unexpected token");
+    bool accept(TokenType type); // Consumes the current token if it has this type
 
     // --- Parsing methods for grammar rules (non-terminals) ---
     // Each of these will correspond to a rule in our grammar.
 
-    // program ::= function_definition EOF
+    // program ::= { global_decl } { function_def } EOF
     // (parseProgram already declared)
 
-    // function_definition ::= type IDENTIFIER "(" ")" "{" statement* "}"
-    std::unique_ptr<FunctionDefinitionNode> parseFunctionDefinition();
-
-    // type ::= "int"
-    Token parseType(); // Returns the type token (e.g., "int")
-
-    // statement ::= return_statement
-    std::unique_ptr<StatementNode> parseStatement();
-
-    // return_statement ::= "return" expression ";"
-    std::unique_ptr<ReturnStatementNode> parseReturnStatement();
-
-    // expression ::= INTEGER_LITERAL
-    std::unique_ptr<ExpressionNode> parseExpression();
-    std::unique_ptr<ExpressionNode> parsePrimaryExpression(); // For literals, parentheses, etc.
+    // global_decl ::= base_type IDENTIFIER [ "=" expression ] ";"
+    //               | base_type IDENTIFIER "[" [ INTEGER_LITERAL ] "]" [ "=" "{" literal { [","] literal } "}" ] ";"
+    // Also used for local declarations inside a body.
+    StatementNode* parseDeclaration();
+
+    // function_def ::= ( "void" | base_type ) IDENTIFIER "(" [ param { "," param } ] ")" "{" { statement } "}"
+    FunctionDefinitionNode* parseFunctionDefinition();
+    ParameterNode* parseParameter(); // param ::= base_type IDENTIFIER
+
+    // base_type ::= "int" | "float" | "char" | "string"
+    static bool isBaseType(TokenType type);
+    TokenIndex parseType(); // Returns the type token (e.g., "int")
+
+    // statement ::= global_decl | io_statement ";" | simple_statement ";"
+    //             | if_statement | while_statement | for_statement | return_statement
+    // Every statement but the three compound ones, which parseStatementInList handles.
+    StatementNode* parseStatement();
+
+    // block ::= "{" { statement } "}" | statement
+    // Parses one statement onto scratch_ and recovers if it was broken. The
+    // bodies of if, while and for are parsed by the same loop, which keeps the
+    // compound statements still open on pending_, so neither deeply nested
+    // blocks nor long else-if chains recurse.
+    void parseStatementInList();
+
+    // simple_statement ::= lvalue "=" expression | call | increment
+    // increment ::= IDENTIFIER ("++" | "--") | ("++" | "--") IDENTIFIER
+    StatementNode* parseSimpleStatement();
+
+    // if_statement ::= "if" "(" condition ")" block [ "else" block ]
+    // while_statement ::= "while" "(" condition ")" block
+    // for_statement ::= "for" "(" [ simple_statement ] ";" [ condition ] ";" [ simple_statement ] ")" block
+    // One of these whose header has been parsed and whose body is open.
+    struct PendingStatement {
+        TokenType keyword;         // KEYWORD_IF, KEYWORD_WHILE or KEYWORD_FOR
+        bool braced;               // The open body is "{" { statement } "}" rather than one statement
+        TokenIndex start;          // First token, for error recovery
+        TokenIndex keywordToken;
+        TokenIndex elseToken;      // Set once an if's else body is open
+        ExpressionNode* condition;
+        StatementNode* init;       // for only; either may be absent
+        StatementNode* update;
+        NodeList<StatementNode> thenBody; // An if's, once its else body is open
+        size_t mark;               // Where the open body's statements start on scratch_
+    };
+    std::vector<PendingStatement> pending_;
+    // Parses the header of the if, while or for at the current token.
+    PendingStatement parseStatementHeader();
+    // Opens the body that starts at the current token: a '{' or one statement.
+    void openBody(PendingStatement& statement);
+
+    // io_statement ::= "scanf" "(" STRING_LITERAL "," ( "&" IDENTIFIER | array_ref ) ")"
+    //               | "printf" "(" STRING_LITERAL [ "," expression ] ")"
+    ScanfStatementNode* parseScanfStatement();
+    PrintfStatementNode* parsePrintfStatement();
+
+    // return_statement ::= "return" [ expression ] ";"
+    ReturnStatementNode* parseReturnStatement();
+
+    // condition ::= expression  (non-zero is true; usually a comparison)
+    ExpressionNode* parseCondition();
+
+    // expression ::= unary { binary_op unary }
+    // unary      ::= { "-" | "!" | "~" } ( "(" expression ")" | primary )
+    // Operator precedence parsing driven by the table in Parser.cpp: one loop with
+    // explicit operand/operator stacks handles every precedence level and every
+    // parenthesis, array index and call, so neither long operator chains nor deep
+    // nesting recurse.
+    ExpressionNode* parseExpression();
+    void finishCall(); // Pops the innermost call frame and pushes its CallNode
+    // primary ::= literal | IDENTIFIER | array_ref | call
+    ExpressionNode* parsePrimaryExpression(); // For literals, names, calls, etc.
+    // Continues a primary that started with IDENTIFIER: array_ref, call or plain name.
+    ExpressionNode* parseNameExpression(TokenIndex nameToken);
 
     // Error reporting utility
-    void error(const std::string& message); // Throws a ParseError or std::runtime_error
-};
-
-// Custom exception for parsing errors (optional, can use std::runtime_error)
-class ParseError : public std::runtime_error {
-public:
-    ParseError(const std::string& message, int line, int col)
-        : std::runtime_error(message + " at line " + std::to_string(line) + " col " + std::to_string(col)),
-        line_(line), col_(col) {}
-    int getLine() const { return line_; }
-    int getColumn() const { return col_; }
-private:
-    int line_;
-    int col_;
+    void error(const std::string& message); // Reports at the current token and enters panic mode
+    void reportAt(TokenIndex token, const std::string& message); // Reports without entering panic mode
+
+    // Error recovery. `start` is where the broken statement (or top-level
+    // construct) began; both always make progress and leave panic mode.
+    void synchronize(TokenIndex start);
+    void synchronizeTopLevel(TokenIndex start);
+    bool atBoundary() const; // The previous token was ';' or '}'
 };
 
 
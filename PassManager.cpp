@@ -0,0 +1,165 @@
+// PassManager.cpp
+#include "PassManager.h"
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct RegisteredPass {
+    const char* name;
+    IrPassFunction run;
+};
+
+const RegisteredPass kPasses[] = {
+#define IR_PASS_ENTRY(name, function) { name, function },
+    IR_PASS_LIST(IR_PASS_ENTRY)
+#undef IR_PASS_ENTRY
+};
+
+// -O0 only drops blocks that cannot run; -O1 folds constants and deletes
+// dead code; -O2 adds value numbering and folds what it simplified, then
+// hoists out of loops and unrolls small ones, cleans the copies up and
+// reduces the multiplies left in loops.
+const char* const kPipelines[] = {
+    "unreachable-blocks",
+    "unreachable-blocks,sccp,copy-propagation,dce,simplify-cfg",
+    "unreachable-blocks,sccp,gvn,copy-propagation,sccp,dce,simplify-cfg,"
+    "licm,unroll,sccp,gvn,copy-propagation,strength-reduction,dce,simplify-cfg",
+};
+
+} // namespace
+
+PassManager::PassManager() {
+#ifdef NDEBUG
+    verify_ = false;
+#else
+    verify_ = true;
+#endif
+}
+
+void PassManager::add(std::string_view name, IrPassFunction run) {
+    passes_.push_back(Entry{ std::string(name), run });
+}
+
+bool PassManager::add(std::string_view name) {
+    for (const RegisteredPass& pass : kPasses) {
+        if (name == pass.name) {
+            for (const std::string& disabled : disabled_) {
+                if (name == disabled) return true;
+            }
+            add(name, pass.run);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PassManager::addList(std::string_view names) {
+    while (!names.empty()) {
+        size_t comma = names.find(',');
+        std::string_view name = names.substr(0, comma);
+        if (!name.empty() && !add(name)) {
+            error_ = "Unknown pass '" + std::string(name) + "'";
+            return false;
+        }
+        names = comma == std::string_view::npos ? std::string_view() : names.substr(comma + 1);
+    }
+    return true;
+}
+
+bool PassManager::disableList(std::string_view names) {
+    while (!names.empty()) {
+        size_t comma = names.find(',');
+        std::string_view name = names.substr(0, comma);
+        if (!name.empty()) {
+            bool known = false;
+            for (const RegisteredPass& pass : kPasses) known = known || name == pass.name;
+            if (!known) {
+                error_ = "Unknown pass '" + std::string(name) + "'";
+                return false;
+            }
+            disabled_.emplace_back(name);
+        }
+        names = comma == std::string_view::npos ? std::string_view() : names.substr(comma + 1);
+    }
+    return true;
+}
+
+void PassManager::recordStep(std::string_view name, double milliseconds, size_t before, size_t after) {
+    PassStatistics step;
+    step.name = std::string(name);
+    step.milliseconds = milliseconds;
+    step.instructionsBefore = before;
+    step.instructionsAfter = after;
+    statistics_.push_back(step);
+}
+
+bool PassManager::verify(const IrModule& module, const std::string& after) {
+    if (!verify_) return true;
+    Clock::time_point start = Clock::now();
+    for (const IrFunction& function : module.functions) {
+        std::string problem = verifyIr(function);
+        if (!problem.empty()) {
+            error_ = "Invalid IR after " + after + " in function '" + std::string(function.name) + "': " + problem;
+            verifyMilliseconds_ += millisecondsSince(start);
+            return false;
+        }
+    }
+    verifyMilliseconds_ += millisecondsSince(start);
+    return true;
+}
+
+bool PassManager::run(IrModule& module) {
+    if (!verify(module, "construction")) return false;
+    for (const Entry& pass : passes_) {
+        PassStatistics step;
+        step.name = pass.name;
+        step.instructionsBefore = module.instructionCount();
+        Clock::time_point start = Clock::now();
+        for (IrFunction& function : module.functions) {
+            if (pass.run(function, module)) ++step.functionsChanged;
+        }
+        step.milliseconds = millisecondsSince(start);
+        step.instructionsAfter = module.instructionCount();
+        statistics_.push_back(step);
+        if (!verify(module, "pass '" + pass.name + "'")) return false;
+    }
+    return true;
+}
+
+void PassManager::report(std::ostream& out) const {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-24s %10s %12s %12s %10s %8s\n",
+        "pass", "ms", "before", "after", "delta", "changed");
+    out << line;
+    double total = 0;
+    for (const PassStatistics& step : statistics_) {
+        long long delta = static_cast<long long>(step.instructionsAfter) - static_cast<long long>(step.instructionsBefore);
+        std::snprintf(line, sizeof(line), "%-24s %10.3f %12zu %12zu %+10lld %8zu\n", step.name.c_str(),
+            step.milliseconds, step.instructionsBefore, step.instructionsAfter, delta, step.functionsChanged);
+        out << line;
+        total += step.milliseconds;
+    }
+    if (verify_) {
+        std::snprintf(line, sizeof(line), "%-24s %10.3f\n", "(verify)", verifyMilliseconds_);
+        out << line;
+        total += verifyMilliseconds_;
+    }
+    std::snprintf(line, sizeof(line), "%-24s %10.3f\n", "total", total);
+    out << line;
+}
+
+void PassManager::listPasses(std::ostream& out) {
+    for (const RegisteredPass& pass : kPasses) out << "  " << pass.name << '\n';
+}
+
+const char* PassManager::pipeline(unsigned level) {
+    const size_t last = sizeof(kPipelines) / sizeof(kPipelines[0]) - 1;
+    return kPipelines[level < last ? level : last];
+}
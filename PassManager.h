@@ -0,0 +1,70 @@
+// PassManager.h
+#ifndef PASSMANAGER_H
+#define PASSMANAGER_H
+
+#include "Ir.h"
+#include "IrPasses.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// PassManager: Runs a pipeline of IR passes over every function of a module,
+// in the order they were added. Unless built with NDEBUG it verifies the IR
+// (see verifyIr) after every pass and stops at the first pass that breaks it.
+// For every pass it records the wall time and the number of instructions
+// before and after, which report() prints as a table (--time-passes).
+class PassManager {
+public:
+    struct PassStatistics {
+        std::string name;
+        double milliseconds = 0;
+        size_t instructionsBefore = 0;
+        size_t instructionsAfter = 0;
+        size_t functionsChanged = 0;
+    };
+
+    PassManager();
+
+    void add(std::string_view name, IrPassFunction run);
+    // Adds a pass of IR_PASS_LIST by name; false if there is no such pass.
+    bool add(std::string_view name);
+    // Adds a comma-separated list of pass names; false (see error()) on an unknown one.
+    bool addList(std::string_view names);
+    // Makes add() skip the passes of a comma-separated list, so that one can be
+    // left out of a pipeline (--disable-passes); false on an unknown name.
+    bool disableList(std::string_view names);
+
+    void setVerify(bool verify) { verify_ = verify; }
+    // Records a step done outside the pass manager (such as building the IR),
+    // so that report() shows it with the passes.
+    void recordStep(std::string_view name, double milliseconds, size_t before, size_t after);
+
+    // Returns false (see error()) if the IR failed verification.
+    bool run(IrModule& module);
+
+    const std::vector<PassStatistics>& statistics() const { return statistics_; }
+    double verifyMilliseconds() const { return verifyMilliseconds_; }
+    void report(std::ostream& out) const;
+    const std::string& error() const { return error_; }
+
+    static void listPasses(std::ostream& out);
+    // The pass list of an optimization level (-O0 to -O2; higher levels get -O2's).
+    static const char* pipeline(unsigned level);
+
+private:
+    struct Entry {
+        std::string name;
+        IrPassFunction run;
+    };
+    std::vector<Entry> passes_;
+    std::vector<std::string> disabled_;
+    std::vector<PassStatistics> statistics_;
+    double verifyMilliseconds_ = 0;
+    bool verify_;
+    std::string error_;
+
+    bool verify(const IrModule& module, const std::string& after);
+};
+
+#endif // PASSMANAGER_H
@@ -0,0 +1,448 @@
+// SemanticAnalyzer.cpp
+#include "SemanticAnalyzer.h"
+
+namespace {
+
+std::string typeName(ValueType type) {
+    return std::string("'") + valueTypeToString(type) + "'";
+}
+
+std::string plural(size_t n, const char* noun) {
+    return std::to_string(n) + " " + noun + (n == 1 ? "" : "s");
+}
+
+// Whether a value of type `from` may be stored in a `to` (true if either
+// already failed to check, so an error is reported only once).
+bool converts(ValueType to, ValueType from) {
+    return to == ValueType::None || from == ValueType::None || to == from || (isNumeric(to) && isNumeric(from));
+}
+
+bool isComparison(BinaryOp op) {
+    return op >= BinaryOp::Less && op <= BinaryOp::NotEqual;
+}
+
+} // namespace
+
+SemanticAnalyzer::SemanticAnalyzer(const TokenBuffer& tokens, Diagnostics& diagnostics, SemanticInfo& info)
+    : tokens_(tokens), diagnostics_(diagnostics), info_(info) {
+}
+
+bool SemanticAnalyzer::analyze(const ProgramNode* program) {
+    size_t errorsBefore = errorCount_;
+    info_.reset(tokens_.size());
+
+    for (const StatementNode* global : program->globals) checkStatement(global);
+    for (const FunctionDefinitionNode* function : program->functions) declareFunction(function);
+    for (const FunctionDefinitionNode* function : program->functions) checkFunction(function);
+    return errorCount_ == errorsBefore;
+}
+
+void SemanticAnalyzer::report(TokenIndex token, std::string message) {
+    ++errorCount_;
+    diagnostics_.report(DiagnosticKind::Semantic, tokens_.offset(token), tokens_.lexeme(token), std::move(message));
+}
+
+void SemanticAnalyzer::declare(TokenIndex nameToken, SymbolKind kind, ValueType type, const FunctionDefinitionNode* function) {
+    info_.declarations[nameToken] = nameToken;
+    if (symbols_.declare(tokens_.symbol(nameToken), kind, type, nameToken, function)) {
+        report(nameToken, "Redefinition of " + quoted(nameToken));
+    }
+}
+
+const Symbol* SemanticAnalyzer::resolve(TokenIndex nameToken) {
+    ++lookupCount_;
+    const Symbol* symbol = symbols_.lookup(tokens_.symbol(nameToken));
+    if (!symbol) {
+        report(nameToken, "Use of undeclared identifier " + quoted(nameToken));
+        return nullptr;
+    }
+    info_.declarations[nameToken] = symbol->declaration;
+    return symbol;
+}
+
+void SemanticAnalyzer::reportConversion(ValueType to, ValueType from, TokenIndex at, const std::string& context) {
+    report(at, context + ": cannot convert " + typeName(from) + " to " + typeName(to));
+}
+
+// --- Declarations and functions ---
+
+void SemanticAnalyzer::declareFunction(const FunctionDefinitionNode* function) {
+    declare(function->identifierToken, SymbolKind::Function,
+        valueTypeOfKeyword(tokens_.type(function->returnTypeToken)), function);
+}
+
+void SemanticAnalyzer::checkFunction(const FunctionDefinitionNode* function) {
+    function_ = function;
+    returnType_ = valueTypeOfKeyword(tokens_.type(function->returnTypeToken));
+
+    // Parameters and the outermost statements of the body share one scope, as in C.
+    symbols_.enterScope();
+    for (const ParameterNode* parameter : function->parameters) {
+        declare(parameter->nameToken, SymbolKind::Parameter, valueTypeOfKeyword(tokens_.type(parameter->typeToken)));
+    }
+    for (size_t i = function->body.count; i-- > 0;) {
+        statements_.push_back(PendingStatement{ function->body[i], ScopeAction::None });
+    }
+    while (!statements_.empty()) {
+        PendingStatement item = statements_.back();
+        statements_.pop_back();
+        if (item.action == ScopeAction::Enter) symbols_.enterScope();
+        else if (item.action == ScopeAction::Leave) symbols_.leaveScope();
+        else checkStatement(item.node);
+    }
+    symbols_.leaveScope();
+    function_ = nullptr;
+}
+
+void SemanticAnalyzer::pushBlock(NodeList<StatementNode> block) {
+    // Checked in order, in a scope of their own, once the statements pushed
+    // before are done.
+    statements_.push_back(PendingStatement{ nullptr, ScopeAction::Leave });
+    for (size_t i = block.count; i-- > 0;) {
+        statements_.push_back(PendingStatement{ block[i], ScopeAction::None });
+    }
+    statements_.push_back(PendingStatement{ nullptr, ScopeAction::Enter });
+}
+
+void SemanticAnalyzer::checkVariableDeclaration(const VariableDeclarationNode* node) {
+    ValueType type = valueTypeOfKeyword(tokens_.type(node->typeToken));
+    // The initializer is checked first, so `int x = x;` refers to an outer x.
+    if (node->initializer) {
+        ValueType value = checkExpression(node->initializer);
+        if (!converts(type, value)) {
+            reportConversion(type, value, expressionToken(node->initializer), "Initializer of " + quoted(node->nameToken));
+        }
+    }
+    declare(node->nameToken, SymbolKind::Variable, type);
+}
+
+void SemanticAnalyzer::checkArrayDeclaration(const ArrayDeclarationNode* node) {
+    ValueType type = valueTypeOfKeyword(tokens_.type(node->typeToken));
+    if (node->sizeToken != kNoToken) {
+        long long size = tokens_.literal(node->sizeToken).integer;
+        if (size <= 0) {
+            report(node->sizeToken, "Size of array " + quoted(node->nameToken) + " must be positive");
+        }
+        else if (node->elements.count > static_cast<unsigned long long>(size)) {
+            report(expressionToken(node->elements[static_cast<size_t>(size)]), "Too many initializers for array "
+                + quoted(node->nameToken) + " (" + plural(node->elements.count, "element") + ", size " + std::to_string(size) + ")");
+        }
+    }
+    else if (node->elements.count == 0) {
+        report(node->nameToken, "Array " + quoted(node->nameToken) + " needs a size or an initializer");
+    }
+    for (const ExpressionNode* element : node->elements) {
+        ValueType value = checkExpression(element);
+        if (!converts(type, value)) reportConversion(type, value, expressionToken(element), "Element of " + quoted(node->nameToken));
+    }
+    declare(node->nameToken, SymbolKind::Array, type);
+}
+
+// --- Statements ---
+
+void SemanticAnalyzer::checkStatement(const StatementNode* statement) {
+    switch (statement->kind) {
+    case NodeKind::VariableDeclaration:
+        checkVariableDeclaration(static_cast<const VariableDeclarationNode*>(statement));
+        break;
+    case NodeKind::ArrayDeclaration:
+        checkArrayDeclaration(static_cast<const ArrayDeclarationNode*>(statement));
+        break;
+    case NodeKind::Assignment: {
+        const AssignmentNode* node = static_cast<const AssignmentNode*>(statement);
+        ValueType target = checkExpression(node->target);
+        ValueType value = checkExpression(node->value);
+        if (!converts(target, value)) {
+            reportConversion(target, value, expressionToken(node->value), "Assignment to " + quoted(expressionToken(node->target)));
+        }
+        break;
+    }
+    case NodeKind::ExpressionStatement:
+        checkExpression(static_cast<const ExpressionStatementNode*>(statement)->expression, false);
+        break;
+    case NodeKind::IncrementStatement: {
+        const IncrementStatementNode* node = static_cast<const IncrementStatementNode*>(statement);
+        const Symbol* symbol = resolve(node->nameToken);
+        if (!symbol) break;
+        if ((symbol->kind != SymbolKind::Variable && symbol->kind != SymbolKind::Parameter) || !isNumeric(symbol->type)) {
+            report(node->opToken, "Operand of " + quoted(node->opToken) + " must be a numeric variable");
+        }
+        break;
+    }
+    case NodeKind::IfStatement: {
+        const IfStatementNode* node = static_cast<const IfStatementNode*>(statement);
+        checkCondition(node->condition);
+        if (node->elseBody.count) pushBlock(node->elseBody);
+        pushBlock(node->thenBody);
+        break;
+    }
+    case NodeKind::WhileStatement: {
+        const WhileStatementNode* node = static_cast<const WhileStatementNode*>(statement);
+        checkCondition(node->condition);
+        pushBlock(node->body);
+        break;
+    }
+    case NodeKind::ForStatement: {
+        // The header only holds simple statements, which declare nothing.
+        const ForStatementNode* node = static_cast<const ForStatementNode*>(statement);
+        if (node->init) checkStatement(node->init);
+        if (node->condition) checkCondition(node->condition);
+        if (node->update) checkStatement(node->update);
+        pushBlock(node->body);
+        break;
+    }
+    case NodeKind::ScanfStatement: {
+        const ScanfStatementNode* node = static_cast<const ScanfStatementNode*>(statement);
+        checkFormat(node->formatToken, node->target, true);
+        break;
+    }
+    case NodeKind::PrintfStatement: {
+        const PrintfStatementNode* node = static_cast<const PrintfStatementNode*>(statement);
+        checkFormat(node->formatToken, node->argument, false);
+        break;
+    }
+    case NodeKind::ReturnStatement:
+        checkReturn(static_cast<const ReturnStatementNode*>(statement));
+        break;
+    default:
+        break;
+    }
+}
+
+void SemanticAnalyzer::checkReturn(const ReturnStatementNode* node) {
+    TokenIndex function = function_->identifierToken;
+    if (!node->returnValue) {
+        if (returnType_ != ValueType::Void) {
+            report(node->keywordToken, "Non-void function " + quoted(function) + " must return a value");
+        }
+        return;
+    }
+    ValueType value = checkExpression(node->returnValue);
+    if (returnType_ == ValueType::Void) {
+        report(node->keywordToken, "Void function " + quoted(function) + " cannot return a value");
+    }
+    else if (!converts(returnType_, value)) {
+        reportConversion(returnType_, value, expressionToken(node->returnValue), "Return value of " + quoted(function));
+    }
+}
+
+void SemanticAnalyzer::checkCondition(const ExpressionNode* condition) {
+    ValueType type = checkExpression(condition);
+    if (type != ValueType::None && !isNumeric(type)) {
+        report(expressionToken(condition), "Condition must be a number, not " + typeName(type));
+    }
+}
+
+void SemanticAnalyzer::checkFormat(TokenIndex formatToken, const ExpressionNode* argument, bool isScanf) {
+    ValueType argumentType = argument ? checkExpression(argument) : ValueType::None;
+
+    // Collect the conversions: '%', optional flags, width and precision, one letter.
+    std::string_view format = tokens_.literal(formatToken).stringValue();
+    size_t conversions = 0;
+    ValueType expected = ValueType::None;
+    std::string_view spec;
+    for (size_t i = 0; i < format.size(); ++i) {
+        if (format[i] != '%') continue;
+        size_t start = i++;
+        if (i < format.size() && format[i] == '%') continue; // A literal '%'
+        std::string_view modifiers = isScanf ? "0123456789" : "-+ #0123456789."; // scanf takes a width only
+        while (i < format.size() && modifiers.find(format[i]) != std::string_view::npos) ++i;
+        if (i == format.size()) {
+            report(formatToken, "Incomplete conversion at the end of the format string");
+            return;
+        }
+        ValueType type;
+        switch (format[i]) {
+        case 'd': case 'i': type = ValueType::Int; break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': type = ValueType::Float; break;
+        case 'c': type = ValueType::Char; break;
+        case 's': type = ValueType::String; break;
+        default:
+            report(formatToken, "Unknown conversion '" + std::string(format.substr(start, i - start + 1)) + "' in format string");
+            return;
+        }
+        if (conversions++ == 0) {
+            expected = type;
+            spec = format.substr(start, i - start + 1);
+        }
+    }
+
+    size_t arguments = argument ? 1 : 0;
+    if (conversions != arguments) {
+        report(formatToken, "Format string has " + plural(conversions, "conversion") + " but "
+            + plural(arguments, "argument") + (arguments == 1 ? " was" : " were") + " given");
+        return;
+    }
+    if (!argument || argumentType == ValueType::None) return;
+    bool matches = argumentType == expected
+        || (!isScanf && (expected == ValueType::Int || expected == ValueType::Char) && isIntegral(argumentType));
+    if (!matches) {
+        report(expressionToken(argument), "Format '" + std::string(spec) + "' expects " + typeName(expected)
+            + ", but the argument has type " + typeName(argumentType));
+    }
+}
+
+// --- Expressions ---
+
+ValueType SemanticAnalyzer::checkExpression(const ExpressionNode* root, bool valueNeeded) {
+    // Postorder with an explicit stack: an operator is finished once the types
+    // of all its operands are on values_.
+    const size_t expressionBase = expressions_.size();
+    expressions_.push_back(PendingExpression{ root, false });
+    while (expressions_.size() > expressionBase) {
+        PendingExpression item = expressions_.back();
+        expressions_.pop_back();
+        const ExpressionNode* node = item.node;
+        ValueType type;
+        if (item.expanded) {
+            type = node->kind == NodeKind::Call
+                ? finishCall(static_cast<const CallNode*>(node), valueNeeded || node != root)
+                : finishOperator(node);
+        }
+        else {
+            switch (node->kind) {
+            case NodeKind::BinaryExpression: {
+                const BinaryExpressionNode* binary = static_cast<const BinaryExpressionNode*>(node);
+                expressions_.push_back(PendingExpression{ node, true });
+                expressions_.push_back(PendingExpression{ binary->right, false });
+                expressions_.push_back(PendingExpression{ binary->left, false });
+                continue;
+            }
+            case NodeKind::UnaryExpression:
+                expressions_.push_back(PendingExpression{ node, true });
+                expressions_.push_back(PendingExpression{ static_cast<const UnaryExpressionNode*>(node)->operand, false });
+                continue;
+            case NodeKind::ArrayIndex:
+                expressions_.push_back(PendingExpression{ node, true });
+                expressions_.push_back(PendingExpression{ static_cast<const ArrayIndexNode*>(node)->index, false });
+                continue;
+            case NodeKind::Call: {
+                const NodeList<ExpressionNode>& arguments = static_cast<const CallNode*>(node)->arguments;
+                expressions_.push_back(PendingExpression{ node, true });
+                for (size_t i = arguments.count; i-- > 0;) {
+                    expressions_.push_back(PendingExpression{ arguments[i], false });
+                }
+                continue;
+            }
+            default:
+                type = checkLeaf(node);
+                break;
+            }
+        }
+        info_.types[expressionToken(node)] = type;
+        values_.push_back(type);
+    }
+    ValueType type = values_.back();
+    values_.pop_back();
+    return type;
+}
+
+ValueType SemanticAnalyzer::checkLeaf(const ExpressionNode* node) {
+    switch (node->kind) {
+    case NodeKind::IntegerLiteral: return ValueType::Int;
+    case NodeKind::FloatLiteral: return ValueType::Float;
+    case NodeKind::CharLiteral: return ValueType::Char;
+    case NodeKind::StringLiteral: return ValueType::String;
+    case NodeKind::Identifier: {
+        TokenIndex name = static_cast<const IdentifierNode*>(node)->nameToken;
+        const Symbol* symbol = resolve(name);
+        if (!symbol) return ValueType::None;
+        if (symbol->kind == SymbolKind::Function) {
+            report(name, quoted(name) + " is a function; call it with '(...)'");
+            return ValueType::None;
+        }
+        if (symbol->kind == SymbolKind::Array) {
+            report(name, "Array " + quoted(name) + " must be indexed");
+            return ValueType::None;
+        }
+        return symbol->type;
+    }
+    default:
+        return ValueType::None; // ErrorExpression: never in a tree that parsed cleanly
+    }
+}
+
+ValueType SemanticAnalyzer::finishOperator(const ExpressionNode* node) {
+    if (node->kind == NodeKind::ArrayIndex) {
+        const ArrayIndexNode* access = static_cast<const ArrayIndexNode*>(node);
+        ValueType index = values_.back();
+        values_.pop_back();
+        const Symbol* symbol = resolve(access->nameToken);
+        if (!symbol) return ValueType::None;
+        if (symbol->kind != SymbolKind::Array) {
+            report(access->nameToken, quoted(access->nameToken) + " is not an array");
+            return ValueType::None;
+        }
+        if (index != ValueType::None && !isIntegral(index)) {
+            report(expressionToken(access->index), "Array index must be an integer, not " + typeName(index));
+        }
+        return symbol->type;
+    }
+
+    if (node->kind == NodeKind::UnaryExpression) {
+        const UnaryExpressionNode* unary = static_cast<const UnaryExpressionNode*>(node);
+        ValueType operand = values_.back();
+        values_.pop_back();
+        if (operand == ValueType::None) return ValueType::None;
+        bool valid = unary->op == UnaryOp::BitNot ? isIntegral(operand) : isNumeric(operand);
+        if (!valid) {
+            report(unary->opToken, "Invalid operand to unary " + quoted(unary->opToken) + " (" + typeName(operand) + ")");
+            return ValueType::None;
+        }
+        return unary->op == UnaryOp::Negate && operand == ValueType::Float ? ValueType::Float : ValueType::Int;
+    }
+
+    const BinaryExpressionNode* binary = static_cast<const BinaryExpressionNode*>(node);
+    ValueType right = values_.back();
+    values_.pop_back();
+    ValueType left = values_.back();
+    values_.pop_back();
+    if (left == ValueType::None || right == ValueType::None) return ValueType::None;
+
+    bool arithmetic = binary->op <= BinaryOp::Divide;
+    bool valid = (arithmetic || isComparison(binary->op) || binary->op == BinaryOp::LogicalAnd || binary->op == BinaryOp::LogicalOr)
+        ? isNumeric(left) && isNumeric(right)
+        : isIntegral(left) && isIntegral(right); // %, shifts and bitwise operators
+    if (!valid) {
+        report(binary->opToken, "Invalid operands to binary " + quoted(binary->opToken)
+            + " (" + typeName(left) + " and " + typeName(right) + ")");
+        return ValueType::None;
+    }
+    if (arithmetic && (left == ValueType::Float || right == ValueType::Float)) return ValueType::Float;
+    return ValueType::Int;
+}
+
+ValueType SemanticAnalyzer::finishCall(const CallNode* node, bool valueNeeded) {
+    const size_t argumentCount = node->arguments.count;
+    const ValueType* arguments = values_.data() + values_.size() - argumentCount;
+    ValueType result = ValueType::None;
+
+    const Symbol* symbol = resolve(node->nameToken);
+    if (symbol && symbol->kind != SymbolKind::Function) {
+        report(node->nameToken, quoted(node->nameToken) + " is not a function");
+    }
+    else if (symbol) {
+        const NodeList<ParameterNode>& parameters = symbol->function->parameters;
+        result = symbol->type;
+        if (argumentCount != parameters.count) {
+            report(node->nameToken, "Function " + quoted(node->nameToken) + " expects "
+                + plural(parameters.count, "argument") + ", but " + std::to_string(argumentCount)
+                + (argumentCount == 1 ? " was" : " were") + " given");
+        }
+        else {
+            for (size_t i = 0; i < argumentCount; ++i) {
+                ValueType parameter = valueTypeOfKeyword(tokens_.type(parameters[i]->typeToken));
+                if (!converts(parameter, arguments[i])) {
+                    reportConversion(parameter, arguments[i], expressionToken(node->arguments[i]),
+                        "Argument " + std::to_string(i + 1) + " of " + quoted(node->nameToken));
+                }
+            }
+        }
+        if (result == ValueType::Void && valueNeeded) {
+            report(node->nameToken, "Void function " + quoted(node->nameToken) + " has no value to use");
+            result = ValueType::None;
+        }
+    }
+    values_.resize(values_.size() - argumentCount);
+    return result;
+}
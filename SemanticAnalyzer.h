@@ -0,0 +1,89 @@
+// SemanticAnalyzer.h
+#ifndef SEMANTICANALYZER_H
+#define SEMANTICANALYZER_H
+
+#include "AstNode.h"
+#include "Diagnostics.h"
+#include "SemanticInfo.h"
+#include "SymbolTable.h"
+#include "TokenBuffer.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// SemanticAnalyzer: The pass after parsing. It resolves every name to its
+// declaration and checks the program's types:
+//  - names: no use before declaration, no redefinition within a scope, and
+//    variables, arrays and functions each used as what they are;
+//  - assignments, initializers, call arguments and return values convert to
+//    the target type (int, char and float convert to each other, string only
+//    to string), operands suit their operator, conditions are numbers;
+//  - printf/scanf format strings: every conversion is one of %d %i %f %e %g
+//    %c %s, their number matches the arguments and each argument has the
+//    conversion's type (printf promotes char to int; scanf needs an exact match).
+//
+// Scoping is C's: globals, then all functions (so calls may precede the
+// callee's definition), then per function one scope for the parameters and the
+// body and one per nested block. Errors go to the Diagnostics sink; results go
+// to a SemanticInfo. Statements and expressions are walked with explicit
+// stacks, like the Parser builds them, so nesting depth is not limited by the
+// call stack.
+class SemanticAnalyzer {
+public:
+    SemanticAnalyzer(const TokenBuffer& tokens, Diagnostics& diagnostics, SemanticInfo& info);
+
+    // Checks a tree that parsed without errors. Returns false if it reported any.
+    bool analyze(const ProgramNode* program);
+
+    size_t errorCount() const { return errorCount_; }
+    size_t lookupCount() const { return lookupCount_; } // Name lookups made so far
+
+private:
+    // Work items of the statement walk: a statement to check, or a scope boundary.
+    enum class ScopeAction : uint8_t { None, Enter, Leave };
+    struct PendingStatement {
+        const StatementNode* node;
+        ScopeAction action;
+    };
+    struct PendingExpression {
+        const ExpressionNode* node;
+        bool expanded; // Its operands are checked; their types are on values_
+    };
+
+    const TokenBuffer& tokens_;
+    Diagnostics& diagnostics_;
+    SemanticInfo& info_;
+    SymbolTable symbols_;
+    const FunctionDefinitionNode* function_ = nullptr; // The function being checked
+    ValueType returnType_ = ValueType::Void;
+    size_t errorCount_ = 0;
+    size_t lookupCount_ = 0;
+    std::vector<PendingStatement> statements_;
+    std::vector<PendingExpression> expressions_;
+    std::vector<ValueType> values_; // Types of the checked operands of pending expressions
+
+    void declareFunction(const FunctionDefinitionNode* function);
+    void checkFunction(const FunctionDefinitionNode* function);
+    void pushBlock(NodeList<StatementNode> block);
+    void checkStatement(const StatementNode* statement);
+    void checkVariableDeclaration(const VariableDeclarationNode* node);
+    void checkArrayDeclaration(const ArrayDeclarationNode* node);
+    void checkReturn(const ReturnStatementNode* node);
+    void checkCondition(const ExpressionNode* condition);
+    void checkFormat(TokenIndex formatToken, const ExpressionNode* argument, bool isScanf);
+
+    // Type of an expression (ValueType::None after reporting an error in it).
+    // A void call is only allowed where no value is needed.
+    ValueType checkExpression(const ExpressionNode* root, bool valueNeeded = true);
+    ValueType checkLeaf(const ExpressionNode* node);
+    ValueType finishOperator(const ExpressionNode* node); // Operand types are on values_
+    ValueType finishCall(const CallNode* node, bool valueNeeded);
+
+    void declare(TokenIndex nameToken, SymbolKind kind, ValueType type, const FunctionDefinitionNode* function = nullptr);
+    const Symbol* resolve(TokenIndex nameToken); // Records the declaration; reports undeclared names
+    void reportConversion(ValueType to, ValueType from, TokenIndex at, const std::string& context);
+    void report(TokenIndex token, std::string message);
+    std::string quoted(TokenIndex token) const { return "'" + std::string(tokens_.lexeme(token)) + "'"; }
+};
+
+#endif // SEMANTICANALYZER_H
@@ -0,0 +1,70 @@
+// SemanticInfo.h
+#ifndef SEMANTICINFO_H
+#define SEMANTICINFO_H
+
+#include "AstNode.h"
+#include <cstdint>
+#include <vector>
+
+// The type of a value. Arrays have the type of their elements; whether a name
+// is an array is a property of its Symbol (see SymbolTable.h).
+enum class ValueType : uint8_t {
+    None,   // Not an expression, or an expression that already failed to check
+    Void,   // The "value" of a call to a void function
+    Int,
+    Float,
+    Char,
+    String,
+};
+
+inline const char* valueTypeToString(ValueType type) {
+    switch (type) {
+    case ValueType::Void: return "void";
+    case ValueType::Int: return "int";
+    case ValueType::Float: return "float";
+    case ValueType::Char: return "char";
+    case ValueType::String: return "string";
+    default: return "<error>";
+    }
+}
+
+// The type named by a type keyword (ValueType::None for any other token).
+inline ValueType valueTypeOfKeyword(TokenType keyword) {
+    switch (keyword) {
+    case TokenType::KEYWORD_VOID: return ValueType::Void;
+    case TokenType::KEYWORD_INT: return ValueType::Int;
+    case TokenType::KEYWORD_FLOAT: return ValueType::Float;
+    case TokenType::KEYWORD_CHAR: return ValueType::Char;
+    case TokenType::KEYWORD_STRING: return ValueType::String;
+    default: return ValueType::None;
+    }
+}
+
+// int, char and float convert to each other implicitly, as in C.
+inline bool isNumeric(ValueType type) {
+    return type == ValueType::Int || type == ValueType::Float || type == ValueType::Char;
+}
+inline bool isIntegral(ValueType type) {
+    return type == ValueType::Int || type == ValueType::Char;
+}
+
+// SemanticInfo: What the semantic pass learned about a tree, in two side
+// tables indexed by token (so the nodes stay as small as they are):
+//  - declarations[t]: for the name token t of a use or a declaration, the name
+//    token of the declaration it refers to (kNoToken elsewhere);
+//  - types[t]: for the key token t of an expression (see expressionToken), the
+//    type of its value (ValueType::None elsewhere).
+struct SemanticInfo {
+    std::vector<TokenIndex> declarations;
+    std::vector<ValueType> types;
+
+    void reset(size_t tokenCount) {
+        declarations.assign(tokenCount, kNoToken);
+        types.assign(tokenCount, ValueType::None);
+    }
+
+    TokenIndex declarationOf(TokenIndex name) const { return declarations[name]; }
+    ValueType typeOf(const ExpressionNode* node) const { return types[expressionToken(node)]; }
+};
+
+#endif // SEMANTICINFO_H
@@ -0,0 +1,135 @@
+// SourceBuffer.cpp
+#include "SourceBuffer.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+SourceBuffer::SourceBuffer(std::string name) : name_(std::move(name)) {
+}
+
+SourceBuffer::~SourceBuffer() {
+#ifndef _WIN32
+    if (mapping_) {
+        munmap(mapping_, size_);
+    }
+#endif
+}
+
+const LineIndex& SourceBuffer::lineIndex() const {
+    std::call_once(lineIndexOnce_, [this] { lineIndex_ = std::make_unique<LineIndex>(text()); });
+    return *lineIndex_;
+}
+
+void SourceBuffer::adoptString(std::string text) {
+    owned_ = std::move(text);
+    data_ = owned_.data();
+    size_ = owned_.size();
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromString(std::string text, std::string name) {
+    // The constructor is private, so std::make_shared cannot be used here.
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer(std::move(name)));
+    buffer->adoptString(std::move(text));
+    return buffer;
+}
+
+#ifndef _WIN32
+
+bool SourceBuffer::mapDescriptor(int fd, size_t length) {
+    if (length == 0) return false; // mmap() rejects empty mappings
+    void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) return false;
+#ifdef MADV_SEQUENTIAL
+    madvise(addr, length, MADV_SEQUENTIAL); // The lexer reads front to back exactly once
+#endif
+    mapping_ = addr;
+    data_ = static_cast<const char*>(addr);
+    size_ = length;
+    return true;
+}
+
+bool SourceBuffer::readDescriptor(int fd, size_t sizeHint) {
+    // One buffer sized from the hint; only streams that outgrow it are reallocated.
+    std::string text;
+    text.resize(sizeHint > 0 ? sizeHint : 64 * 1024);
+    size_t used = 0;
+    while (true) {
+        if (used == text.size()) {
+            text.resize(text.size() * 2);
+        }
+        ssize_t n = ::read(fd, &text[used], text.size() - used);
+        if (n < 0) {
+            if (errno == EINTR) continue; // Interrupted by a signal before reading anything
+            return false;
+        }
+        if (n == 0) break;
+        used += static_cast<size_t>(n);
+    }
+    text.resize(used);
+    adoptString(std::move(text));
+    return true;
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer(path));
+    struct stat st;
+    bool ok = false;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        ok = buffer->mapDescriptor(fd, static_cast<size_t>(st.st_size)) ||
+             buffer->readDescriptor(fd, static_cast<size_t>(st.st_size) + 1);
+    }
+    else {
+        ok = buffer->readDescriptor(fd, 0);
+    }
+    ::close(fd); // A mapping stays valid after its descriptor is closed
+    return ok ? buffer : nullptr;
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromStream(std::FILE* stream, std::string name) {
+    int fd = fileno(stream);
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer(std::move(name)));
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        // Redirected from a file: map what is left of it from the current offset.
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        if (offset == 0 && buffer->mapDescriptor(fd, static_cast<size_t>(st.st_size))) {
+            return buffer;
+        }
+        return buffer->readDescriptor(fd, static_cast<size_t>(st.st_size) + 1) ? buffer : nullptr;
+    }
+    return buffer->readDescriptor(fd, 0) ? buffer : nullptr;
+}
+
+#else // _WIN32: no mmap, read everything with a single preallocated read
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return nullptr;
+    std::string text(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(&text[0], static_cast<std::streamsize>(text.size()));
+    return fromString(std::move(text), path);
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromStream(std::FILE* stream, std::string name) {
+    std::string text(64 * 1024, '\0');
+    size_t used = 0;
+    while (size_t n = std::fread(&text[used], 1, text.size() - used, stream)) {
+        used += n;
+        if (used == text.size()) text.resize(text.size() * 2);
+    }
+    text.resize(used);
+    return fromString(std::move(text), std::move(name));
+}
+
+#endif
@@ -0,0 +1,64 @@
+// SourceBuffer.h
+#ifndef SOURCEBUFFER_H
+#define SOURCEBUFFER_H
+
+#include "LineIndex.h"
+#include <cstdint>
+#include <cstdio>      // For std::FILE
+#include <memory>      // For std::shared_ptr
+#include <mutex>       // For std::once_flag
+#include <string>
+#include <string_view>
+
+// SourceBuffer: Owns the bytes of one translation unit.
+// Tokens and AST nodes only hold std::string_view lexemes into this buffer,
+// so it is always shared through std::shared_ptr and kept alive by the Lexer
+// and by the ProgramNode that the Parser returns.
+//
+// The bytes either live in an owned std::string or in a read-only memory
+// mapping of the input file; the Lexer does not care which.
+class SourceBuffer {
+public:
+    // Takes ownership of an already loaded text.
+    static std::shared_ptr<const SourceBuffer> fromString(std::string text, std::string name);
+
+    // Maps a file read-only. Falls back to one read into a preallocated buffer
+    // when the file cannot be mapped. Returns nullptr if the file cannot be opened.
+    static std::shared_ptr<const SourceBuffer> fromFile(const std::string& path);
+
+    // Reads a whole stream (stdin, pipes). Regular files behind the stream are
+    // mapped like fromFile; everything else is read into one growing buffer.
+    static std::shared_ptr<const SourceBuffer> fromStream(std::FILE* stream, std::string name);
+
+    std::string_view text() const { return std::string_view(data_, size_); }
+    const std::string& name() const { return name_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool isMapped() const { return mapping_ != nullptr; }
+
+    // Line and column of a byte offset. The LineIndex is built on first use
+    // (thread-safe), so sources without diagnostics never pay for it.
+    const LineIndex& lineIndex() const;
+    void locate(uint32_t offset, int& line, int& column) const { lineIndex().locate(offset, line, column); }
+
+    ~SourceBuffer();
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+private:
+    explicit SourceBuffer(std::string name);
+
+    void adoptString(std::string text);
+    bool mapDescriptor(int fd, size_t length);
+    bool readDescriptor(int fd, size_t sizeHint);
+
+    std::string owned_;           // Used when the text is not mapped
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    void* mapping_ = nullptr;     // Start of the mmap()ed region, if any
+    std::string name_;
+    mutable std::once_flag lineIndexOnce_;
+    mutable std::unique_ptr<LineIndex> lineIndex_;
+};
+
+#endif // SOURCEBUFFER_H
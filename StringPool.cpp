@@ -0,0 +1,25 @@
+// StringPool.cpp
+#include "StringPool.h"
+#include <cstring>
+
+std::string_view StringPool::store(std::string_view bytes) {
+    if (bytes.empty()) return std::string_view();
+    if (bytes.size() > left_) {
+        // Oversized strings get a block of their own; the current block stays in use.
+        if (bytes.size() > kBlockSize / 4) {
+            blocks_.emplace_back(new char[bytes.size()]);
+            std::memcpy(blocks_.back().get(), bytes.data(), bytes.size());
+            bytesUsed_ += bytes.size();
+            return std::string_view(blocks_.back().get(), bytes.size());
+        }
+        blocks_.emplace_back(new char[kBlockSize]);
+        next_ = blocks_.back().get();
+        left_ = kBlockSize;
+    }
+    char* out = next_;
+    std::memcpy(out, bytes.data(), bytes.size());
+    next_ += bytes.size();
+    left_ -= bytes.size();
+    bytesUsed_ += bytes.size();
+    return std::string_view(out, bytes.size());
+}
@@ -0,0 +1,35 @@
+// StringPool.h
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// StringPool: Append-only storage for byte strings with stable addresses.
+// Bytes are copied into large blocks, so storing a short string costs no
+// allocation of its own, and views returned by store() stay valid for the
+// lifetime of the pool (moving the pool keeps them valid too).
+class StringPool {
+public:
+    StringPool() = default;
+    StringPool(StringPool&&) noexcept = default;
+    StringPool& operator=(StringPool&&) noexcept = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    std::string_view store(std::string_view bytes);
+
+    size_t bytesUsed() const { return bytesUsed_; }
+
+private:
+    static const size_t kBlockSize = 16 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* next_ = nullptr;   // Free space in the current block
+    size_t left_ = 0;
+    size_t bytesUsed_ = 0;
+};
+
+#endif // STRINGPOOL_H
@@ -0,0 +1,46 @@
+// SymbolTable.cpp
+#include "SymbolTable.h"
+
+namespace {
+const size_t kInitialSlots = 256;
+}
+
+SymbolTable::SymbolTable() : slots_(kInitialSlots, Slot{ kNoSymbol, kNoEntry }) {
+}
+
+void SymbolTable::leaveScope() {
+    uint32_t mark = marks_.back();
+    marks_.pop_back();
+    while (symbols_.size() > mark) {
+        const Symbol& symbol = symbols_.back();
+        slots_[findSlot(symbol.name)].innermost = symbol.shadowed;
+        symbols_.pop_back();
+    }
+}
+
+const Symbol* SymbolTable::declare(SymbolId name, SymbolKind kind, ValueType type, TokenIndex declaration,
+    const FunctionDefinitionNode* function) {
+    size_t slot = findSlot(name);
+    uint32_t shadowed = slots_[slot].innermost;
+    if (shadowed != kNoEntry && symbols_[shadowed].scope == depth()) {
+        return &symbols_[shadowed];
+    }
+    if (slots_[slot].name == kNoSymbol) {
+        slots_[slot].name = name;
+        if (++claimed_ * 2 > slots_.size()) {
+            grow();
+            slot = findSlot(name);
+        }
+    }
+    slots_[slot].innermost = static_cast<uint32_t>(symbols_.size());
+    symbols_.push_back(Symbol{ name, kind, type, declaration, depth(), shadowed, function });
+    return nullptr;
+}
+
+void SymbolTable::grow() {
+    std::vector<Slot> old(slots_.size() * 2, Slot{ kNoSymbol, kNoEntry });
+    old.swap(slots_);
+    for (const Slot& slot : old) {
+        if (slot.name != kNoSymbol) slots_[findSlot(slot.name)] = slot;
+    }
+}
@@ -0,0 +1,84 @@
+// SymbolTable.h
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include "AstNode.h"
+#include "Interner.h"
+#include "SemanticInfo.h"
+#include <cstdint>
+#include <vector>
+
+enum class SymbolKind : uint8_t {
+    Variable,  // A global or local scalar
+    Parameter,
+    Array,     // `type` is the element type
+    Function,  // `type` is the return type
+};
+
+struct Symbol {
+    SymbolId name;
+    SymbolKind kind;
+    ValueType type;
+    TokenIndex declaration; // Name token of the declaration
+    uint32_t scope;         // Nesting depth of the declaring scope (0 = globals)
+    uint32_t shadowed;      // The symbol of the same name this one hides (SymbolTable::kNoEntry if none)
+    const FunctionDefinitionNode* function; // SymbolKind::Function only
+};
+
+// SymbolTable: All symbols visible at one point of a tree walk, in one flat
+// open-addressing table keyed by the interned name, so a lookup is one integer
+// hash and a short probe whatever the nesting depth.
+//
+// Declared symbols are kept on a stack. A table slot holds the innermost
+// symbol of its name, and each symbol links to the one it shadows. Entering a
+// scope pushes the current stack height onto a mark stack; leaving it pops the
+// symbols above the mark and points their slots back at what they shadowed.
+// Scopes therefore allocate nothing, entering one is O(1) and leaving one costs
+// O(1) per symbol declared in it. A slot stays with its name once claimed
+// (there are never tombstones); the table grows only with the number of
+// distinct names declared.
+class SymbolTable {
+public:
+    static const uint32_t kNoEntry = ~0u;
+
+    SymbolTable();
+
+    void enterScope() { marks_.push_back(static_cast<uint32_t>(symbols_.size())); }
+    void leaveScope();
+    uint32_t depth() const { return static_cast<uint32_t>(marks_.size()); }
+
+    // Declares a symbol in the innermost scope. Returns nullptr, or the symbol
+    // of the same name already declared in that scope (nothing is declared).
+    const Symbol* declare(SymbolId name, SymbolKind kind, ValueType type, TokenIndex declaration,
+        const FunctionDefinitionNode* function = nullptr);
+    // The innermost visible symbol called `name`, or nullptr. The pointer is
+    // valid until the next declare() or leaveScope().
+    const Symbol* lookup(SymbolId name) const {
+        uint32_t entry = slots_[findSlot(name)].innermost;
+        return entry == kNoEntry ? nullptr : &symbols_[entry];
+    }
+
+    size_t size() const { return symbols_.size(); } // Symbols currently visible or shadowed
+
+private:
+    struct Slot {
+        SymbolId name;      // kNoSymbol for an unclaimed slot
+        uint32_t innermost; // Index into symbols_, kNoEntry while the name is out of scope
+    };
+
+    // The slot of `name`, or the unclaimed slot where it would go.
+    size_t findSlot(SymbolId name) const {
+        size_t mask = slots_.size() - 1;
+        size_t i = (name * 0x9E3779B9u) & mask; // Odd multiplier: a run of dense IDs lands in distinct slots
+        while (slots_[i].name != name && slots_[i].name != kNoSymbol) i = (i + 1) & mask;
+        return i;
+    }
+    void grow();
+
+    std::vector<Slot> slots_; // Power-of-two size, at most half claimed
+    size_t claimed_ = 0;
+    std::vector<Symbol> symbols_;
+    std::vector<uint32_t> marks_; // symbols_.size() at each open scope
+};
+
+#endif // SYMBOLTABLE_H
@@ -0,0 +1,244 @@
+// TextScan.cpp
+#include "TextScan.h"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#define TEXTSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace textscan {
+namespace {
+
+// --- Scalar reference versions (also used for the tails of the vector loops) ---
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+const char* skipBlanksScalar(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+const char* findByteScalar(const char* p, const char* end, char c) {
+    const void* hit = std::memchr(p, c, static_cast<size_t>(end - p));
+    return hit ? static_cast<const char*>(hit) : end;
+}
+
+const char* findCommentCloseScalar(const char* p, const char* end) {
+    while (p + 1 < end) {
+        if (p[0] == '*' && p[1] == '/') return p;
+        ++p;
+    }
+    return end;
+}
+
+size_t countNewlinesScalar(const char* p, const char* end) {
+    size_t count = 0;
+    for (; p < end; ++p) count += (*p == '\n');
+    return count;
+}
+
+void collectNewlinesScalar(const char* begin, const char* end, uint32_t base, std::vector<uint32_t>& offsets) {
+    for (const char* p = begin; p < end; ++p) {
+        if (*p == '\n') offsets.push_back(base + static_cast<uint32_t>(p - begin));
+    }
+}
+
+#ifdef TEXTSCAN_X86
+
+// --- SSE2: 16 bytes per step ---
+
+const char* skipBlanksSse2(const char* p, const char* end) {
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r'), nl = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, nl)));
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(blank)) & 0xFFFFu;
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return skipBlanksScalar(p, end);
+}
+
+const char* findByteSse2(const char* p, const char* end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return findByteScalar(p, end, c);
+}
+
+const char* findCommentCloseSse2(const char* p, const char* end) {
+    const __m128i star = _mm_set1_epi8('*'), slash = _mm_set1_epi8('/');
+    // Compare the block against '*' and the block shifted by one against '/'.
+    while (end - p >= 17) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, star), _mm_cmpeq_epi8(b, slash))));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return findCommentCloseScalar(p, end);
+}
+
+size_t countNewlinesSse2(const char* p, const char* end) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t count = 0;
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        count += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)))));
+        p += 16;
+    }
+    return count + countNewlinesScalar(p, end);
+}
+
+void collectNewlinesSse2(const char* begin, const char* end, uint32_t base, std::vector<uint32_t>& offsets) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const char* p = begin;
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+        while (mask) { // One iteration per newline, not per byte
+            offsets.push_back(base + static_cast<uint32_t>(p - begin) + static_cast<uint32_t>(__builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+        p += 16;
+    }
+    collectNewlinesScalar(p, end, base + static_cast<uint32_t>(p - begin), offsets);
+}
+
+// --- AVX2: 32 bytes per step, compiled for AVX2 only in these functions ---
+
+__attribute__((target("avx2")))
+const char* skipBlanksAvx2(const char* p, const char* end) {
+    const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r'), nl = _mm256_set1_epi8('\n');
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i blank = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, nl)));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(blank));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return skipBlanksSse2(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* findByteAvx2(const char* p, const char* end, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return findByteSse2(p, end, c);
+}
+
+__attribute__((target("avx2")))
+const char* findCommentCloseAvx2(const char* p, const char* end) {
+    const __m256i star = _mm256_set1_epi8('*'), slash = _mm256_set1_epi8('/');
+    while (end - p >= 33) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, star), _mm256_cmpeq_epi8(b, slash))));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return findCommentCloseSse2(p, end);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t countNewlinesAvx2(const char* p, const char* end) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    size_t count = 0;
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        count += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)))));
+        p += 32;
+    }
+    return count + countNewlinesSse2(p, end);
+}
+
+__attribute__((target("avx2")))
+void collectNewlinesAvx2(const char* begin, const char* end, uint32_t base, std::vector<uint32_t>& offsets) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const char* p = begin;
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+        while (mask) {
+            offsets.push_back(base + static_cast<uint32_t>(p - begin) + static_cast<uint32_t>(__builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+        p += 32;
+    }
+    collectNewlinesSse2(p, end, base + static_cast<uint32_t>(p - begin), offsets);
+}
+
+#endif // TEXTSCAN_X86
+
+struct Implementation {
+    const char* (*skipBlanks)(const char*, const char*);
+    const char* (*findByte)(const char*, const char*, char);
+    const char* (*findCommentClose)(const char*, const char*);
+    size_t (*countNewlines)(const char*, const char*);
+    void (*collectNewlines)(const char*, const char*, uint32_t, std::vector<uint32_t>&);
+    const char* name;
+};
+
+Implementation select() {
+#ifdef TEXTSCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return { skipBlanksAvx2, findByteAvx2, findCommentCloseAvx2, countNewlinesAvx2, collectNewlinesAvx2, "avx2" };
+    }
+    return { skipBlanksSse2, findByteSse2, findCommentCloseSse2, countNewlinesSse2, collectNewlinesSse2, "sse2" };
+#else
+    return { skipBlanksScalar, findByteScalar, findCommentCloseScalar, countNewlinesScalar, collectNewlinesScalar, "scalar" };
+#endif
+}
+
+// Chosen once, before main() runs.
+const Implementation impl = select();
+
+} // namespace
+
+const char* skipBlanks(const char* begin, const char* end) {
+    // Most gaps between tokens are a single space; do not pay for a vector load on those.
+    if (begin < end && !isBlank(*begin)) return begin;
+    if (begin + 1 < end && !isBlank(begin[1])) return begin + 1;
+    return impl.skipBlanks(begin, end);
+}
+
+const char* findByte(const char* begin, const char* end, char c) {
+    return impl.findByte(begin, end, c);
+}
+
+const char* findCommentClose(const char* begin, const char* end) {
+    return impl.findCommentClose(begin, end);
+}
+
+size_t countNewlines(const char* begin, const char* end) {
+    return impl.countNewlines(begin, end);
+}
+
+void collectNewlines(const char* begin, const char* end, uint32_t base, std::vector<uint32_t>& offsets) {
+    impl.collectNewlines(begin, end, base, offsets);
+}
+
+const char* implementationName() {
+    return impl.name;
+}
+
+} // namespace textscan
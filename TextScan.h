@@ -0,0 +1,36 @@
+// TextScan.h
+#ifndef TEXTSCAN_H
+#define TEXTSCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bulk byte scanning used by the Lexer to jump over whitespace and comments.
+// Each function works on the half-open range [begin, end). On x86 the
+// implementation is picked once at runtime: AVX2 (32 bytes per step) when the
+// CPU supports it, otherwise SSE2 (16 bytes per step). Other targets use the
+// scalar versions.
+namespace textscan {
+
+// First byte in [begin, end) that is not ' ', '\t', '\r' or '\n' (end if none).
+const char* skipBlanks(const char* begin, const char* end);
+
+// First occurrence of `c` in [begin, end) (end if none).
+const char* findByte(const char* begin, const char* end, char c);
+
+// Start of the first "*/" that begins in [begin, end) (end if none).
+const char* findCommentClose(const char* begin, const char* end);
+
+// Number of '\n' bytes in [begin, end), counted with popcount over whole blocks.
+size_t countNewlines(const char* begin, const char* end);
+
+// Appends `base + (p - begin)` for every '\n' at p in [begin, end) to `offsets`.
+void collectNewlines(const char* begin, const char* end, uint32_t base, std::vector<uint32_t>& offsets);
+
+// Name of the selected implementation ("avx2", "sse2" or "scalar").
+const char* implementationName();
+
+} // namespace textscan
+
+#endif // TEXTSCAN_H
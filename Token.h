@@ -1,9 +1,11 @@
-#pragma onc// Token.h
+// Token.h
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include "Interner.h"
+#include <cstdint>
 #include <string>
-#include <variant> // C++17, for token values (optional, can start with just string lexeme)
+#include <string_view>
 
 
 // TokenType: Defines all possible types of tokens our lexer can produce.
@@ -63,6 +65,7 @@ enum class TokenType {
     KEYWORD_SHORT, KEYWORD_SIGNED, KEYWORD_SIZEOF, 
     KEYWORD_SWITCH, KEYWORD_TYPEDEF, KEYWORD_UNION,
     KEYWORD_UNSIGNED,  KEYWORD_VOLATILE, 
+    KEYWORD_STRING, KEYWORD_SCANF, KEYWORD_PRINTF, // Base type and I/O statements of the grammar
 
 
     // Special tokens
@@ -73,20 +76,54 @@ enum class TokenType {
 // Helper function to convert TokenType to a printable string (useful for debugging)
 std::string tokenTypeToString(TokenType type);
 
+// LiteralValue: The decoded value of a literal token, filled in once by the Lexer.
+// Strings without escapes view the source text between the quotes; escaped
+// strings view a StringPool owned by the Lexer or TokenBuffer that made the token.
+struct LiteralValue {
+    enum class Kind : uint8_t { None, Integer, Float, Double, Char, String };
+
+    Kind kind;
+    union {
+        long long integer;
+        float floatValue;
+        double doubleValue;
+        char charValue;
+        struct { const char* data; uint32_t size; } string;
+    };
+
+    LiteralValue() : kind(Kind::None), integer(0) {}
+
+    static LiteralValue ofInteger(long long v) { LiteralValue l; l.kind = Kind::Integer; l.integer = v; return l; }
+    static LiteralValue ofFloat(float v) { LiteralValue l; l.kind = Kind::Float; l.floatValue = v; return l; }
+    static LiteralValue ofDouble(double v) { LiteralValue l; l.kind = Kind::Double; l.doubleValue = v; return l; }
+    static LiteralValue ofChar(char v) { LiteralValue l; l.kind = Kind::Char; l.charValue = v; return l; }
+    static LiteralValue ofString(std::string_view v) {
+        LiteralValue l;
+        l.kind = Kind::String;
+        l.string.data = v.data();
+        l.string.size = static_cast<uint32_t>(v.size());
+        return l;
+    }
+
+    std::string_view stringValue() const { return std::string_view(string.data, string.size); }
+};
+
 // Token: Represents a single lexical unit.
 struct Token {
     TokenType type;         // The type of the token
-    std::string lexeme;     // The actual character sequence from the source
-    // std::variant<std::monostate, int, double, std::string> literal_value; // Optional: store parsed literal value
-    int line;               // Line number where the token begins
-    int column;             // Column number where the token begins
+    std::string_view lexeme; // View of the character sequence in the SourceBuffer (no copy)
+    LiteralValue value;     // Decoded value for literal tokens (Kind::None for everything else)
+    uint32_t offset;        // Byte offset of the token in the source; line/column come from
+                            // SourceBuffer::locate() only when a diagnostic needs them
+    SymbolId symbol = kNoSymbol; // Interned name of an IDENTIFIER (see Interner.h)
 
     // Constructor
-    Token(TokenType type, std::string lexeme, int line, int column)
-        : type(type), lexeme(std::move(lexeme)), line(line), column(column) {}
+    // The lexeme is not owned: it must point into a SourceBuffer that outlives the token.
+    Token(TokenType type, std::string_view lexeme, uint32_t offset)
+        : type(type), lexeme(lexeme), offset(offset) {}
 
     // Default constructor for cases like uninitialized token
-    Token() : type(TokenType::UNKNOWN), lexeme(""), line(0), column(0) {}
+    Token() : type(TokenType::UNKNOWN), lexeme(), offset(0) {}
 };
 
-#endif // TOKEN_He
+#endif // TOKEN_H
@@ -0,0 +1,101 @@
+// TokenBuffer.cpp
+#include "TokenBuffer.h"
+#include <cstring>
+
+TokenBuffer::TokenBuffer(std::shared_ptr<const SourceBuffer> source)
+    : source_(std::move(source)), text_(source_->text()) {
+}
+
+void TokenBuffer::reserve(size_t capacity) {
+    if (capacity <= capacity_) return;
+
+    // One block holds all four arrays; the 4-byte columns come first to keep them aligned.
+    std::unique_ptr<unsigned char[]> storage(new unsigned char[capacity * (3 * sizeof(uint32_t) + sizeof(uint8_t))]);
+    uint32_t* offsets = reinterpret_cast<uint32_t*>(storage.get());
+    uint32_t* lengths = offsets + capacity;
+    uint32_t* payloads = lengths + capacity;
+    uint8_t* types = reinterpret_cast<uint8_t*>(payloads + capacity);
+    if (size_ > 0) {
+        std::memcpy(offsets, offsets_, size_ * sizeof(uint32_t));
+        std::memcpy(lengths, lengths_, size_ * sizeof(uint32_t));
+        std::memcpy(payloads, payloads_, size_ * sizeof(uint32_t));
+        std::memcpy(types, types_, size_ * sizeof(uint8_t));
+    }
+    storage_ = std::move(storage);
+    offsets_ = offsets;
+    lengths_ = lengths;
+    payloads_ = payloads;
+    types_ = types;
+    capacity_ = capacity;
+}
+
+uint32_t TokenBuffer::addLiteral(LiteralValue value) {
+    if (value.kind == LiteralValue::Kind::String) {
+        std::string_view bytes = value.stringValue();
+        bool inSource = bytes.data() >= text_.data() && bytes.data() + bytes.size() <= text_.data() + text_.size();
+        if (!inSource) {
+            value = LiteralValue::ofString(strings_.store(bytes));
+        }
+    }
+    literals_.push_back(value);
+    return static_cast<uint32_t>(literals_.size());
+}
+
+void TokenBuffer::push(const Token& token) {
+    uint32_t payload = token.type == TokenType::IDENTIFIER ? token.symbol + 1
+        : token.value.kind == LiteralValue::Kind::None ? 0 : addLiteral(token.value);
+    push(token.type, token.offset, static_cast<uint32_t>(token.lexeme.size()), payload);
+}
+
+void TokenBuffer::appendColumns(const void* offsets, const void* lengths, const void* types, size_t count) {
+    if (size_ + count > capacity_) reserve(size_ + count);
+    std::memcpy(offsets_ + size_, offsets, count * sizeof(uint32_t));
+    std::memcpy(lengths_ + size_, lengths, count * sizeof(uint32_t));
+    std::memcpy(types_ + size_, types, count * sizeof(uint8_t));
+    std::memset(payloads_ + size_, 0, count * sizeof(uint32_t));
+    size_ += count;
+}
+
+void TokenBuffer::internIdentifiers(Interner& interner) {
+    for (size_t i = 0; i < size_; ++i) {
+        if (payloads_[i] == 0 && types_[i] == static_cast<uint8_t>(TokenType::IDENTIFIER)) {
+            payloads_[i] = interner.intern(lexeme(i)) + 1;
+        }
+    }
+}
+
+void TokenBuffer::append(const TokenBuffer& other, size_t from, size_t to, int64_t offsetDelta) {
+    if (from >= to) return;
+    size_t count = to - from;
+    if (size_ + count > capacity_) reserve(size_ + count + capacity_ / 2);
+    std::memcpy(lengths_ + size_, other.lengths_ + from, count * sizeof(uint32_t));
+    std::memcpy(types_ + size_, other.types_ + from, count * sizeof(uint8_t));
+    if (offsetDelta == 0) {
+        std::memcpy(offsets_ + size_, other.offsets_ + from, count * sizeof(uint32_t));
+    }
+    else {
+        for (size_t i = 0; i < count; ++i) {
+            offsets_[size_ + i] = static_cast<uint32_t>(other.offsets_[from + i] + offsetDelta);
+        }
+    }
+
+    // Literal payloads index the other buffer's literal table: re-home the values.
+    // Symbol IDs are the same in both buffers.
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t payload = other.payloads_[from + i];
+        if (payload != 0 && isLiteral(other.type(from + i))) {
+            LiteralValue value = other.literals_[payload - 1];
+            if (value.kind == LiteralValue::Kind::String && other.text_.data() != text_.data()) {
+                // Unescaped strings view the other text; the same bytes sit at the shifted offset here.
+                std::string_view bytes = value.stringValue();
+                if (bytes.data() >= other.text_.data() && bytes.data() <= other.text_.data() + other.text_.size()) {
+                    size_t at = static_cast<size_t>(bytes.data() - other.text_.data() + offsetDelta);
+                    value = LiteralValue::ofString(text_.substr(at, bytes.size()));
+                }
+            }
+            payload = addLiteral(value);
+        }
+        payloads_[size_ + i] = payload;
+    }
+    size_ += count;
+}
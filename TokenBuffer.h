@@ -0,0 +1,103 @@
+// TokenBuffer.h
+#ifndef TOKENBUFFER_H
+#define TOKENBUFFER_H
+
+#include "Token.h"
+#include "SourceBuffer.h"
+#include "StringPool.h"
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// TokenBuffer: The whole token stream of one source in struct-of-arrays form.
+// Each token costs 13 bytes (uint8 type, uint32 offset, uint32 length and a
+// uint32 payload) and all four arrays live in one allocation, sized up front
+// from the byte count of the source. The Parser reads it by index, which
+// gives sequential access and arbitrary lookahead for free.
+// The payload of a literal token is 1 + its index in a side table of decoded
+// LiteralValues; that of an IDENTIFIER is 1 + its SymbolId (0 until interned);
+// it is 0 for every other token.
+// Offsets are 32-bit, so a single source is limited to 4 GiB.
+class TokenBuffer {
+public:
+    explicit TokenBuffer(std::shared_ptr<const SourceBuffer> source);
+
+    TokenBuffer(TokenBuffer&&) noexcept = default;
+    TokenBuffer& operator=(TokenBuffer&&) noexcept = default;
+    TokenBuffer(const TokenBuffer&) = delete;
+    TokenBuffer& operator=(const TokenBuffer&) = delete;
+
+    // Expected token count for a source of `bytes` bytes (about one token per 4 bytes).
+    static size_t estimateTokenCount(size_t bytes) { return bytes / 4 + 16; }
+
+    void reserve(size_t capacity);
+    void push(TokenType type, uint32_t offset, uint32_t length, uint32_t payload = 0) {
+        if (size_ == capacity_) reserve(capacity_ + capacity_ / 2 + 16);
+        types_[size_] = static_cast<uint8_t>(type);
+        offsets_[size_] = offset;
+        lengths_[size_] = length;
+        payloads_[size_] = payload;
+        ++size_;
+    }
+    void push(const Token& token);
+    // Bulk load of saved columns (see AstCache): appends `count` tokens without
+    // literal values; setLiteral() then attaches them.
+    void appendColumns(const void* offsets, const void* lengths, const void* types, size_t count);
+    void setLiteral(size_t index, LiteralValue value) { payloads_[index] = addLiteral(value); }
+    // Interns every IDENTIFIER that has no symbol yet (tokens lexed without an
+    // interner, or loaded from a cache entry: IDs are not stable across runs).
+    void internIdentifiers(Interner& interner);
+    // Appends tokens [from, to) of another buffer, adding `offsetDelta` to their
+    // offsets (used when the other buffer lexed an older version of the text).
+    void append(const TokenBuffer& other, size_t from, size_t to, int64_t offsetDelta = 0);
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    TokenType type(size_t index) const { return static_cast<TokenType>(types_[index]); }
+    uint32_t offset(size_t index) const { return offsets_[index]; }
+    uint32_t length(size_t index) const { return lengths_[index]; }
+    std::string_view lexeme(size_t index) const { return text_.substr(offsets_[index], lengths_[index]); }
+    LiteralValue literal(size_t index) const {
+        return isLiteral(type(index)) && payloads_[index] ? literals_[payloads_[index] - 1] : LiteralValue();
+    }
+    // The interned name of an IDENTIFIER token (kNoSymbol for other tokens).
+    SymbolId symbol(size_t index) const {
+        return type(index) == TokenType::IDENTIFIER ? payloads_[index] - 1 : kNoSymbol;
+    }
+
+    Token token(size_t index) const {
+        Token token(type(index), lexeme(index), offsets_[index]);
+        token.value = literal(index);
+        token.symbol = symbol(index);
+        return token;
+    }
+
+    const std::shared_ptr<const SourceBuffer>& source() const { return source_; }
+
+    // Token types whose payload is a literal (the *_LITERAL types are contiguous).
+    static bool isLiteral(TokenType type) {
+        return type >= TokenType::STRING_LITERAL && type <= TokenType::DOUBLE_LITERAL;
+    }
+
+private:
+    // Stores a literal value, copying escaped string bytes into strings_ unless
+    // they already live in this buffer's source text.
+    uint32_t addLiteral(LiteralValue value);
+
+    std::shared_ptr<const SourceBuffer> source_;
+    std::string_view text_;
+    std::unique_ptr<unsigned char[]> storage_; // offsets_ | lengths_ | payloads_ | types_
+    uint32_t* offsets_ = nullptr;
+    uint32_t* lengths_ = nullptr;
+    uint32_t* payloads_ = nullptr;
+    uint8_t* types_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    std::vector<LiteralValue> literals_;
+    StringPool strings_;
+};
+
+#endif // TOKENBUFFER_H
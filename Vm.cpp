@@ -0,0 +1,350 @@
+// Vm.cpp
+#include "Vm.h"
+#include <cstring>
+
+namespace {
+
+std::string outOfBounds(int32_t index, intptr_t size) {
+    return "Array index " + std::to_string(index) + " is out of bounds (size " + std::to_string(size) + ")";
+}
+
+} // namespace
+
+Vm::Vm(const BytecodeProgram& program, Dispatch dispatch)
+    : program_(program),
+      dispatch_(hasThreadedDispatch() ? dispatch : Dispatch::Switch),
+      stack_(new Value[kStackSlots]),
+      frames_(new Frame[kMaxCallDepth]),
+      scanBuffer_(new char[kMaxScanfString + 1]) {
+    cells_.resize(program.code.size());
+    for (size_t pc = 0; pc < program.code.size(); ++pc) {
+        cells_[pc].operand = static_cast<int32_t>(program.code[pc]);
+    }
+}
+
+bool Vm::run() {
+    globals_.assign(program_.globalCount, Value{});
+    exitStatus_ = 0;
+    errorMessage_.clear();
+    errorOffset_ = 0;
+    if (program_.startDepth > kStackSlots) {
+        errorMessage_ = "Stack overflow while initializing globals";
+        return false;
+    }
+    return dispatch_ == Dispatch::Threaded ? execute<true>() : execute<false>();
+}
+
+bool Vm::scan(const char* format, IoKind kind, Value* target) {
+    switch (kind) {
+    case IoKind::Int: {
+        int value;
+        if (std::fscanf(input_, format, &value) != 1) return false;
+        target->i = value;
+        return true;
+    }
+    case IoKind::Float: {
+        float value;
+        if (std::fscanf(input_, format, &value) != 1) return false;
+        target->f = value;
+        return true;
+    }
+    case IoKind::Char: {
+        char value;
+        if (std::fscanf(input_, format, &value) != 1) return false;
+        target->i = static_cast<signed char>(value);
+        return true;
+    }
+    case IoKind::String: {
+        // The compiler bounded the width by kMaxScanfString.
+        if (std::fscanf(input_, format, scanBuffer_.get()) != 1) return false;
+        target->s = strings_.store(std::string_view(scanBuffer_.get(), std::strlen(scanBuffer_.get()) + 1)).data();
+        return true;
+    }
+    }
+    return false;
+}
+
+// One body for both dispatch modes. VM_NEXT(n) skips n operand cells and runs
+// the next instruction: with kThreaded by jumping to the handler address in its
+// opcode cell, otherwise by going back to the switch. A failed scanf leaves
+// its target unchanged, as in C.
+template <bool kThreaded>
+bool Vm::execute() {
+#if VM_COMPUTED_GOTO
+    static const void* const kHandlers[] = {
+#define VM_HANDLER_ADDRESS(name, operands, effect) &&op_##name,
+        BYTECODE_OP_LIST(VM_HANDLER_ADDRESS)
+#undef VM_HANDLER_ADDRESS
+    };
+    if (kThreaded && !translated_) {
+        for (size_t pc = 0; pc < cells_.size(); pc += 1 + kOpOperandCount[program_.code[pc]]) {
+            cells_[pc].handler = kHandlers[program_.code[pc]];
+        }
+        translated_ = true;
+    }
+    else if (!kThreaded && translated_) {
+        for (size_t pc = 0; pc < cells_.size(); pc += 1 + kOpOperandCount[program_.code[pc]]) {
+            cells_[pc].operand = program_.code[pc];
+        }
+        translated_ = false;
+    }
+#define VM_DISPATCH() do { if (kThreaded) goto *(pc++)->handler; else goto dispatch; } while (0)
+#define VM_CASE(name) case Op::name: op_##name:
+#else
+#define VM_DISPATCH() goto dispatch
+#define VM_CASE(name) case Op::name:
+#endif
+#define VM_NEXT(operands) do { pc += (operands); VM_DISPATCH(); } while (0)
+#define VM_FAIL(message) do { errorMessage_ = (message); goto fail; } while (0)
+
+    const Cell* const code = cells_.data();
+    const Cell* pc = code;
+    Value* sp = stack_.get();
+    Value* bp = sp;
+    Value* const stackEnd = stack_.get() + kStackSlots;
+    Frame* fp = frames_.get();
+    Frame* const framesEnd = frames_.get() + kMaxCallDepth;
+    Value* const globals = globals_.data();
+    const Value* const constants = program_.constants.data();
+    const BytecodeFunction* const functions = program_.functions.data();
+
+    VM_DISPATCH();
+dispatch:
+    switch (static_cast<Op>((pc++)->operand)) {
+    VM_CASE(Halt) {
+        if (program_.mainReturnsValue) exitStatus_ = sp[-1].i;
+        return true;
+    }
+    VM_CASE(Pop) { --sp; VM_NEXT(0); }
+    VM_CASE(Dup) { *sp = sp[-1]; ++sp; VM_NEXT(0); }
+    VM_CASE(PushInt) { (sp++)->i = static_cast<int32_t>(pc[0].operand); VM_NEXT(1); }
+    VM_CASE(PushConst) { *sp++ = constants[pc[0].operand]; VM_NEXT(1); }
+    VM_CASE(LoadLocal) { *sp++ = bp[pc[0].operand]; VM_NEXT(1); }
+    VM_CASE(StoreLocal) { bp[pc[0].operand] = *--sp; VM_NEXT(1); }
+    VM_CASE(LoadGlobal) { *sp++ = globals[pc[0].operand]; VM_NEXT(1); }
+    VM_CASE(StoreGlobal) { globals[pc[0].operand] = *--sp; VM_NEXT(1); }
+
+    // Arrays: operand 0 is the first slot, operand 1 the length. The index is
+    // compared as unsigned, so a negative one is out of bounds too.
+    VM_CASE(LoadLocalElem) {
+        int32_t index = sp[-1].i;
+        if (static_cast<uint32_t>(index) >= static_cast<uint32_t>(pc[1].operand)) VM_FAIL(outOfBounds(index, pc[1].operand));
+        sp[-1] = bp[pc[0].operand + index];
+        VM_NEXT(2);
+    }
+    VM_CASE(StoreLocalElem) {
+        int32_t index = sp[-2].i;
+        if (static_cast<uint32_t>(index) >= static_cast<uint32_t>(pc[1].operand)) VM_FAIL(outOfBounds(index, pc[1].operand));
+        bp[pc[0].operand + index] = sp[-1];
+        sp -= 2;
+        VM_NEXT(2);
+    }
+    VM_CASE(LoadGlobalElem) {
+        int32_t index = sp[-1].i;
+        if (static_cast<uint32_t>(index) >= static_cast<uint32_t>(pc[1].operand)) VM_FAIL(outOfBounds(index, pc[1].operand));
+        sp[-1] = globals[pc[0].operand + index];
+        VM_NEXT(2);
+    }
+    VM_CASE(StoreGlobalElem) {
+        int32_t index = sp[-2].i;
+        if (static_cast<uint32_t>(index) >= static_cast<uint32_t>(pc[1].operand)) VM_FAIL(outOfBounds(index, pc[1].operand));
+        globals[pc[0].operand + index] = sp[-1];
+        sp -= 2;
+        VM_NEXT(2);
+    }
+    VM_CASE(FillLocal) {
+        Value value = *--sp;
+        for (Value *slot = bp + pc[0].operand, *end = slot + pc[1].operand; slot != end; ++slot) *slot = value;
+        VM_NEXT(2);
+    }
+    VM_CASE(FillGlobal) {
+        Value value = *--sp;
+        for (Value *slot = globals + pc[0].operand, *end = slot + pc[1].operand; slot != end; ++slot) *slot = value;
+        VM_NEXT(2);
+    }
+    VM_CASE(AddrLocal) { (sp++)->ref = bp + pc[0].operand; VM_NEXT(1); }
+    VM_CASE(AddrGlobal) { (sp++)->ref = globals + pc[0].operand; VM_NEXT(1); }
+    VM_CASE(AddrLocalElem) {
+        int32_t index = sp[-1].i;
+        if (static_cast<uint32_t>(index) >= static_cast<uint32_t>(pc[1].operand)) VM_FAIL(outOfBounds(index, pc[1].operand));
+        sp[-1].ref = bp + pc[0].operand + index;
+        VM_NEXT(2);
+    }
+    VM_CASE(AddrGlobalElem) {
+        int32_t index = sp[-1].i;
+        if (static_cast<uint32_t>(index) >= static_cast<uint32_t>(pc[1].operand)) VM_FAIL(outOfBounds(index, pc[1].operand));
+        sp[-1].ref = globals + pc[0].operand + index;
+        VM_NEXT(2);
+    }
+    VM_CASE(IncLocal) {
+        Value& slot = bp[pc[0].operand];
+        slot.i = wrapInt(static_cast<uint32_t>(slot.i) + static_cast<uint32_t>(pc[1].operand));
+        VM_NEXT(2);
+    }
+    VM_CASE(IncGlobal) {
+        Value& slot = globals[pc[0].operand];
+        slot.i = wrapInt(static_cast<uint32_t>(slot.i) + static_cast<uint32_t>(pc[1].operand));
+        VM_NEXT(2);
+    }
+
+#define VM_INT_BINARY(name, expression) \
+    VM_CASE(name) { uint32_t a = static_cast<uint32_t>(sp[-2].i), b = static_cast<uint32_t>(sp[-1].i); \
+        (void)a; (void)b; sp[-2].i = (expression); --sp; VM_NEXT(0); }
+    VM_INT_BINARY(AddI, wrapInt(a + b))
+    VM_INT_BINARY(SubI, wrapInt(a - b))
+    VM_INT_BINARY(MulI, wrapInt(a * b))
+    VM_INT_BINARY(ShlI, wrapInt(a << (b & 31)))
+    VM_INT_BINARY(ShrI, sp[-2].i >> (b & 31)) // Arithmetic shift
+    VM_INT_BINARY(AndI, wrapInt(a & b))
+    VM_INT_BINARY(OrI, wrapInt(a | b))
+    VM_INT_BINARY(XorI, wrapInt(a ^ b))
+    VM_INT_BINARY(LtI, sp[-2].i < sp[-1].i)
+    VM_INT_BINARY(LeI, sp[-2].i <= sp[-1].i)
+    VM_INT_BINARY(GtI, sp[-2].i > sp[-1].i)
+    VM_INT_BINARY(GeI, sp[-2].i >= sp[-1].i)
+    VM_INT_BINARY(EqI, a == b)
+    VM_INT_BINARY(NeI, a != b)
+#undef VM_INT_BINARY
+    // INT_MIN / -1 wraps to INT_MIN (and INT_MIN % -1 is 0) instead of trapping.
+    VM_CASE(DivI) {
+        int32_t a = sp[-2].i, b = sp[-1].i;
+        if (b == 0) VM_FAIL("Division by zero");
+        sp[-2].i = b == -1 ? wrapInt(0u - static_cast<uint32_t>(a)) : a / b;
+        --sp;
+        VM_NEXT(0);
+    }
+    VM_CASE(ModI) {
+        int32_t a = sp[-2].i, b = sp[-1].i;
+        if (b == 0) VM_FAIL("Remainder by zero");
+        sp[-2].i = b == -1 ? 0 : a % b;
+        --sp;
+        VM_NEXT(0);
+    }
+    VM_CASE(NegI) { sp[-1].i = wrapInt(0u - static_cast<uint32_t>(sp[-1].i)); VM_NEXT(0); }
+    VM_CASE(NotI) { sp[-1].i = sp[-1].i == 0; VM_NEXT(0); }
+    VM_CASE(BitNotI) { sp[-1].i = ~sp[-1].i; VM_NEXT(0); }
+    VM_CASE(BoolI) { sp[-1].i = sp[-1].i != 0; VM_NEXT(0); }
+
+#define VM_FLOAT_BINARY(name, member, operator) \
+    VM_CASE(name) { sp[-2].member = sp[-2].f operator sp[-1].f; --sp; VM_NEXT(0); }
+    VM_FLOAT_BINARY(AddF, f, +)
+    VM_FLOAT_BINARY(SubF, f, -)
+    VM_FLOAT_BINARY(MulF, f, *)
+    VM_FLOAT_BINARY(DivF, f, /)
+    VM_FLOAT_BINARY(LtF, i, <)
+    VM_FLOAT_BINARY(LeF, i, <=)
+    VM_FLOAT_BINARY(GtF, i, >)
+    VM_FLOAT_BINARY(GeF, i, >=)
+    VM_FLOAT_BINARY(EqF, i, ==)
+    VM_FLOAT_BINARY(NeF, i, !=)
+#undef VM_FLOAT_BINARY
+    VM_CASE(NegF) { sp[-1].f = -sp[-1].f; VM_NEXT(0); }
+    VM_CASE(NotF) { sp[-1].i = sp[-1].f == 0.0; VM_NEXT(0); }
+    VM_CASE(BoolF) { sp[-1].i = sp[-1].f != 0.0; VM_NEXT(0); }
+    VM_CASE(IToF) { sp[-1].f = sp[-1].i; VM_NEXT(0); }
+    VM_CASE(FToI) { sp[-1].i = floatToInt(sp[-1].f); VM_NEXT(0); }
+    VM_CASE(IToC) { sp[-1].i = static_cast<signed char>(sp[-1].i); VM_NEXT(0); }
+
+    // Jump operands are absolute code offsets.
+    VM_CASE(Jump) { pc = code + pc[0].operand; VM_DISPATCH(); }
+    VM_CASE(JumpIfFalse) {
+        if ((--sp)->i == 0) pc = code + pc[0].operand;
+        else ++pc;
+        VM_DISPATCH();
+    }
+    VM_CASE(JumpIfTrue) {
+        if ((--sp)->i != 0) pc = code + pc[0].operand;
+        else ++pc;
+        VM_DISPATCH();
+    }
+    VM_CASE(JumpFalseOrPop) {
+        if (sp[-1].i == 0) {
+            pc = code + pc[0].operand;
+        }
+        else {
+            --sp;
+            ++pc;
+        }
+        VM_DISPATCH();
+    }
+    VM_CASE(JumpTrueOrPop) {
+        if (sp[-1].i != 0) {
+            pc = code + pc[0].operand;
+        }
+        else {
+            --sp;
+            ++pc;
+        }
+        VM_DISPATCH();
+    }
+#define VM_COMPARE_JUMP(name, operator) \
+    VM_CASE(name) { sp -= 2; \
+        if (sp[0].i operator sp[1].i) pc = code + pc[0].operand; else ++pc; \
+        VM_DISPATCH(); }
+    VM_COMPARE_JUMP(JumpIfLtI, <)
+    VM_COMPARE_JUMP(JumpIfLeI, <=)
+    VM_COMPARE_JUMP(JumpIfGtI, >)
+    VM_COMPARE_JUMP(JumpIfGeI, >=)
+    VM_COMPARE_JUMP(JumpIfEqI, ==)
+    VM_COMPARE_JUMP(JumpIfNeI, !=)
+#undef VM_COMPARE_JUMP
+
+    // The arguments on top of the stack become the callee's first slots.
+    VM_CASE(Call) {
+        const BytecodeFunction& callee = functions[pc[0].operand];
+        Value* frame = sp - callee.paramCount;
+        if (fp == framesEnd || callee.frameSize > static_cast<size_t>(stackEnd - frame)) {
+            VM_FAIL("Stack overflow in call to '" + std::string(callee.name) + "'");
+        }
+        *fp++ = Frame{ pc + 1, bp };
+        bp = frame;
+        sp = frame + callee.localCount;
+        pc = code + callee.entry;
+        VM_DISPATCH();
+    }
+    VM_CASE(Return) {
+        --fp;
+        sp = bp;
+        bp = fp->bp;
+        pc = fp->returnPc;
+        VM_DISPATCH();
+    }
+    VM_CASE(ReturnValue) {
+        Value result = sp[-1];
+        --fp;
+        sp = bp;
+        *sp++ = result;
+        bp = fp->bp;
+        pc = fp->returnPc;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(PrintText) { std::fputs(constants[pc[0].operand].s, output_); VM_NEXT(1); }
+    VM_CASE(Printf) {
+        const char* format = constants[pc[0].operand].s;
+        Value argument = *--sp;
+        switch (static_cast<IoKind>(pc[1].operand)) {
+        case IoKind::Float: std::fprintf(output_, format, argument.f); break;
+        case IoKind::String: std::fprintf(output_, format, argument.s); break;
+        default: std::fprintf(output_, format, argument.i); break;
+        }
+        VM_NEXT(2);
+    }
+    VM_CASE(Scanf) {
+        Value* target = (--sp)->ref;
+        scan(constants[pc[0].operand].s, static_cast<IoKind>(pc[1].operand), target);
+        VM_NEXT(2);
+    }
+    }
+    errorMessage_ = "Invalid opcode";
+
+fail:
+    // pc is one past the opcode of the failing instruction.
+    errorOffset_ = program_.sourceOffsetAt(static_cast<uint32_t>(pc - 1 - code));
+    return false;
+
+#undef VM_FAIL
+#undef VM_NEXT
+#undef VM_CASE
+#undef VM_DISPATCH
+}
@@ -0,0 +1,88 @@
+// Vm.h
+#ifndef VM_H
+#define VM_H
+
+#include "Bytecode.h"
+#include "StringPool.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Computed goto ("labels as values") is a GNU extension; other compilers
+// always use the switch loop.
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+
+// Vm: Runs a BytecodeProgram.
+//
+// All values live on one contiguous stack: a call's arguments become the
+// first slots of the callee's frame, its locals follow, and its operands are
+// pushed above them, so calling copies nothing and every frame access is
+// bp[slot]. Frames record only where to return and the caller's bp.
+//
+// The code is translated once into cells of the size of a pointer. With
+// Dispatch::Threaded every opcode cell holds the address of its handler and
+// each handler ends by jumping straight to the next one (direct threading);
+// Dispatch::Switch keeps opcode numbers and goes through one switch. Both run
+// the same handler bodies, so they only differ in how they dispatch.
+//
+// Run-time errors (division by zero, an array index out of bounds, too deep a
+// recursion) stop the program; errorMessage() and errorOffset() (a source
+// offset) describe them. printf and scanf go through the C library's.
+class Vm {
+public:
+    enum class Dispatch : uint8_t { Threaded, Switch };
+    static bool hasThreadedDispatch() { return VM_COMPUTED_GOTO != 0; }
+
+    static const size_t kStackSlots = size_t(1) << 22; // 32 MB of values
+    static const size_t kMaxCallDepth = size_t(1) << 18;
+
+    // Threaded falls back to Switch where computed goto is unavailable.
+    explicit Vm(const BytecodeProgram& program, Dispatch dispatch = Dispatch::Threaded);
+
+    void setOutput(FILE* output) { output_ = output; }
+    void setInput(FILE* input) { input_ = input; }
+
+    // Runs the program from the start. Returns false on a run-time error.
+    bool run();
+
+    Dispatch dispatch() const { return dispatch_; }
+    int exitStatus() const { return exitStatus_; } // main's value, or 0 for void main
+    const std::string& errorMessage() const { return errorMessage_; }
+    uint32_t errorOffset() const { return errorOffset_; }
+
+private:
+    union Cell {
+        const void* handler;
+        intptr_t operand;
+    };
+    struct Frame {
+        const Cell* returnPc;
+        Value* bp;
+    };
+
+    const BytecodeProgram& program_;
+    Dispatch dispatch_;
+    std::vector<Cell> cells_;
+    bool translated_ = false; // Opcode cells hold handler addresses
+    std::unique_ptr<Value[]> stack_;
+    std::unique_ptr<Frame[]> frames_;
+    std::vector<Value> globals_;
+    StringPool strings_;      // Strings read by scanf
+    std::unique_ptr<char[]> scanBuffer_;
+    FILE* output_ = stdout;
+    FILE* input_ = stdin;
+    int exitStatus_ = 0;
+    std::string errorMessage_;
+    uint32_t errorOffset_ = 0;
+
+    template <bool kThreaded>
+    bool execute();
+    bool scan(const char* format, IoKind kind, Value* target);
+};
+
+#endif // VM_H
@@ -2,65 +2,1299 @@
 #include "Lexer.h"
 #include "Parser.h" // Include Parser
 #include "AstNode.h"  // Include AstNode for ProgramNode
+#include "AstVisitor.h"
+#include "AstPrinter.h"
+#include "AstCache.h"
+#include "CompilationUnit.h"
+#include "SourceBuffer.h"
+#include "ParallelLexer.h"
+#include "ParallelParser.h"
+#include "SemanticAnalyzer.h"
+#include "BytecodeCompiler.h"
+#include "Vm.h"
+#include "IrBuilder.h"
+#include "PassManager.h"
+#include "IrInterpreter.h"
+#include "Keywords.h"
+#include "IncrementalLexer.h"
+#include "Bench.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <map>
+#include <random>
 #include <string>
+#include <thread>
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] [file | -]\n"
+        << "  file                 source file to compile (memory-mapped)\n"
+        << "  -                    read the source from stdin\n"
+        << "  --dump-source        echo the source code before parsing\n"
+        << "  --lexer=table|reference\n"
+        << "                       lexer core to use (default: table)\n"
+        << "  --check-lexer        lex with both cores and compare the token streams\n"
+        << "  --check-relex[=N]    apply N (default 2000) random edits to the input and\n"
+        << "                       check each incremental re-lex against a full one\n"
+        << "  --streaming          let the parser pull tokens one at a time instead of\n"
+        << "                       lexing the whole input into a token buffer first\n"
+        << "  --lex-threads=N      lex large inputs on N threads (0 = all cores, default 1)\n"
+        << "  --parse-threads=N    parse the functions of large inputs on N threads\n"
+        << "                       (0 = all cores, default 1)\n"
+        << "  --ast-format=text|json|none\n"
+        << "                       how to print the AST on stdout (default: text);\n"
+        << "                       json prints nothing but the tree\n"
+        << "  --ast-cache=DIR      reuse the tokens and AST of unchanged sources from DIR\n"
+        << "                       (keyed by a hash of the source; filled on a miss)\n"
+        << "  --run                compile the program to bytecode and run it; the exit\n"
+        << "                       status is main's return value (1 on a run-time error)\n"
+        << "  --dump-bytecode      print the compiled bytecode on stdout\n"
+        << "  --vm-dispatch=threaded|switch\n"
+        << "                       how the VM dispatches instructions (default: threaded\n"
+        << "                       where the compiler supports computed goto)\n"
+        << "  --dump-ir            print the SSA IR after the passes on stdout\n"
+        << "  -O0|-O1|-O2          IR optimization level (default: -O0); -O1 propagates\n"
+        << "                       constants and removes dead code, -O2 also numbers values\n"
+        << "                       and optimizes loops (licm, unroll, strength-reduction)\n"
+        << "  --passes=LIST        comma-separated IR passes to run, in order, instead of\n"
+        << "                       those of the -O level\n"
+        << "  --disable-passes=LIST\n"
+        << "                       leave the comma-separated passes out of the pipeline\n"
+        << "  --run-ir             build and optimize the IR and interpret it; the exit\n"
+        << "                       status is main's return value (1 on a run-time error)\n"
+        << "  --time-passes        report the time and instruction count change of\n"
+        << "                       building the IR and of each pass on stderr\n"
+        << "  --time               report the wall time of each phase on stderr\n"
+        << "  --ast-stats          report the AST arena's allocations and node sizes on stderr\n"
+        << "  --bench-expressions[=N]\n"
+        << "                       parse generated N-term expressions (default 100000)\n"
+        << "                       of several shapes and report the throughput\n"
+        << "  --bench-keywords     classify a keyword- and identifier-dense word list with\n"
+        << "                       the perfect hash and with a std::map and report both times\n"
+        << "  --bench-visitors[=N] walk the AST N times (default 100) with the virtual\n"
+        << "                       visitor and the static walker and report both times\n"
+        << "  --bench-lex-threads  lex the input with 1, 2, 4, ... threads up to the core\n"
+        << "                       count, report the throughput of each and check the\n"
+        << "                       tokens against the sequential lexer's\n"
+        << "  --bench-parse-threads\n"
+        << "                       parse the input with 1, 2, 4, ... threads up to the\n"
+        << "                       core count and report the time and speedup of each\n"
+        << "  --bench-semantic[=N] check generated programs with N (default 5000) nested\n"
+        << "                       or sibling blocks and report the name lookup rate\n"
+        << "  --bench-vm           run generated loop-, array- and call-heavy programs with\n"
+        << "                       both VM dispatch modes and report their times\n"
+        << "  --bench-opt          build generated programs at -O0, -O1 and -O2 and report\n"
+        << "                       the pass time and the instructions built and executed\n"
+        << "  --bench-loops        build generated loops at -O2 with and without each loop\n"
+        << "                       pass and report the instructions and multiplies executed\n"
+        << "  --check-opt          build the --bench-opt and --bench-loops programs at every\n"
+        << "                       -O level and loop pass configuration and check that each\n"
+        << "                       build prints what the VM prints\n";
+}
+
+// Node counters for --bench-visitors, one per traversal form. Both sum the
+// node kinds so the walk cannot be optimized away.
+class CountingVisitor : public AstVisitor {
+public:
+    size_t nodes = 0;
+    size_t checksum = 0;
+#define COUNTING_VISITOR_METHOD(Name)                                   \
+    void visit##Name(const Name##Node* node) override {                 \
+        ++nodes;                                                        \
+        checksum += static_cast<size_t>(node->kind);                    \
+        AstVisitor::visit##Name(node);                                  \
+    }
+    AST_NODE_LIST(COUNTING_VISITOR_METHOD)
+#undef COUNTING_VISITOR_METHOD
+};
+
+class CountingWalker : public AstWalker<CountingWalker> {
+public:
+    size_t nodes = 0;
+    size_t checksum = 0;
+#define COUNTING_WALKER_METHOD(Name)                                    \
+    void visit##Name(const Name##Node* node) {                          \
+        ++nodes;                                                        \
+        checksum += static_cast<size_t>(node->kind);                    \
+        visitChildren(node);                                            \
+    }
+    AST_NODE_LIST(COUNTING_WALKER_METHOD)
+#undef COUNTING_WALKER_METHOD
+};
+
+// Walks the tree `rounds` times with the virtual visitor and with the CRTP walker.
+static void benchmarkVisitors(const ProgramNode* program, unsigned rounds) {
+    CountingVisitor visitor;
+    Clock::time_point start = Clock::now();
+    for (unsigned round = 0; round < rounds; ++round) visitor.visit(program);
+    double virtualMs = millisecondsSince(start);
+
+    CountingWalker walker;
+    start = Clock::now();
+    for (unsigned round = 0; round < rounds; ++round) walker.walk(program);
+    double staticMs = millisecondsSince(start);
+
+    size_t nodesPerRound = rounds ? visitor.nodes / rounds : 0;
+    std::cerr << "visit: " << nodesPerRound << " nodes x " << rounds << " rounds" << std::endl;
+    std::cerr << "visit: virtual AstVisitor " << virtualMs << " ms (checksum " << visitor.checksum << ")" << std::endl;
+    std::cerr << "visit: static AstWalker  " << staticMs << " ms (checksum " << walker.checksum << ")" << std::endl;
+}
+
+// Classifies a generated word list, half keywords and half identifiers (many
+// of them a keyword's length or prefix), with lookupKeyword and with the
+// std::map the lexer used before, and reports the lookup rate of both.
+static void benchmarkKeywords() {
+    static const char* const kIdentifiers[] = {
+        "i", "x", "count", "index", "in", "whilex", "form", "integer", "voids", "chart",
+        "returned", "do_", "ifs", "elsewhere", "buffer", "length", "printf_", "sum", "tmp", "next",
+    };
+    std::map<std::string, TokenType, std::less<>> keywords;
+    for (const keyword_detail::Entry& entry : keyword_detail::kKeywords) {
+        keywords.emplace(std::string(entry.spelling), entry.type);
+    }
+    const size_t identifierCount = sizeof(kIdentifiers) / sizeof(kIdentifiers[0]);
+    std::vector<std::string_view> words;
+    for (size_t i = 0; i < 1000000; ++i) {
+        words.push_back(i % 2 ? keyword_detail::kKeywords[i / 2 % keyword_detail::kKeywordCount].spelling
+                              : std::string_view(kIdentifiers[i / 2 % identifierCount]));
+    }
+
+    const unsigned rounds = 20;
+    size_t hashSum = 0;
+    Clock::time_point start = Clock::now();
+    for (unsigned round = 0; round < rounds; ++round) {
+        for (std::string_view word : words) hashSum += static_cast<size_t>(lookupKeyword(word));
+    }
+    double hashMs = millisecondsSince(start);
+
+    size_t mapSum = 0;
+    start = Clock::now();
+    for (unsigned round = 0; round < rounds; ++round) {
+        for (std::string_view word : words) {
+            auto found = keywords.find(word);
+            mapSum += static_cast<size_t>(found != keywords.end() ? found->second : TokenType::IDENTIFIER);
+        }
+    }
+    double mapMs = millisecondsSince(start);
+
+    const double lookups = static_cast<double>(words.size()) * rounds;
+    std::cerr << "keywords: " << words.size() << " words x " << rounds << " rounds" << std::endl;
+    std::cerr << "keywords: perfect hash " << hashMs << " ms (" << (hashMs > 0 ? lookups / hashMs / 1000.0 : 0.0)
+        << " M lookups/s)" << std::endl;
+    std::cerr << "keywords: std::map     " << mapMs << " ms (" << (mapMs > 0 ? lookups / mapMs / 1000.0 : 0.0)
+        << " M lookups/s, " << (hashMs > 0 ? mapMs / hashMs : 0.0) << "x)"
+        << (hashSum == mapSum ? "" : ", results differ!") << std::endl;
+}
+
+// Parses generated sources with `terms`-term expressions of different shapes and
+// reports the parse throughput of each. The expression parser keeps explicit
+// stacks, so none of these may overflow the call stack.
+static void benchmarkExpressions(unsigned terms) {
+    static const char* const kOperators[] = { " + ", " * ", " - ", " / ", " << ", " & ", " || ", " == " };
+    Workload shapes[6] = { { "long chain", "" }, { "nested parentheses", "" }, { "nested operators", "" }, { "prefix chain", "" },
+        { "nested indices", "" }, { "nested calls", "" } };
+    for (Workload& shape : shapes) shape.text = "void f() { x = ";
+    for (unsigned i = 0; i < terms; ++i) {
+        std::string number = std::to_string(i % 1000);
+        shapes[0].text += (i ? kOperators[i % 8] : "") + number;
+        shapes[1].text += '(';
+        shapes[2].text += number + kOperators[i % 8] + "(";
+        shapes[3].text += "- ";
+        shapes[4].text += "a[";
+        shapes[5].text += "g(" + number + ", ";
+    }
+    for (size_t i = 1; i < 6; ++i) shapes[i].text += "1";
+    shapes[1].text.append(terms, ')');
+    shapes[2].text.append(terms, ')');
+    shapes[4].text.append(terms, ']');
+    shapes[5].text.append(terms, ')');
+    for (Workload& shape : shapes) shape.text += "; }\n";
+
+    runWorkloads("expr", shapes, sizeof(shapes) / sizeof(shapes[0]), [&](const Workload& shape, std::ostream& report) {
+        auto source = SourceBuffer::fromString(shape.text, shape.name);
+        Lexer lexer(source);
+        TokenBuffer tokens = lexer.getAllTokens();
+        Arena arena;
+        Diagnostics diagnostics;
+        Clock::time_point start = Clock::now();
+        Parser(tokens, arena, diagnostics).parseProgram();
+        double ms = millisecondsSince(start);
+        report << " " << terms << " terms, " << tokens.size() << " tokens in "
+            << ms << " ms (" << (ms > 0 ? tokens.size() / ms / 1000.0 : 0.0) << " M tokens/s)";
+        return true;
+    });
+}
+
+// Runs the semantic pass over generated programs whose blocks nest `depth`
+// deep (declaring a variable per level, or shadowing a single name at every
+// level) or sit side by side, and reports the lookup throughput of each.
+static void benchmarkSemantics(unsigned depth) {
+    Workload shapes[3] = { { "nested blocks", "" }, { "shadowing", "" }, { "sibling blocks", "" } };
+    for (Workload& shape : shapes) shape.text = "int g = 1;\nint x = 0;\nvoid main() {\n";
+    for (unsigned i = 0; i < depth; ++i) {
+        std::string name = "v" + std::to_string(i);
+        std::string outer = i ? "v" + std::to_string(i - 1) : "g";
+        shapes[0].text += "int " + name + " = " + outer + " + g; if (" + name + " > " + outer + ") {\n";
+        shapes[1].text += "int x = x + 1; while (x < g) {\n";
+        shapes[2].text += "if (g > " + std::to_string(i % 100) + ") { int a = g; int b = a * 2; g = b - a; }\n";
+    }
+    shapes[0].text.append(depth, '}');
+    shapes[1].text.append(depth, '}');
+    for (Workload& shape : shapes) shape.text += "\n}\n";
+
+    runWorkloads("semantic", shapes, sizeof(shapes) / sizeof(shapes[0]), [&](const Workload& shape, std::ostream& report) {
+        auto source = SourceBuffer::fromString(shape.text, shape.name);
+        TokenBuffer tokens = Lexer(source).getAllTokens();
+        Arena arena;
+        Diagnostics diagnostics;
+        ProgramNode* program = Parser(tokens, arena, diagnostics).parseProgram();
+        SemanticInfo info;
+        SemanticAnalyzer analyzer(tokens, diagnostics, info);
+        Clock::time_point start = Clock::now();
+        analyzer.analyze(program);
+        double ms = millisecondsSince(start);
+        report << " " << depth << " blocks, " << analyzer.lookupCount() << " lookups in "
+            << ms << " ms (" << (ms > 0 ? analyzer.lookupCount() / ms / 1000.0 : 0.0) << " M lookups/s)"
+            << (diagnostics.empty() ? "" : " with errors");
+        return true;
+    });
+}
+
+// Lexes, parses, checks and compiles a generated program; false on any error.
+static bool compileProgram(const std::string& text, const char* name, BytecodeProgram& program) {
+    CompilationUnit unit(SourceBuffer::fromString(text, name));
+    if (!checkProgram(unit)) return false;
+    BytecodeCompiler compiler(unit.tokens, unit.semantics);
+    if (!compiler.compile(unit.program, program)) {
+        std::cerr << "Error: " << compiler.error() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Runs generated programs dominated by loops and int arithmetic, by array
+// accesses (a sieve over a global array, a bubble sort of a local one) and by
+// calls (recursive Fibonacci) under both dispatch modes, checks that their
+// output agrees and reports the times.
+static void benchmarkVm() {
+    const Workload workloads[] = {
+        { "loop", "int main() {\n"
+            "  int i; int sum = 0;\n"
+            "  for (i = 0; i < 20000000; i++) {\n"
+            "    sum = sum + i * 3 % 7;\n"
+            "    if (sum > 1000000) { sum = sum - 1000000; }\n"
+            "  }\n"
+            "  printf(\"%d\\n\", sum);\n"
+            "  return 0;\n"
+            "}\n" },
+        { "arrays", "int flags[2000000];\n"
+            "int main() {\n"
+            "  int i; int j; int count = 0; int a[3000];\n"
+            "  for (i = 2; i < 2000000; i++) { flags[i] = 1; }\n"
+            "  for (i = 2; i < 2000000; i++) {\n"
+            "    if (flags[i]) { count++; j = i + i; while (j < 2000000) { flags[j] = 0; j = j + i; } }\n"
+            "  }\n"
+            "  for (i = 0; i < 3000; i++) { a[i] = i * 7919 % 3000; }\n"
+            "  for (i = 0; i < 3000; i++) {\n"
+            "    for (j = 0; j + 1 < 3000 - i; j++) {\n"
+            "      if (a[j] > a[j + 1]) { int t = a[j]; a[j] = a[j + 1]; a[j + 1] = t; }\n"
+            "    }\n"
+            "  }\n"
+            "  printf(\"%d\\n\", count + a[1500]);\n"
+            "  return 0;\n"
+            "}\n" },
+        { "calls", "int fib(int n) {\n"
+            "  if (n < 2) { return n; }\n"
+            "  return fib(n - 1) + fib(n - 2);\n"
+            "}\n"
+            "int main() {\n"
+            "  printf(\"%d\\n\", fib(30));\n"
+            "  return 0;\n"
+            "}\n" },
+    };
+
+    runWorkloads("vm", workloads, sizeof(workloads) / sizeof(workloads[0]), [](const Workload& workload, std::ostream& report) {
+        BytecodeProgram program;
+        if (!compileProgram(workload.text, workload.name, program)) return false;
+        double ms[2] = { 0, 0 };
+        std::string output[2];
+        const Vm::Dispatch modes[2] = { Vm::Dispatch::Switch, Vm::Dispatch::Threaded };
+        for (int mode = 0; mode < 2; ++mode) {
+            Vm vm(program, modes[mode]);
+            std::FILE* capture = std::tmpfile();
+            if (capture) vm.setOutput(capture);
+            Clock::time_point start = Clock::now();
+            bool ok = vm.run();
+            ms[mode] = millisecondsSince(start);
+            if (capture) output[mode] = readCapture(capture);
+            if (!ok) output[mode] += "error: " + vm.errorMessage();
+        }
+        report << " switch " << ms[0] << " ms, threaded " << ms[1] << " ms";
+        if (!Vm::hasThreadedDispatch()) report << " (computed goto unavailable: both use the switch)";
+        else report << " (" << (ms[1] > 0 ? ms[0] / ms[1] : 0.0) << "x)";
+        if (output[0] != output[1]) report << ", outputs differ!";
+        return true;
+    });
+}
+
+// Programs made of what the scalar passes remove: constant expressions and
+// branches, recomputed subexpressions and values nobody uses, and divisions
+// that are unused but must still trap on a zero divisor.
+static const Workload kOptimizerWorkloads[] = {
+    { "constants", "int main() {\n"
+        "  int i; int sum = 0; int width = 16; int height = 9; int debug = 0;\n"
+        "  for (i = 0; i < 200000; i++) {\n"
+        "    int area = width * height;\n"
+        "    int scale = area / 4 % 7 + (1 << 3);\n"
+        "    if (debug) { printf(\"%d\\n\", i); }\n"
+        "    sum = sum + i % scale + area - 144;\n"
+        "    if (sum > 1000000) { sum = sum - 1000000; }\n"
+        "  }\n"
+        "  printf(\"%d\\n\", sum);\n"
+        "  return 0;\n"
+        "}\n" },
+    { "subexpressions", "int data[1000];\n"
+        "int main() {\n"
+        "  int i; int j; int total = 0;\n"
+        "  for (i = 0; i < 1000; i++) { data[i] = i * 37 % 101; }\n"
+        "  for (j = 0; j < 200; j++) {\n"
+        "    for (i = 0; i < 1000; i++) {\n"
+        "      int x = data[i];\n"
+        "      int y = x * j + (x - j) * 3;\n"
+        "      int z = x * j + (x - j) * 3 + (j + x) * 2;\n"
+        "      total = total + (y ^ z) % 1000 + (x + j) * 2;\n"
+        "    }\n"
+        "  }\n"
+        "  printf(\"%d\\n\", total);\n"
+        "  return 0;\n"
+        "}\n" },
+    { "dead code", "int square(int x) { return x * x; }\n"
+        "int main() {\n"
+        "  int i; int kept = 0;\n"
+        "  for (i = 0; i < 200000; i++) {\n"
+        "    int unused = i * i + 7;\n"
+        "    int alsoUnused = unused / 3 + unused % 5;\n"
+        "    int mask = i & 0;\n"
+        "    if (mask != 0) { kept = kept + square(i); }\n"
+        "    kept = kept + (i ^ mask) - (i - i);\n"
+        "  }\n"
+        "  printf(\"%d\\n\", kept);\n"
+        "  return 0;\n"
+        "}\n" },
+    { "floats", "float rate = 1.5;\n"
+        "int main() {\n"
+        "  int i; float x = 0.0; float step = 2.0 * 0.25;\n"
+        "  for (i = 0; i < 200000; i++) { x = x + step * 4.0 - rate + i % 3; }\n"
+        "  printf(\"%f\\n\", x);\n"
+        "  return 0;\n"
+        "}\n" },
+    { "calls", "int fib(int n) {\n"
+        "  if (n < 2) { return n; }\n"
+        "  return fib(n - 1) + fib(n - 2);\n"
+        "}\n"
+        "int main() {\n"
+        "  printf(\"%d\\n\", fib(22));\n"
+        "  return 0;\n"
+        "}\n" },
+    { "divisions", "int main() {\n"
+        "  int i; int zero = 0; int sum = 0; float half = 0.5;\n"
+        "  for (i = 0; i < 200000; i++) {\n"
+        "    int unused = i / 3 + i % 7;\n"
+        "    float ratio = i / half;\n"
+        "    sum = (sum + i % 5) % 100003;\n"
+        "  }\n"
+        "  printf(\"%d\\n\", sum);\n"
+        "  int lost = sum / zero;\n"
+        "  return 0;\n"
+        "}\n" },
+};
+
+// Builds generated programs at -O0, -O1 and -O2 and interprets each build:
+// reports the time spent building and optimizing the IR, the instructions
+// built and executed, and whether every level printed what the VM prints.
+static void benchmarkOptimizer() {
+    const size_t count = sizeof(kOptimizerWorkloads) / sizeof(kOptimizerWorkloads[0]);
+    runWorkloads("opt", kOptimizerWorkloads, count, [](const Workload& workload, std::ostream& report) {
+        CompilationUnit unit(SourceBuffer::fromString(workload.text, workload.name));
+        if (!checkProgram(unit)) return false;
+        const std::string expected = vmOutput(unit);
+
+        bool agree = true;
+        for (unsigned level = 0; level <= 2; ++level) {
+            IrModule module;
+            PassManager passes;
+            passes.setVerify(false);
+            passes.addList(PassManager::pipeline(level));
+            Clock::time_point start = Clock::now();
+            if (!IrBuilder(unit.tokens, unit.semantics).build(unit.program, module) || !passes.run(module)) {
+                report << " -O" << level << " failed";
+                agree = false;
+                continue;
+            }
+            double ms = millisecondsSince(start);
+
+            IrInterpreter interpreter(module);
+            agree = agree && interpreterOutput(interpreter) == expected;
+            report << (level ? ";" : "") << " -O" << level << " " << module.instructionCount() << " built, "
+                << ms << " ms, " << interpreter.executedInstructions() << " executed";
+        }
+        report << (agree ? " (outputs agree with the VM)" : ", outputs differ!");
+        return true;
+    });
+}
+
+// Programs made of what the loop passes work on: invariant expressions, array
+// indices scaled by a loop counter and short loops, and invariant divisions
+// that may trap and so must stay where they are.
+static const Workload kLoopWorkloads[] = {
+    { "invariants", "int width = 37; int height = 11;\n"
+        "int main() {\n"
+        "  int i; int j; int sum = 0;\n"
+        "  for (j = 0; j < 100; j++) {\n"
+        "    for (i = 0; i < 2000; i++) {\n"
+        "      int area = width * height + j * 3;\n"
+        "      sum = (sum + i % (width - 30) + area / 7) & 65535;\n"
+        "    }\n"
+        "  }\n"
+        "  printf(\"%d\\n\", sum);\n"
+        "  return 0;\n"
+        "}\n" },
+    { "array indices", "int grid[4096];\n"
+        "int main() {\n"
+        "  int round; int row; int column; int sum = 0;\n"
+        "  for (round = 0; round < 40; round++) {\n"
+        "    for (row = 0; row < 64; row++) {\n"
+        "      for (column = 0; column < 64; column++) {\n"
+        "        grid[row * 64 + column] = grid[column * 64 + row] + round;\n"
+        "      }\n"
+        "    }\n"
+        "  }\n"
+        "  for (row = 0; row < 4096; row++) { sum = (sum + grid[row]) % 100003; }\n"
+        "  printf(\"%d\\n\", sum);\n"
+        "  return 0;\n"
+        "}\n" },
+    { "short loops", "int main() {\n"
+        "  int coefficients[4]; int i; int k; int sum = 0;\n"
+        "  for (k = 0; k < 4; k++) { coefficients[k] = k * 2 + 1; }\n"
+        "  for (i = 0; i < 50000; i++) {\n"
+        "    int acc = 0;\n"
+        "    for (k = 0; k < 4; k++) { acc = acc * 3 + coefficients[k] * (i + k); }\n"
+        "    sum = (sum + acc) % 1000003;\n"
+        "  }\n"
+        "  printf(\"%d\\n\", sum);\n"
+        "  return 0;\n"
+        "}\n" },
+    { "guarded divisions", "int divisor = 0;\n"
+        "int main() {\n"
+        "  int i; int j; int sum = 0; float half = 0.5;\n"
+        "  for (j = 0; j < 20000; j++) {\n"
+        "    for (i = 0; i < j % 4; i++) {\n"
+        "      if (divisor != 0) { sum = sum + j / divisor; }\n"
+        "      int scaled = j / half;\n"
+        "      sum = (sum + scaled + i) % 100003;\n"
+        "    }\n"
+        "    for (i = 0; i < 0; i++) { sum = sum + 100 / divisor; }\n"
+        "  }\n"
+        "  printf(\"%d\\n\", sum);\n"
+        "  return 0;\n"
+        "}\n" },
+};
+
+// The loop passes left out of -O2 for each build of a loop workload.
+struct LoopConfiguration {
+    const char* name;
+    const char* disabled;
+};
+static const LoopConfiguration kLoopConfigurations[] = {
+    { "no loop passes", "licm,strength-reduction,unroll" },
+    { "licm", "strength-reduction,unroll" },
+    { "strength-reduction", "licm,unroll" },
+    { "unroll", "licm,strength-reduction" },
+    { "-O2", "" },
+};
+
+// Builds generated loops at -O2 without the loop passes, with each one alone
+// and with all of them, and interprets each build: reports the instructions
+// and multiplies executed and whether every build printed what the VM prints.
+static void benchmarkLoops() {
+    const size_t count = sizeof(kLoopWorkloads) / sizeof(kLoopWorkloads[0]);
+    runWorkloads("loops", kLoopWorkloads, count, [](const Workload& workload, std::ostream& report) {
+        CompilationUnit unit(SourceBuffer::fromString(workload.text, workload.name));
+        if (!checkProgram(unit)) return false;
+        const std::string expected = vmOutput(unit);
+
+        bool agree = true;
+        for (const LoopConfiguration& configuration : kLoopConfigurations) {
+            IrModule module;
+            PassManager passes;
+            passes.setVerify(false);
+            passes.disableList(configuration.disabled);
+            passes.addList(PassManager::pipeline(2));
+            if (!IrBuilder(unit.tokens, unit.semantics).build(unit.program, module) || !passes.run(module)) {
+                report << " " << configuration.name << " failed";
+                agree = false;
+                continue;
+            }
+            IrInterpreter interpreter(module);
+            agree = agree && interpreterOutput(interpreter) == expected;
+            report << (&configuration == kLoopConfigurations ? "" : ";") << " " << configuration.name << " "
+                << interpreter.executedInstructions() << " executed, "
+                << interpreter.executedInstructions(IrOp::Mul) << " mul";
+        }
+        report << (agree ? " (outputs agree with the VM)" : ", outputs differ!");
+        return true;
+    });
+}
+
+// Builds the unit's IR, runs `passes` over it (which verify the IR unless
+// built with NDEBUG) and interprets it; returns what is wrong with the build,
+// or an empty string if it prints `expected`.
+static std::string checkBuild(const CompilationUnit& unit, PassManager& passes, const std::string& expected) {
+    IrModule module;
+    if (!IrBuilder(unit.tokens, unit.semantics).build(unit.program, module)) return "failed to build";
+    if (!passes.run(module)) return "failed: " + passes.error();
+    IrInterpreter interpreter(module);
+    return interpreterOutput(interpreter) == expected ? std::string() : "differs from the VM";
+}
+
+// Builds each of the `count` workloads `builds` times, the i-th time with the
+// passes configure(passes, i) adds (it returns the build's name), and checks
+// that every build prints what the VM prints; reports the workloads with a
+// build that does not. `checked` counts the builds.
+template <typename Configure>
+static bool checkWorkloads(const char* prefix, const Workload* workloads, size_t count, size_t builds,
+    Configure configure, size_t& checked) {
+    bool agree = true;
+    runWorkloads(prefix, workloads, count, [&](const Workload& workload, std::ostream& report) {
+        CompilationUnit unit(SourceBuffer::fromString(workload.text, workload.name));
+        if (!checkProgram(unit)) {
+            agree = false;
+            return false;
+        }
+        const std::string expected = vmOutput(unit);
+        bool workloadAgrees = true;
+        for (size_t i = 0; i < builds; ++i) {
+            PassManager passes;
+            const std::string build = configure(passes, i);
+            ++checked;
+            std::string problem = checkBuild(unit, passes, expected);
+            if (problem.empty()) continue;
+            report << (workloadAgrees ? "" : ";") << " " << build << " " << problem;
+            workloadAgrees = false;
+        }
+        agree = agree && workloadAgrees;
+        return !workloadAgrees;
+    });
+    return agree;
+}
+
+// Builds the optimizer workloads at -O0, -O1 and -O2 and the loop workloads
+// with every loop pass configuration, and checks each build against the VM.
+static bool checkOptimizer() {
+    size_t builds = 0;
+    bool agree = checkWorkloads("check-opt", kOptimizerWorkloads, sizeof(kOptimizerWorkloads) / sizeof(kOptimizerWorkloads[0]),
+        3, [](PassManager& passes, size_t level) {
+            passes.addList(PassManager::pipeline(static_cast<unsigned>(level)));
+            return "-O" + std::to_string(level);
+        }, builds);
+    const size_t configurations = sizeof(kLoopConfigurations) / sizeof(kLoopConfigurations[0]);
+    agree &= checkWorkloads("check-loops", kLoopWorkloads, sizeof(kLoopWorkloads) / sizeof(kLoopWorkloads[0]),
+        configurations, [](PassManager& passes, size_t i) {
+            passes.disableList(kLoopConfigurations[i].disabled);
+            passes.addList(PassManager::pipeline(2));
+            return std::string(kLoopConfigurations[i].name);
+        }, builds);
+    if (agree) std::cout << "Optimizer check passed: " << builds << " builds print what the VM prints." << std::endl;
+    return agree;
+}
+
+// Returns the index of the first token that differs between the two buffers
+// (in type, position, literal value or symbol), or the common size if none does.
+static size_t firstTokenMismatch(const TokenBuffer& a, const TokenBuffer& b) {
+    const size_t count = std::min(a.size(), b.size());
+    for (size_t i = 0; i < count; ++i) {
+        LiteralValue x = a.literal(i);
+        LiteralValue y = b.literal(i);
+        bool sameValue = x.kind == y.kind && (x.kind == LiteralValue::Kind::String
+            ? x.stringValue() == y.stringValue() : x.integer == y.integer);
+        if (a.type(i) != b.type(i) || a.offset(i) != b.offset(i) || a.length(i) != b.length(i) || !sameValue
+            || a.symbol(i) != b.symbol(i)) {
+            return i;
+        }
+    }
+    return count;
+}
+
+// Lexes the source with ParallelLexer at every power-of-two thread count up
+// to the core count (best of three rounds each), reports the throughput and
+// the scaling against the sequential Lexer, and checks every token stream
+// against the sequential one.
+static void benchmarkParallelLex(const std::shared_ptr<const SourceBuffer>& source, LexerMode mode) {
+    const double megabytes = source->size() / (1024.0 * 1024.0);
+    Diagnostics sequentialErrors;
+    TokenBuffer expected(source);
+    double sequentialMs = 0;
+    for (int round = 0; round < 3; ++round) {
+        Diagnostics errors;
+        Lexer lexer(source, mode);
+        lexer.setErrorSink(&errors);
+        Clock::time_point start = Clock::now();
+        TokenBuffer tokens = lexer.getAllTokens();
+        double ms = millisecondsSince(start);
+        if (round == 0 || ms < sequentialMs) sequentialMs = ms;
+        expected = std::move(tokens);
+        sequentialErrors = std::move(errors);
+    }
+    std::cerr << "lex: sequential: " << sequentialMs << " ms, " << (sequentialMs > 0 ? megabytes / sequentialMs * 1000.0 : 0.0)
+        << " MB/s, " << expected.size() << " tokens" << std::endl;
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1;; threads = std::min(cores, threads * 2)) {
+        double bestMs = 0;
+        unsigned chunks = 0;
+        unsigned resyncs = 0;
+        bool same = true;
+        for (int round = 0; round < 3; ++round) {
+            Diagnostics errors;
+            ParallelLexer lexer(source, mode);
+            lexer.setErrorSink(&errors);
+            Clock::time_point start = Clock::now();
+            TokenBuffer tokens = lexer.lexAll(threads);
+            double ms = millisecondsSince(start);
+            if (round == 0 || ms < bestMs) bestMs = ms;
+            chunks = lexer.chunkCount();
+            resyncs = lexer.resyncCount();
+            same = same && tokens.size() == expected.size() && firstTokenMismatch(tokens, expected) == tokens.size()
+                && errors.size() == sequentialErrors.size();
+        }
+        std::cerr << "lex: " << threads << (threads == 1 ? " thread:  " : " threads: ") << bestMs << " ms, "
+            << (bestMs > 0 ? megabytes / bestMs * 1000.0 : 0.0) << " MB/s, " << chunks << " chunks, "
+            << resyncs << " resynchronized, speedup " << (bestMs > 0 ? sequentialMs / bestMs : 0.0) << "x"
+            << (same ? "" : ", tokens differ from the sequential lexer!") << std::endl;
+        if (threads == cores) break;
+    }
+}
+
+// Parses the source with ParallelParser at every power-of-two thread count up
+// to the core count (best of three rounds each) and reports the scaling.
+static void benchmarkParallelParse(const std::shared_ptr<const SourceBuffer>& source, LexerMode mode) {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    double baseMs = 0;
+    for (unsigned threads = 1;; threads = std::min(cores, threads * 2)) {
+        double bestMs = 0;
+        size_t workers = 0;
+        size_t functions = 0;
+        bool fellBack = false;
+        for (int round = 0; round < 3; ++round) {
+            CompilationUnit unit(source);
+            Lexer lexer(source, mode);
+            lexer.setErrorSink(&unit.diagnostics);
+            unit.tokens = lexer.getAllTokens();
+            ParallelParser parser(unit);
+            Clock::time_point start = Clock::now();
+            unit.program = parser.parseProgram(threads);
+            double ms = millisecondsSince(start);
+            if (round == 0 || ms < bestMs) bestMs = ms;
+            workers = parser.workerCount();
+            functions = parser.functionCount();
+            fellBack = parser.fellBack();
+        }
+        if (threads == 1) baseMs = bestMs;
+        std::cerr << "parse: " << threads << (threads == 1 ? " thread:  " : " threads: ") << bestMs << " ms, "
+            << workers << " workers, " << functions << " functions"
+            << (fellBack ? " (fell back to sequential)" : "")
+            << ", speedup " << (bestMs > 0 ? baseMs / bestMs : 0.0) << "x" << std::endl;
+        if (threads == cores) break;
+    }
+}
+
+// Lexes the whole source with both lexer cores and reports the first
+// difference in their tokens or in the lexical errors they collect; the
+// errors themselves are printed once.
+static bool checkLexerModes(const std::shared_ptr<const SourceBuffer>& source) {
+    Diagnostics tableErrors;
+    Diagnostics referenceErrors;
+    Lexer table(source, LexerMode::Table);
+    Lexer reference(source, LexerMode::Reference);
+    table.setErrorSink(&tableErrors);
+    reference.setErrorSink(&referenceErrors);
+    for (size_t index = 0; ; ++index) {
+        Token a = table.getNextToken();
+        Token b = reference.getNextToken();
+        bool sameValue = a.value.kind == b.value.kind && (a.value.kind == LiteralValue::Kind::String
+            ? a.value.stringValue() == b.value.stringValue() : a.value.integer == b.value.integer);
+        if (a.type != b.type || a.lexeme != b.lexeme || a.offset != b.offset || !sameValue) {
+            std::cerr << "Lexer mismatch at token " << index << " (offset " << a.offset << "): table gave "
+                << tokenTypeToString(a.type) << " '" << a.lexeme << "', reference gave "
+                << tokenTypeToString(b.type) << " '" << b.lexeme << "'" << std::endl;
+            return false;
+        }
+        if (a.type == TokenType::END_OF_FILE) {
+            tableErrors.printAll(*source, std::cerr);
+            for (size_t i = 0; i < std::max(tableErrors.size(), referenceErrors.size()); ++i) {
+                const Diagnostic* x = i < tableErrors.size() ? &tableErrors.entries()[i] : nullptr;
+                const Diagnostic* y = i < referenceErrors.size() ? &referenceErrors.entries()[i] : nullptr;
+                if (x && y && x->offset == y->offset && x->message == y->message) continue;
+                std::cerr << "Lexer mismatch at error " << i << ": table gave "
+                    << (x ? "'" + x->message + "' at offset " + std::to_string(x->offset) : std::string("none"))
+                    << ", reference gave "
+                    << (y ? "'" + y->message + "' at offset " + std::to_string(y->offset) : std::string("none"))
+                    << std::endl;
+                return false;
+            }
+            std::cout << "Lexer check passed: " << index + 1 << " identical tokens";
+            if (!tableErrors.empty()) std::cout << " and " << tableErrors.size() << " identical errors";
+            std::cout << "." << std::endl;
+            return true;
+        }
+    }
+}
+
+// Applies `edit` with IncrementalLexer and compares the result with lexing
+// the edited text from scratch; returns the edited source and its tokens.
+static bool checkRelex(const char* name, std::shared_ptr<const SourceBuffer>& source, TokenBuffer& tokens,
+                       LexerMode mode, uint32_t offset, uint32_t removedLength, std::string_view inserted) {
+    TextEdit edit;
+    std::shared_ptr<const SourceBuffer> edited = IncrementalLexer::applyEdit(*source, offset, removedLength, inserted, &edit);
+    IncrementalLexer incremental(mode);
+    TokenBuffer relexed = incremental.relex(tokens, edited, edit);
+    Diagnostics errors;
+    Lexer full(edited, mode);
+    full.setErrorSink(&errors);
+    TokenBuffer expected = full.getAllTokens();
+    const size_t mismatch = firstTokenMismatch(relexed, expected);
+    if (mismatch != relexed.size() || relexed.size() != expected.size()) {
+        std::cerr << "Relex mismatch in " << name << " after removing " << removedLength << " bytes at offset "
+            << offset << " and inserting " << inserted.size() << ": token " << mismatch << " of "
+            << relexed.size() << " (a full lex gives " << expected.size() << ")" << std::endl;
+        return false;
+    }
+    source = std::move(edited);
+    tokens = std::move(relexed);
+    return true;
+}
+
+// Checks IncrementalLexer against a full re-lex: first on fixed cases (such
+// as deleting far more text than the tokens around it cover), then after
+// each of `edits` random edits to the input, every edit applied to the
+// result of the previous one. The inserted fragments open and close strings
+// and comments, so edits also change how much of the text is re-lexed.
+static bool checkIncrementalLexer(std::shared_ptr<const SourceBuffer> source, LexerMode mode, unsigned edits) {
+    static const char* const kFragments[] = {
+        "", " ", "\n", "x", "int y = 2;", "\"", "'", "/*", "*/", "//", "\"abc\"", "'c'", "1.5e3", "@", "return 0;",
+    };
+    struct FixedCase {
+        const char* name;
+        std::string text;
+        uint32_t offset;
+        uint32_t removedLength; // Clamped to the end of the text
+        const char* inserted;
+    };
+    const FixedCase fixedCases[] = {
+        { "a long string deleted", "x = \"" + std::string(2000, 'a') + "\";", 4, 2000, "" },
+        { "everything deleted", "int main() { return \"" + std::string(500, 'b') + "\"; }", 0, ~0u, "" },
+        { "a comment opened", "int a; int b; int c;", 6, 0, "/*" },
+    };
+    for (const FixedCase& fixed : fixedCases) {
+        std::shared_ptr<const SourceBuffer> text = SourceBuffer::fromString(fixed.text, fixed.name);
+        Diagnostics errors;
+        Lexer lexer(text, mode);
+        lexer.setErrorSink(&errors);
+        TokenBuffer tokens = lexer.getAllTokens();
+        const uint32_t removedLength = std::min<uint32_t>(fixed.removedLength, static_cast<uint32_t>(text->size()) - fixed.offset);
+        if (!checkRelex(fixed.name, text, tokens, mode, fixed.offset, removedLength, fixed.inserted)) return false;
+    }
+
+    Diagnostics errors;
+    Lexer lexer(source, mode);
+    lexer.setErrorSink(&errors);
+    TokenBuffer tokens = lexer.getAllTokens();
+    std::mt19937 random(12345);
+    const size_t fragmentCount = sizeof(kFragments) / sizeof(kFragments[0]);
+    for (unsigned i = 0; i < edits; ++i) {
+        const uint32_t size = static_cast<uint32_t>(source->size());
+        const uint32_t offset = static_cast<uint32_t>(random() % (size + 1));
+        const uint32_t removedLength = std::min<uint32_t>(size - offset, random() % 3 ? random() % 8 : random() % 200);
+        if (!checkRelex("the input", source, tokens, mode, offset, removedLength,
+                        kFragments[random() % fragmentCount])) {
+            return false;
+        }
+    }
+    std::cout << "Relex check passed: " << sizeof(fixedCases) / sizeof(fixedCases[0]) << " fixed cases and "
+        << edits << " random edits." << std::endl;
+    return true;
+}
 
 int main(int argc, char* argv[]) {
-    std::string sourceCode;
-    std::string inputFileName = "stdin";
+    std::string inputFileName;
+    bool dumpSource = false;
+    bool checkLexer = false;
+    unsigned relexEdits = 0;
+    bool streaming = false;
+    bool reportTime = false;
+    bool astStats = false;
+    unsigned benchRounds = 0;
+    unsigned benchTerms = 0;
+    unsigned benchBlocks = 0;
+    unsigned lexThreads = 1;
+    unsigned parseThreads = 1;
+    bool benchParseThreads = false;
+    bool benchLexThreads = false;
+    bool benchKeywords = false;
+    bool benchVm = false;
+    bool benchOptimizer = false;
+    bool benchLoops = false;
+    bool checkOptimizations = false;
+    bool runIr = false;
+    bool runProgram = false;
+    bool dumpBytecode = false;
+    bool dumpIr = false;
+    bool timePasses = false;
+    std::string passList;
+    bool passListGiven = false;
+    std::string disabledPasses;
+    unsigned optimizationLevel = 0;
+    bool optimizationLevelGiven = false;
+    Vm::Dispatch vmDispatch = Vm::Dispatch::Threaded;
+    bool printTree = true;
+    bool astFormatGiven = false;
+    AstFormat astFormat = AstFormat::Text;
+    std::string cacheDirectory;
+    LexerMode lexerMode = LexerMode::Table;
 
-    if (argc >= 2) {
-        inputFileName = argv[1];
-        std::ifstream file(inputFileName);
-        if (!file.is_open()) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--dump-source") == 0) {
+            dumpSource = true;
+        }
+        else if (std::strcmp(argv[i], "--lexer=table") == 0) {
+            lexerMode = LexerMode::Table;
+        }
+        else if (std::strcmp(argv[i], "--lexer=reference") == 0) {
+            lexerMode = LexerMode::Reference;
+        }
+        else if (std::strcmp(argv[i], "--check-lexer") == 0) {
+            checkLexer = true;
+        }
+        else if (std::strcmp(argv[i], "--check-relex") == 0) {
+            relexEdits = 2000;
+        }
+        else if (std::strncmp(argv[i], "--check-relex=", 14) == 0) {
+            relexEdits = static_cast<unsigned>(std::strtoul(argv[i] + 14, nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--streaming") == 0) {
+            streaming = true;
+        }
+        else if (std::strncmp(argv[i], "--lex-threads=", 14) == 0) {
+            lexThreads = static_cast<unsigned>(std::strtoul(argv[i] + 14, nullptr, 10));
+        }
+        else if (std::strncmp(argv[i], "--parse-threads=", 16) == 0) {
+            parseThreads = static_cast<unsigned>(std::strtoul(argv[i] + 16, nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--bench-lex-threads") == 0) {
+            benchLexThreads = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-parse-threads") == 0) {
+            benchParseThreads = true;
+        }
+        else if (std::strcmp(argv[i], "--ast-format=text") == 0) {
+            astFormat = AstFormat::Text;
+            printTree = true;
+            astFormatGiven = true;
+        }
+        else if (std::strcmp(argv[i], "--ast-format=json") == 0) {
+            astFormat = AstFormat::Json;
+            printTree = true;
+            astFormatGiven = true;
+        }
+        else if (std::strcmp(argv[i], "--ast-format=none") == 0) {
+            printTree = false;
+            astFormatGiven = true;
+        }
+        else if (std::strncmp(argv[i], "--ast-cache=", 12) == 0) {
+            cacheDirectory = argv[i] + 12;
+        }
+        else if (std::strcmp(argv[i], "--run") == 0) {
+            runProgram = true;
+        }
+        else if (std::strcmp(argv[i], "--dump-bytecode") == 0) {
+            dumpBytecode = true;
+        }
+        else if (std::strcmp(argv[i], "--dump-ir") == 0) {
+            dumpIr = true;
+        }
+        else if (std::strncmp(argv[i], "--passes=", 9) == 0) {
+            passList = argv[i] + 9;
+            passListGiven = true;
+        }
+        else if (std::strncmp(argv[i], "--disable-passes=", 17) == 0) {
+            disabledPasses = argv[i] + 17;
+        }
+        else if (std::strcmp(argv[i], "-O0") == 0 || std::strcmp(argv[i], "-O1") == 0 || std::strcmp(argv[i], "-O2") == 0) {
+            optimizationLevel = static_cast<unsigned>(argv[i][2] - '0');
+            optimizationLevelGiven = true;
+        }
+        else if (std::strcmp(argv[i], "--run-ir") == 0) {
+            runIr = true;
+        }
+        else if (std::strcmp(argv[i], "--time-passes") == 0) {
+            timePasses = true;
+        }
+        else if (std::strcmp(argv[i], "--vm-dispatch=threaded") == 0) {
+            vmDispatch = Vm::Dispatch::Threaded;
+        }
+        else if (std::strcmp(argv[i], "--vm-dispatch=switch") == 0) {
+            vmDispatch = Vm::Dispatch::Switch;
+        }
+        else if (std::strcmp(argv[i], "--bench-vm") == 0) {
+            benchVm = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-opt") == 0) {
+            benchOptimizer = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-loops") == 0) {
+            benchLoops = true;
+        }
+        else if (std::strcmp(argv[i], "--check-opt") == 0) {
+            checkOptimizations = true;
+        }
+        else if (std::strcmp(argv[i], "--time") == 0) {
+            reportTime = true;
+        }
+        else if (std::strcmp(argv[i], "--ast-stats") == 0) {
+            astStats = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-expressions") == 0) {
+            benchTerms = 100000;
+        }
+        else if (std::strncmp(argv[i], "--bench-expressions=", 20) == 0) {
+            benchTerms = static_cast<unsigned>(std::strtoul(argv[i] + 20, nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--bench-semantic") == 0) {
+            benchBlocks = 5000;
+        }
+        else if (std::strncmp(argv[i], "--bench-semantic=", 17) == 0) {
+            benchBlocks = static_cast<unsigned>(std::strtoul(argv[i] + 17, nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--bench-keywords") == 0) {
+            benchKeywords = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-visitors") == 0) {
+            benchRounds = 100;
+        }
+        else if (std::strncmp(argv[i], "--bench-visitors=", 17) == 0) {
+            benchRounds = static_cast<unsigned>(std::strtoul(argv[i] + 17, nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        else {
+            inputFileName = argv[i];
+        }
+    }
+
+    if (benchKeywords) {
+        benchmarkKeywords();
+        return 0;
+    }
+    if (benchTerms) {
+        benchmarkExpressions(benchTerms);
+        return 0;
+    }
+    if (benchBlocks) {
+        benchmarkSemantics(benchBlocks);
+        return 0;
+    }
+    if (benchVm) {
+        benchmarkVm();
+        return 0;
+    }
+    if (benchOptimizer) {
+        benchmarkOptimizer();
+        return 0;
+    }
+    if (benchLoops) {
+        benchmarkLoops();
+        return 0;
+    }
+    if (checkOptimizations) {
+        return checkOptimizer() ? 0 : 1;
+    }
+    if (!passListGiven) passList = PassManager::pipeline(optimizationLevel);
+    // When generating code (or running it) the tree is only printed on request.
+    const bool buildIr = dumpIr || timePasses || passListGiven || optimizationLevelGiven || runIr
+        || !disabledPasses.empty();
+    const bool generatesCode = runProgram || dumpBytecode || buildIr;
+    if (generatesCode && !astFormatGiven) printTree = false;
+
+    std::shared_ptr<const SourceBuffer> source;
+    if (inputFileName == "-") {
+        source = SourceBuffer::fromStream(stdin, "stdin");
+        if (!source) {
+            std::cerr << "Error: Could not read from stdin" << std::endl;
+            return 1;
+        }
+    }
+    else if (!inputFileName.empty()) {
+        source = SourceBuffer::fromFile(inputFileName);
+        if (!source) {
             std::cerr << "Error: Could not open file " << inputFileName << std::endl;
             return 1;
         }
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        sourceCode = buffer.str();
-        file.close();
     }
     else {
         std::cout << "No input file provided. Using a default test string for V0.1 Parser.\n";
-        sourceCode = "int main() {\n"
+        source = SourceBuffer::fromString("int main() {\n"
             "  return 123;\n"
             // "  return 456;\n" // Can add more return statements
-            "}\n";
-        inputFileName = "default test string (Parser V0.1)";
+            "}\n", "default test string (Parser V0.1)");
     }
 
-    if (sourceCode.empty()) {
+    if (source->empty()) {
         std::cerr << "Error: No source code to parse." << std::endl;
         return 1;
     }
 
-    std::cout << "Source Code from: " << inputFileName << "\n--- Start --- \n" << sourceCode << "\n--- End ---" << std::endl;
+    if (dumpSource) {
+        std::cout << "Source Code from: " << source->name() << "\n--- Start --- \n" << source->text() << "\n--- End ---" << std::endl;
+    }
 
-    Lexer lexer(sourceCode);
-    Parser parser(lexer);
+    if (checkLexer) {
+        return checkLexerModes(source) ? 0 : 1;
+    }
+    if (relexEdits) {
+        return checkIncrementalLexer(source, lexerMode, relexEdits) ? 0 : 1;
+    }
+    if (benchLexThreads) {
+        benchmarkParallelLex(source, lexerMode);
+        return 0;
+    }
+    if (benchParseThreads) {
+        benchmarkParallelParse(source, lexerMode);
+        return 0;
+    }
 
-    try {
-        std::cout << "\nParsing program..." << std::endl;
-        std::unique_ptr<ProgramNode> astRoot = parser.parseProgram();
-        std::cout << "Parsing successful!" << std::endl;
+    Lexer lexer(source, lexerMode);
+    CompilationUnit unit(source);
+    TokenBuffer& tokens = unit.tokens;
+    lexer.setErrorSink(&unit.diagnostics);
 
-        if (astRoot) {
-            std::cout << "\n--- Abstract Syntax Tree ---" << std::endl;
-            astRoot->print(0);
-            std::cout << "--- End of AST ---" << std::endl;
+    // A cache hit provides the tokens and the tree; lexing and parsing are skipped.
+    AstCache cache(cacheDirectory);
+    uint64_t sourceHash = 0;
+    bool cached = false;
+    if (!cacheDirectory.empty()) {
+        Clock::time_point cacheStart = Clock::now();
+        sourceHash = AstCache::hash(source->text());
+        cached = cache.load(unit, sourceHash);
+        if (!cached && !cache.lastError().empty()) {
+            std::cerr << "Warning: Ignoring AST cache entry: " << cache.lastError() << std::endl;
         }
-        else {
-            std::cout << "AST parsing resulted in a null root." << std::endl;
+        if (reportTime) {
+            std::cerr << "cache: " << (cached ? "hit" : "miss") << " in " << millisecondsSince(cacheStart) << " ms" << std::endl;
         }
+    }
 
+    if (!streaming && !cached) {
+        Clock::time_point lexStart = Clock::now();
+        if (lexThreads == 1) {
+            tokens = lexer.getAllTokens();
+        }
+        else {
+            ParallelLexer parallelLexer(source, lexerMode);
+            parallelLexer.setErrorSink(&unit.diagnostics);
+            tokens = parallelLexer.lexAll(lexThreads);
+            if (reportTime) {
+                std::cerr << "lex: " << parallelLexer.chunkCount() << " chunks, "
+                    << parallelLexer.resyncCount() << " resynchronized" << std::endl;
+            }
+        }
+        if (reportTime) {
+            std::cerr << "lex: " << tokens.size() << " tokens in " << millisecondsSince(lexStart) << " ms" << std::endl;
+        }
     }
-    catch (const ParseError& e) {
-        std::cerr << "Parser Error: " << e.what() << std::endl;
-        // Optionally print the token queue if you want to debug
-        return 1;
+    // All further stdout output goes through `out`; the banners around the text
+    // dump are left out of JSON output so tools can read stdout as is. Each banner
+    // is flushed at once so it still precedes what the next phase says on stderr.
+    OutputBuffer out(stdout);
+    bool banners = !generatesCode && (!printTree || astFormat == AstFormat::Text);
+    try {
+        if (banners) {
+            out << "\nParsing program...\n";
+            out.flush();
+        }
+        Clock::time_point parseStart = Clock::now();
+        if (cached) {
+            // The entry holds the tree already.
+        }
+        else if (streaming) {
+            unit.program = Parser(lexer, tokens, unit.astArena, unit.diagnostics).parseProgram();
+        }
+        else if (parseThreads == 1) {
+            unit.program = Parser(tokens, unit.astArena, unit.diagnostics).parseProgram();
+        }
+        else {
+            ParallelParser parallelParser(unit);
+            unit.program = parallelParser.parseProgram(parseThreads);
+            if (reportTime) {
+                std::cerr << "parse: " << parallelParser.functionCount() << " functions on "
+                    << parallelParser.workerCount() << " workers"
+                    << (parallelParser.fellBack() ? " (fell back to sequential)" : "") << std::endl;
+            }
+        }
+        ProgramNode* astRoot = unit.program;
+        if (reportTime) {
+            std::cerr << "parse: " << millisecondsSince(parseStart) << " ms" << std::endl;
+        }
+        if (unit.diagnostics.empty()) {
+            if (!cacheDirectory.empty() && !cached && !cache.store(unit, sourceHash)) {
+                std::cerr << "Warning: Could not update the AST cache: " << cache.lastError() << std::endl;
+            }
+            Clock::time_point checkStart = Clock::now();
+            SemanticAnalyzer(tokens, unit.diagnostics, unit.semantics).analyze(astRoot);
+            if (reportTime) {
+                std::cerr << "check: " << millisecondsSince(checkStart) << " ms" << std::endl;
+            }
+        }
+        if (!unit.diagnostics.empty()) {
+            unit.diagnostics.printAll(*source, std::cerr);
+            std::cerr << unit.diagnostics.size() << (unit.diagnostics.size() == 1 ? " error" : " errors")
+                << " generated." << std::endl;
+            return 1;
+        }
+        if (astStats) {
+            const Arena& arena = unit.astArena;
+            std::cerr << "ast: " << arena.allocationCount() << " allocations, " << arena.bytesUsed()
+                << " bytes used, " << arena.bytesReserved() << " bytes reserved in "
+                << arena.chunkCount() << " chunks" << std::endl;
+            for (size_t i = 0; i < unit.workerArenas.size(); ++i) {
+                const Arena& worker = unit.workerArenas[i];
+                std::cerr << "ast: worker " << i << ": " << worker.allocationCount() << " allocations, "
+                    << worker.bytesUsed() << " bytes used, " << worker.bytesReserved() << " bytes reserved" << std::endl;
+            }
+            std::cerr << "ast: node sizes:";
+#define AST_NODE_SIZE(Name) std::cerr << (NodeKind::Name == NodeKind{} ? " " : ", ") << #Name "Node " << sizeof(Name##Node);
+            AST_NODE_LIST(AST_NODE_SIZE)
+#undef AST_NODE_SIZE
+            std::cerr << " (Token " << sizeof(Token) << ")" << std::endl;
+            const Interner& interner = Interner::global();
+            std::cerr << "symbols: " << interner.size() << " distinct identifiers, "
+                << interner.bytesUsed() << " bytes of names" << std::endl;
+        }
+        if (banners) {
+            out << "Parsing successful!\n";
+            out.flush();
+        }
+        if (benchRounds) {
+            benchmarkVisitors(astRoot, benchRounds);
+        }
+
+        if (printTree) {
+            Clock::time_point printStart = Clock::now();
+            if (astFormat == AstFormat::Json) {
+                printAst(astRoot, tokens, out, AstFormat::Json);
+                out << '\n';
+            }
+            else {
+                out << "\n--- Abstract Syntax Tree ---\n";
+                printAst(astRoot, tokens, out);
+                out << "--- End of AST ---\n";
+            }
+            out.flush();
+            if (reportTime) {
+                std::cerr << "print: " << millisecondsSince(printStart) << " ms in "
+                    << out.writeCount() << " writes" << std::endl;
+            }
+        }
+
+        if (buildIr) {
+            PassManager passes;
+            if (!passes.disableList(disabledPasses) || !passes.addList(passList)) {
+                std::cerr << "Error: " << passes.error() << "; available passes:\n";
+                PassManager::listPasses(std::cerr);
+                return 1;
+            }
+            Clock::time_point buildStart = Clock::now();
+            IrModule module;
+            IrBuilder builder(tokens, unit.semantics);
+            if (!builder.build(astRoot, module)) {
+                out.flush();
+                std::cerr << "Error: " << builder.error() << std::endl;
+                return 1;
+            }
+            passes.recordStep("build-ssa", millisecondsSince(buildStart), 0, module.instructionCount());
+            bool valid = passes.run(module);
+            if (timePasses) passes.report(std::cerr);
+            if (!valid) {
+                out.flush();
+                std::cerr << "Internal Error: " << passes.error() << std::endl;
+                return 1;
+            }
+            if (dumpIr) printIr(module, out);
+            out.flush();
+            if (runIr) {
+                IrInterpreter interpreter(module);
+                Clock::time_point runStart = Clock::now();
+                bool ok = interpreter.run();
+                std::fflush(stdout);
+                if (reportTime || timePasses) {
+                    std::cerr << "run-ir: " << interpreter.executedInstructions() << " instructions and "
+                        << interpreter.executedCalls() << " calls executed in " << millisecondsSince(runStart) << " ms" << std::endl;
+                }
+                if (!ok) {
+                    int line = 0;
+                    int column = 0;
+                    source->locate(interpreter.errorOffset(), line, column);
+                    std::cerr << "Runtime Error: " << interpreter.errorMessage() << " at line " << line << " col " << column << std::endl;
+                    return 1;
+                }
+                if (!runProgram && !dumpBytecode) return interpreter.exitStatus();
+            }
+        }
+
+        if (runProgram || dumpBytecode) {
+            Clock::time_point compileStart = Clock::now();
+            BytecodeProgram program;
+            BytecodeCompiler compiler(tokens, unit.semantics);
+            if (!compiler.compile(astRoot, program)) {
+                out.flush();
+                std::cerr << "Error: " << compiler.error() << std::endl;
+                return 1;
+            }
+            if (reportTime) {
+                std::cerr << "compile: " << program.code.size() << " words of bytecode in "
+                    << millisecondsSince(compileStart) << " ms" << std::endl;
+            }
+            if (dumpBytecode) program.disassemble(out);
+            out.flush();
+            if (runProgram) {
+                // The program writes to stdout through stdio, after everything above.
+                Vm vm(program, vmDispatch);
+                Clock::time_point runStart = Clock::now();
+                bool ok = vm.run();
+                std::fflush(stdout);
+                if (reportTime) {
+                    std::cerr << "run: " << millisecondsSince(runStart) << " ms ("
+                        << (vm.dispatch() == Vm::Dispatch::Threaded ? "threaded" : "switch") << " dispatch)" << std::endl;
+                }
+                if (!ok) {
+                    int line = 0;
+                    int column = 0;
+                    source->locate(vm.errorOffset(), line, column);
+                    std::cerr << "Runtime Error: " << vm.errorMessage() << " at line " << line << " col " << column << std::endl;
+                    return 1;
+                }
+                return vm.exitStatus();
+            }
+        }
+
     }
     catch (const std::exception& e) {
         std::cerr << "Standard Exception: " << e.what() << std::endl;
@@ -68,4 +1302,4 @@ int main(int argc, char* argv[]) {
     }
 
     return 0;
-}
\ No newline at end of file
+}